@@ -0,0 +1,899 @@
+#include <sys/cdefs.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "cycpdb.h"
+#include "math.h"
+
+#include "debug.h"
+
+/* Number of entries a worker claims at a time */
+#define ATLAS_CHUNK_SIZE        4096
+
+#define ATLAS_MAGIC             "VCPA"
+#define ATLAS_VERSION           1
+
+struct atlas_header {
+        char magic[4];
+        uint16_t version;
+        uint16_t class_count;
+        uint32_t entry_count;
+};
+
+struct atlas_job {
+        struct atlas *atlas;
+
+        /* Index of the next entry to be claimed by a worker */
+        _Atomic uint32_t cursor;
+};
+
+struct atlas_cycpdb_job {
+        const struct atlas *atlas;
+
+        /* Number of feasible entries preceding each chunk */
+        const uint32_t *chunk_ranks;
+        /* Cycle patterns of each feasible entry, in rank order */
+        union vram_cycp *solutions;
+
+        /* Index of the next chunk to be claimed by a worker */
+        _Atomic uint32_t cursor;
+};
+
+static void atlas_unrank(uint32_t, uint32_t, uint32_t *);
+
+static int32_t atlas_class_add(struct atlas *, const struct scrn_format *);
+static uint8_t atlas_entry_solve(const struct atlas *, uint32_t);
+static void *atlas_worker(void *);
+static void *atlas_cycpdb_worker(void *);
+static int atlas_cycpdb_word_compare(const void *, const void *);
+
+/*-
+ * Initialize the atlas ATLAS by enumerating every scroll screen class.
+ *
+ * Every combination of format type, character color count, reduction,
+ * and bank of the pattern name and character pattern data is considered,
+ * and those that demand the same access timings from the same banks are
+ * merged into one class. Combinations rejected by the access timing
+ * tables are not part of any class.
+ *
+ * Each combination is represented by a format of 1x1 planes of 1x1
+ * cells, or by a 512x256 bitmap, that stores each kind of data in a
+ * single bank. Vertical cell scroll, data spanning several banks, and
+ * the rotational backgrounds are not enumerated, as the classes they add
+ * would not fit ATLAS_CLASS_COUNT_MAX. See struct atlas_class for the
+ * scenes covered.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 ATLAS is NULL
+ *   - -2 Entries could not be allocated
+ */
+int32_t
+atlas_init(struct atlas *atlas)
+{
+        if (atlas == NULL) {
+                return -1;
+        }
+
+        memset(atlas, 0x00, sizeof(*atlas));
+
+        /* The first class is that of a disabled scroll screen */
+        atlas->class_count = 1;
+
+        uint8_t type;
+        for (type = SCRN_TYPE_CELL; type <= SCRN_TYPE_BITMAP; type++) {
+                uint8_t cc_count;
+                for (cc_count = SCRN_CCC_PALETTE_16; cc_count <= SCRN_CCC_RGB_16770000; cc_count++) {
+                        uint8_t reduction;
+                        for (reduction = SCRN_REDUCTION_NONE; reduction <= SCRN_REDUCTION_QUARTER; reduction++) {
+                                uint32_t pnd_bank;
+                                for (pnd_bank = 0; pnd_bank < VRAM_BANK_COUNT; pnd_bank++) {
+                                        uint32_t cpd_bank;
+                                        for (cpd_bank = 0; cpd_bank < VRAM_BANK_COUNT; cpd_bank++) {
+                                                struct scrn_format format;
+
+                                                memset(&format, 0x00, sizeof(format));
+
+                                                format.sf_enable = true;
+                                                format.sf_scroll_screen = SCRN_NBG0;
+                                                format.sf_type = type;
+                                                format.sf_cc_count = cc_count;
+                                                format.sf_reduction = reduction;
+
+                                                if (type == SCRN_TYPE_CELL) {
+                                                        struct scrn_cell_format *cell_format;
+                                                        cell_format = &format.sf_format.cell;
+
+                                                        cell_format->scf_character_size = 1 * 1;
+                                                        cell_format->scf_pnd_size = 1;
+                                                        cell_format->scf_plane_size = 1 * 1;
+                                                        cell_format->scf_cp_table = VRAM_ADDR_4MBIT(cpd_bank, 0);
+                                                        cell_format->scf_color_palette = 0x25F00000;
+
+                                                        uint32_t i;
+                                                        for (i = 0; i < 4; i++) {
+                                                                cell_format->scf_map.planes[i] =
+                                                                    VRAM_ADDR_4MBIT(pnd_bank, 0);
+                                                        }
+                                                } else {
+                                                        struct scrn_bitmap_format *bitmap_format;
+                                                        bitmap_format = &format.sf_format.bitmap;
+
+                                                        /* Bitmap formats have no pattern name data */
+                                                        if (pnd_bank != 0) {
+                                                                continue;
+                                                        }
+
+                                                        bitmap_format->sbf_bitmap_size.width = 512;
+                                                        bitmap_format->sbf_bitmap_size.height = 256;
+                                                        bitmap_format->sbf_bitmap_pattern = VRAM_ADDR_4MBIT(cpd_bank, 0);
+                                                        bitmap_format->sbf_color_palette = 0x25F00000;
+                                                }
+
+                                                if ((atlas_class_add(atlas, &format)) < 0) {
+                                                        return -2;
+                                                }
+                                        }
+                                }
+                        }
+                }
+        }
+
+        uint32_t entry_count;
+        entry_count = binomial(atlas->class_count + 3, 4) * ATLAS_SPLIT_COUNT;
+
+        atlas->entries = malloc(entry_count);
+
+        if (atlas->entries == NULL) {
+                return -2;
+        }
+
+        memset(atlas->entries, 0x00, entry_count);
+
+        atlas->entry_count = entry_count;
+
+        DEBUG_PRINTF("class_count: %u, entry_count: %u\n", atlas->class_count,
+            atlas->entry_count);
+
+        return 0;
+}
+
+void
+atlas_deinit(struct atlas *atlas)
+{
+        if (atlas == NULL) {
+                return;
+        }
+
+        free(atlas->entries);
+
+        atlas->entries = NULL;
+        atlas->entry_count = 0;
+}
+
+/*-
+ * Solve every entry of the atlas ATLAS using THREAD_COUNT threads.
+ *
+ * Each thread claims chunks of consecutive entries from a shared cursor
+ * until none remain, so threads that are handed cheap entries (mostly
+ * infeasible ones) simply claim more chunks.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 ATLAS is NULL or not initialized
+ *   - -2 Threads could not be allocated
+ */
+int32_t
+atlas_build(struct atlas *atlas, uint32_t thread_count)
+{
+        if ((atlas == NULL) || (atlas->entries == NULL)) {
+                return -1;
+        }
+
+        if (thread_count == 0) {
+                thread_count = 1;
+        }
+
+        struct atlas_job job;
+
+        job.atlas = atlas;
+        atomic_init(&job.cursor, 0);
+
+        pthread_t *threads;
+        threads = malloc(thread_count * sizeof(pthread_t));
+
+        if (threads == NULL) {
+                return -2;
+        }
+
+        uint32_t i;
+        for (i = 0; i < thread_count; i++) {
+                if ((pthread_create(&threads[i], NULL, atlas_worker, &job)) != 0) {
+                        break;
+                }
+        }
+
+        /* Even if a thread could not be created, the threads that were
+         * created finish the job */
+        if (i == 0) {
+                (void)atlas_worker(&job);
+        }
+
+        uint32_t j;
+        for (j = 0; j < i; j++) {
+                (void)pthread_join(threads[j], NULL);
+        }
+
+        free(threads);
+
+        return 0;
+}
+
+/*-
+ * Look up the NBGs of STATE in the atlas ATLAS, and write the atlas entry
+ * to ENTRY.
+ *
+ * Scroll screen formats rejected by the access timing tables are looked
+ * up by calling vdp2cycp() directly, as it fails before allocating any
+ * access timings.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 ATLAS, STATE, or ENTRY is NULL
+ *   - -2 STATE is not covered by the atlas (a rotational background or
+ *        vertical cell scroll is used, an NBG does not fit any class, or
+ *        the TV screen mode halves the access timings)
+ */
+int32_t
+atlas_lookup(const struct atlas *atlas, const struct state *state, uint8_t *entry)
+{
+        if ((atlas == NULL) || (state == NULL) || (entry == NULL)) {
+                return -1;
+        }
+
+        if (atlas->entries == NULL) {
+                return -1;
+        }
+
+        /* The atlas only covers the normal TV screen modes */
+        if (TVMD_TIMINGS_HALVED(state->tvmd)) {
+                return -2;
+        }
+
+        uint32_t classes[4];
+
+        int32_t ret;
+        ret = atlas_classes_get(atlas->classes, atlas->class_count, state, classes);
+
+        if (ret == -1) {
+                struct state state_copy;
+
+                (void)memcpy(&state_copy, state, sizeof(state_copy));
+
+                /* vdp2cycp() writes the access timings of each scroll
+                 * screen through these, so they must not point into
+                 * STATE */
+                state_copy.scroll_screens[0] = &state_copy.nbg0;
+                state_copy.scroll_screens[1] = &state_copy.nbg1;
+                state_copy.scroll_screens[2] = &state_copy.nbg2;
+                state_copy.scroll_screens[3] = &state_copy.nbg3;
+                state_copy.scroll_screens[4] = &state_copy.rbg0;
+                state_copy.scroll_screens[5] = &state_copy.rbg1;
+
+                *entry = -vdp2cycp(&state_copy);
+
+                return 0;
+        }
+
+        if (ret < 0) {
+                return -2;
+        }
+
+        uint32_t index;
+        index = atlas_index_get(classes, state->ramctl);
+
+        if (index >= atlas->entry_count) {
+                return -2;
+        }
+
+        *entry = atlas->entries[index];
+
+        return 0;
+}
+
+/*-
+ * Initialize STATE with the scene of the entry at INDEX of the atlas
+ * ATLAS.
+ *
+ * The classes of the scene are assigned to NBG0 through NBG3 in
+ * ascending order.
+ */
+void
+atlas_state_init(const struct atlas *atlas, uint32_t index, struct state *state)
+{
+        uint32_t classes[4];
+
+        atlas_unrank(index / ATLAS_SPLIT_COUNT, atlas->class_count, classes);
+
+        struct scrn_format scene_formats[4];
+        const struct scrn_format *formats[SCRN_COUNT + 1];
+
+        uint32_t format_count;
+        format_count = 0;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                if (classes[scrn] == 0) {
+                        continue;
+                }
+
+                scene_formats[format_count] = atlas->formats[classes[scrn]];
+                scene_formats[format_count].sf_scroll_screen = scrn;
+
+                formats[format_count] = &scene_formats[format_count];
+                format_count++;
+        }
+
+        formats[format_count] = NULL;
+
+        state_init(state, formats);
+
+        state->ramctl = (index % ATLAS_SPLIT_COUNT) << 8;
+}
+
+/*-
+ * Write the atlas ATLAS to the file PATH.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 ATLAS or PATH is NULL
+ *   - -2 File could not be written
+ */
+int32_t
+atlas_write(const struct atlas *atlas, const char *path)
+{
+        if ((atlas == NULL) || (path == NULL)) {
+                return -1;
+        }
+
+        FILE *fp;
+        fp = fopen(path, "wb");
+
+        if (fp == NULL) {
+                return -2;
+        }
+
+        struct atlas_header header;
+
+        memset(&header, 0x00, sizeof(header));
+
+        (void)memcpy(header.magic, ATLAS_MAGIC, sizeof(header.magic));
+        header.version = ATLAS_VERSION;
+        header.class_count = atlas->class_count;
+        header.entry_count = atlas->entry_count;
+
+        bool written;
+        written = ((fwrite(&header, sizeof(header), 1, fp)) == 1) &&
+            ((fwrite(atlas->classes, sizeof(struct atlas_class), atlas->class_count, fp)) == atlas->class_count) &&
+            ((fwrite(atlas->entries, 1, atlas->entry_count, fp)) == atlas->entry_count);
+
+        if ((fclose(fp)) != 0) {
+                written = false;
+        }
+
+        return written ? 0 : -2;
+}
+
+/*-
+ * Read the atlas ATLAS from the file PATH.
+ *
+ * Only the classes and entries are read, so the atlas can be looked up
+ * but not rebuilt.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 ATLAS or PATH is NULL
+ *   - -2 File could not be read
+ *   - -3 File is not a valid atlas
+ */
+int32_t
+atlas_read(struct atlas *atlas, const char *path)
+{
+        if ((atlas == NULL) || (path == NULL)) {
+                return -1;
+        }
+
+        memset(atlas, 0x00, sizeof(*atlas));
+
+        FILE *fp;
+        fp = fopen(path, "rb");
+
+        if (fp == NULL) {
+                return -2;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        struct atlas_header header;
+
+        if ((fread(&header, sizeof(header), 1, fp)) != 1) {
+                ret = -2;
+                goto exit;
+        }
+
+        if (((memcmp(header.magic, ATLAS_MAGIC, sizeof(header.magic))) != 0) ||
+            (header.version != ATLAS_VERSION) ||
+            (header.class_count > ATLAS_CLASS_COUNT_MAX) ||
+            (header.entry_count != (binomial(header.class_count + 3, 4) * ATLAS_SPLIT_COUNT))) {
+                ret = -3;
+                goto exit;
+        }
+
+        atlas->class_count = header.class_count;
+
+        if ((fread(atlas->classes, sizeof(struct atlas_class), atlas->class_count, fp)) != atlas->class_count) {
+                ret = -2;
+                goto exit;
+        }
+
+        atlas->entries = malloc(header.entry_count);
+
+        if (atlas->entries == NULL) {
+                ret = -2;
+                goto exit;
+        }
+
+        if ((fread(atlas->entries, 1, header.entry_count, fp)) != header.entry_count) {
+                atlas_deinit(atlas);
+
+                ret = -2;
+                goto exit;
+        }
+
+        atlas->entry_count = header.entry_count;
+
+exit:
+        (void)fclose(fp);
+
+        return ret;
+}
+
+/*-
+ * Write the multi-set of 4 classes of rank RANK, amongst CLASS_COUNT
+ * classes, to CLASSES.
+ */
+static void
+atlas_unrank(uint32_t rank, uint32_t class_count, uint32_t *classes)
+{
+        int32_t i;
+        for (i = 3; i >= 0; i--) {
+                /* Search for the largest d such that (d choose i + 1)
+                 * does not exceed the rank */
+                uint32_t low;
+                low = i;
+                uint32_t high;
+                high = class_count + i;
+
+                while (low < high) {
+                        uint32_t d;
+                        d = (low + high + 1) >> 1;
+
+                        if ((binomial(d, i + 1)) <= rank) {
+                                low = d;
+                        } else {
+                                high = d - 1;
+                        }
+                }
+
+                rank -= binomial(low, i + 1);
+
+                classes[i] = low - i;
+        }
+}
+
+/*-
+ * Add the class of the scroll screen format FORMAT to the atlas ATLAS,
+ * unless the format is rejected or its class is already present.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 Too many classes
+ */
+static int32_t
+atlas_class_add(struct atlas *atlas, const struct scrn_format *format)
+{
+        uint8_t tvcs;
+        uint8_t tpnd;
+        uint8_t tcpd;
+
+        if ((cycp_calculate_timings(format, &tvcs, &tpnd, &tcpd)) < 0) {
+                return 0;
+        }
+
+        const struct scrn_format *formats[] = {
+                format,
+                NULL
+        };
+
+        struct state state;
+
+        state_init(&state, formats);
+
+        struct atlas_class atlas_class;
+
+        atlas_class.tpnd = tpnd;
+        atlas_class.tcpd = tcpd;
+        atlas_class.pnd_bitmap = state.nbg0.pnd_bitmap;
+        atlas_class.cpd_bitmap = state.nbg0.cpd_bitmap;
+
+        uint32_t class;
+        for (class = 1; class < atlas->class_count; class++) {
+                if ((memcmp(&atlas->classes[class], &atlas_class, sizeof(atlas_class))) == 0) {
+                        return 0;
+                }
+        }
+
+        if (atlas->class_count == ATLAS_CLASS_COUNT_MAX) {
+                return -1;
+        }
+
+        atlas->classes[atlas->class_count] = atlas_class;
+        atlas->formats[atlas->class_count] = *format;
+        atlas->class_count++;
+
+        return 0;
+}
+
+/*-
+ * Solve the entry at INDEX of the atlas ATLAS, and return its value.
+ */
+static uint8_t
+atlas_entry_solve(const struct atlas *atlas, uint32_t index)
+{
+        struct state state;
+
+        atlas_state_init(atlas, index, &state);
+
+        int32_t ret;
+        if ((ret = vdp2cycp(&state)) < 0) {
+                return -ret;
+        }
+
+        return 0x80 | vram_cycp_free_count(state.ramctl, &state.vram_cycp);
+}
+
+static void *
+atlas_worker(void *arg)
+{
+        struct atlas_job *job;
+        job = arg;
+
+        struct atlas *atlas;
+        atlas = job->atlas;
+
+        while (true) {
+                uint32_t first;
+                first = atomic_fetch_add(&job->cursor, ATLAS_CHUNK_SIZE);
+
+                if (first >= atlas->entry_count) {
+                        break;
+                }
+
+                uint32_t last;
+                last = first + ATLAS_CHUNK_SIZE;
+
+                if (last > atlas->entry_count) {
+                        last = atlas->entry_count;
+                }
+
+                uint32_t index;
+                for (index = first; index < last; index++) {
+                        atlas->entries[index] = atlas_entry_solve(atlas, index);
+                }
+        }
+
+        return NULL;
+}
+
+/*-
+ * Build the atlas using THREAD_COUNT threads, solve every feasible
+ * entry, and write the solution database read by cycpdb_init() to the
+ * file PATH.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 PATH is NULL
+ *   - -2 Memory or threads could not be allocated
+ *   - -3 Too many distinct cycle pattern words to be indexed
+ *   - -4 File could not be written
+ */
+int32_t
+atlas_cycpdb_generate(const char *path, uint32_t thread_count)
+{
+        if (path == NULL) {
+                return -1;
+        }
+
+        if (thread_count == 0) {
+                thread_count = 1;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        uint32_t *chunk_ranks;
+        chunk_ranks = NULL;
+        uint32_t *ranks;
+        ranks = NULL;
+        uint64_t *bitmap;
+        bitmap = NULL;
+        union vram_cycp *solutions;
+        solutions = NULL;
+        uint32_t *words;
+        words = NULL;
+        uint16_t *values;
+        values = NULL;
+        pthread_t *threads;
+        threads = NULL;
+
+        struct atlas atlas;
+
+        if ((atlas_init(&atlas)) < 0) {
+                return -2;
+        }
+
+        if ((atlas_build(&atlas, thread_count)) < 0) {
+                ret = -2;
+                goto exit;
+        }
+
+        uint32_t chunk_count;
+        chunk_count = (atlas.entry_count + ATLAS_CHUNK_SIZE - 1) / ATLAS_CHUNK_SIZE;
+        uint32_t block_count;
+        block_count = (atlas.entry_count + CYCPDB_BLOCK_SIZE - 1) / CYCPDB_BLOCK_SIZE;
+        uint32_t bitmap_word_count;
+        bitmap_word_count = (atlas.entry_count + 63) / 64;
+
+        chunk_ranks = malloc(chunk_count * sizeof(uint32_t));
+        ranks = malloc(block_count * sizeof(uint32_t));
+        bitmap = calloc(bitmap_word_count, sizeof(uint64_t));
+
+        if ((chunk_ranks == NULL) || (ranks == NULL) || (bitmap == NULL)) {
+                ret = -2;
+                goto exit;
+        }
+
+        uint32_t feasible_count;
+        feasible_count = 0;
+
+        uint32_t index;
+        for (index = 0; index < atlas.entry_count; index++) {
+                if ((index % ATLAS_CHUNK_SIZE) == 0) {
+                        chunk_ranks[index / ATLAS_CHUNK_SIZE] = feasible_count;
+                }
+
+                if ((index % CYCPDB_BLOCK_SIZE) == 0) {
+                        ranks[index / CYCPDB_BLOCK_SIZE] = feasible_count;
+                }
+
+                if (!ATLAS_ENTRY_FEASIBLE(atlas.entries[index])) {
+                        continue;
+                }
+
+                bitmap[index / 64] |= 1ULL << (index % 64);
+                feasible_count++;
+        }
+
+        /* Solve every feasible entry again, this time keeping the cycle
+         * patterns */
+        solutions = malloc(feasible_count * sizeof(union vram_cycp));
+        threads = malloc(thread_count * sizeof(pthread_t));
+
+        if ((feasible_count > 0) && (solutions == NULL)) {
+                ret = -2;
+                goto exit;
+        }
+
+        if (threads == NULL) {
+                ret = -2;
+                goto exit;
+        }
+
+        struct atlas_cycpdb_job job;
+
+        job.atlas = &atlas;
+        job.chunk_ranks = chunk_ranks;
+        job.solutions = solutions;
+        atomic_init(&job.cursor, 0);
+
+        uint32_t i;
+        for (i = 0; i < thread_count; i++) {
+                if ((pthread_create(&threads[i], NULL, atlas_cycpdb_worker, &job)) != 0) {
+                        break;
+                }
+        }
+
+        if (i == 0) {
+                (void)atlas_cycpdb_worker(&job);
+        }
+
+        uint32_t j;
+        for (j = 0; j < i; j++) {
+                (void)pthread_join(threads[j], NULL);
+        }
+
+        /* Pool the distinct words of each bank */
+        uint32_t word_count;
+        word_count = feasible_count * VRAM_BANK_COUNT;
+
+        words = malloc((word_count + 1) * sizeof(uint32_t));
+        values = malloc((word_count + 1) * sizeof(uint16_t));
+
+        if ((words == NULL) || (values == NULL)) {
+                ret = -2;
+                goto exit;
+        }
+
+        if (word_count > 0) {
+                (void)memcpy(words, solutions, word_count * sizeof(uint32_t));
+
+                qsort(words, word_count, sizeof(uint32_t), atlas_cycpdb_word_compare);
+
+                uint32_t unique_count;
+                unique_count = 1;
+
+                for (i = 1; i < word_count; i++) {
+                        if (words[i] != words[unique_count - 1]) {
+                                words[unique_count++] = words[i];
+                        }
+                }
+
+                word_count = unique_count;
+        }
+
+        if (word_count > (UINT16_MAX + 1)) {
+                ret = -3;
+                goto exit;
+        }
+
+        for (i = 0; i < (feasible_count * VRAM_BANK_COUNT); i++) {
+                const uint32_t *word;
+                word = bsearch(&solutions[i / VRAM_BANK_COUNT].pv[i % VRAM_BANK_COUNT],
+                    words, word_count, sizeof(uint32_t), atlas_cycpdb_word_compare);
+
+                assert(word != NULL);
+
+                values[i] = word - words;
+        }
+
+        FILE *fp;
+        fp = fopen(path, "wb");
+
+        if (fp == NULL) {
+                ret = -4;
+                goto exit;
+        }
+
+        struct cycpdb_header header;
+
+        memset(&header, 0x00, sizeof(header));
+
+        (void)memcpy(header.magic, CYCPDB_MAGIC, sizeof(header.magic));
+        header.version = CYCPDB_VERSION;
+        header.class_count = atlas.class_count;
+        header.entry_count = atlas.entry_count;
+        header.feasible_count = feasible_count;
+        header.word_count = word_count;
+
+        uint32_t value_count;
+        value_count = feasible_count * VRAM_BANK_COUNT;
+
+        bool written;
+        written = ((fwrite(&header, sizeof(header), 1, fp)) == 1) &&
+            ((fwrite(atlas.classes, sizeof(struct atlas_class), atlas.class_count, fp)) == atlas.class_count) &&
+            ((fwrite(words, sizeof(uint32_t), word_count, fp)) == word_count) &&
+            ((fwrite(ranks, sizeof(uint32_t), block_count, fp)) == block_count) &&
+            ((fwrite(bitmap, sizeof(uint64_t), bitmap_word_count, fp)) == bitmap_word_count) &&
+            ((fwrite(values, sizeof(uint16_t), value_count, fp)) == value_count);
+
+        if ((fclose(fp)) != 0) {
+                written = false;
+        }
+
+        if (!written) {
+                ret = -4;
+        }
+
+exit:
+        free(threads);
+        free(values);
+        free(words);
+        free(solutions);
+        free(bitmap);
+        free(ranks);
+        free(chunk_ranks);
+
+        atlas_deinit(&atlas);
+
+        return ret;
+}
+
+static void *
+atlas_cycpdb_worker(void *arg)
+{
+        struct atlas_cycpdb_job *job;
+        job = arg;
+
+        const struct atlas *atlas;
+        atlas = job->atlas;
+
+        while (true) {
+                uint32_t chunk;
+                chunk = atomic_fetch_add(&job->cursor, 1);
+
+                uint32_t first;
+                first = chunk * ATLAS_CHUNK_SIZE;
+
+                if (first >= atlas->entry_count) {
+                        break;
+                }
+
+                uint32_t last;
+                last = first + ATLAS_CHUNK_SIZE;
+
+                if (last > atlas->entry_count) {
+                        last = atlas->entry_count;
+                }
+
+                uint32_t rank;
+                rank = job->chunk_ranks[chunk];
+
+                uint32_t index;
+                for (index = first; index < last; index++) {
+                        if (!ATLAS_ENTRY_FEASIBLE(atlas->entries[index])) {
+                                continue;
+                        }
+
+                        struct state state;
+
+                        atlas_state_init(atlas, index, &state);
+
+                        int32_t error __unused;
+                        error = vdp2cycp(&state);
+
+                        assert(error == 0);
+
+                        job->solutions[rank] = state.vram_cycp;
+                        rank++;
+                }
+        }
+
+        return NULL;
+}
+
+static int
+atlas_cycpdb_word_compare(const void *a, const void *b)
+{
+        uint32_t word_a;
+        word_a = *(const uint32_t *)a;
+        uint32_t word_b;
+        word_b = *(const uint32_t *)b;
+
+        return (word_a > word_b) - (word_a < word_b);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef ATLAS_H_
+#define ATLAS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/* Maximum number of scroll screen classes, including the disabled
+ * class */
+#define ATLAS_CLASS_COUNT_MAX   256
+
+/* Number of RAMCTL VRAM partitioning configurations */
+#define ATLAS_SPLIT_COUNT       4
+
+/* Determine if the atlas entry E is feasible */
+#define ATLAS_ENTRY_FEASIBLE(e) (((e) & 0x80) != 0x00)
+
+/* Extract the number of free access timings from feasible atlas entry E */
+#define ATLAS_ENTRY_FREE(e)     ((e) & 0x3F)
+
+/* Extract the (negative) vdp2cycp() error from infeasible atlas entry E */
+#define ATLAS_ENTRY_ERROR(e)    (-(int32_t)((e) & 0x0F))
+
+/* Number of values ATLAS_ENTRY_ERROR() may extract, including 0 */
+#define ATLAS_ERROR_COUNT       16
+
+/*-
+ * A scroll screen class is the access timings an NBG demands, along with
+ * where its pattern name data and character pattern data are stored.
+ *
+ * Scroll screens of the same class are indistinguishable to vdp2cycp(),
+ * and so are scenes made up of the same classes in any NBG order, as
+ * long as vertical cell scroll is not used.
+ *
+ * The atlas only covers part of the scenes vdp2cycp() solves: NBGs
+ * without vertical cell scroll, each storing its pattern name data in a
+ * single bank, and its character pattern data in a single bank, without
+ * the rotational backgrounds, in the normal TV screen modes. Any format
+ * meeting these conditions maps to a class, whatever its plane or bitmap
+ * size. Other scenes are not covered, and atlas_classes_get() rejects
+ * them, so that they are left to the search.
+ */
+struct atlas_class {
+        uint8_t tpnd;
+        uint8_t tcpd;
+        uint8_t pnd_bitmap;
+        uint8_t cpd_bitmap;
+};
+
+struct atlas {
+        uint32_t class_count;
+        struct atlas_class classes[ATLAS_CLASS_COUNT_MAX];
+
+        /* Scroll screen format representing each class */
+        struct scrn_format formats[ATLAS_CLASS_COUNT_MAX];
+
+        /* One entry for each multi-set of 4 classes, for each VRAM
+         * partitioning configuration */
+        uint32_t entry_count;
+        uint8_t *entries;
+};
+
+int32_t atlas_init(struct atlas *);
+void atlas_deinit(struct atlas *);
+
+int32_t atlas_build(struct atlas *, uint32_t);
+int32_t atlas_lookup(const struct atlas *, const struct state *, uint8_t *);
+
+/* Part of libvdp2cycp, defined in cycpdb.c */
+int32_t atlas_classes_get(const struct atlas_class *, uint32_t, const struct state *, uint32_t *);
+uint32_t atlas_index_get(const uint32_t *, uint16_t);
+void atlas_state_init(const struct atlas *, uint32_t, struct state *);
+
+int32_t atlas_write(const struct atlas *, const char *);
+int32_t atlas_read(struct atlas *, const char *);
+
+int32_t atlas_cycpdb_generate(const char *, uint32_t);
+
+#endif /* !ATLAS_H_ */
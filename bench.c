@@ -0,0 +1,709 @@
+#include <sys/cdefs.h>
+#include <sys/resource.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "cache.h"
+#include "cycpdb.h"
+
+#include "debug.h"
+
+/* Worker solving a slice of the scenes, to measure throughput per core */
+struct bench_job {
+        const struct bench_scene *scenes;
+        uint32_t scene_count;
+};
+
+static void bench_format_generate(uint64_t *, const struct bench_scene *, uint8_t, bool,
+    struct scrn_format *);
+static uint32_t bench_address_generate(uint64_t *, int32_t, uint32_t);
+
+static uint64_t bench_clock(void);
+static void bench_report(const char *, uint32_t *, uint32_t, uint64_t, uint32_t);
+static int bench_latency_compare(const void *, const void *);
+static void *bench_worker(void *);
+
+/*-
+ * Return the next pseudo-random number of the sequence SEED (SplitMix64).
+ */
+uint64_t
+bench_random(uint64_t *seed)
+{
+        uint64_t z;
+        z = (*seed += 0x9E3779B97F4A7C15ULL);
+
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+        return z ^ (z >> 31);
+}
+
+/*-
+ * Generate a random scene SCENE from the sequence SEED.
+ *
+ * Each NBG is enabled with a probability of 3/4, and RBG0 with 1/8. The
+ * VRAM partitioning, color counts, reductions, and the banks data is
+ * placed in are random, but legal for the scroll screen. The pattern name
+ * data of every scroll screen shares a single bank, as does the vertical
+ * cell scroll table, since not every combination of banks is valid. One in
+ * BENCH_NEAR_LEGAL_RATIO scenes is near-legal: one of its scroll screens
+ * takes any value the format can hold, such as vertical cell scroll on
+ * NBG2, or a reduction with too many colors.
+ */
+void
+bench_scene_generate(uint64_t *seed, struct bench_scene *scene)
+{
+        memset(scene, 0x00, sizeof(*scene));
+
+        scene->ramctl = (bench_random(seed) & 0x03) << 8;
+        scene->pnd_bank = bench_random(seed) % VRAM_BANK_COUNT;
+        scene->vcs_bank = bench_random(seed) % VRAM_BANK_COUNT;
+
+        uint8_t scrns[SCRN_COUNT];
+        uint32_t scrn_count;
+        scrn_count = 0;
+
+        uint8_t scrn;
+        for (scrn = SCRN_NBG0; scrn <= SCRN_NBG3; scrn++) {
+                if ((bench_random(seed) % 4) != 0) {
+                        scrns[scrn_count++] = scrn;
+                }
+        }
+
+        if ((bench_random(seed) % 8) == 0) {
+                scrns[scrn_count++] = SCRN_RBG0;
+        }
+
+        if (scrn_count == 0) {
+                scrns[scrn_count++] = SCRN_NBG0;
+        }
+
+        uint32_t near_legal;
+        near_legal = scrn_count;
+
+        if ((bench_random(seed) % BENCH_NEAR_LEGAL_RATIO) == 0) {
+                near_legal = bench_random(seed) % scrn_count;
+        }
+
+        uint32_t i;
+        for (i = 0; i < scrn_count; i++) {
+                bench_format_generate(seed, scene, scrns[i], i == near_legal,
+                    &scene->formats[i]);
+        }
+
+        scene->format_count = scrn_count;
+}
+
+/*-
+ * Initialize STATE with the scene SCENE.
+ */
+void
+bench_state_init(const struct bench_scene *scene, struct state *state)
+{
+        const struct scrn_format *formats[SCRN_COUNT + 1];
+
+        uint32_t i;
+        for (i = 0; i < scene->format_count; i++) {
+                formats[i] = &scene->formats[i];
+        }
+
+        formats[i] = NULL;
+
+        state_init(state, formats);
+
+        state->ramctl = scene->ramctl;
+}
+
+/*-
+ * Benchmark vdp2cycp() and its related entry points with SCENE_COUNT
+ * scenes generated from SEED, and print the time taken per call, the
+ * 50th and 99th percentile latencies, the number of calls per second,
+ * and the peak resident set size.
+ *
+ * The throughput of vdp2cycp() per core is also measured when the scenes
+ * are solved by THREAD_COUNT threads at once.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 SCENE_COUNT is zero
+ *   - -2 Memory could not be allocated
+ */
+int32_t
+bench_run(uint64_t seed, uint32_t scene_count, uint32_t thread_count)
+{
+        if (scene_count == 0) {
+                return -1;
+        }
+
+        if (thread_count == 0) {
+                thread_count = 1;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        uint32_t batch_count;
+        batch_count = (scene_count + BENCH_BATCH_SIZE - 1) / BENCH_BATCH_SIZE;
+
+        struct bench_scene *scenes;
+        scenes = malloc(scene_count * sizeof(struct bench_scene));
+        union vram_cycp *vram_cycp;
+        vram_cycp = malloc(scene_count * sizeof(union vram_cycp));
+        int32_t *results;
+        results = malloc(scene_count * sizeof(int32_t));
+        uint32_t *latencies;
+        latencies = malloc(scene_count * sizeof(uint32_t));
+        struct cycp_cache *cache;
+        cache = malloc(sizeof(struct cycp_cache));
+        pthread_t *threads;
+        threads = malloc(thread_count * sizeof(pthread_t));
+        struct bench_job *jobs;
+        jobs = malloc(thread_count * sizeof(struct bench_job));
+
+        /* Structure of arrays of the scroll screens of each scene */
+        uint16_t *batch_ramctl;
+        batch_ramctl = malloc(scene_count * sizeof(uint16_t));
+        uint8_t *batch_values;
+        batch_values = calloc(scene_count * ((7 * 4) + (5 * 2)), sizeof(uint8_t));
+        uint32_t *batch_coefficient_tables;
+        batch_coefficient_tables = calloc(scene_count * 2, sizeof(uint32_t));
+
+        if ((scenes == NULL) || (vram_cycp == NULL) || (results == NULL) ||
+            (latencies == NULL) || (cache == NULL) || (threads == NULL) ||
+            (jobs == NULL) || (batch_ramctl == NULL) || (batch_values == NULL) ||
+            (batch_coefficient_tables == NULL)) {
+                ret = -2;
+                goto exit;
+        }
+
+        (void)printf("Benchmark of %u scene(s), seed %llu\n", scene_count,
+            (unsigned long long)seed);
+
+        uint64_t generate_seed;
+        generate_seed = seed;
+
+        uint32_t i;
+        for (i = 0; i < scene_count; i++) {
+                bench_scene_generate(&generate_seed, &scenes[i]);
+        }
+
+        (void)printf("%-28s %10s %10s %10s %12s\n", "entry point", "ns/call", "p50",
+            "p99", "calls/s");
+
+        struct state state;
+
+        uint64_t start;
+        uint64_t total;
+
+        /* vdp2cycp() */
+        total = 0;
+
+        uint32_t feasible_count;
+        feasible_count = 0;
+
+        for (i = 0; i < scene_count; i++) {
+                bench_state_init(&scenes[i], &state);
+
+                start = bench_clock();
+                results[i] = vdp2cycp(&state);
+                latencies[i] = bench_clock() - start;
+
+                total += latencies[i];
+
+                vram_cycp[i] = state.vram_cycp;
+
+                if (results[i] == 0) {
+                        feasible_count++;
+                }
+        }
+
+        bench_report("vdp2cycp", latencies, scene_count, total, 1);
+
+        /* vdp2cycp_batch(), timed per batch */
+        struct cycp_batch batch;
+
+        memset(&batch, 0x00, sizeof(batch));
+
+        batch.ramctl = batch_ramctl;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                uint8_t *scrn_values;
+                scrn_values = &batch_values[scrn * 7 * scene_count];
+
+                batch.scrns[scrn].tvcs = &scrn_values[0 * scene_count];
+                batch.scrns[scrn].tpnd = &scrn_values[1 * scene_count];
+                batch.scrns[scrn].tcpd = &scrn_values[2 * scene_count];
+                batch.scrns[scrn].vcs_bitmap = &scrn_values[3 * scene_count];
+                batch.scrns[scrn].pnd_bitmap = &scrn_values[4 * scene_count];
+                batch.scrns[scrn].cpd_bitmap = &scrn_values[5 * scene_count];
+                batch.scrns[scrn].vram_exceeded = &scrn_values[6 * scene_count];
+        }
+
+        uint32_t rbg;
+        for (rbg = 0; rbg < 2; rbg++) {
+                uint8_t *rbg_values;
+                rbg_values = &batch_values[((7 * 4) + (rbg * 5)) * scene_count];
+
+                batch.rbgs[rbg].rp_mode = &rbg_values[0 * scene_count];
+                batch.rbgs[rbg].coefficient_table = &batch_coefficient_tables[rbg * scene_count];
+                batch.rbgs[rbg].coefficient_bitmap = &rbg_values[1 * scene_count];
+                batch.rbgs[rbg].pnd_bitmap = &rbg_values[2 * scene_count];
+                batch.rbgs[rbg].cpd_bitmap = &rbg_values[3 * scene_count];
+                batch.rbgs[rbg].vram_exceeded = &rbg_values[4 * scene_count];
+        }
+
+        for (i = 0; i < scene_count; i++) {
+                bench_state_init(&scenes[i], &state);
+
+                batch_ramctl[i] = state.ramctl;
+
+                for (scrn = 0; scrn < 4; scrn++) {
+                        const struct scroll_screen *scroll_screen;
+                        scroll_screen = state.scroll_screens[scrn];
+
+                        ((uint8_t *)batch.scrns[scrn].tvcs)[i] = scroll_screen->tvcs;
+                        ((uint8_t *)batch.scrns[scrn].tpnd)[i] = scroll_screen->tpnd;
+                        ((uint8_t *)batch.scrns[scrn].tcpd)[i] = scroll_screen->tcpd;
+                        ((uint8_t *)batch.scrns[scrn].vcs_bitmap)[i] = scroll_screen->vcs_bitmap;
+                        ((uint8_t *)batch.scrns[scrn].pnd_bitmap)[i] = scroll_screen->pnd_bitmap;
+                        ((uint8_t *)batch.scrns[scrn].cpd_bitmap)[i] = scroll_screen->cpd_bitmap;
+                        ((uint8_t *)batch.scrns[scrn].vram_exceeded)[i] = scroll_screen->vram_exceeded;
+                }
+
+                for (rbg = 0; rbg < 2; rbg++) {
+                        const struct scroll_screen *scroll_screen;
+                        scroll_screen = state.scroll_screens[SCRN_RBG0 + rbg];
+
+                        const struct scrn_format *format;
+                        format = &scroll_screen->format;
+
+                        if (!format->sf_enable) {
+                                continue;
+                        }
+
+                        ((uint8_t *)batch.rbgs[rbg].rp_mode)[i] = (format->sf_type == SCRN_TYPE_CELL) ?
+                            format->sf_format.cell.scf_rp_mode :
+                            format->sf_format.bitmap.sbf_rp_mode;
+                        ((uint32_t *)batch.rbgs[rbg].coefficient_table)[i] = format->sf_coefficient_table;
+                        ((uint8_t *)batch.rbgs[rbg].coefficient_bitmap)[i] = scroll_screen->coefficient_bitmap;
+                        ((uint8_t *)batch.rbgs[rbg].pnd_bitmap)[i] = scroll_screen->pnd_bitmap;
+                        ((uint8_t *)batch.rbgs[rbg].cpd_bitmap)[i] = scroll_screen->cpd_bitmap;
+                        ((uint8_t *)batch.rbgs[rbg].vram_exceeded)[i] = scroll_screen->vram_exceeded;
+                }
+        }
+
+        total = 0;
+
+        uint32_t batch_index;
+        for (batch_index = 0; batch_index < batch_count; batch_index++) {
+                struct cycp_batch chunk;
+                chunk = batch;
+
+                size_t offset;
+                offset = batch_index * BENCH_BATCH_SIZE;
+
+                chunk.count = scene_count - offset;
+
+                if (chunk.count > BENCH_BATCH_SIZE) {
+                        chunk.count = BENCH_BATCH_SIZE;
+                }
+
+                chunk.ramctl += offset;
+
+                for (scrn = 0; scrn < 4; scrn++) {
+                        chunk.scrns[scrn].tvcs += offset;
+                        chunk.scrns[scrn].tpnd += offset;
+                        chunk.scrns[scrn].tcpd += offset;
+                        chunk.scrns[scrn].vcs_bitmap += offset;
+                        chunk.scrns[scrn].pnd_bitmap += offset;
+                        chunk.scrns[scrn].cpd_bitmap += offset;
+                        chunk.scrns[scrn].vram_exceeded += offset;
+                }
+
+                for (rbg = 0; rbg < 2; rbg++) {
+                        chunk.rbgs[rbg].rp_mode += offset;
+                        chunk.rbgs[rbg].coefficient_table += offset;
+                        chunk.rbgs[rbg].coefficient_bitmap += offset;
+                        chunk.rbgs[rbg].pnd_bitmap += offset;
+                        chunk.rbgs[rbg].cpd_bitmap += offset;
+                        chunk.rbgs[rbg].vram_exceeded += offset;
+                }
+
+                union vram_cycp chunk_vram_cycp[BENCH_BATCH_SIZE];
+                int32_t chunk_results[BENCH_BATCH_SIZE];
+
+                chunk.vram_cycp = chunk_vram_cycp;
+                chunk.results = chunk_results;
+
+                start = bench_clock();
+                (void)vdp2cycp_batch(&chunk);
+                latencies[batch_index] = (bench_clock() - start) / chunk.count;
+
+                total += latencies[batch_index] * chunk.count;
+        }
+
+        bench_report("vdp2cycp_batch", latencies, batch_count, total, BENCH_BATCH_SIZE);
+
+        /* cycpdb_vdp2cycp(), if a database is linked in */
+        struct cycpdb cycpdb;
+
+        if ((cycpdb_builtin_init(&cycpdb)) == 0) {
+                total = 0;
+
+                for (i = 0; i < scene_count; i++) {
+                        bench_state_init(&scenes[i], &state);
+
+                        start = bench_clock();
+                        (void)cycpdb_vdp2cycp(&cycpdb, &state);
+                        latencies[i] = bench_clock() - start;
+
+                        total += latencies[i];
+                }
+
+                bench_report("cycpdb_vdp2cycp", latencies, scene_count, total, 1);
+        } else {
+                (void)printf("%-28s (no database linked in)\n", "cycpdb_vdp2cycp");
+        }
+
+        /* cycp_cache_vdp2cycp(), first with a cold cache, then with the
+         * cache filled by the first pass */
+        cycp_cache_init(cache);
+
+        uint32_t pass;
+        for (pass = 0; pass < 2; pass++) {
+                total = 0;
+
+                for (i = 0; i < scene_count; i++) {
+                        bench_state_init(&scenes[i], &state);
+
+                        start = bench_clock();
+                        (void)cycp_cache_vdp2cycp(cache, &state);
+                        latencies[i] = bench_clock() - start;
+
+                        total += latencies[i];
+                }
+
+                bench_report((pass == 0) ? "cycp_cache_vdp2cycp (cold)" : "cycp_cache_vdp2cycp (warm)",
+                    latencies, scene_count, total, 1);
+        }
+
+        uint64_t hit_count;
+        uint64_t miss_count;
+
+        cycp_cache_counts_get(cache, &hit_count, &miss_count);
+
+        /* vdp2cycp_update(), after one NBG of a solved scene changes */
+        uint64_t update_seed;
+        update_seed = ~seed;
+
+        total = 0;
+
+        for (i = 0; i < scene_count; i++) {
+                bench_state_init(&scenes[i], &state);
+
+                (void)vdp2cycp(&state);
+
+                scrn = scenes[i].formats[0].sf_scroll_screen;
+
+                if (scrn <= SCRN_NBG3) {
+                        bench_format_generate(&update_seed, &scenes[i], scrn, false,
+                            &state.scroll_screens[scrn]->format);
+
+                        state_scrn_dirty(&state, scrn);
+                }
+
+                start = bench_clock();
+                (void)vdp2cycp_update(&state);
+                latencies[i] = bench_clock() - start;
+
+                total += latencies[i];
+        }
+
+        bench_report("vdp2cycp_update", latencies, scene_count, total, 1);
+
+        /* vdp2cycp_validate() of the solution of each scene */
+        total = 0;
+
+        for (i = 0; i < scene_count; i++) {
+                bench_state_init(&scenes[i], &state);
+
+                int8_t result;
+
+                start = bench_clock();
+                (void)vdp2cycp_validate(&state, &vram_cycp[i], 1, &result);
+                latencies[i] = bench_clock() - start;
+
+                total += latencies[i];
+        }
+
+        bench_report("vdp2cycp_validate", latencies, scene_count, total, 1);
+
+        /* Throughput of vdp2cycp() per core */
+        uint32_t slice;
+        slice = (scene_count + thread_count - 1) / thread_count;
+
+        start = bench_clock();
+
+        uint32_t thread;
+        for (thread = 0; thread < thread_count; thread++) {
+                struct bench_job *job;
+                job = &jobs[thread];
+
+                uint32_t first;
+                first = thread * slice;
+
+                job->scenes = &scenes[(first < scene_count) ? first : scene_count];
+                job->scene_count = (first < scene_count) ? (scene_count - first) : 0;
+
+                if (job->scene_count > slice) {
+                        job->scene_count = slice;
+                }
+
+                if ((pthread_create(&threads[thread], NULL, bench_worker, job)) != 0) {
+                        (void)bench_worker(job);
+
+                        threads[thread] = pthread_self();
+                }
+        }
+
+        for (thread = 0; thread < thread_count; thread++) {
+                if (!pthread_equal(threads[thread], pthread_self())) {
+                        (void)pthread_join(threads[thread], NULL);
+                }
+        }
+
+        total = bench_clock() - start;
+
+        (void)printf("vdp2cycp on %u thread(s): %.0f calls/s/core\n", thread_count,
+            (scene_count * 1e9) / ((double)total * thread_count));
+
+        (void)printf("Feasible: %u, rejected: %u\n", feasible_count,
+            scene_count - feasible_count);
+        (void)printf("Cache hits: %llu, misses: %llu\n", (unsigned long long)hit_count,
+            (unsigned long long)miss_count);
+
+        struct rusage usage;
+
+        if ((getrusage(RUSAGE_SELF, &usage)) == 0) {
+                (void)printf("Peak RSS: %ld KiB\n", usage.ru_maxrss);
+        }
+
+exit:
+        free(batch_coefficient_tables);
+        free(batch_values);
+        free(batch_ramctl);
+        free(jobs);
+        free(threads);
+        free(cache);
+        free(latencies);
+        free(results);
+        free(vram_cycp);
+        free(scenes);
+
+        return ret;
+}
+
+/*-
+ * Generate the format FORMAT of the scroll screen SCRN of the scene SCENE
+ * from the sequence SEED. If NEAR_LEGAL is true, the format may be one
+ * the scroll screen does not support, and its data may be stored in any
+ * bank.
+ */
+static void
+bench_format_generate(uint64_t *seed, const struct bench_scene *scene, uint8_t scrn,
+    bool near_legal, struct scrn_format *format)
+{
+        /* Highest character color count and reduction of each scroll
+         * screen */
+        static const uint8_t cc_count_max[SCRN_COUNT] = {
+                SCRN_CCC_RGB_16770000,
+                SCRN_CCC_RGB_32768,
+                SCRN_CCC_PALETTE_256,
+                SCRN_CCC_PALETTE_256,
+                SCRN_CCC_RGB_16770000,
+                SCRN_CCC_RGB_16770000
+        };
+
+        static const uint8_t reduction_max[SCRN_COUNT] = {
+                SCRN_REDUCTION_QUARTER,
+                SCRN_REDUCTION_QUARTER,
+                SCRN_REDUCTION_NONE,
+                SCRN_REDUCTION_NONE,
+                SCRN_REDUCTION_NONE,
+                SCRN_REDUCTION_NONE
+        };
+
+        static const uint8_t plane_sizes[] = {
+                1 * 1,
+                2 * 1,
+                2 * 2
+        };
+
+        memset(format, 0x00, sizeof(*format));
+
+        format->sf_enable = true;
+        format->sf_scroll_screen = scrn;
+        format->sf_type = SCRN_TYPE_CELL;
+
+        /* NBG2 and NBG3 only support the cell format */
+        if ((near_legal || (scrn <= SCRN_NBG1) || (scrn >= SCRN_RBG0)) &&
+            ((bench_random(seed) % 4) == 0)) {
+                format->sf_type = SCRN_TYPE_BITMAP;
+        }
+
+        uint8_t cc_count;
+        cc_count = near_legal ? SCRN_CCC_RGB_16770000 : cc_count_max[scrn];
+        uint8_t reduction;
+        reduction = near_legal ? 3 : reduction_max[scrn];
+
+        /* Favor the lower color counts, as most scenes do */
+        uint32_t cc_count_a;
+        cc_count_a = bench_random(seed) % (cc_count + 1);
+        uint32_t cc_count_b;
+        cc_count_b = bench_random(seed) % (cc_count + 1);
+
+        format->sf_cc_count = (cc_count_a < cc_count_b) ? cc_count_a : cc_count_b;
+        format->sf_reduction = bench_random(seed) % (reduction + 1);
+
+        int32_t pnd_bank;
+        pnd_bank = near_legal ? -1 : scene->pnd_bank;
+
+        /* Only NBG0 and NBG1 are capable of vertical cell scroll */
+        if ((near_legal || (scrn <= SCRN_NBG1)) && ((bench_random(seed) % 8) == 0)) {
+                format->sf_vcs_table = bench_address_generate(seed,
+                    near_legal ? -1 : scene->vcs_bank, 0x0001FFFE);
+        }
+
+        uint32_t color_palette;
+        color_palette = 0x25F00000 + ((bench_random(seed) % 0x80) << 5);
+        uint32_t rp_mode;
+        rp_mode = (scrn >= SCRN_RBG0) ? (bench_random(seed) & 0x03) : 0;
+
+        if (format->sf_type == SCRN_TYPE_BITMAP) {
+                struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                bitmap_format->sbf_bitmap_size.width = (bench_random(seed) & 0x01) ? 1024 : 512;
+                bitmap_format->sbf_bitmap_size.height = (bench_random(seed) & 0x01) ? 512 : 256;
+                bitmap_format->sbf_color_palette = color_palette;
+                bitmap_format->sbf_bitmap_pattern = bench_address_generate(seed, -1, 0x00000000);
+                bitmap_format->sbf_rp_mode = rp_mode;
+
+                return;
+        }
+
+        struct scrn_cell_format *cell_format;
+        cell_format = &format->sf_format.cell;
+
+        cell_format->scf_character_size = (bench_random(seed) & 0x01) ? (2 * 2) : (1 * 1);
+        cell_format->scf_pnd_size = (bench_random(seed) & 0x01) ? 2 : 1;
+        cell_format->scf_auxiliary_mode = bench_random(seed) & 0x01;
+        cell_format->scf_plane_size = plane_sizes[bench_random(seed) % 3];
+        cell_format->scf_cp_table = bench_address_generate(seed, -1, 0x0001FFE0);
+        cell_format->scf_color_palette = color_palette;
+        cell_format->scf_rp_mode = rp_mode;
+
+        /* Planes are usually stored one after the other */
+        bool contiguous;
+        contiguous = (bench_random(seed) % 4) != 0;
+
+        uint32_t i;
+        for (i = 0; i < 4; i++) {
+                if (contiguous && (i > 0)) {
+                        cell_format->scf_map.planes[i] = cell_format->scf_map.planes[0] +
+                            (i * 0x0800);
+                } else {
+                        cell_format->scf_map.planes[i] = bench_address_generate(seed,
+                            pnd_bank, 0x0001E000);
+                }
+        }
+}
+
+/*-
+ * Return a random VRAM address from the sequence SEED, in bank BANK, or
+ * in any bank if BANK is negative, at any offset within MASK.
+ */
+static uint32_t
+bench_address_generate(uint64_t *seed, int32_t bank, uint32_t mask)
+{
+        uint64_t value;
+        value = bench_random(seed);
+
+        if (bank < 0) {
+                bank = value % VRAM_BANK_COUNT;
+        }
+
+        return VRAM_ADDR_4MBIT((uint32_t)bank, (value >> 32) & mask);
+}
+
+static uint64_t
+bench_clock(void)
+{
+        struct timespec ts;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*-
+ * Print the time taken per call by the entry point NAME, where each of
+ * the COUNT latencies LATENCIES (in nanoseconds) was measured over
+ * CALL_COUNT calls, and TOTAL nanoseconds were taken over every call.
+ *
+ * LATENCIES is sorted.
+ */
+static void
+bench_report(const char *name, uint32_t *latencies, uint32_t count, uint64_t total,
+    uint32_t call_count)
+{
+        qsort(latencies, count, sizeof(uint32_t), bench_latency_compare);
+
+        uint64_t calls;
+        calls = (uint64_t)count * call_count;
+
+        double ns_per_call;
+        ns_per_call = (double)total / (double)calls;
+
+        (void)printf("%-28s %10.1f %10u %10u %12.0f\n", name, ns_per_call,
+            latencies[count / 2], latencies[((uint64_t)count * 99) / 100],
+            (ns_per_call > 0.0) ? (1e9 / ns_per_call) : 0.0);
+}
+
+static int
+bench_latency_compare(const void *a, const void *b)
+{
+        uint32_t latency_a;
+        latency_a = *(const uint32_t *)a;
+        uint32_t latency_b;
+        latency_b = *(const uint32_t *)b;
+
+        return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+static void *
+bench_worker(void *arg)
+{
+        const struct bench_job *job;
+        job = arg;
+
+        uint32_t i;
+        for (i = 0; i < job->scene_count; i++) {
+                struct state state;
+
+                bench_state_init(&job->scenes[i], &state);
+
+                (void)vdp2cycp(&state);
+        }
+
+        return NULL;
+}
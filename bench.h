@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/* One in this many generated scenes is near-legal */
+#define BENCH_NEAR_LEGAL_RATIO  8
+
+/* Number of configurations given to each vdp2cycp_batch() call */
+#define BENCH_BATCH_SIZE        256
+
+/*-
+ * A generated scene: the VRAM partitioning, and the formats of its
+ * enabled scroll screens.
+ */
+struct bench_scene {
+        uint16_t ramctl;
+
+        /* Bank the pattern name data, and the vertical cell scroll table
+         * of every legal scroll screen is stored in */
+        uint8_t pnd_bank;
+        uint8_t vcs_bank;
+
+        uint32_t format_count;
+        struct scrn_format formats[SCRN_COUNT];
+};
+
+uint64_t bench_random(uint64_t *);
+void bench_scene_generate(uint64_t *, struct bench_scene *);
+void bench_state_init(const struct bench_scene *, struct state *);
+
+int32_t bench_run(uint64_t, uint32_t, uint32_t);
+
+#endif /* !BENCH_H_ */
@@ -0,0 +1,288 @@
+#include <sys/cdefs.h>
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cache.h"
+
+#include "debug.h"
+
+static uint64_t cycp_cache_hash(const struct cycp_cache_key *);
+
+static void cycp_cache_shard_lock(struct cycp_cache_shard *);
+static void cycp_cache_shard_unlock(struct cycp_cache_shard *);
+
+static struct cycp_cache_entry *cycp_cache_shard_find(struct cycp_cache_shard *,
+    uint64_t, const struct cycp_cache_key *);
+
+/*-
+ * Initialize the cache CACHE.
+ */
+void
+cycp_cache_init(struct cycp_cache *cache)
+{
+        if (cache == NULL) {
+                return;
+        }
+
+        memset(cache, 0x00, sizeof(*cache));
+
+        uint32_t shard;
+        for (shard = 0; shard < CYCP_CACHE_SHARD_COUNT; shard++) {
+                atomic_flag_clear(&cache->shards[shard].lock);
+        }
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE, as vdp2cycp() does, unless
+ * a state with the same canonical key has already been calculated.
+ *
+ * The cache is split into shards, each with its own lock, so concurrent
+ * callers rarely contend. The lock is not held while calculating.
+ *
+ * The value vdp2cycp() returns is returned, or -1 if CACHE or STATE is
+ * NULL.
+ */
+int32_t
+cycp_cache_vdp2cycp(struct cycp_cache *cache, struct state *state)
+{
+        if ((cache == NULL) || (state == NULL)) {
+                return -1;
+        }
+
+        struct cycp_cache_key key;
+
+        cycp_cache_key_get(state, &key);
+
+        uint64_t hash;
+        hash = cycp_cache_hash(&key);
+
+        struct cycp_cache_shard *shard;
+        shard = &cache->shards[hash & (CYCP_CACHE_SHARD_COUNT - 1)];
+
+        cycp_cache_shard_lock(shard);
+
+        struct cycp_cache_entry *entry;
+        entry = cycp_cache_shard_find(shard, hash, &key);
+
+        if (entry->valid) {
+                shard->hit_count++;
+
+                int32_t error;
+                error = entry->error;
+
+                state->vram_cycp = entry->vram_cycp;
+                state->solved = (error == 0);
+
+                if (error == 0) {
+                        state->ramctl &= ~CYCP_CACHE_RAMCTL_MASK;
+                        state->ramctl |= entry->ramctl;
+                }
+
+                cycp_cache_shard_unlock(shard);
+
+                return error;
+        }
+
+        shard->miss_count++;
+
+        cycp_cache_shard_unlock(shard);
+
+        int32_t error;
+        error = vdp2cycp(state);
+
+        cycp_cache_shard_lock(shard);
+
+        /* The entry may have been taken in the meantime */
+        entry = cycp_cache_shard_find(shard, hash, &key);
+
+        entry->valid = true;
+        entry->error = error;
+        entry->hash = hash;
+        entry->key = key;
+        entry->vram_cycp = state->vram_cycp;
+        entry->ramctl = state->ramctl & CYCP_CACHE_RAMCTL_MASK;
+
+        cycp_cache_shard_unlock(shard);
+
+        return error;
+}
+
+/*-
+ * Write the number of hits and misses of the cache CACHE to HIT_COUNT and
+ * MISS_COUNT, respectively.
+ */
+void
+cycp_cache_counts_get(struct cycp_cache *cache, uint64_t *hit_count, uint64_t *miss_count)
+{
+        *hit_count = 0;
+        *miss_count = 0;
+
+        if (cache == NULL) {
+                return;
+        }
+
+        uint32_t i;
+        for (i = 0; i < CYCP_CACHE_SHARD_COUNT; i++) {
+                struct cycp_cache_shard *shard;
+                shard = &cache->shards[i];
+
+                cycp_cache_shard_lock(shard);
+
+                *hit_count += shard->hit_count;
+                *miss_count += shard->miss_count;
+
+                cycp_cache_shard_unlock(shard);
+        }
+}
+
+/*-
+ * Calculate the canonical key KEY of STATE.
+ *
+ * The scroll screen formats are never hashed as a whole, as they contain
+ * padding, addresses that only matter through the bank they fall in, and
+ * fields vdp2cycp() ignores. Disabled scroll screens are all zero.
+ */
+void
+cycp_cache_key_get(const struct state *state, struct cycp_cache_key *key)
+{
+        memset(key, 0x00, sizeof(*key));
+
+        uint8_t *bytes;
+        bytes = key->bytes;
+
+        *bytes++ = (state->ramctl & (RAMCTL_VRAMD | RAMCTL_VRBMD)) >> 8;
+        *bytes++ = TVMD_TIMINGS_HALVED(state->tvmd) ? 0x01 : 0x00;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++, bytes += CYCP_CACHE_SCRN_SIZE) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                const struct scrn_format *format;
+                format = &scroll_screen->format;
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                bool vcs;
+                vcs = false;
+                uint8_t pnd_size;
+                pnd_size = 0;
+                uint8_t rp_mode;
+
+                if (format->sf_type == SCRN_TYPE_CELL) {
+                        vcs = VRAM_BANK_ADDRESS(format->sf_vcs_table);
+                        pnd_size = format->sf_format.cell.scf_pnd_size;
+                        rp_mode = format->sf_format.cell.scf_rp_mode;
+                } else {
+                        rp_mode = format->sf_format.bitmap.sbf_rp_mode;
+                }
+
+                bytes[0] = 0x80 | (vcs ? 0x40 : 0x00) |
+                    ((scroll_screen->vram_exceeded != 0x00) ? 0x20 : 0x00) |
+                    format->sf_type;
+                bytes[1] = format->sf_cc_count;
+                bytes[2] = format->sf_reduction;
+                bytes[3] = pnd_size;
+                bytes[4] = scroll_screen->pnd_bitmap;
+                bytes[5] = scroll_screen->cpd_bitmap;
+                bytes[6] = scroll_screen->vcs_bitmap;
+
+                /* Whether a rotational background swaps rotation
+                 * parameters via a coefficient table it lacks */
+                if (scrn >= SCRN_RBG0) {
+                        bytes[7] = scroll_screen->coefficient_bitmap |
+                            ((rp_mode == SCRN_RP_MODE_SWAP_COEFFICIENT) ? 0x10 : 0x00) |
+                            ((format->sf_coefficient_table != 0x00000000) ? 0x20 : 0x00);
+                }
+        }
+}
+
+/*-
+ * Return the 64-bit FNV-1a hash of the key KEY.
+ */
+static uint64_t
+cycp_cache_hash(const struct cycp_cache_key *key)
+{
+        uint64_t hash;
+        hash = 0xCBF29CE484222325ULL;
+
+        uint32_t i;
+        for (i = 0; i < sizeof(key->bytes); i++) {
+                hash ^= key->bytes[i];
+                hash *= 0x00000100000001B3ULL;
+        }
+
+        return hash;
+}
+
+static void
+cycp_cache_shard_lock(struct cycp_cache_shard *shard)
+{
+        while (atomic_flag_test_and_set_explicit(&shard->lock, memory_order_acquire)) {
+        }
+}
+
+static void
+cycp_cache_shard_unlock(struct cycp_cache_shard *shard)
+{
+        atomic_flag_clear_explicit(&shard->lock, memory_order_release);
+}
+
+/*-
+ * Return the entry of the shard SHARD matching KEY. If there is none, an
+ * entry that is either unused or to be evicted is returned instead.
+ *
+ * The shard must be locked.
+ */
+static struct cycp_cache_entry *
+cycp_cache_shard_find(struct cycp_cache_shard *shard, uint64_t hash,
+    const struct cycp_cache_key *key)
+{
+        /* The lower bits of the hash select the shard */
+        uint32_t index;
+        index = hash >> 32;
+
+        struct cycp_cache_entry *unused_entry;
+        unused_entry = NULL;
+
+        uint32_t probe;
+        for (probe = 0; probe < CYCP_CACHE_PROBE_COUNT; probe++) {
+                struct cycp_cache_entry *entry;
+                entry = &shard->entries[(index + probe) & (CYCP_CACHE_SHARD_SIZE - 1)];
+
+                if (!entry->valid) {
+                        if (unused_entry == NULL) {
+                                unused_entry = entry;
+                        }
+
+                        continue;
+                }
+
+                if ((entry->hash == hash) &&
+                    ((memcmp(&entry->key, key, sizeof(*key))) == 0)) {
+                        return entry;
+                }
+        }
+
+        if (unused_entry != NULL) {
+                unused_entry->valid = false;
+
+                return unused_entry;
+        }
+
+        /* Evict an entry, chosen by the hash so that the same entry is
+         * not always the one evicted */
+        struct cycp_cache_entry *entry;
+        entry = &shard->entries[(index + ((hash >> 8) % CYCP_CACHE_PROBE_COUNT)) &
+            (CYCP_CACHE_SHARD_SIZE - 1)];
+
+        entry->valid = false;
+
+        return entry;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/* Number of shards, each with its own lock (must be a power of 2) */
+#define CYCP_CACHE_SHARD_COUNT  64
+
+/* Number of entries per shard (must be a power of 2) */
+#define CYCP_CACHE_SHARD_SIZE   256
+
+/* Number of entries probed before an entry is evicted */
+#define CYCP_CACHE_PROBE_COUNT  8
+
+/* Bits of RAMCTL vdp2cycp() may select: the VRAM partitioning, and the
+ * rotation data bank select of each bank */
+#define CYCP_CACHE_RAMCTL_MASK  (RAMCTL_VRAMD | RAMCTL_VRBMD | RAMCTL_RDBS_MASK)
+
+/* Number of bytes describing a scroll screen in a canonical key */
+#define CYCP_CACHE_SCRN_SIZE    8
+
+/*-
+ * Canonical key of a state. Only the fields vdp2cycp() depends on are
+ * part of it: the VRAM partitioning, whether the TV screen mode halves
+ * the access timings, and for each enabled scroll screen, its format
+ * type, character color count, reduction, pattern name data size, and
+ * the bank bit-maps of its data, along with the coefficient table and
+ * rotation parameter mode of a rotational background.
+ */
+struct cycp_cache_key {
+        uint8_t bytes[2 + (SCRN_COUNT * CYCP_CACHE_SCRN_SIZE)];
+};
+
+struct cycp_cache_entry {
+        bool valid;
+        int32_t error;
+        uint64_t hash;
+        struct cycp_cache_key key;
+        union vram_cycp vram_cycp;
+        /* Bits of RAMCTL selected, if successful */
+        uint16_t ramctl;
+};
+
+struct cycp_cache_shard {
+        atomic_flag lock;
+
+        uint64_t hit_count;
+        uint64_t miss_count;
+
+        struct cycp_cache_entry entries[CYCP_CACHE_SHARD_SIZE];
+};
+
+struct cycp_cache {
+        struct cycp_cache_shard shards[CYCP_CACHE_SHARD_COUNT];
+};
+
+void cycp_cache_init(struct cycp_cache *);
+int32_t cycp_cache_vdp2cycp(struct cycp_cache *, struct state *);
+void cycp_cache_counts_get(struct cycp_cache *, uint64_t *, uint64_t *);
+
+void cycp_cache_key_get(const struct state *, struct cycp_cache_key *);
+
+#endif /* !CACHE_H_ */
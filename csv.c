@@ -0,0 +1,962 @@
+#include <sys/cdefs.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "csv.h"
+
+#include "debug.h"
+
+#define CRAM_START              0x05F00000
+#define CRAM_END                0x05F7FFFF
+
+/* The last address of VRAM depends on its size (VRSIZE) */
+#define VRAM_START              0x05E00000
+
+/* Number of fields of a row, of the cell format */
+#define CSV_FIELD_COUNT         15
+
+/* Number of fields of a row, of a rotational background giving its
+ * rotation parameter mode and coefficient table */
+#define CSV_FIELD_ROTATION_COUNT        17
+
+#define CSV_FIELD_SCROLL_SCREEN         0
+#define CSV_FIELD_TYPE                  1
+#define CSV_FIELD_CC_COUNT              2
+#define CSV_FIELD_VCS_TABLE             3
+#define CSV_FIELD_REDUCTION             4
+#define CSV_FIELD_CHARACTER_SIZE        5
+#define CSV_FIELD_PND_SIZE              6
+#define CSV_FIELD_CP_TABLE              7
+#define CSV_FIELD_COLOR_PALETTE         8
+#define CSV_FIELD_AUXILIARY_MODE        9
+#define CSV_FIELD_PLANE_SIZE            10
+#define CSV_FIELD_PLANE_A               11
+
+#define CSV_FIELD_BITMAP_WIDTH          5
+#define CSV_FIELD_BITMAP_HEIGHT         6
+#define CSV_FIELD_BITMAP_PATTERN        7
+#define CSV_FIELD_BITMAP_COUNT          9
+
+#define CSV_FIELD_RP_MODE               15
+#define CSV_FIELD_COEFFICIENT_TABLE     16
+
+struct csv_map {
+        const char *name;
+        uint8_t value;
+};
+
+/*-
+ * A field is referenced in place, in the mapped file.
+ */
+struct csv_field {
+        const char *start;
+        const char *end;
+};
+
+struct csv_chunk {
+        const char *start;
+        const char *end;
+
+        uint32_t line_count;
+
+        /* Last address of VRAM */
+        uint32_t vram_end;
+
+        size_t scene_count;
+        size_t scene_capacity;
+        struct csv_scene *scenes;
+
+        /* First error of the chunk, where the line is relative to the
+         * start of the chunk */
+        int32_t ret;
+        uint32_t error_line;
+        const char *error;
+};
+
+static const struct csv_map _map_scroll_screens[] = {
+        { "NBG0", SCRN_NBG0 },
+        { "NBG1", SCRN_NBG1 },
+        { "NBG2", SCRN_NBG2 },
+        { "NBG3", SCRN_NBG3 },
+        { "RBG0", SCRN_RBG0 },
+        { "RBG1", SCRN_RBG1 },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_types[] = {
+        { "cell", SCRN_TYPE_CELL },
+        { "bitmap", SCRN_TYPE_BITMAP },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_cc_counts[] = {
+        { "16", SCRN_CCC_PALETTE_16 },
+        { "256", SCRN_CCC_PALETTE_256 },
+        { "2048", SCRN_CCC_PALETTE_2048 },
+        { "32768", SCRN_CCC_RGB_32768 },
+        { "16770000", SCRN_CCC_RGB_16770000 },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_character_sizes[] = {
+        { "1x1", 1 * 1 },
+        { "2x2", 2 * 2 },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_pnd_sizes[] = {
+        { "1", 1 },
+        { "2", 2 },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_auxiliary_modes[] = {
+        { "0", 0 },
+        { "1", 1 },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_reductions[] = {
+        { "1", SCRN_REDUCTION_NONE },
+        { "1/2", SCRN_REDUCTION_HALF },
+        { "1/4", SCRN_REDUCTION_QUARTER },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_rp_modes[] = {
+        { "0", SCRN_RP_MODE_A },
+        { "1", SCRN_RP_MODE_B },
+        { "2", SCRN_RP_MODE_SWAP_COEFFICIENT },
+        { "3", SCRN_RP_MODE_SWAP_WINDOW },
+        { NULL, 0 }
+};
+
+static const struct csv_map _map_plane_sizes[] = {
+        { "1x1", 1 * 1 },
+        { "2x1", 2 * 1 },
+        { "2x2", 2 * 2 },
+        { NULL, 0 }
+};
+
+static void *csv_chunk_parse(void *);
+static const char *csv_chunk_boundary(const char *, const char *, const char *);
+static struct csv_scene *csv_chunk_scene_add(struct csv_chunk *, uint32_t);
+
+static const char *csv_scene_row_parse(struct csv_scene *, const char *, const char *,
+    uint32_t);
+static const char *csv_row_parse(const char *, const char *, uint32_t,
+    struct scrn_format *);
+static const char *csv_row_rotation_parse(const struct csv_field *, uint32_t, uint32_t,
+    struct scrn_format *);
+static uint32_t csv_row_split(const char *, const char *, struct csv_field *);
+
+static bool csv_field_map(const struct csv_field *, const struct csv_map *, uint8_t *);
+static bool csv_field_number(const struct csv_field *, uint32_t *);
+static bool csv_field_address(const struct csv_field *, uint32_t, uint32_t, bool, uint32_t *);
+
+/*-
+ * Load every scene of the CSV file PATH into CSV.
+ *
+ * The file is mapped into memory, and fields are tokenized in place.
+ * Files of at least CSV_CHUNK_SIZE_MIN bytes are split into chunks at
+ * scene boundaries, and each chunk is parsed by one of THREAD_COUNT
+ * threads.
+ *
+ * The first line is a header, and is skipped. Each following row
+ * describes a scroll screen, and blank lines separate scenes. Addresses
+ * are validated against the CRAM range, and the VRAM range of the VRAM
+ * size VRSIZE, either 4-Mbit, or 8-Mbit when VRSIZE_VRAMSZ is set.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CSV or PATH is NULL
+ *   - -2 File could not be read
+ *   - -3 Memory could not be allocated
+ *   - -4 File is not valid, where CSV->error_line and CSV->error describe
+ *        the first error
+ */
+int32_t
+csv_load(struct csv *csv, const char *path, uint16_t vrsize, uint32_t thread_count)
+{
+        if ((csv == NULL) || (path == NULL)) {
+                return -1;
+        }
+
+        memset(csv, 0x00, sizeof(*csv));
+
+        if (thread_count == 0) {
+                thread_count = 1;
+        }
+
+        int fd;
+        fd = open(path, O_RDONLY);
+
+        if (fd < 0) {
+                return -2;
+        }
+
+        struct stat st;
+
+        if ((fstat(fd, &st)) < 0) {
+                (void)close(fd);
+                return -2;
+        }
+
+        size_t size;
+        size = st.st_size;
+
+        if (size == 0) {
+                (void)close(fd);
+
+                csv->error_line = 1;
+                csv->error = "Missing header";
+
+                return -4;
+        }
+
+        const char *buffer;
+        buffer = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        (void)close(fd);
+
+        if (buffer == MAP_FAILED) {
+                return -2;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        const char *end;
+        end = buffer + size;
+
+        /* Skip the header */
+        const char *start;
+        start = memchr(buffer, '\n', size);
+        start = (start == NULL) ? end : (start + 1);
+
+        uint32_t chunk_count;
+        chunk_count = (size / CSV_CHUNK_SIZE_MIN) + 1;
+
+        if (chunk_count > thread_count) {
+                chunk_count = thread_count;
+        }
+
+        struct csv_chunk *chunks;
+        chunks = calloc(chunk_count, sizeof(struct csv_chunk));
+        pthread_t *threads;
+        threads = calloc(chunk_count, sizeof(pthread_t));
+        bool *threads_created;
+        threads_created = calloc(chunk_count, sizeof(bool));
+
+        if ((chunks == NULL) || (threads == NULL) || (threads_created == NULL)) {
+                ret = -3;
+                goto exit;
+        }
+
+        const char *chunk_start;
+        chunk_start = start;
+
+        uint32_t i;
+        for (i = 0; i < chunk_count; i++) {
+                struct csv_chunk *chunk;
+                chunk = &chunks[i];
+
+                chunk->start = chunk_start;
+                chunk->end = end;
+                chunk->vram_end = VRAM_START + VRAM_SIZE(vrsize) - 1;
+
+                if (i < (chunk_count - 1)) {
+                        const char *target;
+                        target = start + (((end - start) / chunk_count) * (i + 1));
+
+                        if (target < chunk_start) {
+                                target = chunk_start;
+                        }
+
+                        chunk->end = csv_chunk_boundary(chunk_start, target, end);
+                }
+
+                chunk_start = chunk->end;
+        }
+
+        for (i = 0; i < chunk_count; i++) {
+                threads_created[i] = (pthread_create(&threads[i], NULL,
+                        csv_chunk_parse, &chunks[i])) == 0;
+
+                /* Parse the chunk if a thread could not be created */
+                if (!threads_created[i]) {
+                        (void)csv_chunk_parse(&chunks[i]);
+                }
+        }
+
+        size_t scene_count;
+        scene_count = 0;
+
+        /* The header is the first line */
+        uint32_t line;
+        line = 2;
+
+        for (i = 0; i < chunk_count; i++) {
+                struct csv_chunk *chunk;
+                chunk = &chunks[i];
+
+                if (threads_created[i]) {
+                        (void)pthread_join(threads[i], NULL);
+                }
+
+                if ((ret == 0) && (chunk->ret < 0)) {
+                        ret = chunk->ret;
+
+                        csv->error_line = line + chunk->error_line;
+                        csv->error = chunk->error;
+                }
+
+                /* Make the line of each scene relative to the file */
+                size_t scene;
+                for (scene = 0; scene < chunk->scene_count; scene++) {
+                        chunk->scenes[scene].line += line;
+                }
+
+                scene_count += chunk->scene_count;
+                line += chunk->line_count;
+        }
+
+        if (ret < 0) {
+                goto exit;
+        }
+
+        csv->scenes = malloc((scene_count + 1) * sizeof(struct csv_scene));
+
+        if (csv->scenes == NULL) {
+                ret = -3;
+                goto exit;
+        }
+
+        for (i = 0; i < chunk_count; i++) {
+                struct csv_chunk *chunk;
+                chunk = &chunks[i];
+
+                if (chunk->scene_count == 0) {
+                        continue;
+                }
+
+                (void)memcpy(&csv->scenes[csv->scene_count], chunk->scenes,
+                    chunk->scene_count * sizeof(struct csv_scene));
+
+                csv->scene_count += chunk->scene_count;
+        }
+
+exit:
+        if (chunks != NULL) {
+                for (i = 0; i < chunk_count; i++) {
+                        free(chunks[i].scenes);
+                }
+        }
+
+        free(threads_created);
+        free(threads);
+        free(chunks);
+
+        (void)munmap((void *)buffer, size);
+
+        return ret;
+}
+
+/*-
+ * Free the scenes of CSV.
+ */
+void
+csv_unload(struct csv *csv)
+{
+        if (csv == NULL) {
+                return;
+        }
+
+        free(csv->scenes);
+
+        csv->scenes = NULL;
+        csv->scene_count = 0;
+}
+
+/*-
+ * Parse the row from START to END, without its line break, as the next
+ * scroll screen of the scene SCENE, as csv_load() parses the rows of a
+ * CSV file, with the VRAM size VRSIZE. A scene starts out zeroed.
+ *
+ * If successful, NULL is returned. Otherwise, a description of the error
+ * is returned, and the scroll screen is not added.
+ */
+const char *
+csv_scene_row_add(struct csv_scene *scene, const char *start, const char *end,
+    uint16_t vrsize)
+{
+        return csv_scene_row_parse(scene, start, end, VRAM_START + VRAM_SIZE(vrsize) - 1);
+}
+
+/*-
+ * Write a pointer to each scroll screen format of the scene SCENE to
+ * FORMATS, followed by NULL, as state_init() expects. FORMATS must hold
+ * SCRN_COUNT + 1 pointers.
+ */
+void
+csv_scene_formats_get(const struct csv_scene *scene, const struct scrn_format **formats)
+{
+        uint32_t i;
+        for (i = 0; i < scene->format_count; i++) {
+                formats[i] = &scene->formats[i];
+        }
+
+        formats[i] = NULL;
+}
+
+static void *
+csv_chunk_parse(void *arg)
+{
+        struct csv_chunk *chunk;
+        chunk = arg;
+
+        struct csv_scene *scene;
+        scene = NULL;
+
+        const char *p;
+        for (p = chunk->start; p < chunk->end; chunk->line_count++) {
+                const char *eol;
+                eol = memchr(p, '\n', chunk->end - p);
+
+                if (eol == NULL) {
+                        eol = chunk->end;
+                }
+
+                const char *line_start;
+                line_start = p;
+
+                p = (eol < chunk->end) ? (eol + 1) : eol;
+
+                if (chunk->ret < 0) {
+                        continue;
+                }
+
+                if (csv_line_blank(line_start, eol)) {
+                        scene = NULL;
+                        continue;
+                }
+
+                if (scene == NULL) {
+                        scene = csv_chunk_scene_add(chunk, chunk->line_count);
+
+                        if (scene == NULL) {
+                                chunk->ret = -3;
+                                chunk->error_line = chunk->line_count;
+                                chunk->error = "Out of memory";
+                                continue;
+                        }
+                }
+
+                const char *error;
+                error = csv_scene_row_parse(scene, line_start, eol, chunk->vram_end);
+
+                if (error != NULL) {
+                        chunk->ret = -4;
+                        chunk->error_line = chunk->line_count;
+                        chunk->error = error;
+                        continue;
+                }
+        }
+
+        return NULL;
+}
+
+/*-
+ * Return the start of the first scene starting at or after TARGET,
+ * amongst the lines from START to END. END is returned if there is none.
+ */
+static const char *
+csv_chunk_boundary(const char *start, const char *target, const char *end)
+{
+        const char *p;
+        p = target;
+
+        /* Move to the start of a line */
+        while ((p > start) && (p[-1] != '\n')) {
+                p--;
+        }
+
+        bool blank;
+        blank = false;
+
+        while (p < end) {
+                const char *eol;
+                eol = memchr(p, '\n', end - p);
+
+                if (eol == NULL) {
+                        return end;
+                }
+
+                bool line_blank;
+                line_blank = csv_line_blank(p, eol);
+
+                if (blank && !line_blank) {
+                        return p;
+                }
+
+                blank = line_blank;
+                p = eol + 1;
+        }
+
+        return end;
+}
+
+static struct csv_scene *
+csv_chunk_scene_add(struct csv_chunk *chunk, uint32_t line)
+{
+        if (chunk->scene_count == chunk->scene_capacity) {
+                size_t scene_capacity;
+                scene_capacity = (chunk->scene_capacity == 0) ? 64 : (chunk->scene_capacity * 2);
+
+                struct csv_scene *scenes;
+                scenes = realloc(chunk->scenes, scene_capacity * sizeof(struct csv_scene));
+
+                if (scenes == NULL) {
+                        return NULL;
+                }
+
+                chunk->scenes = scenes;
+                chunk->scene_capacity = scene_capacity;
+        }
+
+        struct csv_scene *scene;
+        scene = &chunk->scenes[chunk->scene_count];
+
+        chunk->scene_count++;
+
+        memset(scene, 0x00, sizeof(*scene));
+
+        scene->line = line;
+
+        return scene;
+}
+
+/*-
+ * Parse the row from START to END, without its line break, as the next
+ * scroll screen of the scene SCENE, where VRAM_END is the last address of
+ * VRAM.
+ *
+ * If successful, NULL is returned. Otherwise, a description of the error
+ * is returned, and the scroll screen is not added.
+ */
+static const char *
+csv_scene_row_parse(struct csv_scene *scene, const char *start, const char *end,
+    uint32_t vram_end)
+{
+        if (scene->format_count == SCRN_COUNT) {
+                return "Too many scroll screens in scene";
+        }
+
+        struct scrn_format *format;
+        format = &scene->formats[scene->format_count];
+
+        const char *error;
+
+        if ((error = csv_row_parse(start, end, vram_end, format)) != NULL) {
+                return error;
+        }
+
+        uint32_t i;
+        for (i = 0; i < scene->format_count; i++) {
+                if (scene->formats[i].sf_scroll_screen == format->sf_scroll_screen) {
+                        return "Scroll screen appears more than once in scene";
+                }
+        }
+
+        scene->format_count++;
+
+        return NULL;
+}
+
+/*-
+ * Parse the row from START to END into FORMAT, where VRAM_END is the last
+ * address of VRAM.
+ *
+ * If successful, NULL is returned. Otherwise, a description of the error
+ * is returned.
+ */
+static const char *
+csv_row_parse(const char *start, const char *end, uint32_t vram_end,
+    struct scrn_format *format)
+{
+        struct csv_field fields[CSV_FIELD_ROTATION_COUNT];
+
+        uint32_t field_count;
+        field_count = csv_row_split(start, end, fields);
+
+        memset(format, 0x00, sizeof(*format));
+
+        format->sf_enable = true;
+
+        if (field_count <= CSV_FIELD_REDUCTION) {
+                return "Invalid arguments for SCRNFormat";
+        }
+
+        if (!csv_field_map(&fields[CSV_FIELD_SCROLL_SCREEN], _map_scroll_screens,
+                &format->sf_scroll_screen)) {
+                return "Invalid scroll screen";
+        }
+
+        if (!csv_field_map(&fields[CSV_FIELD_TYPE], _map_types, &format->sf_type)) {
+                return "Invalid format specified: cell, bitmap";
+        }
+
+        if (!csv_field_map(&fields[CSV_FIELD_CC_COUNT], _map_cc_counts,
+                &format->sf_cc_count)) {
+                return "Invalid character color count";
+        }
+
+        if (!csv_field_address(&fields[CSV_FIELD_VCS_TABLE], VRAM_START, vram_end,
+                true, &format->sf_vcs_table)) {
+                return "Vertical cell scroll table address is not within VRAM";
+        }
+
+        if (!csv_field_map(&fields[CSV_FIELD_REDUCTION], _map_reductions,
+                &format->sf_reduction)) {
+                return "Invalid reduction";
+        }
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                if (field_count < CSV_FIELD_COUNT) {
+                        return "Invalid arguments for SCRNCellFormat";
+                }
+
+                if (!csv_field_map(&fields[CSV_FIELD_CHARACTER_SIZE], _map_character_sizes,
+                        &cell_format->scf_character_size)) {
+                        return "Invalid character size";
+                }
+
+                if (!csv_field_map(&fields[CSV_FIELD_PND_SIZE], _map_pnd_sizes,
+                        &cell_format->scf_pnd_size)) {
+                        return "Invalid pattern name data size";
+                }
+
+                if (!csv_field_address(&fields[CSV_FIELD_CP_TABLE], VRAM_START, vram_end,
+                        false, &cell_format->scf_cp_table)) {
+                        return "Character pattern table address is not within VRAM";
+                }
+
+                if (!csv_field_address(&fields[CSV_FIELD_COLOR_PALETTE], CRAM_START, CRAM_END,
+                        false, &cell_format->scf_color_palette)) {
+                        return "Color palette address is not within CRAM";
+                }
+
+                if (!csv_field_map(&fields[CSV_FIELD_AUXILIARY_MODE], _map_auxiliary_modes,
+                        &cell_format->scf_auxiliary_mode)) {
+                        return "Invalid auxiliary mode";
+                }
+
+                if (!csv_field_map(&fields[CSV_FIELD_PLANE_SIZE], _map_plane_sizes,
+                        &cell_format->scf_plane_size)) {
+                        return "Invalid plane size";
+                }
+
+                uint32_t plane;
+                for (plane = 0; plane < 4; plane++) {
+                        if (!csv_field_address(&fields[CSV_FIELD_PLANE_A + plane], VRAM_START,
+                                vram_end, false, &cell_format->scf_map.planes[plane])) {
+                                return "Plane address is not within VRAM";
+                        }
+                }
+
+                return csv_row_rotation_parse(fields, field_count, vram_end, format);
+        }
+
+        struct scrn_bitmap_format *bitmap_format;
+        bitmap_format = &format->sf_format.bitmap;
+
+        if (field_count < CSV_FIELD_BITMAP_COUNT) {
+                return "Invalid arguments for SCRNBitmapFormat";
+        }
+
+        uint32_t width;
+        uint32_t height;
+
+        if ((!csv_field_number(&fields[CSV_FIELD_BITMAP_WIDTH], &width)) ||
+            ((width != 512) && (width != 1024))) {
+                return "Invalid bitmap width specified";
+        }
+
+        if ((!csv_field_number(&fields[CSV_FIELD_BITMAP_HEIGHT], &height)) ||
+            ((height != 256) && (height != 512))) {
+                return "Invalid bitmap height specified";
+        }
+
+        bitmap_format->sbf_bitmap_size.width = width;
+        bitmap_format->sbf_bitmap_size.height = height;
+
+        if (!csv_field_address(&fields[CSV_FIELD_BITMAP_PATTERN], VRAM_START, vram_end,
+                false, &bitmap_format->sbf_bitmap_pattern)) {
+                return "Bitmap pattern address is not within VRAM";
+        }
+
+        if (!csv_field_address(&fields[CSV_FIELD_COLOR_PALETTE], CRAM_START, CRAM_END,
+                false, &bitmap_format->sbf_color_palette)) {
+                return "Color palette address is not within CRAM";
+        }
+
+        return csv_row_rotation_parse(fields, field_count, vram_end, format);
+}
+
+/*-
+ * Parse the rotation parameter mode and coefficient table of the
+ * FIELD_COUNT fields FIELDS into FORMAT, if FORMAT is of a rotational
+ * background. Either field may be left empty, or out, for rotation
+ * parameter A and no coefficient table. The coefficient table may be in
+ * VRAM, where VRAM_END is its last address, or in CRAM.
+ *
+ * If successful, NULL is returned. Otherwise, a description of the error
+ * is returned.
+ */
+static const char *
+csv_row_rotation_parse(const struct csv_field *fields, uint32_t field_count,
+    uint32_t vram_end, struct scrn_format *format)
+{
+        if ((format->sf_scroll_screen != SCRN_RBG0) &&
+            (format->sf_scroll_screen != SCRN_RBG1)) {
+                return NULL;
+        }
+
+        uint8_t rp_mode;
+        rp_mode = SCRN_RP_MODE_A;
+
+        if ((field_count > CSV_FIELD_RP_MODE) &&
+            (fields[CSV_FIELD_RP_MODE].start != fields[CSV_FIELD_RP_MODE].end) &&
+            (!csv_field_map(&fields[CSV_FIELD_RP_MODE], _map_rp_modes, &rp_mode))) {
+                return "Invalid rotation parameter mode";
+        }
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                format->sf_format.cell.scf_rp_mode = rp_mode;
+        } else {
+                format->sf_format.bitmap.sbf_rp_mode = rp_mode;
+        }
+
+        if ((field_count > CSV_FIELD_COEFFICIENT_TABLE) &&
+            (fields[CSV_FIELD_COEFFICIENT_TABLE].start !=
+                fields[CSV_FIELD_COEFFICIENT_TABLE].end) &&
+            (!csv_field_address(&fields[CSV_FIELD_COEFFICIENT_TABLE], VRAM_START, vram_end,
+                true, &format->sf_coefficient_table)) &&
+            (!csv_field_address(&fields[CSV_FIELD_COEFFICIENT_TABLE], CRAM_START, CRAM_END,
+                true, &format->sf_coefficient_table))) {
+                return "Coefficient table address is not within VRAM or CRAM";
+        }
+
+        return NULL;
+}
+
+/*-
+ * Split the row from START to END into at most CSV_FIELD_ROTATION_COUNT
+ * fields, and return the number of fields. A field may be enclosed in
+ * double quotes, in which case it may contain commas.
+ */
+static uint32_t
+csv_row_split(const char *start, const char *end, struct csv_field *fields)
+{
+        uint32_t field_count;
+        field_count = 0;
+
+        const char *p;
+        p = start;
+
+        while (field_count < CSV_FIELD_ROTATION_COUNT) {
+                struct csv_field *field;
+                field = &fields[field_count];
+
+                field_count++;
+
+                if ((p < end) && (*p == '"')) {
+                        const char *quote;
+                        quote = memchr(p + 1, '"', end - (p + 1));
+
+                        field->start = p + 1;
+                        field->end = (quote == NULL) ? end : quote;
+
+                        p = (quote == NULL) ? end : (quote + 1);
+                        p = memchr(p, ',', end - p);
+                } else {
+                        field->start = p;
+
+                        p = memchr(p, ',', end - p);
+
+                        field->end = (p == NULL) ? end : p;
+                }
+
+                if (p == NULL) {
+                        break;
+                }
+
+                /* Skip the comma */
+                p++;
+        }
+
+        return field_count;
+}
+
+/*-
+ * Determine if the line from START to END, without its line break, is
+ * blank.
+ */
+bool
+csv_line_blank(const char *start, const char *end)
+{
+        const char *p;
+        for (p = start; p < end; p++) {
+                if ((*p != ' ') && (*p != '\t') && (*p != '\r')) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/*-
+ * Look up the field FIELD amongst the names of the map MAP, ignoring
+ * whitespace, and write the value to VALUE.
+ *
+ * If the field is found, true is returned.
+ */
+static bool
+csv_field_map(const struct csv_field *field, const struct csv_map *map, uint8_t *value)
+{
+        for (; map->name != NULL; map++) {
+                const char *name;
+                name = map->name;
+
+                const char *p;
+                for (p = field->start; p < field->end; p++) {
+                        if ((*p == ' ') || (*p == '\t') || (*p == '\r')) {
+                                continue;
+                        }
+
+                        if (*p != *name) {
+                                break;
+                        }
+
+                        name++;
+                }
+
+                if ((p == field->end) && (*name == '\0')) {
+                        *value = map->value;
+
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/*-
+ * Convert the field FIELD, either a decimal or a hexadecimal number
+ * prefixed with 0x, and write it to VALUE.
+ *
+ * If successful, true is returned.
+ */
+static bool
+csv_field_number(const struct csv_field *field, uint32_t *value)
+{
+        const char *start;
+        start = field->start;
+        const char *end;
+        end = field->end;
+
+        while ((start < end) && ((*start == ' ') || (*start == '\t'))) {
+                start++;
+        }
+
+        while ((end > start) && ((end[-1] == ' ') || (end[-1] == '\t') || (end[-1] == '\r'))) {
+                end--;
+        }
+
+        uint32_t base;
+        base = 10;
+
+        if (((end - start) > 2) && (start[0] == '0') && ((start[1] == 'x') || (start[1] == 'X'))) {
+                base = 16;
+                start += 2;
+        }
+
+        if (start == end) {
+                return false;
+        }
+
+        uint64_t number;
+        number = 0;
+
+        const char *p;
+        for (p = start; p < end; p++) {
+                uint32_t digit;
+
+                if ((*p >= '0') && (*p <= '9')) {
+                        digit = *p - '0';
+                } else if ((base == 16) && (*p >= 'a') && (*p <= 'f')) {
+                        digit = *p - 'a' + 10;
+                } else if ((base == 16) && (*p >= 'A') && (*p <= 'F')) {
+                        digit = *p - 'A' + 10;
+                } else {
+                        return false;
+                }
+
+                number = (number * base) + digit;
+
+                if (number > UINT32_MAX) {
+                        return false;
+                }
+        }
+
+        *value = number;
+
+        return true;
+}
+
+/*-
+ * Convert the address in the field FIELD, and write it to VALUE. The
+ * cache-through bits are masked off, and the address must lie within
+ * FROM and TO. If ALLOW_ZERO is true, an address of zero (unused) is
+ * accepted as well.
+ *
+ * If successful, true is returned.
+ */
+static bool
+csv_field_address(const struct csv_field *field, uint32_t from, uint32_t to,
+    bool allow_zero, uint32_t *value)
+{
+        uint32_t address;
+
+        if (!csv_field_number(field, &address)) {
+                return false;
+        }
+
+        if (allow_zero && (address == 0x00000000)) {
+                *value = address;
+
+                return true;
+        }
+
+        address &= 0x0FFFFFFF;
+
+        if ((address < from) || (address > to)) {
+                return false;
+        }
+
+        *value = address;
+
+        return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef CSV_H_
+#define CSV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2.h"
+
+/* Files smaller than this are parsed by a single thread */
+#define CSV_CHUNK_SIZE_MIN      (1024 * 1024)
+
+/*-
+ * A scene is the scroll screens of consecutive rows of a CSV file. Scenes
+ * are separated by blank lines.
+ */
+struct csv_scene {
+        uint32_t line;                  /* Line of the first row */
+
+        uint32_t format_count;
+        struct scrn_format formats[SCRN_COUNT];
+};
+
+struct csv {
+        size_t scene_count;
+        struct csv_scene *scenes;
+
+        /* Line and description of the first error found, if the file is
+         * not valid */
+        uint32_t error_line;
+        const char *error;
+};
+
+int32_t csv_load(struct csv *, const char *, uint16_t, uint32_t);
+void csv_unload(struct csv *);
+
+const char *csv_scene_row_add(struct csv_scene *, const char *, const char *, uint16_t);
+void csv_scene_formats_get(const struct csv_scene *, const struct scrn_format **);
+
+bool csv_line_blank(const char *, const char *);
+
+#endif /* !CSV_H_ */
@@ -0,0 +1,489 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cycpdb.h"
+#include "atlas.h"
+
+#include "math.h"
+#include "debug.h"
+
+/* Database linked in from the output of atlas_cycpdb_generate(), if
+ * any */
+extern const uint8_t _binary_cycpdb_bin_start[] __attribute__ ((weak));
+extern const uint8_t _binary_cycpdb_bin_end[] __attribute__ ((weak));
+
+static uint16_t read16(const uint8_t *);
+static uint32_t read32(const uint8_t *);
+static uint64_t read64(const uint8_t *);
+
+static uint32_t cycpdb_rank(const struct cycpdb *, uint32_t);
+static uint32_t cycpdb_word_remap(uint32_t, const uint32_t *);
+
+static uint32_t atlas_rank(const uint32_t *);
+
+/*-
+ * Initialize the database DB from the SIZE bytes at BLOB, as written by
+ * atlas_cycpdb_generate(). BLOB is referenced, not copied.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 DB or BLOB is NULL
+ *   - -2 BLOB is not a valid database
+ */
+int32_t
+cycpdb_init(struct cycpdb *db, const void *blob, size_t size)
+{
+        if ((db == NULL) || (blob == NULL)) {
+                return -1;
+        }
+
+        memset(db, 0x00, sizeof(*db));
+
+        const uint8_t *bytes;
+        bytes = blob;
+
+        struct cycpdb_header header;
+
+        if (size < sizeof(header)) {
+                return -2;
+        }
+
+        (void)memcpy(&header, bytes, sizeof(header));
+
+        if (((memcmp(header.magic, CYCPDB_MAGIC, sizeof(header.magic))) != 0) ||
+            (header.version != CYCPDB_VERSION) ||
+            (header.class_count > ATLAS_CLASS_COUNT_MAX) ||
+            (header.entry_count != (binomial(header.class_count + 3, 4) * ATLAS_SPLIT_COUNT)) ||
+            (header.feasible_count > header.entry_count)) {
+                return -2;
+        }
+
+        uint32_t block_count;
+        block_count = (header.entry_count + CYCPDB_BLOCK_SIZE - 1) / CYCPDB_BLOCK_SIZE;
+
+        uint32_t bitmap_word_count;
+        bitmap_word_count = (header.entry_count + 63) / 64;
+
+        size_t expected_size;
+        expected_size = sizeof(header) +
+            (header.class_count * sizeof(struct atlas_class)) +
+            (header.word_count * sizeof(uint32_t)) +
+            (block_count * sizeof(uint32_t)) +
+            (bitmap_word_count * sizeof(uint64_t)) +
+            (header.feasible_count * VRAM_BANK_COUNT * sizeof(uint16_t));
+
+        if (size != expected_size) {
+                return -2;
+        }
+
+        bytes += sizeof(header);
+
+        db->class_count = header.class_count;
+        db->classes = (const struct atlas_class *)bytes;
+        bytes += header.class_count * sizeof(struct atlas_class);
+
+        db->entry_count = header.entry_count;
+        db->feasible_count = header.feasible_count;
+
+        db->word_count = header.word_count;
+        db->words = bytes;
+        bytes += header.word_count * sizeof(uint32_t);
+
+        db->ranks = bytes;
+        bytes += block_count * sizeof(uint32_t);
+
+        db->bitmap = bytes;
+        bytes += bitmap_word_count * sizeof(uint64_t);
+
+        db->values = bytes;
+
+        /* The ranks must count the feasible entries preceding each block,
+         * as the bit-map does, for the rank of a feasible entry to index
+         * the values */
+        uint32_t feasible_count;
+        feasible_count = 0;
+
+        uint32_t i;
+        for (i = 0; i < bitmap_word_count; i++) {
+                if ((((i * 64) % CYCPDB_BLOCK_SIZE) == 0) &&
+                    ((read32(&db->ranks[(i * 64 / CYCPDB_BLOCK_SIZE) * sizeof(uint32_t)])) != feasible_count)) {
+                        return -2;
+                }
+
+                uint64_t word;
+                word = read64(&db->bitmap[i * sizeof(uint64_t)]);
+
+                feasible_count += bit_count(word & 0xFFFFFFFF) + bit_count(word >> 32);
+        }
+
+        if (feasible_count != header.feasible_count) {
+                return -2;
+        }
+
+        /* No bit may be set past the last entry */
+        if (((header.entry_count % 64) != 0) &&
+            (((read64(&db->bitmap[(bitmap_word_count - 1) * sizeof(uint64_t)])) >> (header.entry_count % 64)) != 0)) {
+                return -2;
+        }
+
+        /* Every value must index the word pool */
+        for (i = 0; i < (header.feasible_count * VRAM_BANK_COUNT); i++) {
+                if ((read16(&db->values[i * sizeof(uint16_t)])) >= header.word_count) {
+                        return -2;
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Initialize the database DB from the database linked into the program.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 DB is NULL
+ *   - -2 No database is linked in, or it is not a valid database
+ */
+int32_t
+cycpdb_builtin_init(struct cycpdb *db)
+{
+        if (db == NULL) {
+                return -1;
+        }
+
+        memset(db, 0x00, sizeof(*db));
+
+        if ((_binary_cycpdb_bin_start == NULL) || (_binary_cycpdb_bin_end == NULL)) {
+                return -2;
+        }
+
+        return cycpdb_init(db, _binary_cycpdb_bin_start,
+            _binary_cycpdb_bin_end - _binary_cycpdb_bin_start);
+}
+
+/*-
+ * Look up the VDP2 VRAM cycle patterns of STATE in the database DB.
+ *
+ * The NBGs are mapped to their classes, the classes are sorted to find
+ * the atlas entry, and the stored solution is remapped from the sorted
+ * NBG order back to the NBGs of STATE. No search takes place.
+ *
+ * If successful, 0 is returned and the cycle patterns are written to
+ * STATE. Otherwise, a negative value is returned for the following
+ * cases:
+ *
+ *   - -1 DB or STATE is NULL
+ *   - -2 STATE is not covered by the database
+ *   - -3 STATE is covered by the database, but is not feasible
+ */
+int32_t
+cycpdb_lookup(const struct cycpdb *db, struct state *state)
+{
+        if ((db == NULL) || (state == NULL)) {
+                return -1;
+        }
+
+        if (db->values == NULL) {
+                return -2;
+        }
+
+        /* The database only covers the normal TV screen modes */
+        if (TVMD_TIMINGS_HALVED(state->tvmd)) {
+                return -2;
+        }
+
+        uint32_t classes[4];
+
+        if ((atlas_classes_get(db->classes, db->class_count, state, classes)) < 0) {
+                return -2;
+        }
+
+        /* Sort the classes, keeping track of the NBG each came from */
+        uint32_t scrns[4];
+
+        uint32_t i;
+        for (i = 0; i < 4; i++) {
+                uint32_t j;
+                for (j = i; (j > 0) && (classes[scrns[j - 1]] > classes[i]); j--) {
+                        scrns[j] = scrns[j - 1];
+                }
+
+                scrns[j] = i;
+        }
+
+        uint32_t sorted_classes[4];
+
+        for (i = 0; i < 4; i++) {
+                sorted_classes[i] = classes[scrns[i]];
+        }
+
+        uint32_t index;
+        index = atlas_index_get(sorted_classes, state->ramctl);
+
+        if (index >= db->entry_count) {
+                return -2;
+        }
+
+        uint64_t bitmap_word;
+        bitmap_word = read64(&db->bitmap[(index / 64) * sizeof(uint64_t)]);
+
+        if ((bitmap_word & (1ULL << (index % 64))) == 0) {
+                return -3;
+        }
+
+        const uint8_t *values;
+        values = &db->values[cycpdb_rank(db, index) * VRAM_BANK_COUNT * sizeof(uint16_t)];
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint16_t word_index;
+                word_index = read16(&values[bank * sizeof(uint16_t)]);
+
+                uint32_t word;
+                word = read32(&db->words[word_index * sizeof(uint32_t)]);
+
+                state->vram_cycp.pv[bank] = cycpdb_word_remap(word, scrns);
+        }
+
+        state->solved = true;
+
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE, as vdp2cycp() does, by
+ * looking them up in the database DB first.
+ *
+ * States not covered by the database, and infeasible states (in order
+ * to return the same error) are calculated by calling vdp2cycp().
+ *
+ * The value vdp2cycp() returns is returned, or -1 if DB or STATE is
+ * NULL.
+ */
+int32_t
+cycpdb_vdp2cycp(const struct cycpdb *db, struct state *state)
+{
+        if ((db == NULL) || (state == NULL)) {
+                return -1;
+        }
+
+        if ((cycpdb_lookup(db, state)) == 0) {
+                return 0;
+        }
+
+        return vdp2cycp(state);
+}
+
+/*-
+ * The atlas indexes its entries as the database does, so the indexing is
+ * part of libvdp2cycp, along with the database, whereas the atlas is not.
+ */
+
+/*-
+ * Determine the class of each NBG of STATE amongst the CLASS_COUNT
+ * classes CLASSES, and write them to SCENE_CLASSES.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 The format of an NBG is rejected by the access timing tables
+ *   - -2 STATE is not covered by the classes (a rotational background or
+ *        vertical cell scroll is used, data is stored beyond the end of
+ *        VRAM, or an NBG does not fit any class)
+ */
+int32_t
+atlas_classes_get(const struct atlas_class *classes, uint32_t class_count,
+    const struct state *state, uint32_t *scene_classes)
+{
+        if ((state->rbg0.format.sf_enable) || (state->rbg1.format.sf_enable)) {
+                return -2;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                scene_classes[scrn] = 0;
+
+                if (!scroll_screen->format.sf_enable) {
+                        continue;
+                }
+
+                if (scroll_screen->vram_exceeded != 0x00) {
+                        return -2;
+                }
+
+                uint8_t tvcs;
+                uint8_t tpnd;
+                uint8_t tcpd;
+
+                if ((cycp_calculate_timings(&scroll_screen->format, &tvcs, &tpnd, &tcpd)) < 0) {
+                        return -1;
+                }
+
+                if (tvcs != 0) {
+                        return -2;
+                }
+
+                uint32_t class;
+                for (class = 1; class < class_count; class++) {
+                        const struct atlas_class *atlas_class;
+                        atlas_class = &classes[class];
+
+                        if ((atlas_class->tpnd == tpnd) &&
+                            (atlas_class->tcpd == tcpd) &&
+                            (atlas_class->pnd_bitmap == scroll_screen->pnd_bitmap) &&
+                            (atlas_class->cpd_bitmap == scroll_screen->cpd_bitmap)) {
+                                break;
+                        }
+                }
+
+                if (class == class_count) {
+                        return -2;
+                }
+
+                scene_classes[scrn] = class;
+        }
+
+        return 0;
+}
+
+/*-
+ * Return the atlas index of the NBG classes SCENE_CLASSES, with the VRAM
+ * partitioning of RAMCTL.
+ */
+uint32_t
+atlas_index_get(const uint32_t *scene_classes, uint16_t ramctl)
+{
+        return (atlas_rank(scene_classes) * ATLAS_SPLIT_COUNT) +
+            ((ramctl & (RAMCTL_VRAMD | RAMCTL_VRBMD)) >> 8);
+}
+
+static uint16_t
+read16(const uint8_t *bytes)
+{
+        uint16_t value;
+
+        (void)memcpy(&value, bytes, sizeof(value));
+
+        return value;
+}
+
+static uint32_t
+read32(const uint8_t *bytes)
+{
+        uint32_t value;
+
+        (void)memcpy(&value, bytes, sizeof(value));
+
+        return value;
+}
+
+static uint64_t
+read64(const uint8_t *bytes)
+{
+        uint64_t value;
+
+        (void)memcpy(&value, bytes, sizeof(value));
+
+        return value;
+}
+
+/*-
+ * Return the rank of the multi-set of 4 classes CLASSES.
+ *
+ * The multi-set c0 <= c1 <= c2 <= c3 maps to the combination
+ * d0 < d1 < d2 < d3, where di = ci + i, which is ranked in
+ * co-lexicographic order.
+ */
+static uint32_t
+atlas_rank(const uint32_t *classes)
+{
+        uint32_t sorted[4];
+
+        (void)memcpy(sorted, classes, sizeof(sorted));
+
+        uint32_t i;
+        for (i = 1; i < 4; i++) {
+                uint32_t class;
+                class = sorted[i];
+
+                uint32_t j;
+                for (j = i; (j > 0) && (sorted[j - 1] > class); j--) {
+                        sorted[j] = sorted[j - 1];
+                }
+
+                sorted[j] = class;
+        }
+
+        uint32_t rank;
+        rank = 0;
+
+        for (i = 0; i < 4; i++) {
+                rank += binomial(sorted[i] + i, i + 1);
+        }
+
+        return rank;
+}
+
+/*-
+ * Return the number of feasible entries preceding the entry at INDEX of
+ * the database DB.
+ */
+static uint32_t
+cycpdb_rank(const struct cycpdb *db, uint32_t index)
+{
+        uint32_t rank;
+        rank = read32(&db->ranks[(index / CYCPDB_BLOCK_SIZE) * sizeof(uint32_t)]);
+
+        uint32_t bitmap_index;
+        bitmap_index = (index / CYCPDB_BLOCK_SIZE) * (CYCPDB_BLOCK_SIZE / 64);
+
+        for (; bitmap_index <= (index / 64); bitmap_index++) {
+                uint64_t bitmap_word;
+                bitmap_word = read64(&db->bitmap[bitmap_index * sizeof(uint64_t)]);
+
+                if (bitmap_index == (index / 64)) {
+                        bitmap_word &= (1ULL << (index % 64)) - 1;
+                }
+
+                rank += bit_count(bitmap_word) + bit_count(bitmap_word >> 32);
+        }
+
+        return rank;
+}
+
+/*-
+ * Return the cycle pattern word WORD, where the pattern name and
+ * character pattern data accesses of the NBG at each position of the
+ * sorted order are replaced by those of the NBG SCRNS[position].
+ */
+static uint32_t
+cycpdb_word_remap(uint32_t word, const uint32_t *scrns)
+{
+        uint32_t remapped_word;
+        remapped_word = 0;
+
+        uint32_t timing;
+        for (timing = 0; timing < 8; timing++) {
+                uint32_t shift;
+                shift = timing * 4;
+
+                uint32_t code;
+                code = (word >> shift) & 0x0F;
+
+                if (code <= 0x07) {
+                        code = (code & 0x04) | scrns[code & 0x03];
+                }
+
+                remapped_word |= code << shift;
+        }
+
+        return remapped_word;
+}
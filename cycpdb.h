@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef CYCPDB_H_
+#define CYCPDB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/* Number of atlas entries covered by each precomputed rank */
+#define CYCPDB_BLOCK_SIZE       512
+
+#define CYCPDB_MAGIC            "VCPD"
+#define CYCPDB_VERSION          1
+
+struct atlas_class;
+
+/*-
+ * The database is laid out as the header, followed by the classes, the
+ * word pool (32-bit), the block ranks (32-bit), the bit-map (64-bit), and
+ * the values (16-bit), all in host byte order.
+ */
+struct cycpdb_header {
+        char magic[4];
+        uint16_t version;
+        uint16_t class_count;
+        uint32_t entry_count;
+        uint32_t feasible_count;
+        uint32_t word_count;
+};
+
+/*-
+ * Solution database of every feasible atlas entry.
+ *
+ * The atlas indexes every scene densely, so the rank of an entry amongst
+ * the feasible entries is a minimal perfect hash of the scene: no key is
+ * stored. Each solution is stored as four indices into a pool of the
+ * distinct cycle pattern words of a single bank.
+ */
+struct cycpdb {
+        uint32_t class_count;
+        const struct atlas_class *classes;
+
+        uint32_t entry_count;
+        uint32_t feasible_count;
+
+        uint32_t word_count;
+        const uint8_t *words;
+
+        /* Number of feasible entries preceding each block */
+        const uint8_t *ranks;
+        /* One bit for each atlas entry, set if the entry is feasible */
+        const uint8_t *bitmap;
+        /* Word pool index for each bank, for each feasible entry */
+        const uint8_t *values;
+};
+
+int32_t cycpdb_init(struct cycpdb *, const void *, size_t);
+int32_t cycpdb_builtin_init(struct cycpdb *);
+
+int32_t cycpdb_lookup(const struct cycpdb *, struct state *);
+int32_t cycpdb_vdp2cycp(const struct cycpdb *, struct state *);
+
+#endif /* !CYCPDB_H_ */
@@ -1,15 +1,17 @@
-#include <assert.h>
-#include <string.h>
-#include <stdlib.h>
+#include <stdio.h>
 
 #include "debug.h"
 
 #include "vdp2.h"
 #include "math.h"
 
-#ifdef DEBUG
-char *
-debug_print_cycle_pattern(uint32_t pv)
+/*-
+ * Write the access timings T7 to T0 of the cycle pattern PV as a table
+ * to BUFFER of SIZE bytes, which should be DEBUG_CYCLE_PATTERN_SIZE
+ * bytes.
+ */
+void
+debug_print_cycle_pattern(uint32_t pv, char *buffer, size_t size)
 {
         static const char *timing_mnemonics[] = {
                 "PNDR_NBG0",    /* 0x0 */
@@ -31,21 +33,7 @@ debug_print_cycle_pattern(uint32_t pv)
                 NULL
         };
 
-        char *output_buffer;
-
-        /* Header: 8 strings of length 11, each spaced out (7 spaces), plus newline*/
-        uint32_t line;
-        line = (8 * 11) + 7 + 1;
-
-        /* Two lines plus extra newline and NUL byte */
-        uint32_t bytes;
-        bytes = (2 * line) + 1 + 1;
-
-        output_buffer = malloc(bytes);
-        assert(output_buffer != NULL);
-        memset(output_buffer, '\0', bytes);
-
-        (void)sprintf(output_buffer,
+        (void)snprintf(buffer, size,
             "\n"
             "%-11s %-11s %-11s %-11s %-11s %-11s %-11s %-11s\n"
             "%-11s %-11s %-11s %-11s %-11s %-11s %-11s %-11s\n",
@@ -65,14 +53,14 @@ debug_print_cycle_pattern(uint32_t pv)
             timing_mnemonics[VRAM_CTL_CYCP_TIMING_VALUE(pv, 2)],
             timing_mnemonics[VRAM_CTL_CYCP_TIMING_VALUE(pv, 1)],
             timing_mnemonics[VRAM_CTL_CYCP_TIMING_VALUE(pv, 0)]);
-
-        return output_buffer;
 }
-#endif /* DEBUG */
 
-#ifdef DEBUG
-char *
-debug_print_format(const struct scrn_format *format __unused)
+/*-
+ * Write the scroll screen format FORMAT as a table to BUFFER of SIZE
+ * bytes, which should be DEBUG_FORMAT_SIZE bytes.
+ */
+void
+debug_print_format(const struct scrn_format *format, char *buffer, size_t size)
 {
         static const char *type_names[] __unused = {
                 "Cell",
@@ -113,22 +101,14 @@ debug_print_format(const struct scrn_format *format __unused)
                 NULL
         };
 
-        char *output_buffer;
-
-        /* XXX: Hard coded for now */
-        uint32_t bytes;
-        bytes = 2048;
-
-        output_buffer = malloc(bytes);
-        assert(output_buffer != NULL);
-        memset(output_buffer, '\0', bytes);
+        buffer[0] = '\0';
 
         switch (format->sf_type) {
         case SCRN_TYPE_CELL: {
                 const struct scrn_cell_format *cell_format;
                 cell_format = &format->sf_format.cell;
 
-                (void)sprintf(output_buffer,
+                (void)snprintf(buffer, size,
                     "\n"
                     "    scroll_screen: %s\n"
                     "             type: %s\n"
@@ -161,7 +141,7 @@ debug_print_format(const struct scrn_format *format __unused)
                 const struct scrn_bitmap_format *bitmap_format __unused;
                 bitmap_format = &format->sf_format.bitmap;
 
-                (void)sprintf(output_buffer,
+                (void)snprintf(buffer, size,
                     "\n"
                     "    scroll_screen: %s\n"
                     "             type: %s\n"
@@ -175,10 +155,4 @@ debug_print_format(const struct scrn_format *format __unused)
                     reduction_names[format->sf_reduction]);
         } break;
         }
-
-        return output_buffer;
 }
-#endif /* DEBUG */
-
-#ifdef DEBUG
-#endif /* DEBUG */
@@ -8,16 +8,27 @@
 #ifndef DEBUG_H_
 #define DEBUG_H_
 
-#ifdef DEBUG
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+
+#include "vdp2.h"
+
+/* Size of the text debug_print_cycle_pattern() writes: 2 lines of 8
+ * strings of length 11, each spaced out, plus a leading newline and the
+ * NUL byte */
+#define DEBUG_CYCLE_PATTERN_SIZE        ((2 * ((8 * 11) + 7 + 1)) + 1 + 1)
+
+/* Size of the longest text debug_print_format() writes */
+#define DEBUG_FORMAT_SIZE               1024
+
+#ifdef DEBUG
 #include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
 
+/* The standard error stream is not buffered */
 #define DEBUG_PRINTF(fmt, ...) do {                                            \
         (void)fprintf(stderr, "%s():L%i:" " " fmt, __FUNCTION__, __LINE__,     \
             ##__VA_ARGS__);                                                    \
-        fflush(stderr);                                                        \
 } while(false)
 #else
 #define DEBUG_PRINTF(x...)
@@ -25,11 +36,10 @@
 
 #ifdef DEBUG
 #define DEBUG_CYCLE_PATTERN(pv) do {                                           \
-        char *debug_print_cycle_pattern(uint32_t);                             \
-        char *_output_buffer;                                                  \
-        _output_buffer = debug_print_cycle_pattern(pv);                        \
+        char _output_buffer[DEBUG_CYCLE_PATTERN_SIZE];                         \
+        debug_print_cycle_pattern((pv), _output_buffer,                        \
+            sizeof(_output_buffer));                                           \
         DEBUG_PRINTF("%s", _output_buffer);                                    \
-        free(_output_buffer);                                                  \
 } while (false)
 #else
 #define DEBUG_CYCLE_PATTERN(...)
@@ -37,14 +47,15 @@
 
 #ifdef DEBUG
 #define DEBUG_FORMAT(format) do {                                              \
-        char *debug_print_format(const struct scrn_format *);                  \
-        char *_output_buffer;                                                  \
-        _output_buffer = debug_print_format(format);                           \
+        char _output_buffer[DEBUG_FORMAT_SIZE];                                \
+        debug_print_format((format), _output_buffer, sizeof(_output_buffer));  \
         DEBUG_PRINTF("%s", _output_buffer);                                    \
-        free(_output_buffer);                                                  \
 } while (false)
 #else
 #define DEBUG_FORMAT(...)
 #endif /* DEBUG */
 
+void debug_print_cycle_pattern(uint32_t, char *, size_t);
+void debug_print_format(const struct scrn_format *, char *, size_t);
+
 #endif /* !DEBUG_H_ */
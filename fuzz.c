@@ -0,0 +1,1723 @@
+#include <sys/cdefs.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fuzz.h"
+#include "bench.h"
+#include "math.h"
+
+#include "debug.h"
+
+/* Number of scenes a worker claims at a time */
+#define FUZZ_CHUNK_SIZE         64
+
+/* Number of VRAM partitionings of VRAM-A and VRAM-B */
+#define FUZZ_PARTITION_COUNT    4
+
+/* Number of access codes, and of access timings of a bank */
+#define FUZZ_CODE_COUNT         16
+#define FUZZ_TIMING_COUNT       8
+
+/* Results of the reference for a VRAM partitioning, other than 0 and the
+ * values vdp2cycp() returns when it rejects a scene before allocating
+ * any access timing */
+#define FUZZ_RESULT_INFEASIBLE  (-16) /* No cycle pattern is valid */
+#define FUZZ_RESULT_LIMIT       (-17) /* Given up after FUZZ_NODE_LIMIT branches */
+
+/*-
+ * The tables of the reference are transcribed from the VDP2 manual, apart
+ * from those of the solver, so that a mistake in either is found.
+ */
+
+/* Number of pattern name data reads per cell, by reduction. The hi-res
+ * and exclusive monitor TV screen modes don't reduce */
+static const uint8_t _fuzz_pnd_counts[] = {
+        1,      /* No reduction */
+        2,      /* 1/2 reduction */
+        4       /* 1/4 reduction */
+};
+
+/* Number of character pattern data reads per cell without reduction, by
+ * format type and character color count, or 0 where the color count
+ * can't be displayed. Each reduction doubles the reads, and reduced
+ * scroll screens, as well as every scroll screen of the hi-res and
+ * exclusive monitor TV screen modes, read at most 4 times */
+static const uint8_t _fuzz_cpd_counts[2][5] = {
+        /* Cell */
+        {
+                1,      /* 16 (palette) */
+                2,      /* 256 (palette) */
+                4,      /* 2048 (palette) */
+                0,      /* 32,768 (RGB) */
+                0       /* 16,770,000 (RGB) */
+        },
+        /* Bitmap */
+        {
+                1,      /* 16 (palette) */
+                2,      /* 256 (palette) */
+                4,      /* 2048 (palette) */
+                4,      /* 32,768 (RGB) */
+                8       /* 16,770,000 (RGB) */
+        }
+};
+
+/* Access timings character pattern data can be read at, for each access
+ * timing pattern name data of the same scroll screen is read at. A TV
+ * screen mode has the access timings whose range is not empty */
+static const uint8_t _fuzz_cpd_ranges[2][FUZZ_TIMING_COUNT] = {
+        /* Normal */
+        {
+                0xF7,   /* T0 -> T0, T1, T2, T4, T5, T6, T7 */
+                0xEF,   /* T1 -> T0, T1, T2, T3, T5, T6, T7 */
+                0xCF,   /* T2 -> T0, T1, T2, T3, T6, T7 */
+                0x8F,   /* T3 -> T0, T1, T2, T3, T7 */
+                0x0F,   /* T4 -> T0, T1, T2, T3 */
+                0x0E,   /* T5 -> T1, T2, T3 */
+                0x0C,   /* T6 -> T2, T3 */
+                0x08    /* T7 -> T3 */
+        },
+        /* Hi-res and exclusive monitor */
+        {
+                0x07,   /* T0 -> T0, T1, T2 */
+                0x0E,   /* T1 -> T1, T2, T3 */
+                0x0D,   /* T2 -> T0, T2, T3 */
+                0x0B,   /* T3 -> T0, T1, T3 */
+                0x00,   /* T4 (none) */
+                0x00,   /* T5 (none) */
+                0x00,   /* T6 (none) */
+                0x00    /* T7 (none) */
+        }
+};
+
+/* Access timings the vertical cell scroll table of NBG0 and NBG1 can be
+ * read at, where NBG1 must also be read after NBG0 */
+static const uint8_t _fuzz_vcs_ranges[2] = {
+        0x03,   /* NBG0 -> T0, T1 */
+        0x87    /* NBG1 -> T0, T1, T2, T7 */
+};
+
+/* Bank whose cycle pattern register each bank is read with, for each
+ * VRAM partitioning, where VRAMD is the lowest bit */
+static const uint8_t _fuzz_pattern_banks[FUZZ_PARTITION_COUNT][VRAM_BANK_COUNT] = {
+        {
+                VRAM_BANK_A0,
+                VRAM_BANK_A0,
+                VRAM_BANK_B0,
+                VRAM_BANK_B0
+        },
+        {
+                VRAM_BANK_A0,
+                VRAM_BANK_A1,
+                VRAM_BANK_B0,
+                VRAM_BANK_B0
+        },
+        {
+                VRAM_BANK_A0,
+                VRAM_BANK_A0,
+                VRAM_BANK_B0,
+                VRAM_BANK_B1
+        },
+        {
+                VRAM_BANK_A0,
+                VRAM_BANK_A1,
+                VRAM_BANK_B0,
+                VRAM_BANK_B1
+        }
+};
+
+/* Pairs of banks the pattern name data of the NBGs can't be stored
+ * across, for each VRAM partitioning */
+static const uint8_t _fuzz_pnd_bank_pairs[FUZZ_PARTITION_COUNT][5] = {
+        /* VRAM-A or VRAM-B, not both */
+        {
+                0x0A,   /* A0, B0 */
+                0x09,   /* A0, B1 */
+                0x06,   /* A1, B0 */
+                0x05    /* A1, B1 */
+        },
+        /* A0 not with VRAM-B */
+        {
+                0x0A,   /* A0, B0 */
+                0x09    /* A0, B1 */
+        },
+        /* B0 not with VRAM-A */
+        {
+                0x0A,   /* A0, B0 */
+                0x06    /* A1, B0 */
+        },
+        /* Neither A0 with B0, nor A1 with B1 */
+        {
+                0x0A,   /* A0, B0 */
+                0x05    /* A1, B1 */
+        }
+};
+
+/* Access codes of the reads the reference places before those of
+ * character pattern data, whose ranges depend on them */
+static const uint8_t _fuzz_first_codes[] = {
+        VRAM_CTL_CYCP_PNDR_NBG0,
+        VRAM_CTL_CYCP_PNDR_NBG1,
+        VRAM_CTL_CYCP_PNDR_NBG2,
+        VRAM_CTL_CYCP_PNDR_NBG3,
+        VRAM_CTL_CYCP_VCSTDR_NBG0,
+        VRAM_CTL_CYCP_VCSTDR_NBG1
+};
+
+/*-
+ * Reads a scene requires for one VRAM partitioning, as the reference
+ * derives them from the formats of its scroll screens.
+ */
+struct fuzz_demands {
+        /* VRAM partitioning, and the RDBS the rotational backgrounds
+         * require */
+        uint16_t ramctl;
+
+        /* Bit-map of access timings of the TV screen mode */
+        uint8_t timings;
+        const uint8_t *cpd_ranges;
+        uint8_t vcs_ranges[2];
+
+        /* Bit-map of the banks whose cycle patterns are given to the
+         * NBGs: those with a cycle pattern register of their own, less
+         * the banks of the rotational backgrounds */
+        uint8_t bank_bitmap;
+        /* Bit-maps of the banks RBG1 reads pattern name data, and
+         * character pattern data from, at every access timing */
+        uint8_t rbg1_pnd_bitmap;
+        uint8_t rbg1_cpd_bitmap;
+
+        /* Number of access timings each access code requires of each
+         * bank */
+        uint8_t counts[VRAM_BANK_COUNT][FUZZ_CODE_COUNT];
+};
+
+/*-
+ * Brute-force reference solver. Every access timing of every bank is
+ * given each access code that still requires access timings of the bank,
+ * or is left open, first for the pattern name data and vertical cell
+ * scroll reads, then for the character pattern data reads, as their
+ * ranges depend on the former. A branch is pruned only when a bank has
+ * fewer access timings left than its reads still require.
+ */
+struct fuzz_oracle {
+        const struct fuzz_demands *demands;
+
+        union vram_cycp vram_cycp;
+
+        /* Number of access timings each access code still requires of
+         * each bank */
+        uint8_t remaining[VRAM_BANK_COUNT][FUZZ_CODE_COUNT];
+        /* Bit-map of the access timings of each bank left open for the
+         * character pattern data reads */
+        uint8_t open[VRAM_BANK_COUNT];
+        /* Range of the character pattern data reads of each NBG */
+        uint8_t cpd_ranges[4];
+
+        /* Number of branches of the search visited */
+        uint64_t node_count;
+};
+
+/* Scenes checked by the workers */
+struct fuzz_job {
+        uint64_t seed;
+        uint32_t case_count;
+
+        /* Index of the next scene to be claimed by a worker */
+        _Atomic uint32_t cursor;
+};
+
+/* Outcomes of the scenes checked by a worker */
+struct fuzz_counts {
+        struct fuzz_job *job;
+
+        uint32_t feasible_count;
+        uint32_t rotation_count;
+        uint32_t limit_count;
+        uint32_t disagreement_count;
+};
+
+static pthread_mutex_t _fuzz_report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *fuzz_worker(void *);
+static void fuzz_case_check(uint64_t, struct fuzz_counts *);
+static void fuzz_rotation_generate(uint64_t *, struct bench_scene *);
+static void fuzz_rotation_format_generate(uint64_t *, uint8_t, uint8_t *, struct scrn_format *);
+static uint8_t fuzz_rotation_bank_next(uint64_t *, uint8_t *);
+static void fuzz_report(uint64_t, const char *, int32_t, int32_t, const union vram_cycp *,
+    const union vram_cycp *);
+
+static int32_t fuzz_demands_init(const struct state *, uint16_t, struct fuzz_demands *);
+static bool fuzz_scrn_banks_get(const struct scrn_format *, uint16_t, uint8_t *);
+static int32_t fuzz_scrn_counts_get(const struct scrn_format *, bool, uint8_t *);
+static uint8_t fuzz_pattern_bitmap(uint16_t, uint8_t);
+static uint8_t fuzz_code_timings(uint32_t, uint32_t);
+static uint8_t fuzz_cpd_range_get(const struct fuzz_demands *, const union vram_cycp *,
+    uint32_t);
+
+static int32_t fuzz_oracle_solve(const struct fuzz_demands *, union vram_cycp *);
+static int32_t fuzz_oracle_place(struct fuzz_oracle *, uint32_t);
+static uint32_t fuzz_oracle_first_count(const struct fuzz_oracle *, uint32_t);
+static int32_t fuzz_oracle_fill(struct fuzz_oracle *, uint32_t, uint32_t);
+
+static bool fuzz_check(const struct fuzz_demands *, uint16_t, const union vram_cycp *);
+static uint32_t fuzz_score(const struct fuzz_demands *, const uint8_t *,
+    const union vram_cycp *);
+static uint32_t fuzz_score_max(const struct fuzz_demands *, const uint8_t *);
+
+static uint64_t fuzz_clock(void);
+
+/*-
+ * Check vdp2cycp() and vdp2cycp_optimize() against a brute-force
+ * reference solver with CASE_COUNT scenes generated from SEED, on
+ * THREAD_COUNT threads.
+ *
+ * Scene I is generated from the seed SEED + I, so that a scene reported
+ * can be checked again alone. One in FUZZ_ROTATION_RATIO scenes displays
+ * the rotational backgrounds. The reference derives the reads of each
+ * scene, and the access timings they may be given, from the formats of
+ * its scroll screens and tables of its own, and checks the cycle
+ * patterns of the solver with them, without calling into the solver.
+ *
+ * The solver and the reference disagree when only one of them finds a
+ * cycle pattern, when they reject a scene for different reasons, when
+ * the cycle pattern or RAMCTL of the solver is not valid, or when
+ * vdp2cycp_optimize(), free to change the VRAM partitioning, leaves a
+ * different weighted number of access timings open to the CPU than the
+ * most the reference finds over every VRAM partitioning, for each of
+ * FUZZ_OBJECTIVE_COUNT weightings of the banks. Scenes the reference
+ * gives up on after FUZZ_NODE_LIMIT branches are not checked.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CASE_COUNT is zero
+ *   - -2 Memory could not be allocated
+ *   - -3 The solver and the reference disagree on at least one scene
+ */
+int32_t
+fuzz_run(uint64_t seed, uint32_t case_count, uint32_t thread_count)
+{
+        if (case_count == 0) {
+                return -1;
+        }
+
+        if (thread_count == 0) {
+                thread_count = 1;
+        }
+
+        pthread_t *threads;
+        threads = malloc(thread_count * sizeof(pthread_t));
+        struct fuzz_counts *counts;
+        counts = calloc(thread_count, sizeof(struct fuzz_counts));
+
+        if ((threads == NULL) || (counts == NULL)) {
+                free(counts);
+                free(threads);
+
+                return -2;
+        }
+
+        (void)printf("Fuzzing %u scene(s), seed %llu, using %u thread(s)\n", case_count,
+            (unsigned long long)seed, thread_count);
+
+        struct fuzz_job job;
+
+        job.seed = seed;
+        job.case_count = case_count;
+        atomic_init(&job.cursor, 0);
+
+        uint64_t start;
+        start = fuzz_clock();
+
+        uint32_t i;
+        for (i = 0; i < thread_count; i++) {
+                counts[i].job = &job;
+
+                if ((pthread_create(&threads[i], NULL, fuzz_worker, &counts[i])) != 0) {
+                        break;
+                }
+        }
+
+        /* Even if a thread could not be created, the threads that were
+         * created finish the job */
+        if (i == 0) {
+                (void)fuzz_worker(&counts[0]);
+        }
+
+        uint32_t j;
+        for (j = 0; j < i; j++) {
+                (void)pthread_join(threads[j], NULL);
+        }
+
+        uint64_t total;
+        total = fuzz_clock() - start;
+
+        struct fuzz_counts sum;
+
+        memset(&sum, 0x00, sizeof(sum));
+
+        for (j = 0; j < thread_count; j++) {
+                sum.feasible_count += counts[j].feasible_count;
+                sum.rotation_count += counts[j].rotation_count;
+                sum.limit_count += counts[j].limit_count;
+                sum.disagreement_count += counts[j].disagreement_count;
+        }
+
+        (void)printf("Checked: %u (%u feasible, %u rotational), skipped: %u over limit\n",
+            case_count - sum.limit_count, sum.feasible_count, sum.rotation_count,
+            sum.limit_count);
+        (void)printf("Disagreements: %u\n", sum.disagreement_count);
+        (void)printf("%.0f scenes/s\n", (case_count * 1e9) / (double)total);
+
+        free(counts);
+        free(threads);
+
+        return (sum.disagreement_count > 0) ? -3 : 0;
+}
+
+static void *
+fuzz_worker(void *arg)
+{
+        struct fuzz_counts *counts;
+        counts = arg;
+
+        struct fuzz_job *job;
+        job = counts->job;
+
+        while (true) {
+                uint32_t first;
+                first = atomic_fetch_add(&job->cursor, FUZZ_CHUNK_SIZE);
+
+                if (first >= job->case_count) {
+                        break;
+                }
+
+                uint32_t last;
+                last = first + FUZZ_CHUNK_SIZE;
+
+                if (last > job->case_count) {
+                        last = job->case_count;
+                }
+
+                uint32_t i;
+                for (i = first; i < last; i++) {
+                        fuzz_case_check(job->seed + i, counts);
+                }
+        }
+
+        return NULL;
+}
+
+/*-
+ * Generate a scene from the seed CASE_SEED, check the solver against the
+ * reference, and count the outcome in COUNTS.
+ */
+static void
+fuzz_case_check(uint64_t case_seed, struct fuzz_counts *counts)
+{
+        uint64_t seed;
+        seed = case_seed;
+
+        struct bench_scene scene;
+
+        bench_scene_generate(&seed, &scene);
+
+        uint16_t tvmd;
+        tvmd = ((bench_random(&seed) % FUZZ_HIRES_RATIO) == 0) ?
+            TVMD_HRESO_HIRES_640 : TVMD_HRESO_NORMAL_320;
+
+        if ((bench_random(&seed) % FUZZ_ROTATION_RATIO) == 0) {
+                fuzz_rotation_generate(&seed, &scene);
+        }
+
+        /* The scroll screens of a state point into the state itself, so
+         * each is initialized in place */
+        struct state state;
+        struct state solved;
+
+        bench_state_init(&scene, &state);
+        bench_state_init(&scene, &solved);
+
+        state.tvmd = tvmd;
+        solved.tvmd = tvmd;
+
+        bool rotation;
+        rotation = state.rbg0.format.sf_enable || state.rbg1.format.sf_enable;
+
+        /* The reference solves every VRAM partitioning, starting with
+         * that of the scene */
+        struct fuzz_demands demands[FUZZ_PARTITION_COUNT];
+        int32_t oracle_rets[FUZZ_PARTITION_COUNT];
+        union vram_cycp oracle_vram_cycp[FUZZ_PARTITION_COUNT];
+
+        bool feasible;
+        feasible = false;
+
+        uint32_t partition;
+        for (partition = 0; partition < FUZZ_PARTITION_COUNT; partition++) {
+                oracle_rets[partition] = fuzz_demands_init(&state,
+                    state.ramctl ^ (partition << 8), &demands[partition]);
+
+                memset(&oracle_vram_cycp[partition], 0xFF, sizeof(oracle_vram_cycp[partition]));
+
+                if (oracle_rets[partition] == 0) {
+                        oracle_rets[partition] = fuzz_oracle_solve(&demands[partition],
+                            &oracle_vram_cycp[partition]);
+                }
+
+                if (oracle_rets[partition] == FUZZ_RESULT_LIMIT) {
+                        counts->limit_count++;
+                        return;
+                }
+
+                feasible = feasible || (oracle_rets[partition] == 0);
+        }
+
+        if (rotation) {
+                counts->rotation_count++;
+        }
+
+        /* As vdp2cycp() does, each VRAM partitioning is tried in turn
+         * when a rotational background is displayed */
+        uint32_t partition_count;
+        partition_count = rotation ? FUZZ_PARTITION_COUNT : 1;
+
+        for (partition = 0; partition < partition_count; partition++) {
+                if (oracle_rets[partition] == 0) {
+                        break;
+                }
+        }
+
+        int32_t ret;
+        ret = vdp2cycp(&solved);
+
+        if (partition == partition_count) {
+                /* A scene is either rejected for the same reason, or
+                 * for lack of access timings */
+                bool agree;
+                agree = (oracle_rets[0] == FUZZ_RESULT_INFEASIBLE) ?
+                    ((ret == -4) || (ret == -5) || (ret == -6)) : (ret == oracle_rets[0]);
+
+                if (!agree) {
+                        counts->disagreement_count++;
+
+                        fuzz_report(case_seed, "feasibility differs", ret, oracle_rets[0],
+                            (ret == 0) ? &solved.vram_cycp : NULL, NULL);
+                        return;
+                }
+
+                if (!feasible) {
+                        return;
+                }
+        } else if (ret < 0) {
+                counts->disagreement_count++;
+
+                fuzz_report(case_seed, "feasibility differs", ret, 0, NULL,
+                    &oracle_vram_cycp[partition]);
+                return;
+        } else if ((((solved.ramctl ^ state.ramctl) >> 8) & 0x03) != partition) {
+                counts->disagreement_count++;
+
+                fuzz_report(case_seed, "VRAM partitioning differs", ret, 0,
+                    &solved.vram_cycp, &oracle_vram_cycp[partition]);
+                return;
+        } else if (!fuzz_check(&demands[partition], solved.ramctl, &solved.vram_cycp)) {
+                counts->disagreement_count++;
+
+                fuzz_report(case_seed, "cycle pattern of the solver is invalid", ret, 0,
+                    &solved.vram_cycp, &oracle_vram_cycp[partition]);
+                return;
+        }
+
+        if (feasible) {
+                counts->feasible_count++;
+        }
+
+        /* The first objective weights every bank the same */
+        struct cycp_objective objective;
+
+        memset(&objective, 0x00, sizeof(objective));
+
+        objective.partition = true;
+
+        uint32_t i;
+        for (i = 0; i < FUZZ_OBJECTIVE_COUNT; i++) {
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        objective.weights[bank] = (i == 0) ? 1 : (bench_random(&seed) % 4);
+                }
+
+                uint32_t max_score;
+                max_score = 0;
+
+                for (partition = 0; partition < FUZZ_PARTITION_COUNT; partition++) {
+                        if (oracle_rets[partition] < 0) {
+                                continue;
+                        }
+
+                        uint32_t score;
+                        score = fuzz_score_max(&demands[partition], objective.weights);
+
+                        if (score > max_score) {
+                                max_score = score;
+                        }
+                }
+
+                struct state optimized;
+
+                bench_state_init(&scene, &optimized);
+
+                optimized.tvmd = tvmd;
+
+                int32_t optimize_ret;
+                optimize_ret = vdp2cycp_optimize(&optimized, &objective);
+
+                if (optimize_ret < 0) {
+                        counts->disagreement_count++;
+
+                        fuzz_report(case_seed, "optimized scene is not solved", optimize_ret,
+                            0, NULL, NULL);
+                        return;
+                }
+
+                partition = ((optimized.ramctl ^ state.ramctl) >> 8) & 0x03;
+
+                if ((oracle_rets[partition] < 0) ||
+                    (!fuzz_check(&demands[partition], optimized.ramctl,
+                        &optimized.vram_cycp))) {
+                        counts->disagreement_count++;
+
+                        fuzz_report(case_seed, "optimized cycle pattern is invalid",
+                            optimize_ret, oracle_rets[partition], &optimized.vram_cycp,
+                            NULL);
+                        return;
+                }
+
+                if ((fuzz_score(&demands[partition], objective.weights,
+                            &optimized.vram_cycp)) != max_score) {
+                        counts->disagreement_count++;
+
+                        fuzz_report(case_seed, "weighted access timings open to the CPU "
+                            "differ", optimize_ret, 0, &optimized.vram_cycp,
+                            &oracle_vram_cycp[partition]);
+                        return;
+                }
+        }
+}
+
+/*-
+ * Replace the rotational backgrounds of the scene SCENE with RBG0, and
+ * RBG1 half of the time, generated from the sequence SEED.
+ *
+ * The tables of the rotational backgrounds are each given a bank of
+ * their own, in a random order, so that whether they can be read
+ * depends on the VRAM partitioning, and on how many tables there are.
+ * One in four tables is stored in a random bank instead.
+ *
+ * RBG1 is only displayed without the NBGs, which are kept in one of
+ * four scenes with RBG1, to be rejected, and in half of the scenes
+ * without.
+ */
+static void
+fuzz_rotation_generate(uint64_t *seed, struct bench_scene *scene)
+{
+        bool rbg1;
+        rbg1 = (bench_random(seed) & 0x01) != 0x00;
+
+        bool nbgs;
+        nbgs = rbg1 ? ((bench_random(seed) % 4) == 0) : ((bench_random(seed) & 0x01) != 0x00);
+
+        uint32_t format_count;
+        format_count = 0;
+
+        uint32_t i;
+        for (i = 0; i < scene->format_count; i++) {
+                if ((!nbgs) || (scene->formats[i].sf_scroll_screen > SCRN_NBG3)) {
+                        continue;
+                }
+
+                scene->formats[format_count++] = scene->formats[i];
+        }
+
+        /* Shuffle the banks the tables are given */
+        uint8_t banks[VRAM_BANK_COUNT + 1];
+
+        for (i = 0; i < VRAM_BANK_COUNT; i++) {
+                banks[i] = i;
+        }
+
+        for (i = VRAM_BANK_COUNT - 1; i > 0; i--) {
+                uint32_t j;
+                j = bench_random(seed) % (i + 1);
+
+                uint8_t bank;
+                bank = banks[i];
+
+                banks[i] = banks[j];
+                banks[j] = bank;
+        }
+
+        /* Index of the next bank to be given */
+        banks[VRAM_BANK_COUNT] = 0;
+
+        fuzz_rotation_format_generate(seed, SCRN_RBG0, banks, &scene->formats[format_count++]);
+
+        if (rbg1) {
+                fuzz_rotation_format_generate(seed, SCRN_RBG1, banks,
+                    &scene->formats[format_count++]);
+        }
+
+        scene->format_count = format_count;
+}
+
+/*-
+ * Generate the format FORMAT of the rotational background SCRN from the
+ * sequence SEED. Each of its tables starts the next bank of the shuffled
+ * banks BANKS, whose last entry is the index of that bank, or a random
+ * bank, and fits within it.
+ */
+static void
+fuzz_rotation_format_generate(uint64_t *seed, uint8_t scrn, uint8_t *banks,
+    struct scrn_format *format)
+{
+        memset(format, 0x00, sizeof(*format));
+
+        format->sf_enable = true;
+        format->sf_scroll_screen = scrn;
+        format->sf_type = ((bench_random(seed) % 4) == 0) ? SCRN_TYPE_BITMAP : SCRN_TYPE_CELL;
+        format->sf_cc_count = bench_random(seed) % (SCRN_CCC_PALETTE_256 + 1);
+
+        /* RBG1 rarely has a table to spare a bank for */
+        if ((bench_random(seed) % ((scrn == SCRN_RBG0) ? 2 : 4)) == 0) {
+                format->sf_coefficient_table = VRAM_ADDR_4MBIT(fuzz_rotation_bank_next(seed,
+                        banks), 0x00000);
+        }
+
+        uint8_t rp_mode;
+        rp_mode = bench_random(seed) & 0x03;
+
+        if (format->sf_type == SCRN_TYPE_BITMAP) {
+                struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                bitmap_format->sbf_bitmap_size.width = 512;
+                bitmap_format->sbf_bitmap_size.height = 256;
+                bitmap_format->sbf_bitmap_pattern = VRAM_ADDR_4MBIT(fuzz_rotation_bank_next(seed,
+                        banks), 0x00000);
+                bitmap_format->sbf_rp_mode = rp_mode;
+
+                return;
+        }
+
+        struct scrn_cell_format *cell_format;
+        cell_format = &format->sf_format.cell;
+
+        cell_format->scf_character_size = 1 * 1;
+        cell_format->scf_pnd_size = (bench_random(seed) & 0x01) ? 2 : 1;
+        cell_format->scf_plane_size = 1 * 1;
+        cell_format->scf_cp_table = VRAM_ADDR_4MBIT(fuzz_rotation_bank_next(seed, banks),
+            0x00000);
+        cell_format->scf_rp_mode = rp_mode;
+
+        /* Not every plane of a rotational background need be given */
+        uint32_t pnd_bank;
+        pnd_bank = fuzz_rotation_bank_next(seed, banks);
+        uint32_t plane_count;
+        plane_count = 1 + (bench_random(seed) % 4);
+
+        uint32_t i;
+        for (i = 0; i < plane_count; i++) {
+                cell_format->scf_map.planes[i] = VRAM_ADDR_4MBIT(pnd_bank, i * 0x2000);
+        }
+}
+
+/*-
+ * Return the next bank of the shuffled banks BANKS, as given to
+ * fuzz_rotation_format_generate(), or one in four times, a random bank
+ * drawn from the sequence SEED.
+ */
+static uint8_t
+fuzz_rotation_bank_next(uint64_t *seed, uint8_t *banks)
+{
+        if ((bench_random(seed) % 4) == 0) {
+                return bench_random(seed) % VRAM_BANK_COUNT;
+        }
+
+        uint8_t *next;
+        next = &banks[VRAM_BANK_COUNT];
+
+        uint8_t bank;
+        bank = banks[*next % VRAM_BANK_COUNT];
+
+        (*next)++;
+
+        return bank;
+}
+
+/*-
+ * Print the disagreement WHAT over the scene generated from CASE_SEED,
+ * with the values returned by the solver and the reference, and their
+ * cycle patterns, if any.
+ */
+static void
+fuzz_report(uint64_t case_seed, const char *what, int32_t ret, int32_t oracle_ret,
+    const union vram_cycp *vram_cycp, const union vram_cycp *oracle_vram_cycp)
+{
+        (void)pthread_mutex_lock(&_fuzz_report_mutex);
+
+        (void)printf("fuzz: seed %llu: %s (solver %i, reference %i)\n",
+            (unsigned long long)case_seed, what, ret, oracle_ret);
+
+        if (vram_cycp != NULL) {
+                (void)printf("  solver:    0x%08X 0x%08X 0x%08X 0x%08X\n",
+                    vram_cycp->pv[VRAM_BANK_A0], vram_cycp->pv[VRAM_BANK_A1],
+                    vram_cycp->pv[VRAM_BANK_B0], vram_cycp->pv[VRAM_BANK_B1]);
+        }
+
+        if (oracle_vram_cycp != NULL) {
+                (void)printf("  reference: 0x%08X 0x%08X 0x%08X 0x%08X\n",
+                    oracle_vram_cycp->pv[VRAM_BANK_A0], oracle_vram_cycp->pv[VRAM_BANK_A1],
+                    oracle_vram_cycp->pv[VRAM_BANK_B0], oracle_vram_cycp->pv[VRAM_BANK_B1]);
+        }
+
+        (void)fflush(stdout);
+
+        (void)pthread_mutex_unlock(&_fuzz_report_mutex);
+}
+
+/*-
+ * Derive the reads of the scroll screens of STATE to DEMANDS, where the
+ * VRAM partitioning is that of RAMCTL.
+ *
+ * If successful, 0 is returned. Otherwise, the value vdp2cycp() returns
+ * when it rejects the scene before allocating any access timing is
+ * returned, checked in the same order.
+ */
+static int32_t
+fuzz_demands_init(const struct state *state, uint16_t ramctl, struct fuzz_demands *demands)
+{
+        /* RDBS of each kind of table of a rotational background */
+        static const uint8_t kind_rdbs[CYCP_DEMAND_COUNT] = {
+                RAMCTL_RDBS_COEFFICIENT,
+                RAMCTL_RDBS_PND,
+                RAMCTL_RDBS_CPD
+        };
+
+        static const uint8_t codes[CYCP_DEMAND_COUNT] = {
+                VRAM_CTL_CYCP_VCSTDR_NBG0,
+                VRAM_CTL_CYCP_PNDR_NBG0,
+                VRAM_CTL_CYCP_CHPNDR_NBG0
+        };
+
+        memset(demands, 0x00, sizeof(*demands));
+
+        demands->ramctl = ramctl & ~RAMCTL_RDBS_MASK;
+
+        bool halved;
+        halved = TVMD_TIMINGS_HALVED(state->tvmd);
+
+        demands->cpd_ranges = _fuzz_cpd_ranges[halved ? 1 : 0];
+
+        uint32_t t;
+        for (t = 0; t < FUZZ_TIMING_COUNT; t++) {
+                if (demands->cpd_ranges[t] != 0x00) {
+                        demands->timings |= 1 << t;
+                }
+        }
+
+        demands->vcs_ranges[0] = _fuzz_vcs_ranges[0] & demands->timings;
+        demands->vcs_ranges[1] = _fuzz_vcs_ranges[1] & demands->timings;
+
+        /* Banks of each kind of data of each scroll screen */
+        uint8_t banks[SCRN_COUNT][CYCP_DEMAND_COUNT];
+        uint8_t enable_bitmap;
+        enable_bitmap = 0x00;
+        bool exceeded;
+        exceeded = false;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                const struct scrn_format *format;
+                format = &state->scroll_screens[scrn]->format;
+
+                memset(banks[scrn], 0x00, sizeof(banks[scrn]));
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                enable_bitmap |= 1 << scrn;
+
+                if (!fuzz_scrn_banks_get(format, state->vrsize, banks[scrn])) {
+                        exceeded = true;
+                }
+        }
+
+        if (exceeded) {
+                return -9;
+        }
+
+        /* Vertical cell scroll of NBG0 and NBG1 is read from the same
+         * bank */
+        if ((banks[SCRN_NBG0][CYCP_DEMAND_VCS] != 0x00) &&
+            (banks[SCRN_NBG1][CYCP_DEMAND_VCS] != 0x00) &&
+            ((fuzz_pattern_bitmap(ramctl, banks[SCRN_NBG0][CYCP_DEMAND_VCS])) !=
+                (fuzz_pattern_bitmap(ramctl, banks[SCRN_NBG1][CYCP_DEMAND_VCS])))) {
+                return -2;
+        }
+
+        uint8_t pnd_bitmap;
+        pnd_bitmap = banks[SCRN_NBG0][CYCP_DEMAND_PND] | banks[SCRN_NBG1][CYCP_DEMAND_PND] |
+            banks[SCRN_NBG2][CYCP_DEMAND_PND] | banks[SCRN_NBG3][CYCP_DEMAND_PND];
+
+        const uint8_t *pairs;
+        pairs = _fuzz_pnd_bank_pairs[(ramctl >> 8) & 0x03];
+
+        uint32_t i;
+        for (i = 0; pairs[i] != 0x00; i++) {
+                if ((pnd_bitmap & pairs[i]) == pairs[i]) {
+                        return -3;
+                }
+        }
+
+        /* RBG1 is displayed along with RBG0, and without the NBGs */
+        if (((enable_bitmap & (1 << SCRN_RBG1)) != 0x00) &&
+            (((enable_bitmap & (1 << SCRN_RBG0)) == 0x00) ||
+                ((enable_bitmap & 0x0F) != 0x00))) {
+                return -8;
+        }
+
+        /* Rotation parameters are swapped via coefficient data only
+         * with a coefficient table */
+        for (scrn = SCRN_RBG0; scrn <= SCRN_RBG1; scrn++) {
+                const struct scrn_format *format;
+                format = &state->scroll_screens[scrn]->format;
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                uint8_t rp_mode;
+                rp_mode = (format->sf_type == SCRN_TYPE_CELL) ?
+                    format->sf_format.cell.scf_rp_mode : format->sf_format.bitmap.sbf_rp_mode;
+
+                if ((rp_mode == SCRN_RP_MODE_SWAP_COEFFICIENT) &&
+                    (format->sf_coefficient_table == 0x00000000)) {
+                        return -8;
+                }
+        }
+
+        /* Each bank the tables of RBG0, or the coefficient table of
+         * RBG1, are read from holds a single kind of table, and is read
+         * by the rotation engine alone */
+        uint8_t reserved;
+        reserved = 0x00;
+
+        uint32_t kind;
+        for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                uint8_t bitmap;
+                bitmap = banks[SCRN_RBG0][kind];
+
+                if (kind == CYCP_DEMAND_VCS) {
+                        bitmap |= banks[SCRN_RBG1][kind];
+                }
+
+                bitmap = fuzz_pattern_bitmap(ramctl, bitmap);
+
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                                continue;
+                        }
+
+                        uint8_t rdbs;
+                        rdbs = RAMCTL_RDBS_GET(demands->ramctl, bank);
+
+                        if ((rdbs != RAMCTL_RDBS_NONE) && (rdbs != kind_rdbs[kind])) {
+                                return -7;
+                        }
+
+                        demands->ramctl |= RAMCTL_RDBS(kind_rdbs[kind], bank);
+                }
+
+                reserved |= bitmap;
+        }
+
+        demands->rbg1_pnd_bitmap = fuzz_pattern_bitmap(ramctl, banks[SCRN_RBG1][CYCP_DEMAND_PND]);
+        demands->rbg1_cpd_bitmap = fuzz_pattern_bitmap(ramctl, banks[SCRN_RBG1][CYCP_DEMAND_CPD]);
+
+        if (((demands->rbg1_pnd_bitmap & demands->rbg1_cpd_bitmap) != 0x00) ||
+            (((demands->rbg1_pnd_bitmap | demands->rbg1_cpd_bitmap) & reserved) != 0x00)) {
+                return -7;
+        }
+
+        for (scrn = SCRN_NBG0; scrn <= SCRN_NBG3; scrn++) {
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        if ((fuzz_pattern_bitmap(ramctl, banks[scrn][kind]) & reserved) != 0x00) {
+                                return -7;
+                        }
+                }
+        }
+
+        for (scrn = SCRN_NBG0; scrn <= SCRN_NBG3; scrn++) {
+                const struct scrn_format *format;
+                format = &state->scroll_screens[scrn]->format;
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                uint8_t counts[CYCP_DEMAND_COUNT];
+
+                int32_t ret;
+                if ((ret = fuzz_scrn_counts_get(format, halved, counts)) < 0) {
+                        return ret;
+                }
+
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        uint8_t bitmap;
+                        bitmap = fuzz_pattern_bitmap(ramctl, banks[scrn][kind]);
+
+                        uint32_t bank;
+                        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                                if ((bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                                        demands->counts[bank][codes[kind] + scrn] = counts[kind];
+                                }
+                        }
+                }
+        }
+
+        /* Each bank with a cycle pattern register of its own */
+        demands->bank_bitmap = fuzz_pattern_bitmap(ramctl, 0x0F);
+        demands->bank_bitmap &= ~(reserved | demands->rbg1_pnd_bitmap | demands->rbg1_cpd_bitmap);
+
+        return 0;
+}
+
+/*-
+ * Write the bank bit-maps of each kind of data of the scroll screen of
+ * the format FORMAT to BANKS, in VRAM of the size VRSIZE, where the
+ * vertical cell scroll kind of a rotational background is its
+ * coefficient table.
+ *
+ * The character pattern table of a cell format is taken to hold
+ * CYCP_CP_TABLE_CELL_COUNT cells, up to the end of VRAM.
+ *
+ * If the data is stored within VRAM, true is returned.
+ */
+static bool
+fuzz_scrn_banks_get(const struct scrn_format *format, uint16_t vrsize, uint8_t *banks)
+{
+        /* Number of bits per dot for each character color count */
+        static const uint8_t cc_count_bpp[] = {
+                4,
+                8,
+                16,
+                16,
+                32
+        };
+
+        uint32_t vram_size;
+        vram_size = VRAM_SIZE(vrsize);
+        uint32_t bank_size;
+        bank_size = vram_size / VRAM_BANK_COUNT;
+
+        bool rotation;
+        rotation = format->sf_scroll_screen >= SCRN_RBG0;
+
+        bool within;
+        within = true;
+
+        uint32_t first;
+        uint32_t size;
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                const struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                if (VRAM_BANK_ADDRESS(format->sf_vcs_table)) {
+                        uint32_t offset;
+                        offset = VRAM_OFFSET(format->sf_vcs_table);
+
+                        if (offset >= vram_size) {
+                                within = false;
+                        } else if (!rotation) {
+                                banks[CYCP_DEMAND_VCS] |= VRAM_BANK_BIT(offset / bank_size);
+                        }
+                }
+
+                uint32_t plane_count;
+                plane_count = rotation ? 16 : 4;
+
+                uint32_t i;
+                for (i = 0; i < plane_count; i++) {
+                        if (!VRAM_BANK_ADDRESS(cell_format->scf_map.planes[i])) {
+                                continue;
+                        }
+
+                        uint32_t offset;
+                        offset = VRAM_OFFSET(cell_format->scf_map.planes[i]);
+
+                        if (offset >= vram_size) {
+                                within = false;
+                        } else {
+                                banks[CYCP_DEMAND_PND] |= VRAM_BANK_BIT(offset / bank_size);
+                        }
+                }
+
+                first = VRAM_OFFSET(cell_format->scf_cp_table);
+                size = (CYCP_CP_TABLE_CELL_COUNT * 8 * 8 *
+                    cc_count_bpp[format->sf_cc_count]) / 8;
+
+                /* The table is cut at the end of VRAM */
+                if ((first < vram_size) && ((first + size) > vram_size)) {
+                        size = vram_size - first;
+                }
+        } else {
+                const struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                first = VRAM_OFFSET(bitmap_format->sbf_bitmap_pattern);
+                size = (bitmap_format->sbf_bitmap_size.width *
+                    bitmap_format->sbf_bitmap_size.height *
+                    cc_count_bpp[format->sf_cc_count]) / 8;
+        }
+
+        if (size == 0) {
+                size = 1;
+        }
+
+        if (first >= vram_size) {
+                within = false;
+        } else {
+                if ((first + size) > vram_size) {
+                        within = false;
+
+                        size = vram_size - first;
+                }
+
+                uint32_t bank;
+                for (bank = first / bank_size; bank <= ((first + size - 1) / bank_size); bank++) {
+                        banks[CYCP_DEMAND_CPD] |= VRAM_BANK_BIT(bank);
+                }
+        }
+
+        if (rotation && VRAM_BANK_ADDRESS(format->sf_coefficient_table)) {
+                uint32_t offset;
+                offset = VRAM_OFFSET(format->sf_coefficient_table);
+
+                if (offset >= vram_size) {
+                        within = false;
+                } else {
+                        banks[CYCP_DEMAND_VCS] |= VRAM_BANK_BIT(offset / bank_size);
+                }
+        }
+
+        return within;
+}
+
+/*-
+ * Write the number of access timings each kind of read of the NBG of
+ * the format FORMAT requires per cell to COUNTS, in a TV screen mode
+ * whose access timings are HALVED or not.
+ *
+ * If successful, 0 is returned. Otherwise, the value vdp2cycp() returns
+ * for a count the tables reject is returned.
+ */
+static int32_t
+fuzz_scrn_counts_get(const struct scrn_format *format, bool halved, uint8_t *counts)
+{
+        memset(counts, 0x00, CYCP_DEMAND_COUNT);
+
+        uint8_t reduction;
+        reduction = format->sf_reduction;
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                /* Only NBG0 and NBG1 are capable of vertical cell
+                 * scroll */
+                if (VRAM_BANK_ADDRESS(format->sf_vcs_table)) {
+                        if (format->sf_scroll_screen > SCRN_NBG1) {
+                                return -4;
+                        }
+
+                        counts[CYCP_DEMAND_VCS] = 1;
+                }
+
+                uint8_t pnd_size;
+                pnd_size = format->sf_format.cell.scf_pnd_size;
+
+                if (((pnd_size != 1) && (pnd_size != 2)) ||
+                    (reduction > SCRN_REDUCTION_QUARTER) ||
+                    (halved && (reduction != SCRN_REDUCTION_NONE))) {
+                        return -5;
+                }
+
+                counts[CYCP_DEMAND_PND] = _fuzz_pnd_counts[reduction];
+        }
+
+        uint8_t count;
+        count = (format->sf_cc_count <= SCRN_CCC_RGB_16770000) ?
+            _fuzz_cpd_counts[format->sf_type][format->sf_cc_count] : 0;
+
+        if ((count == 0) || (reduction > SCRN_REDUCTION_QUARTER)) {
+                return -6;
+        }
+
+        count <<= reduction;
+
+        if ((halved && ((reduction != SCRN_REDUCTION_NONE) || (count > 4))) ||
+            ((reduction != SCRN_REDUCTION_NONE) && (count > 4))) {
+                return -6;
+        }
+
+        counts[CYCP_DEMAND_CPD] = count;
+
+        return 0;
+}
+
+/*-
+ * Return the bit-map of the banks whose cycle pattern registers the banks
+ * of the bit-map BANKS are read with, where the VRAM partitioning is that
+ * of RAMCTL.
+ */
+static uint8_t
+fuzz_pattern_bitmap(uint16_t ramctl, uint8_t banks)
+{
+        const uint8_t *pattern_banks;
+        pattern_banks = _fuzz_pattern_banks[(ramctl >> 8) & 0x03];
+
+        uint8_t bitmap;
+        bitmap = 0x00;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((banks & VRAM_BANK_BIT(bank)) != 0x00) {
+                        bitmap |= VRAM_BANK_BIT(pattern_banks[bank]);
+                }
+        }
+
+        return bitmap;
+}
+
+/*-
+ * Return the bit-map of the access timings of the cycle pattern PV set
+ * to the access code CODE.
+ */
+static uint8_t
+fuzz_code_timings(uint32_t pv, uint32_t code)
+{
+        uint8_t timings;
+        timings = 0x00;
+
+        uint32_t t;
+        for (t = 0; t < FUZZ_TIMING_COUNT; t++) {
+                if (VRAM_CTL_CYCP_TIMING_VALUE(pv, t) == code) {
+                        timings |= 1 << t;
+                }
+        }
+
+        return timings;
+}
+
+/*-
+ * Return the range of access timings the character pattern data of the
+ * NBG SCRN can be read at, as left by each of its pattern name data
+ * reads in the cycle patterns VRAM_CYCP.
+ */
+static uint8_t
+fuzz_cpd_range_get(const struct fuzz_demands *demands, const union vram_cycp *vram_cycp,
+    uint32_t scrn)
+{
+        uint8_t range;
+        range = demands->timings;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if (demands->counts[bank][VRAM_CTL_CYCP_PNDR_NBG0 + scrn] == 0) {
+                        continue;
+                }
+
+                uint8_t timings;
+                timings = fuzz_code_timings(vram_cycp->pv[bank], VRAM_CTL_CYCP_PNDR_NBG0 + scrn) &
+                    demands->timings;
+
+                uint32_t t;
+                for (t = 0; t < FUZZ_TIMING_COUNT; t++) {
+                        if ((timings & (1 << t)) != 0x00) {
+                                range &= demands->cpd_ranges[t];
+                        }
+                }
+        }
+
+        return range;
+}
+
+/*-
+ * Find a cycle pattern of DEMANDS with the reference, written to
+ * VRAM_CYCP.
+ *
+ * If a cycle pattern is found, 0 is returned. Otherwise,
+ * FUZZ_RESULT_INFEASIBLE is returned if there is none, or
+ * FUZZ_RESULT_LIMIT once FUZZ_NODE_LIMIT branches are visited.
+ */
+static int32_t
+fuzz_oracle_solve(const struct fuzz_demands *demands, union vram_cycp *vram_cycp)
+{
+        struct fuzz_oracle oracle;
+
+        memset(&oracle, 0x00, sizeof(oracle));
+
+        oracle.demands = demands;
+
+        memset(&oracle.vram_cycp, 0xFF, sizeof(oracle.vram_cycp));
+        (void)memcpy(oracle.remaining, demands->counts, sizeof(oracle.remaining));
+
+        int32_t ret;
+        ret = fuzz_oracle_place(&oracle, 0);
+
+        if (ret < 0) {
+                return FUZZ_RESULT_LIMIT;
+        }
+
+        if (ret == 0) {
+                return FUZZ_RESULT_INFEASIBLE;
+        }
+
+        /* RBG1 reads at every access timing of its banks */
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t code;
+
+                if ((demands->rbg1_pnd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        code = VRAM_CTL_CYCP_PNDR_NBG0;
+                } else if ((demands->rbg1_cpd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        code = VRAM_CTL_CYCP_CHPNDR_NBG0;
+                } else {
+                        continue;
+                }
+
+                uint32_t t;
+                for (t = 0; t < FUZZ_TIMING_COUNT; t++) {
+                        if ((demands->timings & (1 << t)) != 0x00) {
+                                oracle.vram_cycp.pv[bank] &= ~VRAM_CTL_CYCP_TIMING_MASK(t);
+                                oracle.vram_cycp.pv[bank] |= code << VRAM_CTL_CYCP_TIMING_BIT(t);
+                        }
+                }
+        }
+
+        *vram_cycp = oracle.vram_cycp;
+
+        return 0;
+}
+
+/*-
+ * Give access timing SLOT % 8 of bank SLOT / 8 of ORACLE each pattern
+ * name data or vertical cell scroll access code that still requires
+ * access timings of the bank, or leave it open, and try the slots
+ * following it. Once every slot is tried, the character pattern data
+ * reads are given the access timings left open.
+ *
+ * If a valid cycle pattern is found, 1 is returned. If none is, 0 is
+ * returned, or -1 once FUZZ_NODE_LIMIT branches are visited.
+ */
+static int32_t
+fuzz_oracle_place(struct fuzz_oracle *oracle, uint32_t slot)
+{
+        const struct fuzz_demands *demands;
+        demands = oracle->demands;
+
+        if (oracle->node_count >= FUZZ_NODE_LIMIT) {
+                return -1;
+        }
+
+        oracle->node_count++;
+
+        /* Every pattern name data and vertical cell scroll read of the
+         * previous bank must have been given its access timings */
+        if ((slot > 0) && ((slot % FUZZ_TIMING_COUNT) == 0) &&
+            ((fuzz_oracle_first_count(oracle, (slot / FUZZ_TIMING_COUNT) - 1)) > 0)) {
+                return 0;
+        }
+
+        if (slot == (VRAM_BANK_COUNT * FUZZ_TIMING_COUNT)) {
+                union vram_cycp vram_cycp;
+                vram_cycp = oracle->vram_cycp;
+                uint8_t remaining[VRAM_BANK_COUNT][FUZZ_CODE_COUNT];
+
+                (void)memcpy(remaining, oracle->remaining, sizeof(remaining));
+
+                uint32_t scrn;
+                for (scrn = 0; scrn < 4; scrn++) {
+                        oracle->cpd_ranges[scrn] = fuzz_cpd_range_get(demands, &oracle->vram_cycp,
+                            scrn);
+                }
+
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        if ((demands->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                                continue;
+                        }
+
+                        int32_t ret;
+                        ret = fuzz_oracle_fill(oracle, bank, 0);
+
+                        if (ret <= 0) {
+                                oracle->vram_cycp = vram_cycp;
+
+                                (void)memcpy(oracle->remaining, remaining, sizeof(remaining));
+
+                                return ret;
+                        }
+                }
+
+                return 1;
+        }
+
+        uint32_t bank;
+        bank = slot / FUZZ_TIMING_COUNT;
+        uint32_t t;
+        t = slot % FUZZ_TIMING_COUNT;
+
+        if (((demands->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) ||
+            ((demands->timings & (1 << t)) == 0x00)) {
+                return fuzz_oracle_place(oracle, slot + 1);
+        }
+
+        const uint8_t *remaining;
+        remaining = oracle->remaining[bank];
+
+        uint32_t first_count;
+        first_count = fuzz_oracle_first_count(oracle, bank);
+
+        uint32_t cpd_count;
+        cpd_count = remaining[VRAM_CTL_CYCP_CHPNDR_NBG0] + remaining[VRAM_CTL_CYCP_CHPNDR_NBG1] +
+            remaining[VRAM_CTL_CYCP_CHPNDR_NBG2] + remaining[VRAM_CTL_CYCP_CHPNDR_NBG3];
+
+        /* Access timings of the bank from this one on */
+        uint32_t left;
+        left = bit_count(demands->timings & ~((1 << t) - 1));
+
+        if ((first_count > left) ||
+            ((first_count + cpd_count) > (left + bit_count(oracle->open[bank])))) {
+                return 0;
+        }
+
+        uint32_t i;
+        for (i = 0; i < sizeof(_fuzz_first_codes); i++) {
+                uint32_t code;
+                code = _fuzz_first_codes[i];
+
+                if (remaining[code] == 0) {
+                        continue;
+                }
+
+                if ((code == VRAM_CTL_CYCP_VCSTDR_NBG0) &&
+                    ((demands->vcs_ranges[0] & (1 << t)) == 0x00)) {
+                        continue;
+                }
+
+                /* After every NBG0 vertical cell scroll read */
+                if ((code == VRAM_CTL_CYCP_VCSTDR_NBG1) &&
+                    (((demands->vcs_ranges[1] & (1 << t)) == 0x00) ||
+                        (remaining[VRAM_CTL_CYCP_VCSTDR_NBG0] > 0))) {
+                        continue;
+                }
+
+                oracle->vram_cycp.pv[bank] &= ~VRAM_CTL_CYCP_TIMING_MASK(t);
+                oracle->vram_cycp.pv[bank] |= code << VRAM_CTL_CYCP_TIMING_BIT(t);
+                oracle->remaining[bank][code]--;
+
+                int32_t ret;
+                ret = fuzz_oracle_place(oracle, slot + 1);
+
+                /* A cycle pattern found is kept */
+                if (ret != 0) {
+                        return ret;
+                }
+
+                oracle->remaining[bank][code]++;
+                oracle->vram_cycp.pv[bank] |= VRAM_CTL_CYCP_TIMING_MASK(t);
+        }
+
+        oracle->open[bank] |= 1 << t;
+
+        int32_t ret;
+        ret = fuzz_oracle_place(oracle, slot + 1);
+
+        oracle->open[bank] &= ~(1 << t);
+
+        return ret;
+}
+
+/*-
+ * Return the number of access timings the pattern name data and vertical
+ * cell scroll reads of bank BANK of ORACLE still require.
+ */
+static uint32_t
+fuzz_oracle_first_count(const struct fuzz_oracle *oracle, uint32_t bank)
+{
+        uint32_t count;
+        count = 0;
+
+        uint32_t i;
+        for (i = 0; i < sizeof(_fuzz_first_codes); i++) {
+                count += oracle->remaining[bank][_fuzz_first_codes[i]];
+        }
+
+        return count;
+}
+
+/*-
+ * Give the open access timing T of bank BANK of ORACLE each character
+ * pattern data access code that still requires access timings of the
+ * bank, within its range, or leave it open, and try the access timings
+ * following it.
+ *
+ * If every read of the bank is given its access timings, 1 is returned,
+ * and the access timings are kept. If not, 0 is returned, or -1 once
+ * FUZZ_NODE_LIMIT branches are visited.
+ */
+static int32_t
+fuzz_oracle_fill(struct fuzz_oracle *oracle, uint32_t bank, uint32_t t)
+{
+        if (oracle->node_count >= FUZZ_NODE_LIMIT) {
+                return -1;
+        }
+
+        oracle->node_count++;
+
+        uint8_t *remaining;
+        remaining = oracle->remaining[bank];
+
+        uint32_t count;
+        count = remaining[VRAM_CTL_CYCP_CHPNDR_NBG0] + remaining[VRAM_CTL_CYCP_CHPNDR_NBG1] +
+            remaining[VRAM_CTL_CYCP_CHPNDR_NBG2] + remaining[VRAM_CTL_CYCP_CHPNDR_NBG3];
+
+        if (count == 0) {
+                return 1;
+        }
+
+        uint8_t open;
+        open = oracle->open[bank] & ~((1 << t) - 1);
+
+        if (count > bit_count(open)) {
+                return 0;
+        }
+
+        /* The next open access timing */
+        while ((open & (1 << t)) == 0x00) {
+                t++;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                uint32_t code;
+                code = VRAM_CTL_CYCP_CHPNDR_NBG0 + scrn;
+
+                if ((remaining[code] == 0) || ((oracle->cpd_ranges[scrn] & (1 << t)) == 0x00)) {
+                        continue;
+                }
+
+                oracle->vram_cycp.pv[bank] &= ~VRAM_CTL_CYCP_TIMING_MASK(t);
+                oracle->vram_cycp.pv[bank] |= code << VRAM_CTL_CYCP_TIMING_BIT(t);
+                remaining[code]--;
+
+                int32_t ret;
+                ret = fuzz_oracle_fill(oracle, bank, t + 1);
+
+                if (ret != 0) {
+                        return ret;
+                }
+
+                remaining[code]++;
+                oracle->vram_cycp.pv[bank] |= VRAM_CTL_CYCP_TIMING_MASK(t);
+        }
+
+        return fuzz_oracle_fill(oracle, bank, t + 1);
+}
+
+/*-
+ * Check the cycle patterns VRAM_CYCP and RAMCTL of the solver against
+ * DEMANDS.
+ *
+ * RAMCTL must hold the VRAM partitioning and RDBS of DEMANDS. In each
+ * bank given to the NBGs, every access timing of the TV screen mode must
+ * be set to a read of data stored in the bank, to CPU read/write, or to
+ * no access, and each read must be given as many access timings as it
+ * requires, within its range. The banks of RBG1 must be read at every
+ * access timing.
+ *
+ * If the cycle patterns are valid, true is returned.
+ */
+static bool
+fuzz_check(const struct fuzz_demands *demands, uint16_t ramctl, const union vram_cycp *vram_cycp)
+{
+        if (ramctl != demands->ramctl) {
+                return false;
+        }
+
+        /* After the last NBG0 vertical cell scroll read */
+        uint8_t vcs_range_nbg1;
+        vcs_range_nbg1 = demands->vcs_ranges[1];
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if (demands->counts[bank][VRAM_CTL_CYCP_VCSTDR_NBG0] == 0) {
+                        continue;
+                }
+
+                uint8_t timings;
+                timings = fuzz_code_timings(vram_cycp->pv[bank], VRAM_CTL_CYCP_VCSTDR_NBG0);
+
+                uint32_t t;
+                for (t = 0; t < FUZZ_TIMING_COUNT; t++) {
+                        if ((timings & (1 << t)) != 0x00) {
+                                vcs_range_nbg1 &= ~((2 << t) - 1);
+                        }
+                }
+        }
+
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t pv;
+                pv = vram_cycp->pv[bank];
+
+                if ((demands->rbg1_pnd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        if (fuzz_code_timings(pv, VRAM_CTL_CYCP_PNDR_NBG0) != demands->timings) {
+                                return false;
+                        }
+
+                        continue;
+                }
+
+                if ((demands->rbg1_cpd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        if (fuzz_code_timings(pv, VRAM_CTL_CYCP_CHPNDR_NBG0) != demands->timings) {
+                                return false;
+                        }
+
+                        continue;
+                }
+
+                if ((demands->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                uint32_t code;
+                for (code = 0; code < FUZZ_CODE_COUNT; code++) {
+                        uint8_t timings;
+                        timings = fuzz_code_timings(pv, code) & demands->timings;
+
+                        if ((code == VRAM_CTL_CYCP_CPU_RW) || (code == VRAM_CTL_CYCP_NO_ACCESS)) {
+                                continue;
+                        }
+
+                        uint8_t count;
+                        count = demands->counts[bank][code];
+
+                        if (count == 0) {
+                                if (timings != 0x00) {
+                                        return false;
+                                }
+
+                                continue;
+                        }
+
+                        uint8_t range;
+                        range = demands->timings;
+
+                        if (code == VRAM_CTL_CYCP_VCSTDR_NBG0) {
+                                range = demands->vcs_ranges[0];
+                        } else if (code == VRAM_CTL_CYCP_VCSTDR_NBG1) {
+                                range = vcs_range_nbg1;
+                        } else if ((code >= VRAM_CTL_CYCP_CHPNDR_NBG0) &&
+                            (code <= VRAM_CTL_CYCP_CHPNDR_NBG3)) {
+                                range = fuzz_cpd_range_get(demands, vram_cycp,
+                                    code - VRAM_CTL_CYCP_CHPNDR_NBG0);
+                        }
+
+                        if (bit_count(timings & range) < count) {
+                                return false;
+                        }
+                }
+        }
+
+        return true;
+}
+
+/*-
+ * Return the number of access timings of the cycle patterns VRAM_CYCP
+ * open to the CPU, weighted per bank by WEIGHTS, in the banks given to
+ * the NBGs of DEMANDS.
+ */
+static uint32_t
+fuzz_score(const struct fuzz_demands *demands, const uint8_t *weights,
+    const union vram_cycp *vram_cycp)
+{
+        uint32_t score;
+        score = 0;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((demands->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                uint8_t timings;
+                timings = fuzz_code_timings(vram_cycp->pv[bank], VRAM_CTL_CYCP_CPU_RW) &
+                    demands->timings;
+
+                score += weights[bank] * bit_count(timings);
+        }
+
+        return score;
+}
+
+/*-
+ * Return the most access timings that can be left open to the CPU by a
+ * cycle pattern of DEMANDS, weighted per bank by WEIGHTS.
+ *
+ * Each read is given no more access timings than it requires, so every
+ * cycle pattern the reference finds leaves the same access timings of
+ * each bank open, and the banks of RBG1 none.
+ */
+static uint32_t
+fuzz_score_max(const struct fuzz_demands *demands, const uint8_t *weights)
+{
+        uint32_t score;
+        score = 0;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((demands->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                uint32_t count;
+                count = 0;
+
+                uint32_t code;
+                for (code = 0; code < FUZZ_CODE_COUNT; code++) {
+                        count += demands->counts[bank][code];
+                }
+
+                score += weights[bank] * (bit_count(demands->timings) - count);
+        }
+
+        return score;
+}
+
+static uint64_t
+fuzz_clock(void)
+{
+        struct timespec ts;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef FUZZ_H_
+#define FUZZ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/* Most branches the reference searches for a single scene before it
+ * gives up on the scene */
+#define FUZZ_NODE_LIMIT         (1 << 22)
+
+/* One in this many generated scenes is solved in the hi-res TV screen
+ * mode */
+#define FUZZ_HIRES_RATIO        4
+
+/* One in this many generated scenes displays the rotational
+ * backgrounds */
+#define FUZZ_ROTATION_RATIO     4
+
+/* Number of weightings of the banks vdp2cycp_optimize() is checked
+ * with, the first weighting every bank the same */
+#define FUZZ_OBJECTIVE_COUNT    4
+
+int32_t fuzz_run(uint64_t, uint32_t, uint32_t);
+
+#endif /* !FUZZ_H_ */
@@ -0,0 +1,873 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layout.h"
+#include "math.h"
+
+#include "debug.h"
+
+/* Every table of every NBG */
+#define LAYOUT_TABLE_COUNT      (4 * CYCP_DEMAND_COUNT)
+
+/* Bitmap pattern lead addresses are given in units of 4-Mbit banks */
+#define LAYOUT_BITMAP_ALIGNMENT 0x20000
+
+/*-
+ * Search for the layout of the tables of a scene, one bank at a time for
+ * each table, from the largest table to the smallest.
+ */
+struct layout_search {
+        struct layout *layout;
+
+        /* Tables in the order banks are chosen for them, as SCRN *
+         * CYCP_DEMAND_COUNT + KIND */
+        uint8_t items[LAYOUT_TABLE_COUNT];
+        uint32_t item_count;
+
+        /* Bank chosen for each table */
+        uint8_t banks[LAYOUT_TABLE_COUNT];
+
+        /* Number of bytes and of access timings taken per bank */
+        uint32_t sizes[VRAM_BANK_COUNT];
+        uint8_t counts[VRAM_BANK_COUNT];
+
+        uint32_t bank_size;
+        uint8_t timing_count;
+
+        /* Offset of each table of the best layout found so far */
+        uint32_t offsets[LAYOUT_TABLE_COUNT];
+        bool found;
+};
+
+static void layout_search(struct layout_search *, uint32_t);
+static void layout_evaluate(struct layout_search *);
+static int32_t layout_place(const struct layout_search *, uint8_t, uint32_t *, uint32_t *);
+static void layout_formats_apply(const struct layout *, const uint32_t *, struct scrn_format *);
+
+static int32_t layout_banks_parse(const char *, uint8_t *);
+
+/*-
+ * Initialize CONSTRAINTS, such that every table is of its default size,
+ * and may be placed in any bank.
+ */
+void
+layout_constraints_init(struct layout_constraints *constraints)
+{
+        if (constraints == NULL) {
+                return;
+        }
+
+        memset(constraints->sizes, 0x00, sizeof(constraints->sizes));
+        memset(constraints->bank_bitmaps, 0x0F, sizeof(constraints->bank_bitmaps));
+}
+
+/*-
+ * Read the constraints of the file PATH into CONSTRAINTS, as described
+ * in struct layout_constraints.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CONSTRAINTS, PATH, or ERROR_LINE is NULL
+ *   - -2 The file could not be read
+ *   - -3 A line is not valid, where its line number is written to
+ *        ERROR_LINE
+ */
+int32_t
+layout_constraints_load(struct layout_constraints *constraints, const char *path,
+    uint32_t *error_line)
+{
+        static const char *scrn_names[] = {
+                "NBG0",
+                "NBG1",
+                "NBG2",
+                "NBG3"
+        };
+
+        static const char *kind_names[CYCP_DEMAND_COUNT] = {
+                "VCS",
+                "PND",
+                "CPD"
+        };
+
+        if ((constraints == NULL) || (path == NULL) || (error_line == NULL)) {
+                return -1;
+        }
+
+        layout_constraints_init(constraints);
+
+        FILE *fp;
+
+        if ((fp = fopen(path, "r")) == NULL) {
+                return -2;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        uint32_t line;
+        line = 0;
+
+        char text[256];
+
+        while ((fgets(text, sizeof(text), fp)) != NULL) {
+                line++;
+
+                text[strcspn(text, "\r\n")] = '\0';
+
+                if ((text[0] == '\0') || (text[0] == '#')) {
+                        continue;
+                }
+
+                char *fields[4];
+
+                uint32_t field_count;
+                field_count = 0;
+
+                char *field;
+                field = text;
+
+                while ((field != NULL) && (field_count < 4)) {
+                        fields[field_count++] = field;
+
+                        if ((field = strchr(field, ',')) != NULL) {
+                                *field++ = '\0';
+                        }
+                }
+
+                if ((field != NULL) || (field_count < 2)) {
+                        ret = -3;
+                        break;
+                }
+
+                uint32_t scrn;
+                for (scrn = 0; scrn < 4; scrn++) {
+                        if ((strcmp(fields[0], scrn_names[scrn])) == 0) {
+                                break;
+                        }
+                }
+
+                uint32_t kind;
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        if ((strcmp(fields[1], kind_names[kind])) == 0) {
+                                break;
+                        }
+                }
+
+                if ((scrn == 4) || (kind == CYCP_DEMAND_COUNT)) {
+                        ret = -3;
+                        break;
+                }
+
+                if ((field_count > 2) && (fields[2][0] != '\0')) {
+                        char *end;
+
+                        unsigned long size;
+                        size = strtoul(fields[2], &end, 0);
+
+                        if ((*end != '\0') || (size == 0) || (size > 0x00100000)) {
+                                ret = -3;
+                                break;
+                        }
+
+                        constraints->sizes[scrn][kind] = size;
+                }
+
+                if ((field_count > 3) && (fields[3][0] != '\0') &&
+                    ((layout_banks_parse(fields[3], &constraints->bank_bitmaps[scrn][kind])) < 0)) {
+                        ret = -3;
+                        break;
+                }
+        }
+
+        if (ret < 0) {
+                *error_line = line;
+        }
+
+        (void)fclose(fp);
+
+        return ret;
+}
+
+/*-
+ * Initialize LAYOUT with the formats of the scene SCENE, the tables of
+ * its NBGs sized and constrained by CONSTRAINTS, in the TV screen mode
+ * TVMD, and with the VRAM size VRSIZE.
+ *
+ * The pattern name table of an NBG holds its planes, in the order, and
+ * at the distance from each other, they are given. The character pattern
+ * table of a bitmap format is the size of its bitmap. A size given by
+ * CONSTRAINTS replaces the default size of a table, but grows the
+ * planes, or the bitmap, only.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 LAYOUT, SCENE, or CONSTRAINTS is NULL
+ *   - -2 A rotational background is enabled
+ *   - -3 The format of an NBG is not supported, as
+ *        cycp_calculate_timings_tvmd() finds it
+ */
+int32_t
+layout_init(struct layout *layout, const struct csv_scene *scene,
+    const struct layout_constraints *constraints, uint16_t tvmd, uint16_t vrsize)
+{
+        /* Number of bits per dot for each character color count */
+        static const uint8_t cc_count_bpp[] = {
+                4,      /* 16 (palette) */
+                8,      /* 256 (palette) */
+                16,     /* 2048 (palette) */
+                16,     /* 32,768 (RGB) */
+                32      /* 16,770,000 (RGB) */
+        };
+
+        if ((layout == NULL) || (scene == NULL) || (constraints == NULL)) {
+                return -1;
+        }
+
+        memset(layout, 0x00, sizeof(*layout));
+
+        layout->format_count = scene->format_count;
+        layout->tvmd = tvmd;
+        layout->vrsize = vrsize;
+
+        (void)memcpy(layout->formats, scene->formats,
+            scene->format_count * sizeof(struct scrn_format));
+
+        uint32_t i;
+        for (i = 0; i < layout->format_count; i++) {
+                const struct scrn_format *format;
+                format = &layout->formats[i];
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                uint8_t scrn;
+                scrn = format->sf_scroll_screen;
+
+                if (scrn > SCRN_NBG3) {
+                        return -2;
+                }
+
+                struct layout_table *tables;
+                tables = layout->tables[scrn];
+
+                if ((cycp_calculate_timings_tvmd(format, tvmd,
+                            &tables[CYCP_DEMAND_VCS].count,
+                            &tables[CYCP_DEMAND_PND].count,
+                            &tables[CYCP_DEMAND_CPD].count)) < 0) {
+                        return -3;
+                }
+
+                uint32_t bpp;
+                bpp = cc_count_bpp[format->sf_cc_count];
+
+                if (format->sf_type == SCRN_TYPE_BITMAP) {
+                        const struct scrn_bitmap_format *bitmap_format;
+                        bitmap_format = &format->sf_format.bitmap;
+
+                        tables[CYCP_DEMAND_CPD].size = (bitmap_format->sbf_bitmap_size.width *
+                            bitmap_format->sbf_bitmap_size.height * bpp) >> 3;
+                        tables[CYCP_DEMAND_CPD].alignment = LAYOUT_BITMAP_ALIGNMENT;
+                        tables[CYCP_DEMAND_CPD].offset =
+                            VRAM_OFFSET(bitmap_format->sbf_bitmap_pattern);
+                } else {
+                        const struct scrn_cell_format *cell_format;
+                        cell_format = &format->sf_format.cell;
+
+                        /* A page is 64x64 cells, or 32x32 characters of
+                         * 2x2 cells, of one or two words each */
+                        uint32_t plane_size;
+                        plane_size = ((cell_format->scf_character_size == (2 * 2)) ?
+                            (32 * 32) : (64 * 64)) * cell_format->scf_pnd_size * 2 *
+                            cell_format->scf_plane_size;
+
+                        uint32_t first;
+                        first = VRAM_OFFSET(cell_format->scf_map.planes[0]);
+                        uint32_t last;
+                        last = first;
+
+                        uint32_t plane;
+                        for (plane = 1; plane < 4; plane++) {
+                                uint32_t offset;
+                                offset = VRAM_OFFSET(cell_format->scf_map.planes[plane]);
+
+                                first = (offset < first) ? offset : first;
+                                last = (offset > last) ? offset : last;
+                        }
+
+                        tables[CYCP_DEMAND_PND].size = (last - first) + plane_size;
+                        tables[CYCP_DEMAND_PND].alignment = plane_size;
+                        tables[CYCP_DEMAND_PND].offset = first;
+
+                        /* Each cell is 8x8 dots */
+                        tables[CYCP_DEMAND_CPD].size = (LAYOUT_CPD_CELL_COUNT * 8 * 8 * bpp) >> 3;
+                        tables[CYCP_DEMAND_CPD].alignment = 0x20;
+                        tables[CYCP_DEMAND_CPD].offset = VRAM_OFFSET(cell_format->scf_cp_table);
+
+                        if (tables[CYCP_DEMAND_VCS].count > 0) {
+                                tables[CYCP_DEMAND_VCS].size = LAYOUT_VCS_SIZE;
+                                tables[CYCP_DEMAND_VCS].alignment = 4;
+                                tables[CYCP_DEMAND_VCS].offset = VRAM_OFFSET(format->sf_vcs_table);
+                        }
+                }
+
+                uint32_t kind;
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        struct layout_table *table;
+                        table = &tables[kind];
+
+                        if (table->size == 0) {
+                                continue;
+                        }
+
+                        uint32_t size;
+                        size = constraints->sizes[scrn][kind];
+
+                        /* The planes and the bitmap are no smaller than
+                         * the formats make them */
+                        if ((size > table->size) ||
+                            ((size > 0) && (kind != CYCP_DEMAND_PND) &&
+                                (format->sf_type == SCRN_TYPE_CELL))) {
+                                table->size = size;
+                        }
+
+                        table->bank_bitmap = constraints->bank_bitmaps[scrn][kind];
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Choose the bank and the address of every table of LAYOUT, such that
+ * the cycle patterns can be calculated, as vdp2cycp_optimize() does with
+ * any VRAM partitioning.
+ *
+ * Of every layout, the one leaving the most access timings open to the
+ * CPU is chosen, then the one leaving the largest contiguous free region
+ * of VRAM. Every bank of each table is tried, pruned when a bank lacks
+ * the bytes or the access timings the tables placed in it require. The
+ * tables placed in a bank are packed from its start, the most aligned
+ * first, and a bitmap may run on into the banks that follow.
+ *
+ * If successful, the formats of LAYOUT are written with the addresses of
+ * the layout chosen, along with its offsets, VRAM partitioning, and
+ * cycle patterns. Otherwise, a negative value is returned for the
+ * following cases:
+ *
+ *   - -1 LAYOUT is NULL
+ *   - -2 No layout permits the cycle patterns to be calculated
+ */
+int32_t
+layout_solve(struct layout *layout)
+{
+        if (layout == NULL) {
+                return -1;
+        }
+
+        struct layout_search search;
+
+        memset(&search, 0x00, sizeof(search));
+
+        search.layout = layout;
+        search.bank_size = VRAM_SIZE(layout->vrsize) / VRAM_BANK_COUNT;
+
+        struct cycp_ranges ranges;
+
+        cycp_calculate_ranges(layout->tvmd, &ranges);
+
+        search.timing_count = bit_count(ranges.timings);
+
+        layout->solve_count = 0;
+
+        /* From the largest table to the smallest */
+        uint32_t item;
+        for (item = 0; item < LAYOUT_TABLE_COUNT; item++) {
+                const struct layout_table *table;
+                table = &layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT];
+
+                if (table->size == 0) {
+                        continue;
+                }
+
+                uint32_t i;
+                for (i = search.item_count; i > 0; i--) {
+                        uint8_t previous;
+                        previous = search.items[i - 1];
+
+                        if (layout->tables[previous / CYCP_DEMAND_COUNT][previous % CYCP_DEMAND_COUNT].size >=
+                            table->size) {
+                                break;
+                        }
+
+                        search.items[i] = previous;
+                }
+
+                search.items[i] = item;
+                search.item_count++;
+        }
+
+        layout_search(&search, 0);
+
+        if (!search.found) {
+                return -2;
+        }
+
+        /* The planes are moved from the offsets they were given */
+        struct scrn_format formats[SCRN_COUNT];
+
+        layout_formats_apply(layout, search.offsets, formats);
+
+        (void)memcpy(layout->formats, formats, layout->format_count * sizeof(struct scrn_format));
+
+        for (item = 0; item < LAYOUT_TABLE_COUNT; item++) {
+                layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT].offset =
+                    search.offsets[item];
+        }
+
+        return 0;
+}
+
+/*-
+ * Try every bank of item I of SEARCH, and of the items following it.
+ */
+static void
+layout_search(struct layout_search *search, uint32_t i)
+{
+        if (i == search->item_count) {
+                layout_evaluate(search);
+                return;
+        }
+
+        uint8_t item;
+        item = search->items[i];
+
+        const struct layout_table *table;
+        table = &search->layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT];
+
+        /* Starting with the bank the table is in */
+        uint32_t first_bank;
+        first_bank = table->offset / search->bank_size;
+
+        uint32_t j;
+        for (j = 0; j < VRAM_BANK_COUNT; j++) {
+                uint32_t bank;
+                bank = (first_bank + j) % VRAM_BANK_COUNT;
+
+                if ((table->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                /* A bitmap larger than a bank runs on into the next */
+                if ((table->size <= search->bank_size) &&
+                    ((search->sizes[bank] + table->size) > search->bank_size)) {
+                        continue;
+                }
+
+                if ((search->counts[bank] + table->count) > search->timing_count) {
+                        continue;
+                }
+
+                search->banks[item] = bank;
+                search->sizes[bank] += table->size;
+                search->counts[bank] += table->count;
+
+                layout_search(search, i + 1);
+
+                search->sizes[bank] -= table->size;
+                search->counts[bank] -= table->count;
+        }
+}
+
+/*-
+ * Place the tables in the banks chosen by SEARCH, calculate the cycle
+ * patterns, and keep the layout if it is the best found so far.
+ */
+static void
+layout_evaluate(struct layout_search *search)
+{
+        /* Every bank is weighted the same */
+        const struct cycp_objective objective = {
+                .weights = {
+                        1,
+                        1,
+                        1,
+                        1
+                },
+                .partition = true
+        };
+
+        struct layout *layout;
+        layout = search->layout;
+
+        /* Banks holding tables */
+        uint8_t used_banks;
+        used_banks = 0x00;
+
+        uint32_t i;
+        for (i = 0; i < search->item_count; i++) {
+                used_banks |= VRAM_BANK_BIT(search->banks[search->items[i]]);
+        }
+
+        uint32_t offsets[LAYOUT_TABLE_COUNT];
+        uint32_t free_size;
+        free_size = 0;
+        bool placed;
+        placed = false;
+
+        /* Pack each bank holding tables towards either end, keeping the
+         * packing that leaves the largest contiguous free region */
+        uint32_t tops;
+        for (tops = 0x00; tops <= 0x0F; tops++) {
+                if ((tops & ~used_banks) != 0x00) {
+                        continue;
+                }
+
+                uint32_t tops_offsets[LAYOUT_TABLE_COUNT];
+                uint32_t tops_free_size;
+
+                if ((layout_place(search, tops, tops_offsets, &tops_free_size)) < 0) {
+                        continue;
+                }
+
+                if (placed && (tops_free_size <= free_size)) {
+                        continue;
+                }
+
+                placed = true;
+
+                (void)memcpy(offsets, tops_offsets, sizeof(offsets));
+                free_size = tops_free_size;
+        }
+
+        if (!placed) {
+                return;
+        }
+
+        struct scrn_format formats[SCRN_COUNT];
+        const struct scrn_format *format_ptrs[SCRN_COUNT + 1];
+
+        layout_formats_apply(layout, offsets, formats);
+
+        for (i = 0; i < layout->format_count; i++) {
+                format_ptrs[i] = &formats[i];
+        }
+
+        format_ptrs[i] = NULL;
+
+        struct state state;
+
+        state_init(&state, format_ptrs);
+
+        if (layout->vrsize != 0x0000) {
+                state_vrsize_set(&state, layout->vrsize);
+        }
+
+        state.tvmd = layout->tvmd;
+        state.ramctl = 0x0000;
+
+        layout->solve_count++;
+
+        if ((vdp2cycp_optimize(&state, &objective)) < 0) {
+                return;
+        }
+
+        uint32_t free_count;
+        free_count = vram_cycp_free_count(state.ramctl, &state.vram_cycp);
+
+        if (search->found &&
+            ((free_count < layout->free_count) ||
+                ((free_count == layout->free_count) && (free_size <= layout->free_size)))) {
+                return;
+        }
+
+        search->found = true;
+
+        (void)memcpy(search->offsets, offsets, sizeof(offsets));
+
+        layout->ramctl = state.ramctl;
+        layout->vram_cycp = state.vram_cycp;
+        layout->free_count = free_count;
+        layout->free_size = free_size;
+}
+
+/*-
+ * Pack the tables in the banks chosen by SEARCH, writing the offset of
+ * each table to OFFSETS, and the size of the largest contiguous free
+ * region of VRAM left to FREE_SIZE.
+ *
+ * The tables of a bank are packed towards its end if its bit is set in
+ * the bank bit-map TOPS, and towards its start otherwise, such that
+ * banks left partly free can have their free regions meet.
+ *
+ * If successful, 0 is returned. Otherwise, -1 is returned if a table
+ * can't be placed in its bank.
+ */
+static int32_t
+layout_place(const struct layout_search *search, uint8_t tops, uint32_t *offsets,
+    uint32_t *free_size)
+{
+        const struct layout *layout;
+        layout = search->layout;
+
+        memset(offsets, 0x00, LAYOUT_TABLE_COUNT * sizeof(uint32_t));
+
+        /* Placed tables, in the order of their offsets */
+        uint8_t placed[LAYOUT_TABLE_COUNT];
+        uint32_t placed_count;
+        placed_count = 0;
+
+        /* End of the last table placed, which a bitmap may push into the
+         * banks that follow */
+        uint32_t cursor;
+        cursor = 0;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t bank_start;
+                bank_start = bank * search->bank_size;
+                uint32_t bank_end;
+                bank_end = bank_start + search->bank_size;
+
+                if (cursor < bank_start) {
+                        cursor = bank_start;
+                }
+
+                /* The tables of the bank, the most aligned first */
+                uint8_t items[LAYOUT_TABLE_COUNT];
+                uint32_t item_count;
+                item_count = 0;
+
+                uint32_t i;
+                for (i = 0; i < search->item_count; i++) {
+                        uint8_t item;
+                        item = search->items[i];
+
+                        if (search->banks[item] != bank) {
+                                continue;
+                        }
+
+                        uint32_t alignment;
+                        alignment = layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT].alignment;
+
+                        uint32_t j;
+                        for (j = item_count; j > 0; j--) {
+                                uint8_t previous;
+                                previous = items[j - 1];
+
+                                if (layout->tables[previous / CYCP_DEMAND_COUNT][previous % CYCP_DEMAND_COUNT].alignment >=
+                                    alignment) {
+                                        break;
+                                }
+
+                                items[j] = previous;
+                        }
+
+                        items[j] = item;
+                        item_count++;
+                }
+
+                if ((tops & VRAM_BANK_BIT(bank)) != 0x00) {
+                        uint32_t top;
+                        top = bank_end;
+
+                        for (i = 0; i < item_count; i++) {
+                                uint8_t item;
+                                item = items[i];
+
+                                const struct layout_table *table;
+                                table = &layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT];
+
+                                if (table->size > (top - cursor)) {
+                                        return -1;
+                                }
+
+                                uint32_t offset;
+                                offset = (top - table->size) & ~(table->alignment - 1);
+
+                                if (offset < cursor) {
+                                        return -1;
+                                }
+
+                                offsets[item] = offset;
+                                top = offset;
+
+                                /* Placed downwards, so shift the others */
+                                (void)memmove(&placed[placed_count - i + 1],
+                                    &placed[placed_count - i], i);
+                                placed[placed_count - i] = item;
+                                placed_count++;
+                        }
+
+                        cursor = bank_end;
+
+                        continue;
+                }
+
+                for (i = 0; i < item_count; i++) {
+                        uint8_t item;
+                        item = items[i];
+
+                        const struct layout_table *table;
+                        table = &layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT];
+
+                        uint32_t offset;
+                        offset = (cursor + table->alignment - 1) & ~(table->alignment - 1);
+
+                        if (offset >= bank_end) {
+                                return -1;
+                        }
+
+                        /* Only a bitmap may run on into the next bank */
+                        if (((item % CYCP_DEMAND_COUNT) != CYCP_DEMAND_CPD) ||
+                            (table->alignment != LAYOUT_BITMAP_ALIGNMENT)) {
+                                if ((offset + table->size) > bank_end) {
+                                        return -1;
+                                }
+                        }
+
+                        offsets[item] = offset;
+                        cursor = offset + table->size;
+
+                        placed[placed_count++] = item;
+                }
+        }
+
+        uint32_t vram_size;
+        vram_size = VRAM_SIZE(layout->vrsize);
+
+        if (cursor > vram_size) {
+                return -1;
+        }
+
+        *free_size = 0;
+
+        uint32_t end;
+        end = 0;
+
+        uint32_t i;
+        for (i = 0; i <= placed_count; i++) {
+                uint32_t offset;
+                offset = (i < placed_count) ? offsets[placed[i]] : vram_size;
+
+                if ((offset - end) > *free_size) {
+                        *free_size = offset - end;
+                }
+
+                if (i < placed_count) {
+                        uint8_t item;
+                        item = placed[i];
+
+                        end = offset + layout->tables[item / CYCP_DEMAND_COUNT][item % CYCP_DEMAND_COUNT].size;
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Write the formats of LAYOUT to FORMATS, with each table at its offset
+ * in OFFSETS.
+ */
+static void
+layout_formats_apply(const struct layout *layout, const uint32_t *offsets,
+    struct scrn_format *formats)
+{
+        (void)memcpy(formats, layout->formats, layout->format_count * sizeof(struct scrn_format));
+
+        uint32_t i;
+        for (i = 0; i < layout->format_count; i++) {
+                struct scrn_format *format;
+                format = &formats[i];
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                uint8_t scrn;
+                scrn = format->sf_scroll_screen;
+
+                const uint32_t *scrn_offsets;
+                scrn_offsets = &offsets[scrn * CYCP_DEMAND_COUNT];
+
+                const struct layout_table *tables;
+                tables = layout->tables[scrn];
+
+                if (format->sf_type == SCRN_TYPE_BITMAP) {
+                        format->sf_format.bitmap.sbf_bitmap_pattern =
+                            VRAM_ADDR_4MBIT(0, scrn_offsets[CYCP_DEMAND_CPD]);
+
+                        continue;
+                }
+
+                struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                /* The planes keep their distance from the first plane */
+                uint32_t plane;
+                for (plane = 0; plane < 4; plane++) {
+                        uint32_t offset;
+                        offset = VRAM_OFFSET(cell_format->scf_map.planes[plane]) -
+                            tables[CYCP_DEMAND_PND].offset;
+
+                        cell_format->scf_map.planes[plane] =
+                            VRAM_ADDR_4MBIT(0, scrn_offsets[CYCP_DEMAND_PND] + offset);
+                }
+
+                cell_format->scf_cp_table = VRAM_ADDR_4MBIT(0, scrn_offsets[CYCP_DEMAND_CPD]);
+
+                if (tables[CYCP_DEMAND_VCS].size > 0) {
+                        format->sf_vcs_table = VRAM_ADDR_4MBIT(0, scrn_offsets[CYCP_DEMAND_VCS]);
+                }
+        }
+}
+
+/*-
+ * Parse the banks TEXT, such as "A0+B1", into the bank bit-map BITMAP.
+ *
+ * If successful, 0 is returned. Otherwise, -1 is returned.
+ */
+static int32_t
+layout_banks_parse(const char *text, uint8_t *bitmap)
+{
+        static const char *bank_names[VRAM_BANK_COUNT] = {
+                "A0",
+                "A1",
+                "B0",
+                "B1"
+        };
+
+        *bitmap = 0x00;
+
+        while (true) {
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        if ((strncmp(text, bank_names[bank], 2)) == 0) {
+                                break;
+                        }
+                }
+
+                if (bank == VRAM_BANK_COUNT) {
+                        return -1;
+                }
+
+                *bitmap |= VRAM_BANK_BIT(bank);
+
+                text += 2;
+
+                if (*text == '\0') {
+                        return 0;
+                }
+
+                if (*text++ != '+') {
+                        return -1;
+                }
+        }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+#include "csv.h"
+
+/* Default size of the character pattern table of a cell format, in
+ * cells */
+#define LAYOUT_CPD_CELL_COUNT   CYCP_CP_TABLE_CELL_COUNT
+
+/* Default size of a vertical cell scroll table, in bytes */
+#define LAYOUT_VCS_SIZE         0x0200
+
+/*-
+ * Constraints on the tables of each NBG, read from a file of lines of the
+ * form:
+ *
+ *   NBG0,CPD,0x8000,A0+B0
+ *
+ * That is, the scroll screen, the table (PND, CPD, or VCS), its size in
+ * bytes, and the banks it may be placed in. An empty size is the default
+ * size of the table, and empty banks are any bank. Blank lines, and lines
+ * starting with '#', are ignored.
+ */
+struct layout_constraints {
+        /* Size of each table, per CYCP_DEMAND_* kind, or zero for its
+         * default size */
+        uint32_t sizes[4][CYCP_DEMAND_COUNT];
+        /* Bank bit-map of the banks each table may be placed in */
+        uint8_t bank_bitmaps[4][CYCP_DEMAND_COUNT];
+};
+
+/*-
+ * VRAM layout of the tables of the NBGs of a scene, as chosen by
+ * layout_solve().
+ */
+struct layout {
+        struct scrn_format formats[SCRN_COUNT];
+        uint32_t format_count;
+
+        uint16_t tvmd;
+        uint16_t vrsize;
+
+        struct layout_table {
+                uint32_t size;          /* Zero if the table is not used */
+                uint32_t alignment;
+                uint8_t bank_bitmap;    /* Banks it may be placed in */
+                uint8_t count;          /* Number of access timings required */
+
+                /* Offset of the table from the start of VRAM */
+                uint32_t offset;
+        } tables[4][CYCP_DEMAND_COUNT];
+
+        /* VRAM partitioning and cycle patterns of the layout */
+        uint16_t ramctl;
+        union vram_cycp vram_cycp;
+
+        /* Number of access timings open to the CPU, and size of the
+         * largest contiguous free region of VRAM, in bytes */
+        uint32_t free_count;
+        uint32_t free_size;
+
+        /* Number of layouts solved */
+        uint32_t solve_count;
+};
+
+void layout_constraints_init(struct layout_constraints *);
+int32_t layout_constraints_load(struct layout_constraints *, const char *, uint32_t *);
+
+int32_t layout_init(struct layout *, const struct csv_scene *, const struct layout_constraints *,
+    uint16_t, uint16_t);
+int32_t layout_solve(struct layout *);
+
+#endif /* !LAYOUT_H_ */
@@ -0,0 +1,1436 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vdp2cycp.h"
+#include "atlas.h"
+#include "cycpdb.h"
+#include "csv.h"
+#include "packed.h"
+#include "bench.h"
+#include "fuzz.h"
+#include "server.h"
+#include "layout.h"
+#include "schedule.h"
+
+#include "debug.h"
+#include "trace.h"
+
+#define MAIN_TRACE_MAGIC        "VCPT"
+#define MAIN_TRACE_VERSION      1
+
+/*-
+ * Header of a file of the events recorded by -t, followed by the events
+ * from the oldest to the newest.
+ */
+struct main_trace_header {
+        char magic[4];
+        uint16_t version;
+        uint16_t event_size;
+        uint32_t event_count;
+};
+
+static void usage(const char *);
+static int main_atlas_build(const char *, uint32_t);
+static int main_atlas_lookup(const char *, const struct csv *, uint16_t, uint16_t);
+static int main_scenes_solve(const struct csv *, uint16_t, uint16_t, bool, bool, bool, bool);
+static int main_layouts_solve(const struct csv *, const char *, uint16_t, uint16_t);
+static int main_schedule_solve(const struct csv *, const char *, uint16_t, uint16_t);
+static int main_delta_solve(const struct csv *, uint16_t, uint16_t);
+static int main_blocks_write(const char *, const struct csv *, uint16_t, uint16_t);
+static int main_serve(const char *, uint16_t, uint16_t);
+static int32_t main_tvmd_parse(const char *, uint16_t *);
+static int32_t main_vrsize_parse(const char *, uint16_t *);
+static void main_scene_state_init(const struct csv *, size_t, uint16_t, struct state *);
+static int main_corpus_solve(const struct packed_corpus *);
+static int main_corpus_write(const char *, const struct csv *);
+static int32_t main_corpus_csv_get(const struct packed_corpus *, struct csv *);
+static void main_vram_cycp_print(const union vram_cycp *);
+static void main_sim_print(const struct cycp_sim *);
+static void main_layout_print(const struct layout *);
+static void main_writes_print(const struct cycp_write *, size_t, const char *);
+static int main_cycpdb_generate(const char *, uint32_t);
+static void main_trace_start(void);
+static int main_trace_write(const char *);
+static int main_trace_decode(const char *);
+
+int
+main(int argc, char *argv[])
+{
+        DEBUG_PRINTF("sizeof(union vram_cycp): %lu bytes(s)\n", sizeof(union vram_cycp));
+        DEBUG_PRINTF("sizeof(struct scrn_format): %lu byte(s)\n", sizeof(struct scrn_format));
+        DEBUG_PRINTF("sizeof(struct scrn_cell_format): %lu byte(s)\n", sizeof(struct scrn_cell_format));
+        DEBUG_PRINTF("sizeof(struct scrn_bitmap_format): %lu byte(s)\n", sizeof(struct scrn_bitmap_format));
+        DEBUG_PRINTF("sizeof(struct state): %lu byte(s)\n", sizeof(struct state));
+
+        const char *atlas_build_path;
+        atlas_build_path = NULL;
+        const char *atlas_lookup_path;
+        atlas_lookup_path = NULL;
+        const char *cycpdb_path;
+        cycpdb_path = NULL;
+        const char *corpus_path;
+        corpus_path = NULL;
+        const char *trace_path;
+        trace_path = NULL;
+        const char *trace_decode_path;
+        trace_decode_path = NULL;
+        const char *constraints_path;
+        constraints_path = NULL;
+        const char *lines;
+        lines = NULL;
+        const char *blocks_path;
+        blocks_path = NULL;
+        const char *socket_path;
+        socket_path = NULL;
+        uint32_t bench_count;
+        bench_count = 0;
+        uint64_t bench_seed;
+        bench_seed = 1;
+        uint32_t fuzz_count;
+        fuzz_count = 0;
+        bool stats;
+        stats = false;
+        bool explain;
+        explain = false;
+        bool optimize;
+        optimize = false;
+        bool simulate;
+        simulate = false;
+        bool delta;
+        delta = false;
+        bool serve;
+        serve = false;
+        uint16_t tvmd;
+        tvmd = TVMD_HRESO_NORMAL_320;
+        uint16_t vrsize;
+        vrsize = 0x0000;
+
+        uint32_t thread_count;
+        thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+        int opt;
+        while ((opt = getopt(argc, argv, "a:l:g:p:b:z:s:vecfo:k:wx:iu:m:r:t:d:j:h")) != -1) {
+                switch (opt) {
+                case 'a':
+                        atlas_build_path = optarg;
+                        break;
+                case 'l':
+                        atlas_lookup_path = optarg;
+                        break;
+                case 'g':
+                        cycpdb_path = optarg;
+                        break;
+                case 'p':
+                        corpus_path = optarg;
+                        break;
+                case 'b':
+                        bench_count = strtoul(optarg, NULL, 0);
+                        break;
+                case 'z':
+                        fuzz_count = strtoul(optarg, NULL, 0);
+                        break;
+                case 's':
+                        bench_seed = strtoull(optarg, NULL, 0);
+                        break;
+                case 'v':
+                        stats = true;
+                        break;
+                case 'e':
+                        explain = true;
+                        break;
+                case 'c':
+                        optimize = true;
+                        break;
+                case 'f':
+                        simulate = true;
+                        break;
+                case 'o':
+                        constraints_path = optarg;
+                        break;
+                case 'k':
+                        lines = optarg;
+                        break;
+                case 'w':
+                        delta = true;
+                        break;
+                case 'x':
+                        blocks_path = optarg;
+                        break;
+                case 'i':
+                        serve = true;
+                        break;
+                case 'u':
+                        serve = true;
+                        socket_path = optarg;
+                        break;
+                case 'm':
+                        if ((main_tvmd_parse(optarg, &tvmd)) < 0) {
+                                (void)fprintf(stderr, "error: Invalid TV screen mode %s\n", optarg);
+                                return 2;
+                        }
+                        break;
+                case 'r':
+                        if ((main_vrsize_parse(optarg, &vrsize)) < 0) {
+                                (void)fprintf(stderr, "error: Invalid VRAM size %s\n", optarg);
+                                return 2;
+                        }
+                        break;
+                case 't':
+#ifdef TRACE
+                        trace_path = optarg;
+#else
+                        (void)fprintf(stderr, "error: Tracepoints are not compiled in "
+                            "(build with TRACE=1)\n");
+                        return 2;
+#endif /* TRACE */
+                        break;
+                case 'd':
+                        trace_decode_path = optarg;
+                        break;
+                case 'j':
+                        thread_count = strtoul(optarg, NULL, 0);
+                        break;
+                case 'h':
+                default:
+                        usage(argv[0]);
+                        return (opt == 'h') ? 0 : 2;
+                }
+        }
+
+        if (trace_decode_path != NULL) {
+                return main_trace_decode(trace_decode_path);
+        }
+
+        if (atlas_build_path != NULL) {
+                return main_atlas_build(atlas_build_path, thread_count);
+        }
+
+        if (cycpdb_path != NULL) {
+                return main_cycpdb_generate(cycpdb_path, thread_count);
+        }
+
+        if (bench_count > 0) {
+                if ((bench_run(bench_seed, bench_count, thread_count)) < 0) {
+                        (void)fprintf(stderr, "error: Unable to run benchmark\n");
+                        return 1;
+                }
+
+                return 0;
+        }
+
+        if (fuzz_count > 0) {
+                int32_t ret;
+                ret = fuzz_run(bench_seed, fuzz_count, thread_count);
+
+                if (ret == -3) {
+                        (void)fprintf(stderr, "error: The solver and the reference disagree\n");
+                        return 1;
+                }
+
+                if (ret < 0) {
+                        (void)fprintf(stderr, "error: Unable to run fuzzer\n");
+                        return 1;
+                }
+
+                return 0;
+        }
+
+        if (serve) {
+                return main_serve(socket_path, tvmd, vrsize);
+        }
+
+        const char *csv_path;
+        csv_path = (optind < argc) ? argv[optind] : "bg.csv";
+
+        struct csv csv;
+
+        /* The file is either a corpus of packed formats, or a CSV file */
+        struct packed_corpus corpus;
+
+        int32_t ret;
+        ret = packed_corpus_open(&corpus, csv_path);
+
+        /* The bank bit-maps of a corpus are those of 4-Mbit VRAM */
+        if ((vrsize != 0x0000) && ((ret == 0) || (corpus_path != NULL))) {
+                if (ret == 0) {
+                        packed_corpus_close(&corpus);
+                }
+
+                (void)fprintf(stderr, "error: A corpus can only hold scenes of 4-Mbit VRAM\n");
+                return 2;
+        }
+
+        /* The access timings packed in a corpus are those of the normal
+         * TV screen modes, so scenes of other modes are unpacked, and
+         * solved as those of a CSV file */
+        if ((ret == 0) && (atlas_lookup_path == NULL) && (corpus_path == NULL) &&
+            !TVMD_TIMINGS_HALVED(tvmd)) {
+                int exit_code;
+                exit_code = main_corpus_solve(&corpus);
+
+                packed_corpus_close(&corpus);
+
+                return exit_code;
+        }
+
+        if (ret == -4) {
+                (void)fprintf(stderr, "error: %s is not a valid corpus\n", csv_path);
+                return 1;
+        }
+
+        if (ret == 0) {
+                ret = main_corpus_csv_get(&corpus, &csv);
+
+                packed_corpus_close(&corpus);
+
+                if (ret < 0) {
+                        (void)fprintf(stderr, "error: Unable to load %s\n", csv_path);
+                        return 1;
+                }
+        } else if ((ret = csv_load(&csv, csv_path, vrsize, thread_count)) < 0) {
+                if (ret == -4) {
+                        (void)fprintf(stderr, "%s:%u: error: %s\n", csv_path,
+                            csv.error_line, csv.error);
+                } else {
+                        (void)fprintf(stderr, "error: Unable to load %s\n", csv_path);
+                }
+
+                return 1;
+        }
+
+        int exit_code;
+
+        if (atlas_lookup_path != NULL) {
+                exit_code = main_atlas_lookup(atlas_lookup_path, &csv, tvmd, vrsize);
+        } else if (corpus_path != NULL) {
+                exit_code = main_corpus_write(corpus_path, &csv);
+        } else if (constraints_path != NULL) {
+                exit_code = main_layouts_solve(&csv, constraints_path, tvmd, vrsize);
+        } else if (lines != NULL) {
+                exit_code = main_schedule_solve(&csv, lines, tvmd, vrsize);
+        } else if (delta) {
+                exit_code = main_delta_solve(&csv, tvmd, vrsize);
+        } else if (blocks_path != NULL) {
+                exit_code = main_blocks_write(blocks_path, &csv, tvmd, vrsize);
+        } else {
+                if (trace_path != NULL) {
+                        main_trace_start();
+                }
+
+                exit_code = main_scenes_solve(&csv, tvmd, vrsize, stats, explain,
+                    optimize, simulate);
+
+                if ((trace_path != NULL) && ((main_trace_write(trace_path)) != 0)) {
+                        exit_code = 1;
+                }
+        }
+
+        csv_unload(&csv);
+
+        return exit_code;
+}
+
+/*-
+ * Solve every scene of the CSV file CSV in the TV screen mode TVMD, with
+ * the VRAM size VRSIZE, and print the cycle patterns. If STATS is true,
+ * the solution database is not looked up, and the
+ * statistics of vdp2cycp_stats() are printed after each scene. If
+ * EXPLAIN is true, the conflict of each scene that can't be solved is
+ * explained. If OPTIMIZE is true, the cycle patterns leave the most
+ * access timings open to the CPU, and RAMCTL is printed if its VRAM
+ * partitioning changes. If SIMULATE is true, the VRAM reads of the cycle
+ * patterns over a frame, as approximated by vdp2cycp_simulate(), are
+ * printed.
+ */
+static int
+main_scenes_solve(const struct csv *csv, uint16_t tvmd, uint16_t vrsize, bool stats,
+    bool explain, bool optimize, bool simulate)
+{
+        /* Every bank is weighted the same */
+        const struct cycp_objective objective = {
+                .weights = {
+                        1,
+                        1,
+                        1,
+                        1
+                },
+                .partition = true
+        };
+
+        /* Look up the solution database, if one is linked in */
+        struct cycpdb cycpdb;
+
+        (void)cycpdb_builtin_init(&cycpdb);
+
+        int exit_code;
+        exit_code = 0;
+
+        size_t scene;
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                struct state state;
+
+                main_scene_state_init(csv, scene, vrsize, &state);
+
+                state.tvmd = tvmd;
+
+                struct cycp_stats scene_stats;
+
+                uint16_t ramctl;
+                ramctl = state.ramctl;
+
+                int32_t error;
+
+                if (optimize) {
+                        error = vdp2cycp_optimize(&state, &objective);
+                } else if (stats) {
+                        error = vdp2cycp_stats(&state, &scene_stats);
+                } else {
+                        error = cycpdb_vdp2cycp(&cycpdb, &state);
+                }
+                DEBUG_PRINTF("vdp2cycp: %i\n", error);
+
+                if (stats && !optimize) {
+                        (void)printf("stats: nodes %llu, prunes range %llu bank %llu "
+                            "pnd-bank %llu vcs-bank %llu, "
+                            "ns validate %llu timings %llu search %llu, "
+                            "slots A0 %u A1 %u B0 %u B1 %u\n",
+                            (unsigned long long)scene_stats.node_count,
+                            (unsigned long long)scene_stats.prune_counts[CYCP_PRUNE_RANGE],
+                            (unsigned long long)scene_stats.prune_counts[CYCP_PRUNE_BANK],
+                            (unsigned long long)scene_stats.prune_counts[CYCP_PRUNE_PND_BANK],
+                            (unsigned long long)scene_stats.prune_counts[CYCP_PRUNE_VCS_BANK],
+                            (unsigned long long)scene_stats.phase_ns[CYCP_PHASE_VALIDATE],
+                            (unsigned long long)scene_stats.phase_ns[CYCP_PHASE_TIMINGS],
+                            (unsigned long long)scene_stats.phase_ns[CYCP_PHASE_SEARCH],
+                            scene_stats.slot_counts[VRAM_BANK_A0],
+                            scene_stats.slot_counts[VRAM_BANK_A1],
+                            scene_stats.slot_counts[VRAM_BANK_B0],
+                            scene_stats.slot_counts[VRAM_BANK_B1]);
+                }
+
+                if (error < 0) {
+                        (void)fprintf(stderr, "error: Unable to calculate cycle patterns (%i)\n",
+                            error);
+
+                        struct cycp_explain scene_explain;
+                        char text[512];
+
+                        if (explain &&
+                            ((vdp2cycp_explain(&state, &scene_explain)) == 0) &&
+                            ((vdp2cycp_explain_format(&state, &scene_explain, text,
+                                    sizeof(text))) == 0)) {
+                                (void)fprintf(stderr, "  %s\n", text);
+                        }
+
+                        exit_code = 1;
+                        continue;
+                }
+
+                if (state.ramctl != ramctl) {
+                        (void)printf("RAMCTL: 0x%04X\n", state.ramctl);
+                }
+
+                main_vram_cycp_print(&state.vram_cycp);
+
+                struct cycp_sim sim;
+
+                if (simulate &&
+                    ((vdp2cycp_simulate(&state, &state.vram_cycp, 1, &sim)) == 0)) {
+                        main_sim_print(&sim);
+                }
+        }
+
+        return exit_code;
+}
+
+/*-
+ * Choose the VRAM layout of the tables of every scene of the CSV file
+ * CSV, as constrained by the file CONSTRAINTS_PATH, or by none if it is
+ * "-", in the TV screen mode TVMD, with the VRAM size VRSIZE, and print
+ * the layout.
+ */
+static int
+main_layouts_solve(const struct csv *csv, const char *constraints_path, uint16_t tvmd,
+    uint16_t vrsize)
+{
+        struct layout_constraints constraints;
+
+        layout_constraints_init(&constraints);
+
+        if ((strcmp(constraints_path, "-")) != 0) {
+                uint32_t error_line;
+
+                int32_t ret;
+                ret = layout_constraints_load(&constraints, constraints_path, &error_line);
+
+                if (ret == -3) {
+                        (void)fprintf(stderr, "%s:%u: error: Invalid constraint\n",
+                            constraints_path, error_line);
+                        return 1;
+                }
+
+                if (ret < 0) {
+                        (void)fprintf(stderr, "error: Unable to load %s\n", constraints_path);
+                        return 1;
+                }
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        size_t scene;
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                if (csv->scene_count > 1) {
+                        (void)printf("Scene at line %u:\n", csv->scenes[scene].line);
+                }
+
+                struct layout layout;
+
+                int32_t ret;
+                ret = layout_init(&layout, &csv->scenes[scene], &constraints, tvmd, vrsize);
+
+                if (ret == -2) {
+                        (void)fprintf(stderr, "error: The layout of a scene with a rotational "
+                            "background can't be chosen\n");
+
+                        exit_code = 1;
+                        continue;
+                }
+
+                if ((ret < 0) || ((ret = layout_solve(&layout)) < 0)) {
+                        (void)fprintf(stderr, "error: Unable to choose layout (%i)\n", ret);
+
+                        exit_code = 1;
+                        continue;
+                }
+
+                main_layout_print(&layout);
+        }
+
+        return exit_code;
+}
+
+/*-
+ * Solve the scenes of the CSV file CSV as the segments of a single frame,
+ * starting at the scanlines of the comma separated list LINES, in the TV
+ * screen mode TVMD, with the VRAM size VRSIZE. The cycle patterns of each
+ * segment are printed, followed by the register writes that switch from
+ * one segment to the next.
+ */
+static int
+main_schedule_solve(const struct csv *csv, const char *lines, uint16_t tvmd, uint16_t vrsize)
+{
+        struct state *states;
+        states = malloc((csv->scene_count + 1) * sizeof(struct state));
+        struct cycp_segment *segments;
+        segments = malloc((csv->scene_count + 1) * sizeof(struct cycp_segment));
+        struct cycp_write *writes;
+        writes = malloc((csv->scene_count + 1) * sizeof(struct cycp_write));
+
+        if ((states == NULL) || (segments == NULL) || (writes == NULL)) {
+                (void)fprintf(stderr, "error: Unable to solve segments\n");
+
+                free(writes);
+                free(segments);
+                free(states);
+
+                return 1;
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        const char *text;
+        text = lines;
+
+        size_t count;
+        for (count = 0; (count < csv->scene_count) && (*text != '\0'); count++) {
+                char *end;
+
+                segments[count].line = strtoul(text, &end, 0);
+                segments[count].state = &states[count];
+
+                text = (*end == ',') ? (end + 1) : end;
+
+                const struct scrn_format *formats[SCRN_COUNT + 1];
+
+                csv_scene_formats_get(&csv->scenes[count], formats);
+
+                state_init(&states[count], formats);
+
+                if (vrsize != 0x0000) {
+                        state_vrsize_set(&states[count], vrsize);
+                }
+
+                states[count].tvmd = tvmd;
+                states[count].ramctl = 0x0000;
+        }
+
+        size_t write_count;
+
+        int32_t ret;
+
+        if ((count != csv->scene_count) || (*text != '\0')) {
+                (void)fprintf(stderr, "error: Expected the first scanline of each of the "
+                    "%zu scene(s)\n", csv->scene_count);
+
+                exit_code = 1;
+        } else if ((ret = cycp_schedule_solve(segments, count, writes, &write_count)) == -2) {
+                (void)fprintf(stderr, "error: The scanlines of the segments must increase\n");
+
+                exit_code = 1;
+        } else {
+                size_t i;
+                for (i = 0; i < count; i++) {
+                        if (!states[i].solved) {
+                                break;
+                        }
+
+                        (void)printf("Segment at line %u:\n", segments[i].line);
+
+                        main_vram_cycp_print(&states[i].vram_cycp);
+                }
+
+                if (ret < 0) {
+                        (void)fprintf(stderr, "error: Unable to calculate cycle patterns of "
+                            "the segment at line %u (%i)\n", segments[i].line,
+                            segments[i].result);
+
+                        exit_code = 1;
+                } else {
+                        main_writes_print(writes, write_count, "line");
+                }
+        }
+
+        free(writes);
+        free(segments);
+        free(states);
+
+        return exit_code;
+}
+
+/*-
+ * Solve the scenes of the CSV file CSV in order, in the TV screen mode
+ * TVMD, with the VRAM size VRSIZE, such that as few registers as
+ * possible change from one scene to the next. The cycle patterns of each
+ * scene are printed, followed by the register writes that switch from
+ * one scene to the next.
+ */
+static int
+main_delta_solve(const struct csv *csv, uint16_t tvmd, uint16_t vrsize)
+{
+        struct state *states;
+        states = malloc((csv->scene_count + 1) * sizeof(struct state));
+        struct cycp_write *writes;
+        writes = malloc(((csv->scene_count * CYCP_DELTA_WRITE_COUNT) + 1) *
+            sizeof(struct cycp_write));
+
+        if ((states == NULL) || (writes == NULL)) {
+                (void)fprintf(stderr, "error: Unable to solve scenes\n");
+
+                free(writes);
+                free(states);
+
+                return 1;
+        }
+
+        size_t scene;
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                const struct scrn_format *formats[SCRN_COUNT + 1];
+
+                csv_scene_formats_get(&csv->scenes[scene], formats);
+
+                state_init(&states[scene], formats);
+
+                if (vrsize != 0x0000) {
+                        state_vrsize_set(&states[scene], vrsize);
+                }
+
+                states[scene].tvmd = tvmd;
+                states[scene].ramctl = 0x0000;
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        size_t write_count;
+
+        int32_t ret;
+        ret = cycp_delta_solve(states, csv->scene_count, writes, &write_count);
+
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                if (!states[scene].solved) {
+                        break;
+                }
+
+                (void)printf("Scene at line %u:\n", csv->scenes[scene].line);
+
+                main_vram_cycp_print(&states[scene].vram_cycp);
+        }
+
+        if (ret < 0) {
+                (void)fprintf(stderr, "error: Unable to calculate cycle patterns of the "
+                    "scene at line %u\n", csv->scenes[scene].line);
+
+                exit_code = 1;
+        } else {
+                main_writes_print(writes, write_count, "scene");
+        }
+
+        free(writes);
+        free(states);
+
+        return exit_code;
+}
+
+/*-
+ * Solve every scene of the CSV file CSV in the TV screen mode TVMD, with
+ * the VRAM size VRSIZE, and write the block of registers RAMCTL through
+ * CYCB1U of each scene, big-endian, one after the other to the file
+ * PATH.
+ */
+static int
+main_blocks_write(const char *path, const struct csv *csv, uint16_t tvmd, uint16_t vrsize)
+{
+        struct state *states;
+        states = malloc((csv->scene_count + 1) * sizeof(struct state));
+        uint8_t *blocks;
+        blocks = malloc((csv->scene_count + 1) * VDP2_REG_CYCP_SIZE);
+        int32_t *results;
+        results = malloc((csv->scene_count + 1) * sizeof(int32_t));
+
+        if ((states == NULL) || (blocks == NULL) || (results == NULL)) {
+                (void)fprintf(stderr, "error: Unable to solve scenes\n");
+
+                free(results);
+                free(blocks);
+                free(states);
+
+                return 1;
+        }
+
+        size_t scene;
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                const struct scrn_format *formats[SCRN_COUNT + 1];
+
+                csv_scene_formats_get(&csv->scenes[scene], formats);
+
+                state_init(&states[scene], formats);
+
+                if (vrsize != 0x0000) {
+                        state_vrsize_set(&states[scene], vrsize);
+                }
+
+                states[scene].tvmd = tvmd;
+                states[scene].ramctl = 0x0000;
+        }
+
+        (void)vdp2cycp_registers_bulk(states, csv->scene_count, blocks, results);
+
+        int exit_code;
+        exit_code = 0;
+
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                if (results[scene] < 0) {
+                        (void)fprintf(stderr, "error: Unable to calculate cycle patterns of "
+                            "the scene at line %u (%i)\n", csv->scenes[scene].line,
+                            results[scene]);
+
+                        exit_code = 1;
+                }
+        }
+
+        FILE *fp;
+
+        if (((fp = fopen(path, "wb")) == NULL) ||
+            ((fwrite(blocks, VDP2_REG_CYCP_SIZE, csv->scene_count, fp)) != csv->scene_count)) {
+                (void)fprintf(stderr, "error: Unable to write %s\n", path);
+
+                exit_code = 1;
+        }
+
+        if ((fp != NULL) && ((fclose(fp)) != 0)) {
+                (void)fprintf(stderr, "error: Unable to write %s\n", path);
+
+                exit_code = 1;
+        }
+
+        free(results);
+        free(blocks);
+        free(states);
+
+        return exit_code;
+}
+
+/*-
+ * Serve the scenes read from standard input, or from each connection to
+ * the Unix domain socket SOCKET_PATH, if not NULL, in the TV screen mode
+ * TVMD, with the VRAM size VRSIZE.
+ */
+static int
+main_serve(const char *socket_path, uint16_t tvmd, uint16_t vrsize)
+{
+        struct server server;
+
+        if ((server_init(&server, tvmd, vrsize)) < 0) {
+                (void)fprintf(stderr, "error: Unable to start server\n");
+                return 1;
+        }
+
+        int32_t ret;
+
+        if (socket_path != NULL) {
+                ret = server_listen(&server, socket_path);
+        } else {
+                ret = server_serve(&server, STDIN_FILENO, STDOUT_FILENO);
+        }
+
+        server_deinit(&server);
+
+        if (ret < 0) {
+                if (socket_path != NULL) {
+                        (void)fprintf(stderr, "error: Unable to serve %s (%i)\n",
+                            socket_path, ret);
+                } else {
+                        (void)fprintf(stderr, "error: Unable to serve standard input (%i)\n",
+                            ret);
+                }
+
+                return 1;
+        }
+
+        return 0;
+}
+
+/*-
+ * Solve every scene of the corpus CORPUS, and print the cycle patterns
+ * as main_scenes_solve() does.
+ */
+static int
+main_corpus_solve(const struct packed_corpus *corpus)
+{
+        union vram_cycp *vram_cycp;
+        vram_cycp = malloc((corpus->scene_count + 1) * sizeof(union vram_cycp));
+        uint16_t *ramctl;
+        ramctl = malloc((corpus->scene_count + 1) * sizeof(uint16_t));
+        int32_t *results;
+        results = malloc((corpus->scene_count + 1) * sizeof(int32_t));
+
+        if ((vram_cycp == NULL) ||
+            (ramctl == NULL) ||
+            (results == NULL) ||
+            ((packed_corpus_solve(corpus, vram_cycp, ramctl, results)) < 0)) {
+                (void)fprintf(stderr, "error: Unable to solve corpus\n");
+
+                free(results);
+                free(ramctl);
+                free(vram_cycp);
+
+                return 1;
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        uint32_t scene;
+        for (scene = 0; scene < corpus->scene_count; scene++) {
+                if (corpus->scene_count > 1) {
+                        (void)printf("Scene at line %u:\n", corpus->lines[scene]);
+                }
+
+                if (results[scene] < 0) {
+                        (void)fprintf(stderr, "error: Unable to calculate cycle patterns (%i)\n",
+                            results[scene]);
+
+                        exit_code = 1;
+                        continue;
+                }
+
+                /* As main_scene_state_init() starts every scene at a
+                 * RAMCTL of zero */
+                if (ramctl[scene] != 0x0000) {
+                        (void)printf("RAMCTL: 0x%04X\n", ramctl[scene]);
+                }
+
+                main_vram_cycp_print(&vram_cycp[scene]);
+        }
+
+        free(results);
+        free(ramctl);
+        free(vram_cycp);
+
+        return exit_code;
+}
+
+/*-
+ * Write the scenes of the CSV file CSV to PATH as a corpus of packed
+ * formats.
+ */
+static int
+main_corpus_write(const char *path, const struct csv *csv)
+{
+        int32_t ret;
+        ret = packed_corpus_write(path, csv->scenes, csv->scene_count);
+
+        if (ret < 0) {
+                (void)fprintf(stderr, "error: Unable to write corpus to %s (%i)\n", path, ret);
+                return 1;
+        }
+
+        (void)printf("Wrote %zu scene(s) to %s\n", csv->scene_count, path);
+
+        return 0;
+}
+
+/*-
+ * Unpack every scene of the corpus CORPUS into CSV, as if CSV were
+ * loaded by csv_load().
+ */
+static int32_t
+main_corpus_csv_get(const struct packed_corpus *corpus, struct csv *csv)
+{
+        memset(csv, 0x00, sizeof(*csv));
+
+        csv->scenes = malloc((corpus->scene_count + 1) * sizeof(struct csv_scene));
+
+        if (csv->scenes == NULL) {
+                return -3;
+        }
+
+        uint32_t scene;
+        for (scene = 0; scene < corpus->scene_count; scene++) {
+                (void)packed_corpus_scene_get(corpus, scene, &csv->scenes[scene]);
+        }
+
+        csv->scene_count = corpus->scene_count;
+
+        return 0;
+}
+
+static void
+main_vram_cycp_print(const union vram_cycp *vram_cycp)
+{
+        static const char *bank_names[] = {
+                "CYCA0",
+                "CYCA1",
+                "CYCB0",
+                "CYCB1"
+        };
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                DEBUG_CYCLE_PATTERN(vram_cycp->pv[bank]);
+
+                (void)printf("%s: 0x%08X\n", bank_names[bank], vram_cycp->pv[bank]);
+        }
+}
+
+/*-
+ * Print the VRAM reads SIM of each bank in use over a frame.
+ */
+static void
+main_sim_print(const struct cycp_sim *sim)
+{
+        static const char *bank_names[] = {
+                "A0",
+                "A1",
+                "B0",
+                "B1"
+        };
+
+        (void)printf("sim: %ux%u dots\n", sim->dot_count, sim->line_count);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                const struct cycp_sim_bank *sim_bank;
+                sim_bank = &sim->banks[bank];
+
+                if (sim_bank->timing_count == 0) {
+                        continue;
+                }
+
+                (void)printf("  %s: fetches %u, invalid %u, stalls %u, cpu %u, "
+                    "utilization %u.%u%%\n",
+                    bank_names[bank],
+                    sim_bank->fetch_count,
+                    sim_bank->invalid_count,
+                    sim_bank->stall_count,
+                    sim_bank->cpu_count,
+                    sim_bank->utilization / 10,
+                    sim_bank->utilization % 10);
+        }
+}
+
+/*-
+ * Print the address and the bank of each table of the layout LAYOUT,
+ * followed by its VRAM partitioning, and its cycle patterns.
+ */
+static void
+main_layout_print(const struct layout *layout)
+{
+        static const char *scrn_names[] = {
+                "NBG0",
+                "NBG1",
+                "NBG2",
+                "NBG3"
+        };
+
+        static const char *kind_names[CYCP_DEMAND_COUNT] = {
+                "VCS",
+                "PND",
+                "CPD"
+        };
+
+        static const char *bank_names[] = {
+                "A0",
+                "A1",
+                "B0",
+                "B1"
+        };
+
+        uint32_t bank_size;
+        bank_size = VRAM_SIZE(layout->vrsize) / VRAM_BANK_COUNT;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                uint32_t kind;
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        const struct layout_table *table;
+                        table = &layout->tables[scrn][kind];
+
+                        if (table->size == 0) {
+                                continue;
+                        }
+
+                        (void)printf("%s %s: 0x%08X-0x%08X (%s)\n",
+                            scrn_names[scrn],
+                            kind_names[kind],
+                            VRAM_ADDR_4MBIT(0, table->offset),
+                            VRAM_ADDR_4MBIT(0, table->offset + table->size - 1),
+                            bank_names[table->offset / bank_size]);
+                }
+        }
+
+        (void)printf("RAMCTL: 0x%04X\n", layout->ramctl);
+
+        main_vram_cycp_print(&layout->vram_cycp);
+
+        (void)printf("layout: free access timings %u, free VRAM 0x%05X bytes, "
+            "%u layouts solved\n",
+            layout->free_count,
+            layout->free_size,
+            layout->solve_count);
+}
+
+/*-
+ * Print the COUNT register writes WRITES, each at the LABEL of its line,
+ * followed by the number of registers written.
+ */
+static void
+main_writes_print(const struct cycp_write *writes, size_t count, const char *label)
+{
+        uint32_t register_count;
+        register_count = 0;
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+                const struct cycp_write *write;
+                write = &writes[i];
+
+                (void)printf("write: %s %u, 0x%08X:", label, write->line,
+                    VDP2_REG_BASE + write->reg);
+
+                uint32_t j;
+                for (j = 0; j < write->count; j++) {
+                        (void)printf(" 0x%04X", write->values[j]);
+                }
+
+                (void)printf("\n");
+
+                register_count += write->count;
+        }
+
+        (void)printf("writes: %zu write(s), %u register(s)\n", count, register_count);
+}
+
+/*-
+ * Initialize STATE with the scene SCENE of the CSV file CSV, with the
+ * VRAM size VRSIZE. When the CSV file holds more than one scene, the
+ * scene is announced first.
+ */
+static void
+main_scene_state_init(const struct csv *csv, size_t scene, uint16_t vrsize,
+    struct state *state)
+{
+        const struct scrn_format *formats[SCRN_COUNT + 1];
+
+        csv_scene_formats_get(&csv->scenes[scene], formats);
+
+        state_init(state, formats);
+
+        if (vrsize != 0x0000) {
+                state_vrsize_set(state, vrsize);
+        }
+
+        /* XXX: Place holder */
+        state->ramctl = 0x0000;
+
+        if (csv->scene_count > 1) {
+                (void)printf("Scene at line %u:\n", csv->scenes[scene].line);
+        }
+}
+
+/*-
+ * Parse the TV screen mode TEXT, either a name, or the value of TVMD,
+ * into TVMD.
+ *
+ * If successful, 0 is returned. Otherwise, -1 is returned.
+ */
+static int32_t
+main_tvmd_parse(const char *text, uint16_t *tvmd)
+{
+        static const struct {
+                const char *name;
+                uint16_t tvmd;
+        } modes[] = {
+                { "normal",             TVMD_HRESO_NORMAL_320 },
+                { "hires",              TVMD_HRESO_HIRES_640 },
+                { "exclusive",          TVMD_HRESO_EXCLUSIVE_320 },
+                { "exclusive-hires",    TVMD_HRESO_EXCLUSIVE_640 },
+                { "interlace",          TVMD_HRESO_NORMAL_320 | TVMD_LSMD_DOUBLE_INTERLACE },
+                { "hires-interlace",    TVMD_HRESO_HIRES_640 | TVMD_LSMD_DOUBLE_INTERLACE }
+        };
+
+        uint32_t i;
+        for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+                if ((strcmp(text, modes[i].name)) == 0) {
+                        *tvmd = modes[i].tvmd;
+
+                        return 0;
+                }
+        }
+
+        char *end;
+
+        unsigned long value;
+        value = strtoul(text, &end, 0);
+
+        if ((*text == '\0') || (*end != '\0') || (value > 0xFFFF)) {
+                return -1;
+        }
+
+        *tvmd = value;
+
+        return 0;
+}
+
+/*-
+ * Parse the VRAM size TEXT, in Mbit, into VRSIZE.
+ *
+ * If successful, 0 is returned. Otherwise, -1 is returned.
+ */
+static int32_t
+main_vrsize_parse(const char *text, uint16_t *vrsize)
+{
+        if ((strcmp(text, "4")) == 0) {
+                *vrsize = 0x0000;
+
+                return 0;
+        }
+
+        if ((strcmp(text, "8")) == 0) {
+                *vrsize = VRSIZE_VRAMSZ;
+
+                return 0;
+        }
+
+        return -1;
+}
+
+static void
+usage(const char *progname)
+{
+        (void)fprintf(stderr,
+            "usage: %s [-h] [-j threads] [-a atlas | -l atlas | -g database | -p corpus |\n"
+            "           -b count [-s seed] | -z count [-s seed] | -d trace | -i |\n"
+            "           -u socket] [-v] [-e] [-c] [-f] [-o layout] [-k lines] [-w]\n"
+            "          [-x blocks] [-m mode] [-r size] [-t trace] [file]\n"
+            "  -a atlas     Build the feasibility atlas and write it to ATLAS\n"
+            "  -l atlas     Look up the scenes of FILE (bg.csv) in ATLAS\n"
+            "  -g database  Generate the solution database and write it to DATABASE\n"
+            "  -p corpus    Pack the scenes of FILE and write them to CORPUS\n"
+            "  -b count     Benchmark the solver with COUNT generated scenes\n"
+            "  -z count     Check the solver against a brute-force reference with\n"
+            "               COUNT generated scenes\n"
+            "  -s seed      Seed of the scenes generated by -b or -z (1)\n"
+            "  -v           Print solver statistics of each scene of FILE\n"
+            "  -e           Explain why each scene of FILE that can't be solved\n"
+            "               conflicts\n"
+            "  -c           Leave the most access timings open to the CPU, changing\n"
+            "               the VRAM partitioning if needed\n"
+            "  -f           Count the VRAM reads of a cell of each scene of FILE,\n"
+            "               scaled to a frame, and print them per bank\n"
+            "  -o layout    Choose the VRAM layout of the tables of each scene of\n"
+            "               FILE, as constrained by the file LAYOUT (- for none)\n"
+            "  -k lines     Solve the scenes of FILE as the segments of a frame,\n"
+            "               starting at the comma separated scanlines LINES, and\n"
+            "               print the register writes between segments\n"
+            "  -w           Solve the scenes of FILE in order, changing as few\n"
+            "               registers as possible from one scene to the next, and\n"
+            "               print the register writes between scenes\n"
+            "  -x blocks    Write the registers RAMCTL through CYCB1U of each scene\n"
+            "               of FILE to BLOCKS, big-endian, one block after another\n"
+            "  -i           Read scenes from standard input, one after another, each\n"
+            "               ended by a blank line, and write their cycle patterns\n"
+            "               to standard output\n"
+            "  -u socket    Serve the scenes of each connection to the Unix domain\n"
+            "               socket SOCKET, as -i does\n"
+            "  -m mode      TV screen mode of the scenes of FILE: normal, hires,\n"
+            "               exclusive, exclusive-hires, interlace, hires-interlace,\n"
+            "               or the value of TVMD (normal)\n"
+            "  -r size      VRAM size of the scenes of FILE, in Mbit: 4 or 8 (4)\n"
+            "  -t trace     Record the last events of solving the scenes of FILE,\n"
+            "               and write them to TRACE (built with TRACE=1 only)\n"
+            "  -d trace     Decode the events written to TRACE by -t\n"
+            "  -j threads   Number of threads used to build the atlas, to load\n"
+            "               large CSV files, to measure throughput per core, and\n"
+            "               to fuzz\n"
+            "FILE is either a CSV file, or a corpus written by -p\n",
+            progname);
+}
+
+static int
+main_atlas_build(const char *path, uint32_t thread_count)
+{
+        struct atlas atlas;
+
+        if ((atlas_init(&atlas)) < 0) {
+                (void)fprintf(stderr, "error: Unable to initialize atlas\n");
+                return 1;
+        }
+
+        (void)printf("Building atlas of %u classes, %u entries using %u thread(s)\n",
+            atlas.class_count, atlas.entry_count, thread_count);
+
+        if ((atlas_build(&atlas, thread_count)) < 0) {
+                (void)fprintf(stderr, "error: Unable to build atlas\n");
+                atlas_deinit(&atlas);
+                return 1;
+        }
+
+        uint32_t error_counts[ATLAS_ERROR_COUNT];
+        memset(error_counts, 0x00, sizeof(error_counts));
+
+        uint32_t index;
+        for (index = 0; index < atlas.entry_count; index++) {
+                uint8_t entry;
+                entry = atlas.entries[index];
+
+                if (ATLAS_ENTRY_FEASIBLE(entry)) {
+                        error_counts[0]++;
+                } else {
+                        error_counts[-ATLAS_ENTRY_ERROR(entry)]++;
+                }
+        }
+
+        (void)printf("Feasible: %u\n", error_counts[0]);
+
+        uint32_t error;
+        for (error = 1; error < ATLAS_ERROR_COUNT; error++) {
+                if (error_counts[error] == 0) {
+                        continue;
+                }
+
+                (void)printf("Rejected with %i: %u\n", -(int32_t)error, error_counts[error]);
+        }
+
+        int32_t ret;
+        ret = atlas_write(&atlas, path);
+
+        atlas_deinit(&atlas);
+
+        if (ret < 0) {
+                (void)fprintf(stderr, "error: Unable to write atlas to %s\n", path);
+                return 1;
+        }
+
+        return 0;
+}
+
+static int
+main_atlas_lookup(const char *path, const struct csv *csv, uint16_t tvmd, uint16_t vrsize)
+{
+        struct atlas atlas;
+
+        if ((atlas_read(&atlas, path)) < 0) {
+                (void)fprintf(stderr, "error: Unable to read atlas from %s\n", path);
+                return 1;
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        size_t scene;
+        for (scene = 0; scene < csv->scene_count; scene++) {
+                struct state state;
+
+                main_scene_state_init(csv, scene, vrsize, &state);
+
+                state.tvmd = tvmd;
+
+                uint8_t entry;
+
+                if ((atlas_lookup(&atlas, &state, &entry)) < 0) {
+                        (void)fprintf(stderr, "error: Configuration is not covered by the atlas\n");
+
+                        exit_code = 1;
+                        continue;
+                }
+
+                if (ATLAS_ENTRY_FEASIBLE(entry)) {
+                        (void)printf("Feasible, %u free access timing(s)\n", ATLAS_ENTRY_FREE(entry));
+                        continue;
+                }
+
+                (void)printf("Rejected with %i\n", ATLAS_ENTRY_ERROR(entry));
+
+                exit_code = 1;
+        }
+
+        atlas_deinit(&atlas);
+
+        return exit_code;
+}
+
+static int
+main_cycpdb_generate(const char *path, uint32_t thread_count)
+{
+        (void)printf("Generating solution database using %u thread(s)\n", thread_count);
+
+        int32_t ret;
+        ret = atlas_cycpdb_generate(path, thread_count);
+
+        if (ret < 0) {
+                (void)fprintf(stderr, "error: Unable to generate solution database (%i)\n", ret);
+                return 1;
+        }
+
+        (void)printf("Wrote solution database to %s\n", path);
+
+        return 0;
+}
+
+/*-
+ * Record the events of the tracepoints in the ring buffer.
+ */
+static void
+main_trace_start(void)
+{
+        trace_ring_reset();
+
+#ifdef TRACE
+        trace_hook = trace_ring_record;
+#endif /* TRACE */
+}
+
+/*-
+ * Stop recording, and write the events of the ring buffer to the file
+ * PATH.
+ */
+static int
+main_trace_write(const char *path)
+{
+        /* Too large for the stack */
+        static struct trace_event events[TRACE_RING_SIZE];
+
+#ifdef TRACE
+        trace_hook = NULL;
+#endif /* TRACE */
+
+        struct main_trace_header header;
+
+        memset(&header, 0x00, sizeof(header));
+
+        (void)memcpy(header.magic, MAIN_TRACE_MAGIC, sizeof(header.magic));
+        header.version = MAIN_TRACE_VERSION;
+        header.event_size = sizeof(struct trace_event);
+        header.event_count = trace_ring_copy(events, TRACE_RING_SIZE);
+
+        FILE *fp;
+        fp = fopen(path, "wb");
+
+        bool written;
+        written = (fp != NULL) &&
+            ((fwrite(&header, sizeof(header), 1, fp)) == 1) &&
+            ((fwrite(events, sizeof(struct trace_event), header.event_count, fp)) == header.event_count);
+
+        if ((fp != NULL) && ((fclose(fp)) != 0)) {
+                written = false;
+        }
+
+        if (!written) {
+                (void)fprintf(stderr, "error: Unable to write trace to %s\n", path);
+                return 1;
+        }
+
+        return 0;
+}
+
+/*-
+ * Print the events written to the file PATH by -t, one per line, along
+ * with their sequence number.
+ */
+static int
+main_trace_decode(const char *path)
+{
+        FILE *fp;
+        fp = fopen(path, "rb");
+
+        if (fp == NULL) {
+                (void)fprintf(stderr, "error: Unable to read trace from %s\n", path);
+                return 1;
+        }
+
+        struct main_trace_header header;
+
+        if (((fread(&header, sizeof(header), 1, fp)) != 1) ||
+            ((memcmp(header.magic, MAIN_TRACE_MAGIC, sizeof(header.magic))) != 0) ||
+            (header.version != MAIN_TRACE_VERSION) ||
+            (header.event_size != sizeof(struct trace_event))) {
+                (void)fclose(fp);
+
+                (void)fprintf(stderr, "error: %s is not a valid trace\n", path);
+                return 1;
+        }
+
+        int exit_code;
+        exit_code = 0;
+
+        uint32_t i;
+        for (i = 0; i < header.event_count; i++) {
+                struct trace_event event;
+
+                if ((fread(&event, sizeof(event), 1, fp)) != 1) {
+                        (void)fprintf(stderr, "error: %s is truncated\n", path);
+
+                        exit_code = 1;
+                        break;
+                }
+
+                char text[TRACE_EVENT_TEXT_SIZE];
+
+                (void)trace_event_format(&event, text, sizeof(text));
+
+                (void)printf("%8u %s\n", event.sequence, text);
+        }
+
+        (void)fclose(fp);
+
+        return exit_code;
+}
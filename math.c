@@ -27,3 +27,40 @@ log2_pow2(uint32_t v)
 
         return r;
 }
+
+/*-
+ * Return the number of bits set in a 32-bit value V.
+ */
+uint32_t
+bit_count(uint32_t v)
+{
+        v = v - ((v >> 1) & 0x55555555);
+        v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+        v = (v + (v >> 4)) & 0x0F0F0F0F;
+
+        return (v * 0x01010101) >> 24;
+}
+
+/*-
+ * Return the binomial coefficient N choose K, for K no greater than 4.
+ */
+uint32_t
+binomial(uint32_t n, uint32_t k)
+{
+        uint64_t numerator;
+        numerator = 1;
+        uint64_t denominator;
+        denominator = 1;
+
+        uint32_t i;
+        for (i = 0; i < k; i++) {
+                if (n < i) {
+                        return 0;
+                }
+
+                numerator *= n - i;
+                denominator *= i + 1;
+        }
+
+        return numerator / denominator;
+}
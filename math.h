@@ -11,5 +11,7 @@
 #include <stdint.h>
 
 uint32_t log2_pow2(uint32_t);
+uint32_t bit_count(uint32_t);
+uint32_t binomial(uint32_t, uint32_t);
 
 #endif /* !MATH_H_ */
@@ -0,0 +1,793 @@
+#include <sys/cdefs.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "packed.h"
+#include "vdp2cycp.h"
+
+#include "debug.h"
+
+#define PACKED_CORPUS_MAGIC     "VCPS"
+#define PACKED_CORPUS_VERSION   1
+
+#define VRAM_BASE               0x05E00000
+#define VRAM_MASK               0x000FFFFF
+
+#define CRAM_BASE               0x05F00000
+#define CRAM_MASK               0x0007FFFF
+
+/*-
+ * The corpus is laid out as the header, followed by the line of each
+ * scene (32-bit), the index of the first format of each scene (32-bit),
+ * and, aligned to 8 bytes, the packed formats, all in host byte order.
+ */
+struct packed_corpus_header {
+        char magic[4];
+        uint16_t version;
+        uint16_t format_size;
+        uint32_t scene_count;
+        uint32_t format_count;
+};
+
+static bool packed_address_pack(uint32_t, uint32_t, uint32_t, int32_t *, uint32_t *);
+static size_t packed_corpus_formats_offset(uint32_t);
+
+/*-
+ * Pack the scroll screen format FORMAT into PACKED.
+ *
+ * A disabled scroll screen is packed as all zeroes. Otherwise, the lead
+ * addresses must be within VRAM (or CRAM, for the color palette), and
+ * share the same upper 4 bits. Only the first 4 planes are packed.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 FORMAT or PACKED is NULL
+ *   - -2 FORMAT can not be represented
+ */
+int32_t
+scrn_packed_pack(const struct scrn_format *format, struct scrn_packed_format *packed)
+{
+        if ((format == NULL) || (packed == NULL)) {
+                return -1;
+        }
+
+        memset(packed, 0x00, sizeof(*packed));
+
+        if (!format->sf_enable) {
+                return 0;
+        }
+
+        if ((format->sf_scroll_screen >= SCRN_COUNT) ||
+            (format->sf_type > SCRN_TYPE_BITMAP) ||
+            (format->sf_cc_count > SCRN_CCC_RGB_16770000) ||
+            (format->sf_reduction > 3)) {
+                return -2;
+        }
+
+        SCRN_PACKED_SET(packed, SCRN_PACKED_ENABLE, 1);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_SCROLL_SCREEN, format->sf_scroll_screen);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_TYPE, format->sf_type);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_CC_COUNT, format->sf_cc_count);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_REDUCTION, format->sf_reduction);
+
+        /* The region is not known until the first address is packed */
+        int32_t region;
+        region = -1;
+
+        uint32_t offset;
+
+        if (format->sf_vcs_table != 0x00000000) {
+                if (!packed_address_pack(format->sf_vcs_table, VRAM_BASE, VRAM_MASK,
+                        &region, &offset)) {
+                        return -2;
+                }
+
+                SCRN_PACKED_SET(packed, SCRN_PACKED_VCS, 1);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_VCS_TABLE, offset);
+        }
+
+        uint32_t color_palette;
+        uint32_t cp_table;
+        uint8_t rp_mode;
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                const struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                uint32_t plane_size;
+                plane_size = cell_format->scf_plane_size;
+
+                if (((cell_format->scf_character_size != (1 * 1)) &&
+                        (cell_format->scf_character_size != (2 * 2))) ||
+                    ((cell_format->scf_pnd_size != 1) && (cell_format->scf_pnd_size != 2)) ||
+                    (cell_format->scf_auxiliary_mode > 1) ||
+                    ((plane_size != (1 * 1)) && (plane_size != (2 * 1)) &&
+                        (plane_size != (2 * 2)))) {
+                        return -2;
+                }
+
+                SCRN_PACKED_SET(packed, SCRN_PACKED_CHARACTER_SIZE,
+                    cell_format->scf_character_size == (2 * 2));
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PND_SIZE, cell_format->scf_pnd_size == 2);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_AUXILIARY_MODE,
+                    cell_format->scf_auxiliary_mode);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PLANE_SIZE, plane_size >> 1);
+
+                /* The planes of RBG0 and RBG1 beyond the first 4 can't
+                 * be packed */
+                uint32_t i;
+                for (i = 4; i < 16; i++) {
+                        if (cell_format->scf_map.planes[i] != 0x00000000) {
+                                return -2;
+                        }
+                }
+
+                uint32_t plane_offsets[4];
+
+                for (i = 0; i < 4; i++) {
+                        if (!packed_address_pack(cell_format->scf_map.planes[i], VRAM_BASE,
+                                VRAM_MASK, &region, &plane_offsets[i])) {
+                                return -2;
+                        }
+                }
+
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PLANE_A, plane_offsets[0]);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PLANE_B, plane_offsets[1]);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PLANE_C, plane_offsets[2]);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_PLANE_D, plane_offsets[3]);
+
+                color_palette = cell_format->scf_color_palette;
+                cp_table = cell_format->scf_cp_table;
+                rp_mode = cell_format->scf_rp_mode;
+        } else {
+                const struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                uint16_t width;
+                width = bitmap_format->sbf_bitmap_size.width;
+                uint16_t height;
+                height = bitmap_format->sbf_bitmap_size.height;
+
+                if (((width != 512) && (width != 1024)) ||
+                    ((height != 256) && (height != 512))) {
+                        return -2;
+                }
+
+                SCRN_PACKED_SET(packed, SCRN_PACKED_BITMAP_WIDTH, width == 1024);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_BITMAP_HEIGHT, height == 512);
+
+                color_palette = bitmap_format->sbf_color_palette;
+                cp_table = bitmap_format->sbf_bitmap_pattern;
+                rp_mode = bitmap_format->sbf_rp_mode;
+        }
+
+        if (rp_mode > 3) {
+                return -2;
+        }
+
+        SCRN_PACKED_SET(packed, SCRN_PACKED_RP_MODE, rp_mode);
+
+        if (format->sf_coefficient_table != 0x00000000) {
+                bool vram;
+                vram = VRAM_BANK_ADDRESS(format->sf_coefficient_table);
+
+                if (!packed_address_pack(format->sf_coefficient_table,
+                        vram ? VRAM_BASE : CRAM_BASE, vram ? VRAM_MASK : CRAM_MASK,
+                        &region, &offset)) {
+                        return -2;
+                }
+
+                SCRN_PACKED_SET(packed, SCRN_PACKED_COEFFICIENT, vram ? 1 : 2);
+                SCRN_PACKED_SET(packed, SCRN_PACKED_COEFFICIENT_TABLE, offset);
+        }
+
+        if (!packed_address_pack(cp_table, VRAM_BASE, VRAM_MASK, &region, &offset)) {
+                return -2;
+        }
+
+        SCRN_PACKED_SET(packed, SCRN_PACKED_CP_TABLE, offset);
+
+        if (!packed_address_pack(color_palette, CRAM_BASE, CRAM_MASK, &region, &offset)) {
+                return -2;
+        }
+
+        SCRN_PACKED_SET(packed, SCRN_PACKED_COLOR_PALETTE, offset);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_REGION, region);
+
+        /* Derive what the solver needs from the format */
+        uint8_t tvcs;
+        uint8_t tpnd;
+        uint8_t tcpd;
+
+        int32_t ret;
+        ret = cycp_calculate_timings(format, &tvcs, &tpnd, &tcpd);
+
+        if (ret < 0) {
+                SCRN_PACKED_SET(packed, SCRN_PACKED_ERROR, -ret);
+
+                return 0;
+        }
+
+        const struct scrn_format *formats[2];
+        formats[0] = format;
+        formats[1] = NULL;
+
+        struct state state;
+
+        state_init(&state, formats);
+
+        const struct scroll_screen *scroll_screen;
+        scroll_screen = state.scroll_screens[format->sf_scroll_screen];
+
+        SCRN_PACKED_SET(packed, SCRN_PACKED_TVCS, tvcs);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_TPND, tpnd);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_TCPD, tcpd);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_VCS_BITMAP, scroll_screen->vcs_bitmap);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_PND_BITMAP, scroll_screen->pnd_bitmap);
+        SCRN_PACKED_SET(packed, SCRN_PACKED_CPD_BITMAP, scroll_screen->cpd_bitmap);
+
+        return 0;
+}
+
+/*-
+ * Unpack the packed scroll screen format PACKED into FORMAT.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 PACKED or FORMAT is NULL
+ */
+int32_t
+scrn_packed_unpack(const struct scrn_packed_format *packed, struct scrn_format *format)
+{
+        if ((packed == NULL) || (format == NULL)) {
+                return -1;
+        }
+
+        memset(format, 0x00, sizeof(*format));
+
+        if (!SCRN_PACKED_GET(packed, SCRN_PACKED_ENABLE)) {
+                return 0;
+        }
+
+        uint32_t region;
+        region = SCRN_PACKED_GET(packed, SCRN_PACKED_REGION) << 28;
+
+        format->sf_enable = true;
+        format->sf_scroll_screen = SCRN_PACKED_GET(packed, SCRN_PACKED_SCROLL_SCREEN);
+        format->sf_type = SCRN_PACKED_GET(packed, SCRN_PACKED_TYPE);
+        format->sf_cc_count = SCRN_PACKED_GET(packed, SCRN_PACKED_CC_COUNT);
+        format->sf_reduction = SCRN_PACKED_GET(packed, SCRN_PACKED_REDUCTION);
+
+        if (SCRN_PACKED_GET(packed, SCRN_PACKED_VCS)) {
+                format->sf_vcs_table = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_VCS_TABLE);
+        }
+
+        switch (SCRN_PACKED_GET(packed, SCRN_PACKED_COEFFICIENT)) {
+        case 1:
+                format->sf_coefficient_table = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_COEFFICIENT_TABLE);
+                break;
+        case 2:
+                format->sf_coefficient_table = region | CRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_COEFFICIENT_TABLE);
+                break;
+        }
+
+        uint32_t color_palette;
+        color_palette = region | CRAM_BASE | SCRN_PACKED_GET(packed, SCRN_PACKED_COLOR_PALETTE);
+        uint32_t cp_table;
+        cp_table = region | VRAM_BASE | SCRN_PACKED_GET(packed, SCRN_PACKED_CP_TABLE);
+
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                cell_format->scf_character_size =
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_CHARACTER_SIZE) ? (2 * 2) : (1 * 1);
+                cell_format->scf_pnd_size = SCRN_PACKED_GET(packed, SCRN_PACKED_PND_SIZE) + 1;
+                cell_format->scf_auxiliary_mode = SCRN_PACKED_GET(packed, SCRN_PACKED_AUXILIARY_MODE);
+                cell_format->scf_cp_table = cp_table;
+                cell_format->scf_color_palette = color_palette;
+                cell_format->scf_plane_size =
+                    1 << SCRN_PACKED_GET(packed, SCRN_PACKED_PLANE_SIZE);
+                cell_format->scf_rp_mode = SCRN_PACKED_GET(packed, SCRN_PACKED_RP_MODE);
+
+                cell_format->scf_map.plane_a = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_PLANE_A);
+                cell_format->scf_map.plane_b = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_PLANE_B);
+                cell_format->scf_map.plane_c = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_PLANE_C);
+                cell_format->scf_map.plane_d = region | VRAM_BASE |
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_PLANE_D);
+        } else {
+                struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                bitmap_format->sbf_bitmap_size.width =
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_BITMAP_WIDTH) ? 1024 : 512;
+                bitmap_format->sbf_bitmap_size.height =
+                    SCRN_PACKED_GET(packed, SCRN_PACKED_BITMAP_HEIGHT) ? 512 : 256;
+                bitmap_format->sbf_color_palette = color_palette;
+                bitmap_format->sbf_bitmap_pattern = cp_table;
+                bitmap_format->sbf_rp_mode = SCRN_PACKED_GET(packed, SCRN_PACKED_RP_MODE);
+        }
+
+        return 0;
+}
+
+/*-
+ * Pack the SCENE_COUNT scenes SCENES, and write them to the file PATH as
+ * a corpus.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 PATH or SCENES is NULL
+ *   - -2 A scroll screen format can not be packed
+ *   - -3 Memory could not be allocated
+ *   - -4 File could not be written
+ */
+int32_t
+packed_corpus_write(const char *path, const struct csv_scene *scenes, size_t scene_count)
+{
+        if ((path == NULL) || ((scenes == NULL) && (scene_count > 0))) {
+                return -1;
+        }
+
+        if (scene_count >= UINT32_MAX) {
+                return -2;
+        }
+
+        int32_t ret;
+        ret = 0;
+
+        uint32_t *lines;
+        lines = malloc((scene_count + 1) * sizeof(uint32_t));
+        uint32_t *starts;
+        starts = malloc((scene_count + 1) * sizeof(uint32_t));
+        struct scrn_packed_format *formats;
+        formats = malloc(((scene_count * SCRN_COUNT) + 1) * sizeof(struct scrn_packed_format));
+
+        if ((lines == NULL) || (starts == NULL) || (formats == NULL)) {
+                ret = -3;
+                goto exit;
+        }
+
+        uint32_t format_count;
+        format_count = 0;
+
+        size_t scene;
+        for (scene = 0; scene < scene_count; scene++) {
+                lines[scene] = scenes[scene].line;
+                starts[scene] = format_count;
+
+                if (scenes[scene].format_count > SCRN_COUNT) {
+                        ret = -2;
+                        goto exit;
+                }
+
+                uint32_t i;
+                for (i = 0; i < scenes[scene].format_count; i++) {
+                        if ((scrn_packed_pack(&scenes[scene].formats[i],
+                                    &formats[format_count])) < 0) {
+                                ret = -2;
+                                goto exit;
+                        }
+
+                        format_count++;
+                }
+        }
+
+        starts[scene_count] = format_count;
+
+        FILE *fp;
+        fp = fopen(path, "wb");
+
+        if (fp == NULL) {
+                ret = -4;
+                goto exit;
+        }
+
+        struct packed_corpus_header header;
+
+        memset(&header, 0x00, sizeof(header));
+
+        (void)memcpy(header.magic, PACKED_CORPUS_MAGIC, sizeof(header.magic));
+        header.version = PACKED_CORPUS_VERSION;
+        header.format_size = sizeof(struct scrn_packed_format);
+        header.scene_count = scene_count;
+        header.format_count = format_count;
+
+        static const uint8_t padding[8];
+
+        size_t padding_size;
+        padding_size = packed_corpus_formats_offset(scene_count) -
+            (sizeof(header) + ((2 * scene_count) + 1) * sizeof(uint32_t));
+
+        bool written;
+        written = ((fwrite(&header, sizeof(header), 1, fp)) == 1) &&
+            ((fwrite(lines, sizeof(uint32_t), scene_count, fp)) == scene_count) &&
+            ((fwrite(starts, sizeof(uint32_t), scene_count + 1, fp)) == (scene_count + 1)) &&
+            ((fwrite(padding, 1, padding_size, fp)) == padding_size) &&
+            ((fwrite(formats, sizeof(struct scrn_packed_format), format_count, fp)) == format_count);
+
+        if ((fclose(fp)) != 0) {
+                written = false;
+        }
+
+        if (!written) {
+                ret = -4;
+        }
+
+exit:
+        free(formats);
+        free(starts);
+        free(lines);
+
+        return ret;
+}
+
+/*-
+ * Open the corpus file PATH, written by packed_corpus_write(), into
+ * CORPUS. The file is mapped into memory, and the packed formats are
+ * referenced in place.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CORPUS or PATH is NULL
+ *   - -2 File could not be read
+ *   - -3 File is not a corpus
+ *   - -4 File is a corpus, but is not valid
+ */
+int32_t
+packed_corpus_open(struct packed_corpus *corpus, const char *path)
+{
+        if ((corpus == NULL) || (path == NULL)) {
+                return -1;
+        }
+
+        memset(corpus, 0x00, sizeof(*corpus));
+
+        int fd;
+        fd = open(path, O_RDONLY);
+
+        if (fd < 0) {
+                return -2;
+        }
+
+        struct stat st;
+
+        if ((fstat(fd, &st)) < 0) {
+                (void)close(fd);
+                return -2;
+        }
+
+        size_t size;
+        size = st.st_size;
+
+        struct packed_corpus_header header;
+
+        if (size < sizeof(header)) {
+                (void)close(fd);
+                return -3;
+        }
+
+        uint8_t *bytes;
+        bytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        (void)close(fd);
+
+        if (bytes == MAP_FAILED) {
+                return -2;
+        }
+
+        (void)memcpy(&header, bytes, sizeof(header));
+
+        if ((memcmp(header.magic, PACKED_CORPUS_MAGIC, sizeof(header.magic))) != 0) {
+                (void)munmap(bytes, size);
+
+                return -3;
+        }
+
+        if ((header.version != PACKED_CORPUS_VERSION) ||
+            (header.format_size != sizeof(struct scrn_packed_format)) ||
+            (header.scene_count == UINT32_MAX)) {
+                goto invalid;
+        }
+
+        size_t expected_size;
+        expected_size = packed_corpus_formats_offset(header.scene_count) +
+            ((size_t)header.format_count * sizeof(struct scrn_packed_format));
+
+        if (size != expected_size) {
+                goto invalid;
+        }
+
+        corpus->scene_count = header.scene_count;
+        corpus->format_count = header.format_count;
+        corpus->lines = (const uint32_t *)(bytes + sizeof(header));
+        corpus->starts = corpus->lines + header.scene_count;
+        corpus->formats = (const struct scrn_packed_format *)(bytes +
+            packed_corpus_formats_offset(header.scene_count));
+
+        /* Each scene holds at most SCRN_COUNT formats */
+        uint32_t scene;
+        for (scene = 0; scene < corpus->scene_count; scene++) {
+                if ((corpus->starts[scene] > corpus->starts[scene + 1]) ||
+                    ((corpus->starts[scene + 1] - corpus->starts[scene]) > SCRN_COUNT)) {
+                        goto invalid;
+                }
+        }
+
+        if ((corpus->starts[0] != 0) ||
+            (corpus->starts[corpus->scene_count] != corpus->format_count)) {
+                goto invalid;
+        }
+
+        corpus->map = bytes;
+        corpus->map_size = size;
+
+        return 0;
+
+invalid:
+        (void)munmap(bytes, size);
+
+        memset(corpus, 0x00, sizeof(*corpus));
+
+        return -4;
+}
+
+/*-
+ * Unmap the corpus CORPUS.
+ */
+void
+packed_corpus_close(struct packed_corpus *corpus)
+{
+        if ((corpus == NULL) || (corpus->map == NULL)) {
+                return;
+        }
+
+        (void)munmap(corpus->map, corpus->map_size);
+
+        memset(corpus, 0x00, sizeof(*corpus));
+}
+
+/*-
+ * Unpack the scroll screen formats of the scene SCENE of the corpus
+ * CORPUS into CSV_SCENE.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CORPUS or CSV_SCENE is NULL, or SCENE is out of range
+ */
+int32_t
+packed_corpus_scene_get(const struct packed_corpus *corpus, uint32_t scene,
+    struct csv_scene *csv_scene)
+{
+        if ((corpus == NULL) || (csv_scene == NULL) || (scene >= corpus->scene_count)) {
+                return -1;
+        }
+
+        memset(csv_scene, 0x00, sizeof(*csv_scene));
+
+        csv_scene->line = corpus->lines[scene];
+
+        uint32_t i;
+        for (i = corpus->starts[scene]; i < corpus->starts[scene + 1]; i++) {
+                (void)scrn_packed_unpack(&corpus->formats[i],
+                    &csv_scene->formats[csv_scene->format_count]);
+
+                csv_scene->format_count++;
+        }
+
+        return 0;
+}
+
+/*-
+ * Calculate the VDP2 VRAM cycle patterns of each scene of the corpus
+ * CORPUS, as vdp2cycp() does.
+ *
+ * The access timings and bank bit-maps are read from the packed formats
+ * in place, and every scene is solved by vdp2cycp_batch(). Scenes that
+ * use a rotational background, or hold a format vdp2cycp() rejects, are
+ * unpacked and solved by vdp2cycp() instead. Every scene is solved in
+ * the normal TV screen modes, as the access timings packed are those of
+ * the normal modes.
+ *
+ * The result of each scene is written to RESULTS, and if successful, its
+ * cycle patterns to VRAM_CYCP. If SCENE_RAMCTL is not NULL, the RAMCTL of
+ * each scene is written to it, where the VRAM partitioning and RDBS are those
+ * vdp2cycp() selects for the rotational backgrounds.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CORPUS, VRAM_CYCP, or RESULTS is NULL
+ *   - -2 Memory could not be allocated
+ */
+int32_t
+packed_corpus_solve(const struct packed_corpus *corpus, union vram_cycp *vram_cycp,
+    uint16_t *scene_ramctl, int32_t *results)
+{
+        if ((corpus == NULL) || (vram_cycp == NULL) || (results == NULL)) {
+                return -1;
+        }
+
+        size_t count;
+        count = corpus->scene_count;
+
+        /* One array for each of the 6 values of each NBG */
+        uint8_t *values;
+        values = calloc((count * 6 * 4) + 1, sizeof(uint8_t));
+        uint16_t *ramctl;
+        ramctl = calloc(count + 1, sizeof(uint16_t));
+        bool *unpacked;
+        unpacked = calloc(count + 1, sizeof(bool));
+
+        if ((values == NULL) || (ramctl == NULL) || (unpacked == NULL)) {
+                free(unpacked);
+                free(ramctl);
+                free(values);
+
+                return -2;
+        }
+
+        struct cycp_batch batch;
+
+        memset(&batch, 0x00, sizeof(batch));
+
+        batch.count = count;
+        batch.ramctl = ramctl;
+        batch.vram_cycp = vram_cycp;
+        batch.results = results;
+
+        uint8_t *tvcs[4];
+        uint8_t *tpnd[4];
+        uint8_t *tcpd[4];
+        uint8_t *vcs_bitmap[4];
+        uint8_t *pnd_bitmap[4];
+        uint8_t *cpd_bitmap[4];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 4; scrn++) {
+                uint8_t *scrn_values;
+                scrn_values = &values[scrn * 6 * count];
+
+                tvcs[scrn] = &scrn_values[0 * count];
+                tpnd[scrn] = &scrn_values[1 * count];
+                tcpd[scrn] = &scrn_values[2 * count];
+                vcs_bitmap[scrn] = &scrn_values[3 * count];
+                pnd_bitmap[scrn] = &scrn_values[4 * count];
+                cpd_bitmap[scrn] = &scrn_values[5 * count];
+
+                batch.scrns[scrn].tvcs = tvcs[scrn];
+                batch.scrns[scrn].tpnd = tpnd[scrn];
+                batch.scrns[scrn].tcpd = tcpd[scrn];
+                batch.scrns[scrn].vcs_bitmap = vcs_bitmap[scrn];
+                batch.scrns[scrn].pnd_bitmap = pnd_bitmap[scrn];
+                batch.scrns[scrn].cpd_bitmap = cpd_bitmap[scrn];
+        }
+
+        size_t scene;
+        for (scene = 0; scene < count; scene++) {
+                uint32_t i;
+                for (i = corpus->starts[scene]; i < corpus->starts[scene + 1]; i++) {
+                        const struct scrn_packed_format *packed;
+                        packed = &corpus->formats[i];
+
+                        if (!SCRN_PACKED_GET(packed, SCRN_PACKED_ENABLE)) {
+                                continue;
+                        }
+
+                        scrn = SCRN_PACKED_GET(packed, SCRN_PACKED_SCROLL_SCREEN);
+
+                        if ((scrn > SCRN_NBG3) || (SCRN_PACKED_GET(packed, SCRN_PACKED_ERROR) != 0)) {
+                                unpacked[scene] = true;
+                                continue;
+                        }
+
+                        tvcs[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_TVCS);
+                        tpnd[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_TPND);
+                        tcpd[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_TCPD);
+                        vcs_bitmap[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_VCS_BITMAP);
+                        pnd_bitmap[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_PND_BITMAP);
+                        cpd_bitmap[scrn][scene] = SCRN_PACKED_GET(packed, SCRN_PACKED_CPD_BITMAP);
+                }
+
+                /* Leave the scene to vdp2cycp() */
+                if (unpacked[scene]) {
+                        for (scrn = 0; scrn < 4; scrn++) {
+                                tcpd[scrn][scene] = 0;
+                        }
+                }
+        }
+
+        (void)vdp2cycp_batch(&batch);
+
+        for (scene = 0; scene < count; scene++) {
+                if (!unpacked[scene]) {
+                        continue;
+                }
+
+                struct csv_scene csv_scene;
+
+                (void)packed_corpus_scene_get(corpus, scene, &csv_scene);
+
+                const struct scrn_format *formats[SCRN_COUNT + 1];
+
+                csv_scene_formats_get(&csv_scene, formats);
+
+                struct state state;
+
+                state_init(&state, formats);
+
+                results[scene] = vdp2cycp(&state);
+                vram_cycp[scene] = state.vram_cycp;
+                ramctl[scene] = state.ramctl;
+        }
+
+        if (scene_ramctl != NULL) {
+                (void)memcpy(scene_ramctl, ramctl, count * sizeof(uint16_t));
+        }
+
+        free(unpacked);
+        free(ramctl);
+        free(values);
+
+        return 0;
+}
+
+/*-
+ * Pack ADDRESS as an offset from BASE, where the offset is within MASK.
+ * The upper 4 bits of ADDRESS must match REGION, unless REGION is
+ * negative, in which case REGION is set.
+ */
+static bool
+packed_address_pack(uint32_t address, uint32_t base, uint32_t mask, int32_t *region,
+    uint32_t *offset)
+{
+        if (((address & 0x0FFFFFFF) & ~mask) != base) {
+                return false;
+        }
+
+        int32_t address_region;
+        address_region = address >> 28;
+
+        if (*region < 0) {
+                *region = address_region;
+        } else if (*region != address_region) {
+                return false;
+        }
+
+        *offset = address & mask;
+
+        return true;
+}
+
+/*-
+ * Return the offset of the packed formats of a corpus of SCENE_COUNT
+ * scenes.
+ */
+static size_t
+packed_corpus_formats_offset(uint32_t scene_count)
+{
+        size_t offset;
+        offset = sizeof(struct packed_corpus_header) +
+            ((((size_t)scene_count * 2) + 1) * sizeof(uint32_t));
+
+        return (offset + 7) & ~(size_t)7;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef PACKED_H_
+#define PACKED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2.h"
+#include "csv.h"
+
+/*-
+ * Bit-packed scroll screen format, 32 bytes in place of the 92 bytes of
+ * struct scrn_format.
+ *
+ * Each field is described by its word, its starting bit, and its width.
+ * Addresses are stored as an offset from the start of VRAM or CRAM, and
+ * share the upper 4 bits (the cache region) of the lead addresses.
+ *
+ * The last word holds what vdp2cycp() derives from the format: the
+ * number of access timings and the bank bit-map of each kind of read in
+ * 4-Mbit VRAM, or the (negated) error of cycp_calculate_timings(). The
+ * solver reads it directly, without unpacking the format. It also holds
+ * the coefficient table of a rotational background.
+ */
+struct scrn_packed_format {
+        uint64_t spf_words[4];
+};
+
+#define SCRN_PACKED_ENABLE              0,  0,  1
+#define SCRN_PACKED_SCROLL_SCREEN       0,  1,  3
+#define SCRN_PACKED_TYPE                0,  4,  1
+#define SCRN_PACKED_CC_COUNT            0,  5,  3
+#define SCRN_PACKED_REDUCTION           0,  8,  2
+#define SCRN_PACKED_CHARACTER_SIZE      0, 10,  1 /* (1 * 1) or (2 * 2) cells */
+#define SCRN_PACKED_PND_SIZE            0, 11,  1 /* 1-word or 2-words */
+#define SCRN_PACKED_AUXILIARY_MODE      0, 12,  1
+#define SCRN_PACKED_PLANE_SIZE          0, 13,  2 /* (1 * 1), (2 * 1), or (2 * 2) */
+#define SCRN_PACKED_RP_MODE             0, 15,  2
+#define SCRN_PACKED_BITMAP_WIDTH        0, 17,  1 /* 512 or 1024 */
+#define SCRN_PACKED_BITMAP_HEIGHT       0, 18,  1 /* 256 or 512 */
+#define SCRN_PACKED_VCS                 0, 19,  1 /* Vertical cell scroll is used */
+#define SCRN_PACKED_REGION              0, 20,  4
+#define SCRN_PACKED_VCS_TABLE           0, 24, 20
+#define SCRN_PACKED_COLOR_PALETTE       0, 44, 19
+
+/* Character pattern table, or bitmap pattern lead address */
+#define SCRN_PACKED_CP_TABLE            1,  0, 20
+#define SCRN_PACKED_PLANE_A             1, 20, 20
+#define SCRN_PACKED_PLANE_B             1, 40, 20
+#define SCRN_PACKED_PLANE_C             2,  0, 20
+#define SCRN_PACKED_PLANE_D             2, 20, 20
+
+#define SCRN_PACKED_TVCS                3,  0,  4
+#define SCRN_PACKED_TPND                3,  4,  4
+#define SCRN_PACKED_TCPD                3,  8,  4
+#define SCRN_PACKED_VCS_BITMAP          3, 12,  4
+#define SCRN_PACKED_PND_BITMAP          3, 16,  4
+#define SCRN_PACKED_CPD_BITMAP          3, 20,  4
+#define SCRN_PACKED_ERROR               3, 24,  3
+#define SCRN_PACKED_COEFFICIENT         3, 27,  2 /* None, in VRAM, or in CRAM */
+#define SCRN_PACKED_COEFFICIENT_TABLE   3, 29, 20
+
+/* Extract field F from packed format SPF */
+#define SCRN_PACKED_GET(spf, f)         SCRN_PACKED_FIELD_GET(spf, f)
+
+#define SCRN_PACKED_FIELD_GET(spf, word, bit, width)                          \
+        ((uint32_t)(((spf)->spf_words[(word)] >> (bit)) &                      \
+            ((UINT64_C(1) << (width)) - 1)))
+
+/* Set field F of packed format SPF to X, where the field is clear */
+#define SCRN_PACKED_SET(spf, f, x)      SCRN_PACKED_FIELD_SET(spf, f, x)
+
+#define SCRN_PACKED_FIELD_SET(spf, word, bit, width, x)                       \
+        ((spf)->spf_words[(word)] |=                                           \
+            ((uint64_t)(x) & ((UINT64_C(1) << (width)) - 1)) << (bit))
+
+/*-
+ * A corpus of scenes of packed scroll screen formats, mapped into memory
+ * from a file written by packed_corpus_write().
+ */
+struct packed_corpus {
+        uint32_t scene_count;
+        uint32_t format_count;
+
+        /* Line of the CSV file each scene was read from */
+        const uint32_t *lines;
+        /* Index of the first format of each scene, followed by the
+         * number of formats */
+        const uint32_t *starts;
+        const struct scrn_packed_format *formats;
+
+        void *map;
+        size_t map_size;
+};
+
+int32_t scrn_packed_pack(const struct scrn_format *, struct scrn_packed_format *);
+int32_t scrn_packed_unpack(const struct scrn_packed_format *, struct scrn_format *);
+
+int32_t packed_corpus_write(const char *, const struct csv_scene *, size_t);
+int32_t packed_corpus_open(struct packed_corpus *, const char *);
+void packed_corpus_close(struct packed_corpus *);
+
+int32_t packed_corpus_scene_get(const struct packed_corpus *, uint32_t, struct csv_scene *);
+int32_t packed_corpus_solve(const struct packed_corpus *, union vram_cycp *, uint16_t *,
+    int32_t *);
+
+#endif /* !PACKED_H_ */
@@ -0,0 +1,466 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "schedule.h"
+
+#include "math.h"
+#include "debug.h"
+
+/* Number of cycle pattern registers, CYCA0L through CYCB1U */
+#define CYCP_REGISTER_COUNT     (VDP2_REG_CYCP_COUNT - 1)
+
+static int32_t cycp_schedule_step(struct state *, struct state *, bool, const uint16_t *,
+    uint16_t *);
+static void cycp_schedule_state_apply(struct state *, const struct state *, bool);
+static uint32_t cycp_registers_minimize(const struct state *, const uint16_t *,
+    union vram_cycp *);
+static void cycp_register_set(union vram_cycp *, uint32_t, uint16_t);
+static void cycp_writes_append(const uint16_t *, const uint16_t *, bool, uint16_t,
+    struct cycp_write *, size_t *);
+
+/*-
+ * Calculate the cycle patterns of each of the COUNT segments SEGMENTS of
+ * a frame, in the order of their first scanlines, and write to WRITES
+ * the register writes that switch from one segment to the next. The
+ * number of writes, at most one per segment, is written to WRITE_COUNT.
+ *
+ * The first segment is solved as vdp2cycp() does. Each segment that
+ * follows is solved as cycp_delta_solve() does, so that as few registers
+ * as possible change between segments. A change of RAMCTL solves the
+ * segment from scratch.
+ *
+ * The write of the first segment holds every register from RAMCTL
+ * through CYCB1U. The write of each segment that follows holds the
+ * registers from the first to the last that change, such that a single
+ * transfer during the horizontal blank applies it, and is left out when
+ * no register changes.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 SEGMENTS, the state of a segment, WRITES, or WRITE_COUNT is NULL
+ *   - -2 The segments are not in the order of their first scanlines, or
+ *        differ in TV screen mode or VRAM size
+ *   - -3 The cycle patterns of a segment can't be calculated, where the
+ *        value vdp2cycp() returns is written to its result, and the
+ *        segments that follow are not solved
+ */
+int32_t
+cycp_schedule_solve(struct cycp_segment *segments, size_t count, struct cycp_write *writes,
+    size_t *write_count)
+{
+        if ((segments == NULL) || (writes == NULL) || (write_count == NULL)) {
+                return -1;
+        }
+
+        *write_count = 0;
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+                const struct state *state;
+                state = segments[i].state;
+
+                if (state == NULL) {
+                        return -1;
+                }
+
+                if (i == 0) {
+                        continue;
+                }
+
+                const struct cycp_segment *prev_segment;
+                prev_segment = &segments[i - 1];
+
+                if ((segments[i].line <= prev_segment->line) ||
+                    (state->tvmd != prev_segment->state->tvmd) ||
+                    (state->vrsize != prev_segment->state->vrsize)) {
+                        return -2;
+                }
+        }
+
+        /* Solved from one segment to the next */
+        struct state work;
+
+        state_init(&work, NULL);
+
+        uint16_t registers[VDP2_REG_CYCP_COUNT];
+        uint16_t prev_registers[VDP2_REG_CYCP_COUNT];
+
+        /* RAMCTL given to the previous segment, as the rotation data banks
+         * selected are written to it once solved */
+        uint16_t ramctl;
+        ramctl = 0x0000;
+
+        for (i = 0; i < count; i++) {
+                struct cycp_segment *segment;
+                segment = &segments[i];
+
+                /* The VRAM partitioning, or the rotation data banks, of
+                 * the previous segment may not be kept */
+                bool reset;
+                reset = (i == 0) || (segment->state->ramctl != ramctl);
+
+                ramctl = segment->state->ramctl;
+
+                segment->result = cycp_schedule_step(&work, segment->state, reset,
+                    (i == 0) ? NULL : prev_registers, registers);
+                DEBUG_PRINTF("segment at line %u: %i\n", segment->line, segment->result);
+
+                if (segment->result < 0) {
+                        return -3;
+                }
+
+                cycp_writes_append((i == 0) ? NULL : prev_registers, registers, true,
+                    segment->line, writes, write_count);
+
+                (void)memcpy(prev_registers, registers, sizeof(registers));
+        }
+
+        return 0;
+}
+
+/*-
+ * Calculate the cycle patterns of each of the COUNT states STATES, in
+ * order, such that as few VDP2 registers as possible change from one
+ * state to the next, and write to WRITES the register writes that switch
+ * from one state to the next. The number of writes, at most
+ * CYCP_DELTA_WRITE_COUNT per state, is written to WRITE_COUNT.
+ *
+ * Each state is solved both as vdp2cycp_update() does from the state
+ * before it, keeping the access timings of the NBGs whose formats are
+ * the same, and from scratch. Then, of the registers that change, every
+ * combination that takes the values of the previous state instead is
+ * validated, as any valid cycle pattern is as good as another. The
+ * solution changing the fewest registers is kept, then the one leaving
+ * the most access timings free. A change of RAMCTL, TV screen mode, or
+ * VRAM size, or a rotational background, solves the state from scratch
+ * only.
+ *
+ * The writes of the first state hold every register from RAMCTL through
+ * CYCB1U. Each write of a state that follows holds a run of consecutive
+ * registers that change. The line of each write is the index of its
+ * state.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 STATES, WRITES, or WRITE_COUNT is NULL
+ *   - -2 The cycle patterns of a state can't be calculated, and the
+ *        states that follow are not solved. Its cycle patterns no longer
+ *        hold a solution
+ */
+int32_t
+cycp_delta_solve(struct state *states, size_t count, struct cycp_write *writes,
+    size_t *write_count)
+{
+        if ((states == NULL) || (writes == NULL) || (write_count == NULL)) {
+                return -1;
+        }
+
+        *write_count = 0;
+
+        /* Solved from one state to the next */
+        struct state work;
+
+        state_init(&work, NULL);
+
+        uint16_t registers[VDP2_REG_CYCP_COUNT];
+        uint16_t prev_registers[VDP2_REG_CYCP_COUNT];
+
+        /* RAMCTL given to the previous state */
+        uint16_t ramctl;
+        ramctl = 0x0000;
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+                struct state *state;
+                state = &states[i];
+
+                bool reset;
+                reset = (i == 0) ||
+                    (state->ramctl != ramctl) ||
+                    (state->tvmd != states[i - 1].tvmd) ||
+                    (state->vrsize != states[i - 1].vrsize);
+
+                ramctl = state->ramctl;
+
+                int32_t ret;
+                ret = cycp_schedule_step(&work, state, reset,
+                    (i == 0) ? NULL : prev_registers, registers);
+                DEBUG_PRINTF("state %zu: %i\n", i, ret);
+
+                if (ret < 0) {
+                        return -2;
+                }
+
+                cycp_writes_append((i == 0) ? NULL : prev_registers, registers, false,
+                    i, writes, write_count);
+
+                (void)memcpy(prev_registers, registers, sizeof(registers));
+        }
+
+        return 0;
+}
+
+/*-
+ * Solve STATE from the state WORK, which holds the solution of the
+ * previous state, as cycp_delta_solve() describes, and write the values
+ * of its registers to REGISTERS. If PREV_REGISTERS, the registers of the
+ * previous state, is NULL, RESET is true, or a rotational background is
+ * enabled, STATE is solved from scratch only.
+ *
+ * The value vdp2cycp() returns is returned.
+ */
+static int32_t
+cycp_schedule_step(struct state *work, struct state *state, bool reset,
+    const uint16_t *prev_registers, uint16_t *registers)
+{
+        /* The rotational backgrounds select the VRAM partitioning and the
+         * rotation data banks anew, from the RAMCTL given */
+        if ((state->rbg0.format.sf_enable) ||
+            (state->rbg1.format.sf_enable) ||
+            (work->rbg0.format.sf_enable) ||
+            (work->rbg1.format.sf_enable)) {
+                reset = true;
+        }
+
+        cycp_schedule_state_apply(work, state, reset);
+
+        int32_t ret;
+        ret = vdp2cycp_update(work);
+
+        if (ret < 0) {
+                state->solved = false;
+
+                return ret;
+        }
+
+        uint32_t change_count;
+        change_count = 0;
+
+        if (prev_registers != NULL) {
+                change_count = cycp_registers_minimize(work, prev_registers, &work->vram_cycp);
+        }
+
+        /* Unless solved from scratch already, as vdp2cycp_update() may
+         * keep the access timings of NBGs no longer needed */
+        if ((prev_registers != NULL) && (!reset) && (change_count > 0) &&
+            ((vdp2cycp(state)) == 0)) {
+                uint32_t state_change_count;
+                state_change_count = cycp_registers_minimize(state, prev_registers,
+                    &state->vram_cycp);
+
+                if ((state_change_count < change_count) ||
+                    ((state_change_count == change_count) &&
+                        ((vram_cycp_free_count(state->ramctl, &state->vram_cycp)) >
+                            (vram_cycp_free_count(work->ramctl, &work->vram_cycp))))) {
+                        work->vram_cycp = state->vram_cycp;
+                        work->ramctl = state->ramctl;
+                }
+        }
+
+        state->ramctl = work->ramctl;
+        state->vram_cycp = work->vram_cycp;
+        state->solved = true;
+
+        vram_cycp_registers_get(work->ramctl, &work->vram_cycp, registers);
+
+        return 0;
+}
+
+/*-
+ * Bring the state WORK, solved for the previous state, to the scroll
+ * screens of STATE. The scroll screens whose formats differ are marked
+ * as changed. If RESET is true, RAMCTL, the TV screen mode, and the VRAM
+ * size are taken from STATE as well, and every scroll screen is solved
+ * again.
+ */
+static void
+cycp_schedule_state_apply(struct state *work, const struct state *state, bool reset)
+{
+        if (reset) {
+                work->ramctl = state->ramctl;
+                work->tvmd = state->tvmd;
+                work->vrsize = state->vrsize;
+                work->solved = false;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                struct scrn_format *format;
+                format = &work->scroll_screens[scrn]->format;
+
+                const struct scrn_format *state_format;
+                state_format = &state->scroll_screens[scrn]->format;
+
+                if ((!reset) && ((memcmp(format, state_format, sizeof(*format))) == 0)) {
+                        continue;
+                }
+
+                (void)memcpy(format, state_format, sizeof(*format));
+
+                state_scrn_dirty(work, scrn);
+        }
+}
+
+/*-
+ * Of the cycle pattern registers of VRAM_CYCP, solved for STATE, that
+ * differ from PREV_REGISTERS, set those to their previous values that
+ * keep the cycle patterns valid for STATE, changing as few registers as
+ * possible. Every combination is validated at once, at most 256 of them.
+ *
+ * The number of registers, RAMCTL included, that still differ from
+ * PREV_REGISTERS is returned.
+ */
+static uint32_t
+cycp_registers_minimize(const struct state *state, const uint16_t *prev_registers,
+    union vram_cycp *vram_cycp)
+{
+        uint16_t registers[VDP2_REG_CYCP_COUNT];
+
+        vram_cycp_registers_get(state->ramctl, vram_cycp, registers);
+
+        /* Cycle pattern registers that differ */
+        uint8_t changed[CYCP_REGISTER_COUNT];
+        uint32_t changed_count;
+        changed_count = 0;
+
+        uint32_t i;
+        for (i = 0; i < CYCP_REGISTER_COUNT; i++) {
+                if (registers[i + 1] != prev_registers[i + 1]) {
+                        changed[changed_count++] = i;
+                }
+        }
+
+        uint32_t ramctl_changed;
+        ramctl_changed = (registers[0] != prev_registers[0]) ? 1 : 0;
+
+        if (changed_count == 0) {
+                return ramctl_changed;
+        }
+
+        /* Each bit of a combination keeps a changed register at its
+         * previous value */
+        union vram_cycp patterns[1 << CYCP_REGISTER_COUNT];
+        int8_t results[1 << CYCP_REGISTER_COUNT];
+
+        uint32_t combination_count;
+        combination_count = 1 << changed_count;
+
+        uint32_t combination;
+        for (combination = 0; combination < combination_count; combination++) {
+                patterns[combination] = *vram_cycp;
+
+                for (i = 0; i < changed_count; i++) {
+                        if ((combination & (1 << i)) != 0x00) {
+                                cycp_register_set(&patterns[combination], changed[i],
+                                    prev_registers[changed[i] + 1]);
+                        }
+                }
+        }
+
+        if ((vdp2cycp_validate(state, patterns, combination_count, results)) < 0) {
+                return changed_count + ramctl_changed;
+        }
+
+        /* The combination of no register kept is the solution itself */
+        uint32_t best;
+        best = 0;
+
+        for (combination = 1; combination < combination_count; combination++) {
+                if (results[combination] < 0) {
+                        continue;
+                }
+
+                uint32_t kept_count;
+                kept_count = bit_count(combination);
+                uint32_t best_kept_count;
+                best_kept_count = bit_count(best);
+
+                if ((kept_count > best_kept_count) ||
+                    ((kept_count == best_kept_count) &&
+                        ((vram_cycp_free_count(state->ramctl, &patterns[combination])) >
+                            (vram_cycp_free_count(state->ramctl, &patterns[best]))))) {
+                        best = combination;
+                }
+        }
+
+        *vram_cycp = patterns[best];
+
+        return (changed_count - bit_count(best)) + ramctl_changed;
+}
+
+/*-
+ * Set the access timings of the cycle pattern register INDEX, from CYCA0L
+ * at 0, of VRAM_CYCP to those of the register value VALUE.
+ */
+static void
+cycp_register_set(union vram_cycp *vram_cycp, uint32_t index, uint16_t value)
+{
+        uint32_t bank;
+        bank = index >> 1;
+
+        /* The upper register holds T4 to T7 */
+        uint32_t first_t;
+        first_t = (index & 0x01) * 4;
+
+        uint32_t t;
+        for (t = 0; t < 4; t++) {
+                uint32_t timing;
+                timing = (value >> (12 - (t * 4))) & 0x000F;
+
+                vram_cycp->pv[bank] &= ~VRAM_CTL_CYCP_TIMING_MASK(first_t + t);
+                vram_cycp->pv[bank] |= timing << VRAM_CTL_CYCP_TIMING_BIT(first_t + t);
+        }
+}
+
+/*-
+ * Append to WRITES, of which there are WRITE_COUNT, the writes of the
+ * registers REGISTERS that differ from PREV_REGISTERS, at the line LINE.
+ * Every register is written if PREV_REGISTERS is NULL. If SINGLE is true,
+ * a single write holds every register from the first to the last that
+ * differ. Otherwise, each run of consecutive registers that differ is
+ * written on its own.
+ */
+static void
+cycp_writes_append(const uint16_t *prev_registers, const uint16_t *registers, bool single,
+    uint16_t line, struct cycp_write *writes, size_t *write_count)
+{
+        struct cycp_write *write;
+        write = NULL;
+
+        uint32_t i;
+        for (i = 0; i < VDP2_REG_CYCP_COUNT; i++) {
+                bool changed;
+                changed = (prev_registers == NULL) || (registers[i] != prev_registers[i]);
+
+                if (!changed) {
+                        if (!single) {
+                                write = NULL;
+                        }
+
+                        continue;
+                }
+
+                if (write == NULL) {
+                        write = &writes[(*write_count)++];
+
+                        write->line = line;
+                        write->reg = VDP2_REG_RAMCTL + (i * sizeof(uint16_t));
+                        write->count = 0;
+                }
+
+                /* The registers left unchanged within a single write are
+                 * written with their current values */
+                while ((write->reg + (write->count * sizeof(uint16_t))) <=
+                    (VDP2_REG_RAMCTL + (i * sizeof(uint16_t)))) {
+                        uint32_t index;
+                        index = ((write->reg - VDP2_REG_RAMCTL) / sizeof(uint16_t)) + write->count;
+
+                        write->values[write->count++] = registers[index];
+                }
+        }
+}
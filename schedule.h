@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+
+/*-
+ * Segment of a frame, from its first scanline up to the first scanline of
+ * the segment that follows, displaying the scroll screens of STATE.
+ */
+struct cycp_segment {
+        uint16_t line;
+        /* Cycle patterns and RAMCTL are written once solved */
+        struct state *state;
+        /* Value vdp2cycp() returns for the segment */
+        int32_t result;
+};
+
+/* Most writes of the registers of a state by cycp_delta_solve(), one
+ * per run of consecutive registers that change */
+#define CYCP_DELTA_WRITE_COUNT  ((VDP2_REG_CYCP_COUNT + 1) / 2)
+
+/*-
+ * Write of COUNT consecutive VDP2 registers, starting at the register
+ * REG, during the horizontal blank preceding the scanline LINE, or for
+ * cycp_delta_solve(), before the state of index LINE is displayed. The
+ * values are in the byte order of the host.
+ */
+struct cycp_write {
+        uint16_t line;
+        /* Offset of the first register from VDP2_REG_BASE */
+        uint16_t reg;
+        uint16_t count;
+        uint16_t values[VDP2_REG_CYCP_COUNT];
+};
+
+int32_t cycp_schedule_solve(struct cycp_segment *, size_t, struct cycp_write *, size_t *);
+int32_t cycp_delta_solve(struct state *, size_t, struct cycp_write *, size_t *);
+
+#endif /* !SCHEDULE_H_ */
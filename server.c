@@ -0,0 +1,510 @@
+#include <sys/cdefs.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "csv.h"
+
+#include "debug.h"
+
+/* Room left in the output buffer for the response to a scene */
+#define SERVER_RESPONSE_SIZE    256
+
+/* Header row of a CSV file, which is skipped */
+#define SERVER_HEADER           "Scroll screen,"
+
+/*-
+ * Connection reading scenes from IN_FD, and writing their solutions to
+ * OUT_FD.
+ */
+struct server_connection {
+        struct server *server;
+
+        int in_fd;
+        int out_fd;
+
+        /* Line of the stream being read */
+        uint32_t line;
+
+        /* Scene being read, and the first error found in its rows */
+        struct csv_scene scene;
+        uint32_t error_line;
+        const char *error;
+
+        /* The rest of a row too long to be read is skipped */
+        bool skip;
+
+        size_t in_length;
+        size_t out_length;
+        char in[SERVER_BUFFER_SIZE];
+        char out[SERVER_BUFFER_SIZE];
+};
+
+static void *server_connection_thread(void *);
+static int32_t server_connection_serve(struct server_connection *);
+static void server_connection_line(struct server_connection *, const char *, const char *);
+static void server_connection_scene_end(struct server_connection *);
+static bool server_connection_flush(struct server_connection *);
+
+/*-
+ * Initialize the server SERVER, solving scenes in the TV screen mode
+ * TVMD, with the VRAM size VRSIZE.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 SERVER is NULL
+ *   - -2 Memory could not be allocated
+ */
+int32_t
+server_init(struct server *server, uint16_t tvmd, uint16_t vrsize)
+{
+        if (server == NULL) {
+                return -1;
+        }
+
+        memset(server, 0x00, sizeof(*server));
+
+        server->tvmd = tvmd;
+        server->vrsize = vrsize;
+
+        server->cycpdb_loaded = (cycpdb_builtin_init(&server->cycpdb)) == 0;
+
+        if (server->cycpdb_loaded) {
+                return 0;
+        }
+
+        if ((server->cache = malloc(sizeof(struct cycp_cache))) == NULL) {
+                return -2;
+        }
+
+        cycp_cache_init(server->cache);
+
+        return 0;
+}
+
+/*-
+ * Free the cache of the server SERVER.
+ */
+void
+server_deinit(struct server *server)
+{
+        if (server == NULL) {
+                return;
+        }
+
+        free(server->cache);
+
+        server->cache = NULL;
+}
+
+/*-
+ * Read scenes from the file descriptor IN_FD, and write the solution of
+ * each to the file descriptor OUT_FD, in order, until the end of IN_FD.
+ *
+ * Scenes are read as the rows of a CSV file, with a blank line after
+ * each scene, where the header row may appear anywhere, and is skipped.
+ * The solution of a scene is written as the cycle patterns are printed
+ * by main(), preceded by RAMCTL if the solver changes it, or as a line
+ * starting with "error:", and is followed by a blank line.
+ *
+ * Input is read as it arrives, and solutions are only written once no
+ * more input is waiting, or the output buffer is full, so that a client
+ * may send many scenes before reading their solutions.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 SERVER is NULL
+ *   - -2 Memory could not be allocated
+ *   - -3 IN_FD could not be read, or OUT_FD could not be written
+ */
+int32_t
+server_serve(struct server *server, int in_fd, int out_fd)
+{
+        if (server == NULL) {
+                return -1;
+        }
+
+        struct server_connection *connection;
+
+        if ((connection = malloc(sizeof(struct server_connection))) == NULL) {
+                return -2;
+        }
+
+        memset(connection, 0x00, offsetof(struct server_connection, in));
+
+        connection->server = server;
+        connection->in_fd = in_fd;
+        connection->out_fd = out_fd;
+
+        int32_t ret;
+        ret = server_connection_serve(connection);
+
+        free(connection);
+
+        return ret;
+}
+
+/*-
+ * Serve each connection to the Unix domain socket at PATH, as
+ * server_serve() does, each from a thread of its own. A socket left at
+ * PATH is replaced. Connections are accepted until accepting fails.
+ *
+ * If successful, 0 is never returned. Otherwise, a negative value is
+ * returned for the following cases:
+ *
+ *   - -1 SERVER or PATH is NULL
+ *   - -2 PATH is too long, or is not a socket
+ *   - -3 The socket could not be created, bound, or listened on
+ *   - -4 A connection could not be accepted
+ */
+int32_t
+server_listen(struct server *server, const char *path)
+{
+        if ((server == NULL) || (path == NULL)) {
+                return -1;
+        }
+
+        struct sockaddr_un addr;
+
+        memset(&addr, 0x00, sizeof(addr));
+
+        addr.sun_family = AF_UNIX;
+
+        if ((strlen(path)) >= sizeof(addr.sun_path)) {
+                return -2;
+        }
+
+        (void)strcpy(addr.sun_path, path);
+
+        struct stat st;
+
+        if ((stat(path, &st)) == 0) {
+                if (!S_ISSOCK(st.st_mode)) {
+                        return -2;
+                }
+
+                (void)unlink(path);
+        }
+
+        /* A client leaving early must not end the server */
+        (void)signal(SIGPIPE, SIG_IGN);
+
+        int fd;
+
+        if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+                return -3;
+        }
+
+        if (((bind(fd, (const struct sockaddr *)&addr, sizeof(addr))) < 0) ||
+            ((listen(fd, SERVER_BACKLOG)) < 0)) {
+                (void)close(fd);
+
+                return -3;
+        }
+
+        while (true) {
+                int connection_fd;
+
+                if ((connection_fd = accept(fd, NULL, NULL)) < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+
+                        break;
+                }
+
+                struct server_connection *connection;
+
+                if ((connection = malloc(sizeof(struct server_connection))) == NULL) {
+                        (void)close(connection_fd);
+                        continue;
+                }
+
+                memset(connection, 0x00, offsetof(struct server_connection, in));
+
+                connection->server = server;
+                connection->in_fd = connection_fd;
+                connection->out_fd = connection_fd;
+
+                pthread_t thread;
+
+                if ((pthread_create(&thread, NULL, server_connection_thread, connection)) != 0) {
+                        (void)close(connection_fd);
+                        free(connection);
+                        continue;
+                }
+
+                (void)pthread_detach(thread);
+        }
+
+        (void)close(fd);
+
+        return -4;
+}
+
+static void *
+server_connection_thread(void *arg)
+{
+        struct server_connection *connection;
+        connection = arg;
+
+        (void)server_connection_serve(connection);
+
+        (void)close(connection->in_fd);
+
+        free(connection);
+
+        return NULL;
+}
+
+static int32_t
+server_connection_serve(struct server_connection *connection)
+{
+        while (true) {
+                /* Write the solutions before waiting for more input */
+                struct pollfd pollfd = {
+                        .fd = connection->in_fd,
+                        .events = POLLIN
+                };
+
+                if (((poll(&pollfd, 1, 0)) == 0) && (!server_connection_flush(connection))) {
+                        return -3;
+                }
+
+                ssize_t length;
+                length = read(connection->in_fd, &connection->in[connection->in_length],
+                    SERVER_BUFFER_SIZE - connection->in_length);
+
+                if (length < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+
+                        return -3;
+                }
+
+                if (length == 0) {
+                        break;
+                }
+
+                connection->in_length += length;
+
+                const char *p;
+                p = connection->in;
+
+                const char *end;
+                end = &connection->in[connection->in_length];
+
+                const char *eol;
+                while ((eol = memchr(p, '\n', end - p)) != NULL) {
+                        if (connection->skip) {
+                                connection->skip = false;
+                        } else {
+                                server_connection_line(connection, p, eol);
+                        }
+
+                        p = eol + 1;
+                }
+
+                connection->in_length = end - p;
+
+                (void)memmove(connection->in, p, connection->in_length);
+
+                /* The rest of a row that doesn't fit is skipped */
+                if (connection->in_length == SERVER_BUFFER_SIZE) {
+                        connection->line++;
+
+                        if (connection->error == NULL) {
+                                connection->error_line = connection->line;
+                                connection->error = "Row is too long";
+                        }
+
+                        connection->in_length = 0;
+                        connection->skip = true;
+                }
+        }
+
+        /* The last row may lack a line break */
+        if ((connection->in_length > 0) && (!connection->skip)) {
+                server_connection_line(connection, connection->in,
+                    &connection->in[connection->in_length]);
+        }
+
+        server_connection_scene_end(connection);
+
+        return server_connection_flush(connection) ? 0 : -3;
+}
+
+/*-
+ * Read the line from START to END of CONNECTION, either a row of the
+ * scene being read, or the blank line ending it.
+ */
+static void
+server_connection_line(struct server_connection *connection, const char *start,
+    const char *end)
+{
+        connection->line++;
+
+        if (csv_line_blank(start, end)) {
+                server_connection_scene_end(connection);
+                return;
+        }
+
+        size_t header_length;
+        header_length = sizeof(SERVER_HEADER) - 1;
+
+        if ((((size_t)(end - start)) >= header_length) &&
+            ((strncmp(start, SERVER_HEADER, header_length)) == 0)) {
+                return;
+        }
+
+        if (connection->error != NULL) {
+                return;
+        }
+
+        if (connection->scene.format_count == 0) {
+                connection->scene.line = connection->line;
+        }
+
+        const char *error;
+
+        if ((error = csv_scene_row_add(&connection->scene, start, end,
+                    connection->server->vrsize)) != NULL) {
+                connection->error_line = connection->line;
+                connection->error = error;
+        }
+}
+
+/*-
+ * Solve the scene read by CONNECTION, if any, and write its solution to
+ * the output buffer.
+ */
+static void
+server_connection_scene_end(struct server_connection *connection)
+{
+        static const char *bank_names[] = {
+                "CYCA0",
+                "CYCA1",
+                "CYCB0",
+                "CYCB1"
+        };
+
+        struct server *server;
+        server = connection->server;
+
+        if ((connection->scene.format_count == 0) && (connection->error == NULL)) {
+                return;
+        }
+
+        if ((SERVER_BUFFER_SIZE - connection->out_length) < SERVER_RESPONSE_SIZE) {
+                (void)server_connection_flush(connection);
+        }
+
+        char *out;
+        out = &connection->out[connection->out_length];
+
+        int length;
+
+        if (connection->error != NULL) {
+                length = snprintf(out, SERVER_RESPONSE_SIZE, "error: Line %u: %s\n\n",
+                    connection->error_line, connection->error);
+        } else {
+                const struct scrn_format *formats[SCRN_COUNT + 1];
+
+                csv_scene_formats_get(&connection->scene, formats);
+
+                struct state state;
+
+                state_init(&state, formats);
+
+                if (server->vrsize != 0x0000) {
+                        state_vrsize_set(&state, server->vrsize);
+                }
+
+                state.tvmd = server->tvmd;
+                state.ramctl = 0x0000;
+
+                int32_t error;
+
+                if (server->cycpdb_loaded) {
+                        error = cycpdb_vdp2cycp(&server->cycpdb, &state);
+                } else {
+                        error = cycp_cache_vdp2cycp(server->cache, &state);
+                }
+                DEBUG_PRINTF("scene at line %u: %i\n", connection->scene.line, error);
+
+                if (error < 0) {
+                        length = snprintf(out, SERVER_RESPONSE_SIZE,
+                            "error: Unable to calculate cycle patterns (%i)\n\n", error);
+                } else {
+                        length = 0;
+
+                        if (state.ramctl != 0x0000) {
+                                length += snprintf(&out[length], SERVER_RESPONSE_SIZE - length,
+                                    "RAMCTL: 0x%04X\n", state.ramctl);
+                        }
+
+                        uint32_t bank;
+                        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                                length += snprintf(&out[length], SERVER_RESPONSE_SIZE - length,
+                                    "%s: 0x%08X\n", bank_names[bank], state.vram_cycp.pv[bank]);
+                        }
+
+                        length += snprintf(&out[length], SERVER_RESPONSE_SIZE - length, "\n");
+                }
+        }
+
+        connection->out_length += length;
+
+        memset(&connection->scene, 0x00, sizeof(connection->scene));
+
+        connection->error = NULL;
+}
+
+/*-
+ * Write the output buffer of CONNECTION.
+ *
+ * If successful, true is returned.
+ */
+static bool
+server_connection_flush(struct server_connection *connection)
+{
+        size_t offset;
+        offset = 0;
+
+        while (offset < connection->out_length) {
+                ssize_t length;
+                length = write(connection->out_fd, &connection->out[offset],
+                    connection->out_length - offset);
+
+                if (length < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+
+                        connection->out_length = 0;
+
+                        return false;
+                }
+
+                offset += length;
+        }
+
+        connection->out_length = 0;
+
+        return true;
+}
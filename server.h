@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vdp2cycp.h"
+#include "cache.h"
+#include "cycpdb.h"
+
+/* Size of the input and of the output buffer of each connection, and the
+ * longest row read */
+#define SERVER_BUFFER_SIZE      (64 * 1024)
+
+/* Number of connections of the Unix domain socket waiting to be
+ * accepted */
+#define SERVER_BACKLOG          64
+
+/*-
+ * Server solving the scenes of every connection, in the TV screen mode
+ * TVMD, with the VRAM size VRSIZE.
+ *
+ * The solution database is looked up if one is linked in. Otherwise, the
+ * solutions are cached, and the cache is shared by every connection.
+ */
+struct server {
+        uint16_t tvmd;
+        uint16_t vrsize;
+
+        bool cycpdb_loaded;
+        struct cycpdb cycpdb;
+
+        struct cycp_cache *cache;
+};
+
+int32_t server_init(struct server *, uint16_t, uint16_t);
+void server_deinit(struct server *);
+
+int32_t server_serve(struct server *, int, int);
+int32_t server_listen(struct server *, const char *);
+
+#endif /* !SERVER_H_ */
@@ -0,0 +1,84 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+/*-
+ * Initialize FORMAT as an enabled cell format of the scroll screen SCRN
+ * with 16 colors, 1-word pattern name data, and 1x1 cells, where every
+ * plane is stored at PLANE, and the character pattern table at
+ * CP_TABLE.
+ */
+void
+test_format_cell_init(struct scrn_format *format, uint8_t scrn, uint32_t plane,
+    uint32_t cp_table)
+{
+        memset(format, 0x00, sizeof(*format));
+
+        format->sf_enable = true;
+        format->sf_scroll_screen = scrn;
+        format->sf_type = SCRN_TYPE_CELL;
+        format->sf_cc_count = SCRN_CCC_PALETTE_16;
+        format->sf_reduction = SCRN_REDUCTION_NONE;
+
+        struct scrn_cell_format *cell_format;
+        cell_format = &format->sf_format.cell;
+
+        cell_format->scf_character_size = 1;
+        cell_format->scf_pnd_size = 1;
+        cell_format->scf_plane_size = 1;
+        cell_format->scf_cp_table = cp_table;
+
+        uint32_t i;
+        for (i = 0; i < 4; i++) {
+                cell_format->scf_map.planes[i] = plane;
+        }
+}
+
+/*-
+ * Initialize STATE with the COUNT formats FORMATS, in the TV screen mode
+ * TVMD.
+ */
+void
+test_state_init(struct state *state, const struct scrn_format *formats, size_t count,
+    uint16_t tvmd)
+{
+        const struct scrn_format *format_ptrs[SCRN_COUNT + 1];
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+                format_ptrs[i] = &formats[i];
+        }
+
+        format_ptrs[count] = NULL;
+
+        state_init(state, format_ptrs);
+
+        state->tvmd = tvmd;
+
+        /* Calculate the demands again in the TV screen mode */
+        state_vrsize_set(state, state->vrsize);
+}
+
+int
+main(void)
+{
+        int failed;
+        failed = 0;
+
+        failed += test_vdp2cycp();
+        failed += test_cycpdb();
+        failed += test_layout();
+        failed += test_schedule();
+        failed += test_cache();
+        failed += test_csv();
+        failed += test_packed();
+        failed += test_server();
+        failed += test_trace();
+
+        return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <cmocka.h>
+
+#include "vdp2cycp.h"
+
+/* Cycle pattern value of a bank where every access timing is set to no
+ * access */
+#define TEST_PV_NO_ACCESS       UINT32_C(0xFFFFFFFF)
+
+/* Cycle pattern value of a bank where only access timing T is set to the
+ * access code CODE */
+#define TEST_PV(t, code)                                                       \
+        (TEST_PV_NO_ACCESS & ~VRAM_CTL_CYCP_TIMING_MASK(t)) |                  \
+        ((uint32_t)(code) << VRAM_CTL_CYCP_TIMING_BIT(t))
+
+void test_format_cell_init(struct scrn_format *, uint8_t, uint32_t, uint32_t);
+void test_state_init(struct state *, const struct scrn_format *, size_t, uint16_t);
+
+int test_vdp2cycp(void);
+int test_cycpdb(void);
+int test_layout(void);
+int test_schedule(void);
+int test_cache(void);
+int test_csv(void);
+int test_packed(void);
+int test_server(void);
+int test_trace(void);
+
+#endif /* !TEST_H_ */
@@ -0,0 +1,134 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "cache.h"
+
+static void test_cache_key(void **);
+static void test_cache_hit(void **);
+static void test_cache_error(void **);
+
+static void test_state_nbg0_init(struct state *, uint32_t, uint32_t);
+
+/* Too large for the stack */
+static struct cycp_cache _cache;
+
+/*-
+ * Initialize STATE with NBG0 storing its pattern name data at PND_ADDR,
+ * and its character pattern data at CPD_ADDR.
+ */
+static void
+test_state_nbg0_init(struct state *state, uint32_t pnd_addr, uint32_t cpd_addr)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, pnd_addr, cpd_addr);
+
+        test_state_init(state, &format, 1, TVMD_HRESO_NORMAL_320);
+}
+
+static void
+test_cache_key(void **unused __unused)
+{
+        struct state states[3];
+
+        test_state_nbg0_init(&states[0], VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+        test_state_nbg0_init(&states[1], VRAM_ADDR_4MBIT(0, 0x04000),
+            VRAM_ADDR_4MBIT(2, 0x10000));
+        test_state_nbg0_init(&states[2], VRAM_ADDR_4MBIT(1, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        struct cycp_cache_key keys[3];
+
+        uint32_t i;
+        for (i = 0; i < 3; i++) {
+                cycp_cache_key_get(&states[i], &keys[i]);
+        }
+
+        /* Only the banks of the tables are part of the key */
+        assert_memory_equal(&keys[0], &keys[1], sizeof(struct cycp_cache_key));
+        assert_memory_not_equal(&keys[0], &keys[2], sizeof(struct cycp_cache_key));
+}
+
+static void
+test_cache_hit(void **unused __unused)
+{
+        cycp_cache_init(&_cache);
+
+        struct state states[3];
+
+        test_state_nbg0_init(&states[0], VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+        test_state_nbg0_init(&states[1], VRAM_ADDR_4MBIT(0, 0x04000),
+            VRAM_ADDR_4MBIT(2, 0x10000));
+        test_state_nbg0_init(&states[2], VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        assert_int_equal(cycp_cache_vdp2cycp(NULL, &states[0]), -1);
+        assert_int_equal(cycp_cache_vdp2cycp(&_cache, NULL), -1);
+
+        assert_int_equal(cycp_cache_vdp2cycp(&_cache, &states[0]), 0);
+        assert_int_equal(cycp_cache_vdp2cycp(&_cache, &states[1]), 0);
+        assert_int_equal(vdp2cycp(&states[2]), 0);
+
+        assert_true(states[1].solved);
+        assert_int_equal(states[1].ramctl, states[2].ramctl);
+        assert_memory_equal(&states[1].vram_cycp, &states[2].vram_cycp,
+            sizeof(union vram_cycp));
+
+        uint64_t hit_count;
+        uint64_t miss_count;
+
+        cycp_cache_counts_get(&_cache, &hit_count, &miss_count);
+
+        assert_int_equal(hit_count, 1);
+        assert_int_equal(miss_count, 1);
+}
+
+static void
+test_cache_error(void **unused __unused)
+{
+        cycp_cache_init(&_cache);
+
+        /* A cell format can't display 32,768 colors */
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        format.sf_cc_count = SCRN_CCC_RGB_32768;
+
+        struct state state;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(cycp_cache_vdp2cycp(&_cache, &state), -6);
+        assert_int_equal(cycp_cache_vdp2cycp(&_cache, &state), -6);
+        assert_false(state.solved);
+
+        uint64_t hit_count;
+        uint64_t miss_count;
+
+        cycp_cache_counts_get(&_cache, &hit_count, &miss_count);
+
+        assert_int_equal(hit_count, 1);
+        assert_int_equal(miss_count, 1);
+}
+
+int
+test_cache(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_cache_key),
+                cmocka_unit_test(test_cache_hit),
+                cmocka_unit_test(test_cache_error)
+        };
+
+        return cmocka_run_group_tests_name("cache", tests, NULL, NULL);
+}
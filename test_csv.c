@@ -0,0 +1,151 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "csv.h"
+
+static void test_csv_row(void **);
+static void test_csv_row_rejected(void **);
+static void test_csv_row_vrsize(void **);
+static void test_csv_line_blank(void **);
+
+static const char *test_row_add(struct csv_scene *, const char *, uint16_t);
+
+/*-
+ * Add the row ROW, without its line break, to the scene SCENE, with the
+ * VRAM size VRSIZE.
+ */
+static const char *
+test_row_add(struct csv_scene *scene, const char *row, uint16_t vrsize)
+{
+        return csv_scene_row_add(scene, row, row + strlen(row), vrsize);
+}
+
+static void
+test_csv_row(void **unused __unused)
+{
+        struct csv_scene scene;
+
+        memset(&scene, 0x00, sizeof(scene));
+
+        assert_null(test_row_add(&scene, "NBG1,cell,256,0x25E60000,1/2,2x2,1,"
+                "0x25E40000,0x25F00200,1,2x1,0x25E00000,0x25E02000,0x25E04000,0x25E06000",
+                0x0000));
+
+        assert_int_equal(scene.format_count, 1);
+
+        /* Addresses are stored without the cache-through bits */
+        const struct scrn_format *format;
+        format = &scene.formats[0];
+
+        assert_true(format->sf_enable);
+        assert_int_equal(format->sf_scroll_screen, SCRN_NBG1);
+        assert_int_equal(format->sf_type, SCRN_TYPE_CELL);
+        assert_int_equal(format->sf_cc_count, SCRN_CCC_PALETTE_256);
+        assert_int_equal(format->sf_vcs_table, 0x05E60000);
+        assert_int_equal(format->sf_reduction, SCRN_REDUCTION_HALF);
+
+        const struct scrn_cell_format *cell_format;
+        cell_format = &format->sf_format.cell;
+
+        assert_int_equal(cell_format->scf_character_size, 2 * 2);
+        assert_int_equal(cell_format->scf_pnd_size, 1);
+        assert_int_equal(cell_format->scf_cp_table, 0x05E40000);
+        assert_int_equal(cell_format->scf_color_palette, 0x05F00200);
+        assert_int_equal(cell_format->scf_auxiliary_mode, 1);
+        assert_int_equal(cell_format->scf_plane_size, 2 * 1);
+        assert_int_equal(cell_format->scf_map.planes[0], 0x05E00000);
+        assert_int_equal(cell_format->scf_map.planes[3], 0x05E06000);
+
+        /* Whitespace around a name is ignored, and a zero vertical cell
+         * scroll table address means it's unused */
+        assert_null(test_row_add(&scene, " NBG0 ,cell, 16 ,0,1,1x1,2,"
+                "0x05E20000,0x05F00000,0,1x1,0x05E00000,0x05E00000,0x05E00000,0x05E00000",
+                0x0000));
+
+        assert_int_equal(scene.format_count, 2);
+        assert_int_equal(scene.formats[1].sf_scroll_screen, SCRN_NBG0);
+        assert_int_equal(scene.formats[1].sf_cc_count, SCRN_CCC_PALETTE_16);
+        assert_int_equal(scene.formats[1].sf_vcs_table, 0x00000000);
+}
+
+static void
+test_csv_row_rejected(void **unused __unused)
+{
+        struct csv_scene scene;
+
+        memset(&scene, 0x00, sizeof(scene));
+
+        assert_string_equal(test_row_add(&scene, "NBG0,cell,16", 0x0000),
+            "Invalid arguments for SCRNFormat");
+        assert_string_equal(test_row_add(&scene, "NBG4,cell,16,0,1", 0x0000),
+            "Invalid scroll screen");
+        assert_string_equal(test_row_add(&scene, "NBG0,cell,17,0,1", 0x0000),
+            "Invalid character color count");
+        assert_string_equal(test_row_add(&scene, "NBG0,cell,16,0,1", 0x0000),
+            "Invalid arguments for SCRNCellFormat");
+        assert_string_equal(test_row_add(&scene, "NBG0,cell,16,0,1,1x1,1,"
+                "0x25E00000,0x25E00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000",
+                0x0000), "Color palette address is not within CRAM");
+
+        assert_int_equal(scene.format_count, 0);
+
+        /* A scroll screen appears once in a scene */
+        assert_null(test_row_add(&scene, "NBG0,cell,16,0,1,1x1,1,"
+                "0x25E00000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000",
+                0x0000));
+        assert_string_equal(test_row_add(&scene, "NBG0,cell,16,0,1,1x1,1,"
+                "0x25E00000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000",
+                0x0000), "Scroll screen appears more than once in scene");
+
+        assert_int_equal(scene.format_count, 1);
+}
+
+static void
+test_csv_row_vrsize(void **unused __unused)
+{
+        static const char row[] = "NBG0,cell,16,0,1,1x1,1,"
+            "0x25E80000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000";
+
+        struct csv_scene scene;
+
+        memset(&scene, 0x00, sizeof(scene));
+
+        /* The character pattern table is past the end of 4-Mbit VRAM */
+        assert_string_equal(test_row_add(&scene, row, 0x0000),
+            "Character pattern table address is not within VRAM");
+        assert_int_equal(scene.format_count, 0);
+
+        assert_null(test_row_add(&scene, row, VRSIZE_VRAMSZ));
+        assert_int_equal(scene.format_count, 1);
+        assert_int_equal(scene.formats[0].sf_format.cell.scf_cp_table, 0x05E80000);
+}
+
+static void
+test_csv_line_blank(void **unused __unused)
+{
+        static const char blank[] = " \t\r";
+        static const char row[] = " ,";
+
+        assert_true(csv_line_blank(blank, blank + strlen(blank)));
+        assert_true(csv_line_blank(blank, blank));
+        assert_false(csv_line_blank(row, row + strlen(row)));
+}
+
+int
+test_csv(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_csv_row),
+                cmocka_unit_test(test_csv_row_rejected),
+                cmocka_unit_test(test_csv_row_vrsize),
+                cmocka_unit_test(test_csv_line_blank)
+        };
+
+        return cmocka_run_group_tests_name("csv", tests, NULL, NULL);
+}
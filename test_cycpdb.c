@@ -0,0 +1,202 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "atlas.h"
+#include "cycpdb.h"
+
+/*-
+ * Database of the empty class, and the class of NBG0 as initialized by
+ * test_state_nbg0_init(), where only the scene of NBG0 alone, without
+ * VRAM partitioning, is feasible.
+ */
+struct test_cycpdb_blob {
+        struct cycpdb_header header;
+        struct atlas_class classes[2];
+        uint32_t words[2];
+        uint32_t ranks[1];
+        uint64_t bitmap[1];
+        uint16_t values[VRAM_BANK_COUNT];
+} __packed;
+
+static void test_cycpdb_valid(void **);
+static void test_cycpdb_magic(void **);
+static void test_cycpdb_value_index(void **);
+static void test_cycpdb_rank(void **);
+
+static void test_state_nbg0_init(struct state *);
+static void test_cycpdb_blob_init(struct test_cycpdb_blob *, const struct state *);
+
+/*-
+ * Initialize STATE with NBG0 storing its pattern name data in bank A0,
+ * and its character pattern data in bank B0.
+ */
+static void
+test_state_nbg0_init(struct state *state)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        test_state_init(state, &format, 1, TVMD_HRESO_NORMAL_320);
+}
+
+static void
+test_cycpdb_blob_init(struct test_cycpdb_blob *blob, const struct state *state)
+{
+        memset(blob, 0x00, sizeof(*blob));
+
+        (void)memcpy(blob->header.magic, CYCPDB_MAGIC, sizeof(blob->header.magic));
+        blob->header.version = CYCPDB_VERSION;
+        blob->header.class_count = 2;
+        blob->header.entry_count = 5 * ATLAS_SPLIT_COUNT;
+        blob->header.feasible_count = 1;
+        blob->header.word_count = 2;
+
+        /* 1-word pattern name data of a 16 color cell format, without
+         * reduction, takes a single access timing of each */
+        blob->classes[1].tpnd = 1;
+        blob->classes[1].tcpd = 1;
+        blob->classes[1].pnd_bitmap = 0x08;
+        blob->classes[1].cpd_bitmap = 0x02;
+
+        /* NBG0 is sorted after the three empty classes, so its accesses
+         * are stored as those of NBG3 */
+        blob->words[0] = 0x37FFFFFF;
+        blob->words[1] = TEST_PV_NO_ACCESS;
+
+        uint32_t classes[4] = {
+                0,
+                0,
+                0,
+                1
+        };
+
+        uint32_t index;
+        index = atlas_index_get(classes, state->ramctl);
+
+        blob->ranks[0] = 0;
+        blob->bitmap[0] = UINT64_C(1) << index;
+
+        blob->values[VRAM_BANK_A0] = 0;
+        blob->values[VRAM_BANK_A1] = 0;
+        blob->values[VRAM_BANK_B0] = 1;
+        blob->values[VRAM_BANK_B1] = 1;
+}
+
+static void
+test_cycpdb_valid(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state);
+
+        struct test_cycpdb_blob blob;
+
+        test_cycpdb_blob_init(&blob, &state);
+
+        struct cycpdb db;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob) - 1), -2);
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), 0);
+
+        assert_int_equal(cycpdb_lookup(&db, &state), 0);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A0], 0x04FFFFFF);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A1], 0x04FFFFFF);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B0], TEST_PV_NO_ACCESS);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B1], TEST_PV_NO_ACCESS);
+}
+
+static void
+test_cycpdb_magic(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state);
+
+        struct test_cycpdb_blob blob;
+
+        test_cycpdb_blob_init(&blob, &state);
+
+        blob.header.magic[0] = 'X';
+
+        struct cycpdb db;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+
+        test_cycpdb_blob_init(&blob, &state);
+
+        blob.header.entry_count = 4 * ATLAS_SPLIT_COUNT;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+}
+
+static void
+test_cycpdb_value_index(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state);
+
+        struct test_cycpdb_blob blob;
+
+        test_cycpdb_blob_init(&blob, &state);
+
+        blob.values[VRAM_BANK_B1] = 2;
+
+        struct cycpdb db;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+}
+
+static void
+test_cycpdb_rank(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state);
+
+        struct test_cycpdb_blob blob;
+
+        test_cycpdb_blob_init(&blob, &state);
+
+        struct cycpdb db;
+
+        /* The bit-map must agree with the number of feasible entries */
+        blob.bitmap[0] |= UINT64_C(1) << 0;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+
+        /* No bit may be set past the last entry */
+        test_cycpdb_blob_init(&blob, &state);
+
+        blob.bitmap[0] = UINT64_C(1) << (5 * ATLAS_SPLIT_COUNT);
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+
+        /* The first block is preceded by no feasible entry */
+        test_cycpdb_blob_init(&blob, &state);
+
+        blob.ranks[0] = 1;
+
+        assert_int_equal(cycpdb_init(&db, &blob, sizeof(blob)), -2);
+}
+
+int
+test_cycpdb(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_cycpdb_valid),
+                cmocka_unit_test(test_cycpdb_magic),
+                cmocka_unit_test(test_cycpdb_value_index),
+                cmocka_unit_test(test_cycpdb_rank)
+        };
+
+        return cmocka_run_group_tests_name("cycpdb", tests, NULL, NULL);
+}
@@ -0,0 +1,216 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "layout.h"
+
+static void test_layout_tables(void **);
+static void test_layout_rejected(void **);
+static void test_layout_constrained(void **);
+static void test_layout_infeasible(void **);
+
+static void test_scene_init(struct csv_scene *, const struct scrn_format *, uint32_t);
+
+/*-
+ * Initialize SCENE with the COUNT formats FORMATS.
+ */
+static void
+test_scene_init(struct csv_scene *scene, const struct scrn_format *formats, uint32_t count)
+{
+        memset(scene, 0x00, sizeof(*scene));
+
+        scene->format_count = count;
+
+        (void)memcpy(scene->formats, formats, count * sizeof(struct scrn_format));
+}
+
+static void
+test_layout_tables(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        struct csv_scene scene;
+
+        test_scene_init(&scene, &format, 1);
+
+        struct layout_constraints constraints;
+
+        layout_constraints_init(&constraints);
+
+        struct layout layout;
+
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), 0);
+
+        /* A plane of 64x64 1-word cells */
+        const struct layout_table *table;
+        table = &layout.tables[SCRN_NBG0][CYCP_DEMAND_PND];
+
+        assert_int_equal(table->size, 0x2000);
+        assert_int_equal(table->alignment, 0x2000);
+        assert_int_equal(table->count, 1);
+        assert_int_equal(table->offset, 0x00000);
+        assert_int_equal(table->bank_bitmap, 0x0F);
+
+        /* 1024 cells of 16 colors */
+        table = &layout.tables[SCRN_NBG0][CYCP_DEMAND_CPD];
+
+        assert_int_equal(table->size, 0x8000);
+        assert_int_equal(table->alignment, 0x20);
+        assert_int_equal(table->count, 1);
+        assert_int_equal(table->offset, 0x40000);
+
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_VCS].size, 0);
+        assert_int_equal(layout.tables[SCRN_NBG1][CYCP_DEMAND_PND].size, 0);
+
+        /* The character pattern table of a cell format may shrink, but
+         * the planes may only grow */
+        constraints.sizes[SCRN_NBG0][CYCP_DEMAND_PND] = 0x1000;
+        constraints.sizes[SCRN_NBG0][CYCP_DEMAND_CPD] = 0x4000;
+        constraints.bank_bitmaps[SCRN_NBG0][CYCP_DEMAND_CPD] = VRAM_BANK_BIT(VRAM_BANK_B1);
+
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), 0);
+
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_PND].size, 0x2000);
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_CPD].size, 0x4000);
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_CPD].bank_bitmap,
+            VRAM_BANK_BIT(VRAM_BANK_B1));
+}
+
+static void
+test_layout_rejected(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_RBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        struct csv_scene scene;
+
+        test_scene_init(&scene, &format, 1);
+
+        struct layout_constraints constraints;
+
+        layout_constraints_init(&constraints);
+
+        struct layout layout;
+
+        assert_int_equal(layout_init(NULL, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), -1);
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), -2);
+
+        /* A cell format can't display 32,768 colors */
+        test_format_cell_init(&scene.formats[0], SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        scene.formats[0].sf_cc_count = SCRN_CCC_RGB_32768;
+
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), -3);
+
+        assert_int_equal(layout_solve(NULL), -1);
+}
+
+static void
+test_layout_constrained(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(0, 0x02000));
+
+        struct csv_scene scene;
+
+        test_scene_init(&scene, &format, 1);
+
+        struct layout_constraints constraints;
+
+        layout_constraints_init(&constraints);
+
+        constraints.bank_bitmaps[SCRN_NBG0][CYCP_DEMAND_PND] = VRAM_BANK_BIT(VRAM_BANK_B1);
+        constraints.bank_bitmaps[SCRN_NBG0][CYCP_DEMAND_CPD] = VRAM_BANK_BIT(VRAM_BANK_A0);
+
+        struct layout layout;
+
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), 0);
+        assert_int_equal(layout_solve(&layout), 0);
+
+        /* The planes are placed at the end of bank B1, leaving the
+         * largest free region between the tables */
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_PND].offset, 0x7E000);
+        assert_int_equal(layout.tables[SCRN_NBG0][CYCP_DEMAND_CPD].offset, 0x00000);
+        assert_int_equal(layout.formats[0].sf_format.cell.scf_map.planes[0],
+            VRAM_ADDR_4MBIT(0, 0x7E000));
+        assert_int_equal(layout.formats[0].sf_format.cell.scf_map.planes[3],
+            VRAM_ADDR_4MBIT(0, 0x7E000));
+        assert_int_equal(layout.formats[0].sf_format.cell.scf_cp_table,
+            VRAM_ADDR_4MBIT(0, 0x00000));
+        assert_int_equal(layout.free_size, 0x76000);
+
+        /* Both VRAM-A and VRAM-B are partitioned, so that only a single
+         * access timing of each of A0 and B1 is taken */
+        assert_int_equal(layout.ramctl, RAMCTL_VRAMD | RAMCTL_VRBMD);
+        assert_int_equal(layout.vram_cycp.pv[VRAM_BANK_A0], 0xEEEEEEE4);
+        assert_int_equal(layout.vram_cycp.pv[VRAM_BANK_A1], 0xEEEEEEEE);
+        assert_int_equal(layout.vram_cycp.pv[VRAM_BANK_B0], 0xEEEEEEEE);
+        assert_int_equal(layout.vram_cycp.pv[VRAM_BANK_B1], 0xEEEEEEE0);
+        assert_int_equal(layout.free_count, 30);
+        assert_int_equal(layout.solve_count, 1);
+}
+
+static void
+test_layout_infeasible(void **unused __unused)
+{
+        struct scrn_format formats[4];
+
+        uint8_t scrn;
+        for (scrn = SCRN_NBG0; scrn <= SCRN_NBG3; scrn++) {
+                test_format_cell_init(&formats[scrn], scrn, VRAM_ADDR_4MBIT(0, 0x00000),
+                    VRAM_ADDR_4MBIT(0, 0x00000));
+
+                formats[scrn].sf_cc_count = SCRN_CCC_PALETTE_256;
+        }
+
+        struct csv_scene scene;
+
+        test_scene_init(&scene, formats, 4);
+
+        struct layout_constraints constraints;
+
+        layout_constraints_init(&constraints);
+
+        /* Every table in bank A0 requires 12 access timings of it */
+        memset(constraints.bank_bitmaps, VRAM_BANK_BIT(VRAM_BANK_A0),
+            sizeof(constraints.bank_bitmaps));
+
+        struct layout layout;
+
+        assert_int_equal(layout_init(&layout, &scene, &constraints, TVMD_HRESO_NORMAL_320,
+                0x0000), 0);
+        assert_int_equal(layout_solve(&layout), -2);
+        assert_int_equal(layout.solve_count, 0);
+}
+
+int
+test_layout(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_layout_tables),
+                cmocka_unit_test(test_layout_rejected),
+                cmocka_unit_test(test_layout_constrained),
+                cmocka_unit_test(test_layout_infeasible)
+        };
+
+        return cmocka_run_group_tests_name("layout", tests, NULL, NULL);
+}
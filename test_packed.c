@@ -0,0 +1,228 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#include "packed.h"
+
+static void test_packed_round_trip(void **);
+static void test_packed_rejected(void **);
+static void test_packed_corpus(void **);
+
+static void test_format_init(struct scrn_format *);
+static void test_path_create(char *, const void *, size_t);
+
+/*-
+ * Initialize FORMAT with NBG1 of 256 colors at 1/2 reduction, that uses
+ * vertical cell scroll, storing its pattern name data in bank A0, and its
+ * character pattern data in bank B0.
+ */
+static void
+test_format_init(struct scrn_format *format)
+{
+        test_format_cell_init(format, SCRN_NBG1, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        format->sf_cc_count = SCRN_CCC_PALETTE_256;
+        format->sf_reduction = SCRN_REDUCTION_HALF;
+        format->sf_vcs_table = VRAM_ADDR_4MBIT(1, 0x00000);
+
+        struct scrn_cell_format *cell_format;
+        cell_format = &format->sf_format.cell;
+
+        cell_format->scf_character_size = 2 * 2;
+        cell_format->scf_auxiliary_mode = 1;
+        cell_format->scf_plane_size = 2 * 1;
+        cell_format->scf_color_palette = 0x25F00200;
+        cell_format->scf_map.planes[1] = VRAM_ADDR_4MBIT(0, 0x02000);
+}
+
+/*-
+ * Create a temporary file holding the SIZE bytes of DATA, and write its
+ * path to PATH, which holds at least 32 bytes.
+ */
+static void
+test_path_create(char *path, const void *data, size_t size)
+{
+        (void)strcpy(path, "/tmp/test_packed.XXXXXX");
+
+        int fd;
+        fd = mkstemp(path);
+
+        assert_true(fd >= 0);
+        assert_int_equal(write(fd, data, size), size);
+
+        (void)close(fd);
+}
+
+static void
+test_packed_round_trip(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_init(&format);
+
+        struct scrn_packed_format packed;
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), 0);
+
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_SCROLL_SCREEN), SCRN_NBG1);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_REGION), 0x2);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_PLANE_B), 0x02000);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_CP_TABLE), 0x40000);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_COLOR_PALETTE), 0x00200);
+
+        /* The access timings and banks vdp2cycp() reads */
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_TVCS), 1);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_TPND), 2);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_TCPD), 4);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_VCS_BITMAP),
+            VRAM_BANK_BIT(VRAM_BANK_A1));
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_PND_BITMAP),
+            VRAM_BANK_BIT(VRAM_BANK_A0));
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_CPD_BITMAP),
+            VRAM_BANK_BIT(VRAM_BANK_B0));
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_ERROR), 0);
+
+        struct scrn_format unpacked;
+
+        assert_int_equal(scrn_packed_unpack(&packed, &unpacked), 0);
+        assert_memory_equal(&unpacked, &format, sizeof(format));
+
+        /* The error of a format vdp2cycp() rejects is packed instead */
+        format.sf_cc_count = SCRN_CCC_RGB_32768;
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), 0);
+        assert_int_equal(SCRN_PACKED_GET(&packed, SCRN_PACKED_ERROR), 6);
+
+        /* A disabled scroll screen is packed as all zeroes */
+        format.sf_enable = false;
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), 0);
+        assert_int_equal(packed.spf_words[0], 0);
+        assert_int_equal(packed.spf_words[3], 0);
+}
+
+static void
+test_packed_rejected(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_init(&format);
+
+        struct scrn_packed_format packed;
+
+        assert_int_equal(scrn_packed_pack(NULL, &packed), -1);
+        assert_int_equal(scrn_packed_unpack(&packed, NULL), -1);
+
+        /* The lead addresses share the same cache region */
+        format.sf_format.cell.scf_map.planes[3] = 0x05E00000;
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), -2);
+
+        /* Only the first 4 planes are packed */
+        test_format_init(&format);
+
+        format.sf_format.cell.scf_map.planes[4] = VRAM_ADDR_4MBIT(0, 0x00000);
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), -2);
+
+        test_format_init(&format);
+
+        format.sf_format.cell.scf_color_palette = VRAM_ADDR_4MBIT(0, 0x00000);
+
+        assert_int_equal(scrn_packed_pack(&format, &packed), -2);
+}
+
+static void
+test_packed_corpus(void **unused __unused)
+{
+        struct csv_scene scenes[2];
+
+        memset(scenes, 0x00, sizeof(scenes));
+
+        scenes[0].line = 2;
+        scenes[0].format_count = 1;
+
+        test_format_init(&scenes[0].formats[0]);
+
+        scenes[1].line = 4;
+        scenes[1].format_count = 2;
+
+        test_format_cell_init(&scenes[1].formats[0], SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+        test_format_cell_init(&scenes[1].formats[1], SCRN_NBG2, VRAM_ADDR_4MBIT(1, 0x00000),
+            VRAM_ADDR_4MBIT(3, 0x00000));
+
+        scenes[1].formats[0].sf_format.cell.scf_color_palette = 0x25F00000;
+        scenes[1].formats[1].sf_format.cell.scf_color_palette = 0x25F00000;
+
+        /* A cell format can't display 32,768 colors */
+        scenes[1].formats[1].sf_cc_count = SCRN_CCC_RGB_32768;
+
+        char path[32];
+
+        test_path_create(path, "", 0);
+
+        assert_int_equal(packed_corpus_write(path, scenes, 2), 0);
+
+        struct packed_corpus corpus;
+
+        assert_int_equal(packed_corpus_open(&corpus, path), 0);
+        assert_int_equal(corpus.scene_count, 2);
+        assert_int_equal(corpus.format_count, 3);
+        assert_int_equal(corpus.lines[1], 4);
+
+        struct csv_scene scene;
+
+        assert_int_equal(packed_corpus_scene_get(&corpus, 2, &scene), -1);
+        assert_int_equal(packed_corpus_scene_get(&corpus, 1, &scene), 0);
+        assert_int_equal(scene.format_count, 2);
+        assert_memory_equal(scene.formats, scenes[1].formats, 2 * sizeof(struct scrn_format));
+
+        union vram_cycp vram_cycp[2];
+        int32_t results[2];
+
+        assert_int_equal(packed_corpus_solve(&corpus, vram_cycp, NULL, results), 0);
+
+        /* As vdp2cycp() calculates them */
+        struct state state;
+
+        test_state_init(&state, scenes[0].formats, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+        assert_int_equal(results[0], 0);
+        assert_memory_equal(&vram_cycp[0], &state.vram_cycp, sizeof(union vram_cycp));
+        assert_int_equal(results[1], -6);
+
+        packed_corpus_close(&corpus);
+
+        (void)unlink(path);
+
+        /* A file that is not a corpus */
+        test_path_create(path, "Scroll screen,Format\n", 21);
+
+        assert_int_equal(packed_corpus_open(&corpus, path), -3);
+
+        (void)unlink(path);
+
+        assert_int_equal(packed_corpus_open(&corpus, path), -2);
+}
+
+int
+test_packed(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_packed_round_trip),
+                cmocka_unit_test(test_packed_rejected),
+                cmocka_unit_test(test_packed_corpus)
+        };
+
+        return cmocka_run_group_tests_name("packed", tests, NULL, NULL);
+}
@@ -0,0 +1,275 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "schedule.h"
+
+static void test_schedule_invalid(void **);
+static void test_schedule_segments(void **);
+static void test_schedule_unchanged(void **);
+static void test_schedule_failed(void **);
+static void test_delta_runs(void **);
+
+static void test_state_nbgs_init(struct state *, uint32_t, uint16_t);
+
+/*-
+ * Initialize STATE with the first COUNT of NBG0, storing its pattern
+ * name data in bank A0, and its character pattern data in bank B0, and
+ * NBG1, storing them in banks A1 and B1, in the TV screen mode TVMD.
+ */
+static void
+test_state_nbgs_init(struct state *state, uint32_t count, uint16_t tvmd)
+{
+        struct scrn_format formats[2];
+
+        test_format_cell_init(&formats[0], SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+        test_format_cell_init(&formats[1], SCRN_NBG1, VRAM_ADDR_4MBIT(1, 0x00000),
+            VRAM_ADDR_4MBIT(3, 0x00000));
+
+        test_state_init(state, formats, count, tvmd);
+}
+
+static void
+test_schedule_invalid(void **unused __unused)
+{
+        struct state states[2];
+
+        test_state_nbgs_init(&states[0], 1, TVMD_HRESO_NORMAL_320);
+        test_state_nbgs_init(&states[1], 2, TVMD_HRESO_NORMAL_320);
+
+        struct cycp_segment segments[2] = {
+                {
+                        .line = 0,
+                        .state = &states[0]
+                },
+                {
+                        .line = 0,
+                        .state = &states[1]
+                }
+        };
+
+        struct cycp_write writes[2];
+        size_t write_count;
+
+        assert_int_equal(cycp_schedule_solve(NULL, 2, writes, &write_count), -1);
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, NULL), -1);
+
+        /* Segments start on distinct scanlines, in order */
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), -2);
+
+        segments[1].line = 100;
+        states[1].tvmd = TVMD_HRESO_HIRES_640;
+
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), -2);
+
+        segments[1].state = NULL;
+
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), -1);
+}
+
+static void
+test_schedule_segments(void **unused __unused)
+{
+        struct state states[2];
+
+        test_state_nbgs_init(&states[0], 1, TVMD_HRESO_NORMAL_320);
+        test_state_nbgs_init(&states[1], 2, TVMD_HRESO_NORMAL_320);
+
+        states[0].ramctl = RAMCTL_VRAMD | RAMCTL_VRBMD;
+        states[1].ramctl = RAMCTL_VRAMD | RAMCTL_VRBMD;
+
+        struct cycp_segment segments[2] = {
+                {
+                        .line = 0,
+                        .state = &states[0]
+                },
+                {
+                        .line = 100,
+                        .state = &states[1]
+                }
+        };
+
+        struct cycp_write writes[2];
+        size_t write_count;
+
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), 0);
+        assert_int_equal(segments[0].result, 0);
+        assert_int_equal(segments[1].result, 0);
+
+        /* NBG1 takes access timings of banks A1 and B1 only, so the
+         * access timings of NBG0 are kept */
+        assert_int_equal(states[0].ramctl, RAMCTL_VRAMD | RAMCTL_VRBMD);
+        assert_int_equal(states[0].vram_cycp.pv[VRAM_BANK_A0], TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0));
+        assert_int_equal(states[0].vram_cycp.pv[VRAM_BANK_A1], TEST_PV_NO_ACCESS);
+        assert_int_equal(states[0].vram_cycp.pv[VRAM_BANK_B0],
+            TEST_PV(0, VRAM_CTL_CYCP_CHPNDR_NBG0));
+        assert_int_equal(states[0].vram_cycp.pv[VRAM_BANK_B1], TEST_PV_NO_ACCESS);
+
+        assert_int_equal(states[1].vram_cycp.pv[VRAM_BANK_A0], TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0));
+        assert_int_equal(states[1].vram_cycp.pv[VRAM_BANK_A1], TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG1));
+        assert_int_equal(states[1].vram_cycp.pv[VRAM_BANK_B0],
+            TEST_PV(0, VRAM_CTL_CYCP_CHPNDR_NBG0));
+        assert_int_equal(states[1].vram_cycp.pv[VRAM_BANK_B1],
+            TEST_PV(0, VRAM_CTL_CYCP_CHPNDR_NBG1));
+
+        /* The first segment writes RAMCTL through CYCB1U */
+        static const uint16_t first_values[] = {
+                RAMCTL_VRAMD | RAMCTL_VRBMD,
+                0x0FFF,
+                0xFFFF,
+                0xFFFF,
+                0xFFFF,
+                0x4FFF,
+                0xFFFF,
+                0xFFFF,
+                0xFFFF
+        };
+
+        /* The second writes CYCA1L through CYCB1L in a single transfer,
+         * along with the registers between them that don't change */
+        static const uint16_t second_values[] = {
+                0x1FFF,
+                0xFFFF,
+                0x4FFF,
+                0xFFFF,
+                0x5FFF
+        };
+
+        assert_int_equal(write_count, 2);
+
+        assert_int_equal(writes[0].line, 0);
+        assert_int_equal(writes[0].reg, VDP2_REG_RAMCTL);
+        assert_int_equal(writes[0].count, VDP2_REG_CYCP_COUNT);
+        assert_memory_equal(writes[0].values, first_values, sizeof(first_values));
+
+        assert_int_equal(writes[1].line, 100);
+        assert_int_equal(writes[1].reg, VDP2_REG_CYCA1L);
+        assert_int_equal(writes[1].count, 5);
+        assert_memory_equal(writes[1].values, second_values, sizeof(second_values));
+}
+
+static void
+test_schedule_unchanged(void **unused __unused)
+{
+        struct state states[2];
+
+        test_state_nbgs_init(&states[0], 2, TVMD_HRESO_NORMAL_320);
+        test_state_nbgs_init(&states[1], 2, TVMD_HRESO_NORMAL_320);
+
+        struct cycp_segment segments[2] = {
+                {
+                        .line = 0,
+                        .state = &states[0]
+                },
+                {
+                        .line = 120,
+                        .state = &states[1]
+                }
+        };
+
+        struct cycp_write writes[2];
+        size_t write_count;
+
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), 0);
+
+        /* No register changes, so the second segment writes nothing */
+        assert_int_equal(write_count, 1);
+        assert_int_equal(writes[0].line, 0);
+        assert_int_equal(writes[0].count, VDP2_REG_CYCP_COUNT);
+        assert_memory_equal(&states[1].vram_cycp, &states[0].vram_cycp,
+            sizeof(union vram_cycp));
+}
+
+static void
+test_schedule_failed(void **unused __unused)
+{
+        struct state states[2];
+
+        test_state_nbgs_init(&states[0], 1, TVMD_HRESO_NORMAL_320);
+        test_state_nbgs_init(&states[1], 1, TVMD_HRESO_NORMAL_320);
+
+        struct cycp_segment segments[2] = {
+                {
+                        .line = 0,
+                        .state = &states[0]
+                },
+                {
+                        .line = 200,
+                        .state = &states[1]
+                }
+        };
+
+        /* A cell format can't display 32,768 colors */
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        format.sf_cc_count = SCRN_CCC_RGB_32768;
+
+        test_state_init(&states[1], &format, 1, TVMD_HRESO_NORMAL_320);
+
+        struct cycp_write writes[2];
+        size_t write_count;
+
+        assert_int_equal(cycp_schedule_solve(segments, 2, writes, &write_count), -3);
+        assert_int_equal(segments[0].result, 0);
+        assert_int_equal(segments[1].result, -6);
+
+        /* The writes of the segments before it are kept */
+        assert_int_equal(write_count, 1);
+}
+
+static void
+test_delta_runs(void **unused __unused)
+{
+        struct state states[2];
+
+        test_state_nbgs_init(&states[0], 1, TVMD_HRESO_NORMAL_320);
+        test_state_nbgs_init(&states[1], 2, TVMD_HRESO_NORMAL_320);
+
+        states[0].ramctl = RAMCTL_VRAMD | RAMCTL_VRBMD;
+        states[1].ramctl = RAMCTL_VRAMD | RAMCTL_VRBMD;
+
+        struct cycp_write writes[1 + CYCP_DELTA_WRITE_COUNT];
+        size_t write_count;
+
+        assert_int_equal(cycp_delta_solve(states, 2, writes, &write_count), 0);
+
+        /* Each run of registers that changes is written on its own */
+        assert_int_equal(write_count, 3);
+
+        assert_int_equal(writes[0].line, 0);
+        assert_int_equal(writes[0].reg, VDP2_REG_RAMCTL);
+        assert_int_equal(writes[0].count, VDP2_REG_CYCP_COUNT);
+
+        assert_int_equal(writes[1].line, 1);
+        assert_int_equal(writes[1].reg, VDP2_REG_CYCA1L);
+        assert_int_equal(writes[1].count, 1);
+        assert_int_equal(writes[1].values[0], 0x1FFF);
+
+        assert_int_equal(writes[2].line, 1);
+        assert_int_equal(writes[2].reg, VDP2_REG_CYCB1L);
+        assert_int_equal(writes[2].count, 1);
+        assert_int_equal(writes[2].values[0], 0x5FFF);
+}
+
+int
+test_schedule(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_schedule_invalid),
+                cmocka_unit_test(test_schedule_segments),
+                cmocka_unit_test(test_schedule_unchanged),
+                cmocka_unit_test(test_schedule_failed),
+                cmocka_unit_test(test_delta_runs)
+        };
+
+        return cmocka_run_group_tests_name("schedule", tests, NULL, NULL);
+}
@@ -0,0 +1,130 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#include "server.h"
+
+static void test_server_scenes(void **);
+static void test_server_invalid(void **);
+
+static void test_server_serve(const char *, char *, size_t);
+
+/*-
+ * Serve the scenes of INPUT over a pipe, and write the solutions read
+ * back to OUTPUT of SIZE bytes.
+ */
+static void
+test_server_serve(const char *input, char *output, size_t size)
+{
+        struct server server;
+
+        assert_int_equal(server_init(&server, TVMD_HRESO_NORMAL_320, 0x0000), 0);
+
+        int in_fds[2];
+        int out_fds[2];
+
+        assert_int_equal(pipe(in_fds), 0);
+        assert_int_equal(pipe(out_fds), 0);
+
+        /* Both fit in a pipe, so the input is written before it's served,
+         * and the output read after */
+        assert_int_equal(write(in_fds[1], input, strlen(input)), strlen(input));
+
+        (void)close(in_fds[1]);
+
+        assert_int_equal(server_serve(&server, in_fds[0], out_fds[1]), 0);
+
+        (void)close(in_fds[0]);
+        (void)close(out_fds[1]);
+
+        ssize_t length;
+        length = read(out_fds[0], output, size - 1);
+
+        assert_true(length >= 0);
+
+        output[length] = '\0';
+
+        (void)close(out_fds[0]);
+
+        server_deinit(&server);
+}
+
+static void
+test_server_scenes(void **unused __unused)
+{
+        static const char input[] =
+            "Scroll screen,Format,Character color count\n"
+            "NBG0,cell,16,0,1,1x1,1,"
+            "0x25E40000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000\n"
+            "\n"
+            "NBG0,cell,32768,0,1,1x1,1,"
+            "0x25E40000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000\n"
+            "\n"
+            "NBG0,cell,16,0,1,1x1,1,"
+            "0x25E40000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000\n";
+
+        /* The last scene ends with the input, without a blank line */
+        static const char solutions[] =
+            "CYCA0: 0xFFFFFFF0\n"
+            "CYCA1: 0xFFFFFFF0\n"
+            "CYCB0: 0xFFFFFFF4\n"
+            "CYCB1: 0xFFFFFFF4\n"
+            "\n"
+            "error: Unable to calculate cycle patterns (-6)\n"
+            "\n"
+            "CYCA0: 0xFFFFFFF0\n"
+            "CYCA1: 0xFFFFFFF0\n"
+            "CYCB0: 0xFFFFFFF4\n"
+            "CYCB1: 0xFFFFFFF4\n"
+            "\n";
+
+        char output[512];
+
+        test_server_serve(input, output, sizeof(output));
+
+        assert_string_equal(output, solutions);
+}
+
+static void
+test_server_invalid(void **unused __unused)
+{
+        static const char input[] =
+            "NBG0,cell,17\n"
+            "\n"
+            "NBG0,cell,16,0,1,1x1,1,"
+            "0x25E40000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000\n"
+            "NBG0,cell,16,0,1,1x1,1,"
+            "0x25E40000,0x25F00000,0,1x1,0x25E00000,0x25E00000,0x25E00000,0x25E00000\n"
+            "\n";
+
+        static const char solutions[] =
+            "error: Line 1: Invalid arguments for SCRNFormat\n"
+            "\n"
+            "error: Line 4: Scroll screen appears more than once in scene\n"
+            "\n";
+
+        char output[512];
+
+        test_server_serve(input, output, sizeof(output));
+
+        assert_string_equal(output, solutions);
+
+        assert_int_equal(server_serve(NULL, 0, 1), -1);
+}
+
+int
+test_server(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_server_scenes),
+                cmocka_unit_test(test_server_invalid)
+        };
+
+        return cmocka_run_group_tests_name("server", tests, NULL, NULL);
+}
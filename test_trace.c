@@ -0,0 +1,118 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "trace.h"
+
+static void test_trace_ring(void **);
+static void test_trace_ring_wrapped(void **);
+static void test_trace_event_format(void **);
+
+static void
+test_trace_ring(void **unused __unused)
+{
+        trace_ring_reset();
+
+        trace_ring_record(TRACE_SOLVE_BEGIN, 0x0300, 0);
+        trace_ring_record(TRACE_NODE, 1, 0x0105);
+        trace_ring_record(TRACE_SOLVE_END, 0, 0);
+
+        struct trace_event events[4];
+
+        /* The last events are copied, from the oldest to the newest */
+        assert_int_equal(trace_ring_copy(events, 2), 2);
+        assert_int_equal(events[0].sequence, 1);
+        assert_int_equal(events[0].event, TRACE_NODE);
+        assert_int_equal(events[0].a, 1);
+        assert_int_equal(events[0].b, 0x0105);
+        assert_int_equal(events[1].sequence, 2);
+        assert_int_equal(events[1].event, TRACE_SOLVE_END);
+
+        assert_int_equal(trace_ring_copy(events, 4), 3);
+        assert_int_equal(events[0].event, TRACE_SOLVE_BEGIN);
+        assert_int_equal(events[0].a, 0x0300);
+
+        trace_ring_reset();
+
+        assert_int_equal(trace_ring_copy(events, 4), 0);
+}
+
+static void
+test_trace_ring_wrapped(void **unused __unused)
+{
+        trace_ring_reset();
+
+        uint32_t i;
+        for (i = 0; i < (TRACE_RING_SIZE + 2); i++) {
+                trace_ring_record(TRACE_NODE, i, 0);
+        }
+
+        /* The two oldest events are recorded over */
+        static struct trace_event events[TRACE_RING_SIZE + 1];
+
+        assert_int_equal(trace_ring_copy(events, TRACE_RING_SIZE + 1), TRACE_RING_SIZE);
+        assert_int_equal(events[0].sequence, 2);
+        assert_int_equal(events[0].a, 2);
+        assert_int_equal(events[TRACE_RING_SIZE - 1].a, TRACE_RING_SIZE + 1);
+
+        trace_ring_reset();
+}
+
+static void
+test_trace_event_format(void **unused __unused)
+{
+        char text[TRACE_EVENT_TEXT_SIZE];
+
+        struct trace_event event;
+
+        memset(&event, 0x00, sizeof(event));
+
+        event.event = TRACE_BITMAPS;
+        event.a = SCRN_NBG1;
+        event.b = (VRAM_BANK_BIT(VRAM_BANK_A1) << 8) |
+            ((VRAM_BANK_BIT(VRAM_BANK_B0) | VRAM_BANK_BIT(VRAM_BANK_B1)) << 16);
+
+        assert_int_equal(trace_event_format(&event, text, sizeof(text)), 0);
+        assert_string_equal(text,
+            "  NBG1: banks VCS -, PND A1, CPD B0+B1, coefficient -");
+
+        event.event = TRACE_NODE;
+        event.a = 3;
+        event.b = (VRAM_BANK_B0 << 8) | 0x13;
+
+        assert_int_equal(trace_event_format(&event, text, sizeof(text)), 0);
+        assert_string_equal(text, "    item 3: bank B0, T0 T1 T4");
+
+        event.event = TRACE_SOLVE_END;
+        event.a = (uint32_t)-6;
+
+        assert_int_equal(trace_event_format(&event, text, sizeof(text)), 0);
+        assert_string_equal(text, "solve: returned -6");
+
+        /* The arguments of an event not known are still written */
+        event.event = TRACE_EVENT_COUNT;
+        event.a = 1;
+        event.b = 2;
+
+        assert_int_equal(trace_event_format(&event, text, sizeof(text)), -2);
+        assert_string_equal(text, "event 8: 0x00000001, 0x00000002");
+
+        assert_int_equal(trace_event_format(NULL, text, sizeof(text)), -1);
+}
+
+int
+test_trace(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_trace_ring),
+                cmocka_unit_test(test_trace_ring_wrapped),
+                cmocka_unit_test(test_trace_event_format)
+        };
+
+        return cmocka_run_group_tests_name("trace", tests, NULL, NULL);
+}
@@ -0,0 +1,715 @@
+#include <sys/cdefs.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+static void test_validate_solution(void **);
+static void test_validate_pnd_halved(void **);
+static void test_validate_reserved(void **);
+static void test_validate_pairs(void **);
+static void test_update_coefficient_move(void **);
+static void test_alloc_four_nbgs(void **);
+static void test_alloc_four_nbgs_hires(void **);
+static void test_alloc_range_conflict(void **);
+static void test_cpd_bitmap_extent(void **);
+static void test_batch_validate(void **);
+static void test_optimize_partition(void **);
+static void test_simulate_cell_count(void **);
+static void test_registers_block(void **);
+static void test_explain_conflict(void **);
+static void test_vrsize_banks(void **);
+
+static void test_state_nbgs_init(struct state *, uint32_t, uint8_t, uint16_t);
+static void test_vram_cycp_assert(const union vram_cycp *, uint32_t, uint32_t);
+
+/*-
+ * Initialize STATE with NBG0 storing its pattern name data in bank A0,
+ * and its character pattern data in bank B0, in the TV screen mode TVMD.
+ */
+static void
+test_state_nbg0_init(struct state *state, uint16_t tvmd)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        test_state_init(state, &format, 1, tvmd);
+}
+
+/*-
+ * Initialize STATE with COUNT NBGs, each with CC_COUNT colors, storing
+ * their pattern name data in bank A0, and their character pattern data
+ * in bank B0, in the TV screen mode TVMD.
+ */
+static void
+test_state_nbgs_init(struct state *state, uint32_t count, uint8_t cc_count, uint16_t tvmd)
+{
+        struct scrn_format formats[4];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < count; scrn++) {
+                test_format_cell_init(&formats[scrn], scrn, VRAM_ADDR_4MBIT(0, 0x00000),
+                    VRAM_ADDR_4MBIT(2, 0x00000));
+
+                formats[scrn].sf_cc_count = cc_count;
+        }
+
+        test_state_init(state, formats, count, tvmd);
+}
+
+/*-
+ * Assert that the cycle patterns VRAM_CYCP of VRAM-A and VRAM-B, which
+ * are not partitioned, are A and B, respectively.
+ */
+static void
+test_vram_cycp_assert(const union vram_cycp *vram_cycp, uint32_t a, uint32_t b)
+{
+        assert_int_equal(vram_cycp->pv[VRAM_BANK_A0], a);
+        assert_int_equal(vram_cycp->pv[VRAM_BANK_A1], a);
+        assert_int_equal(vram_cycp->pv[VRAM_BANK_B0], b);
+        assert_int_equal(vram_cycp->pv[VRAM_BANK_B1], b);
+}
+
+static void
+test_validate_solution(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+
+        int8_t result;
+
+        assert_int_equal(vdp2cycp_validate(&state, &state.vram_cycp, 1, &result), 0);
+        assert_int_equal(result, 0);
+}
+
+/* Pattern name data read at T4, which the hi-res TV screen modes lack */
+static void
+test_validate_pnd_halved(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_HIRES_640);
+
+        union vram_cycp vram_cycp;
+
+        vram_cycp.pv[VRAM_BANK_A0] = TEST_PV(4, VRAM_CTL_CYCP_PNDR_NBG0);
+        vram_cycp.pv[VRAM_BANK_A1] = TEST_PV_NO_ACCESS;
+        vram_cycp.pv[VRAM_BANK_B0] = TEST_PV(0, VRAM_CTL_CYCP_CHPNDR_NBG0);
+        vram_cycp.pv[VRAM_BANK_B1] = TEST_PV_NO_ACCESS;
+
+        int8_t result;
+
+        assert_int_equal(vdp2cycp_validate(&state, &vram_cycp, 1, &result), 0);
+        assert_int_equal(result, -5);
+
+        /* The same read at T0 is valid */
+        vram_cycp.pv[VRAM_BANK_A0] = TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0);
+
+        assert_int_equal(vdp2cycp_validate(&state, &vram_cycp, 1, &result), 0);
+        assert_int_equal(result, 0);
+}
+
+static void
+test_validate_reserved(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+
+        union vram_cycp vram_cycp;
+        vram_cycp = state.vram_cycp;
+
+        vram_cycp.pv[VRAM_BANK_B0] &= ~VRAM_CTL_CYCP_TIMING_MASK(7);
+        vram_cycp.pv[VRAM_BANK_B0] |= UINT32_C(0x8) << VRAM_CTL_CYCP_TIMING_BIT(7);
+
+        int8_t result;
+
+        assert_int_equal(vdp2cycp_validate(&state, &vram_cycp, 1, &result), 0);
+        assert_int_equal(result, -7);
+}
+
+/* Patterns validated together, two at a time where the CPU supports it,
+ * give the same results as each validated alone */
+static void
+test_validate_pairs(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+
+        union vram_cycp patterns[5];
+
+        uint32_t i;
+        for (i = 0; i < 5; i++) {
+                patterns[i] = state.vram_cycp;
+        }
+
+        /* No pattern name data read */
+        patterns[1].pv[VRAM_BANK_A0] = TEST_PV_NO_ACCESS;
+        /* Reserved access code */
+        patterns[2].pv[VRAM_BANK_A0] = TEST_PV(7, 0x9);
+        /* No character pattern data read */
+        patterns[4].pv[VRAM_BANK_B0] = TEST_PV_NO_ACCESS;
+
+        int8_t results[5];
+
+        assert_int_equal(vdp2cycp_validate(&state, patterns, 5, results), 0);
+
+        static const int8_t expected[5] = {
+                0,
+                -5,
+                -7,
+                0,
+                -6
+        };
+
+        for (i = 0; i < 5; i++) {
+                int8_t result;
+
+                assert_int_equal(vdp2cycp_validate(&state, &patterns[i], 1, &result), 0);
+                assert_int_equal(result, expected[i]);
+                assert_int_equal(results[i], expected[i]);
+        }
+}
+
+/* Moving the coefficient table of RBG0 changes none of the demands of
+ * the NBGs, but changes the banks reserved for it */
+static void
+test_update_coefficient_move(void **unused __unused)
+{
+        struct scrn_format formats[2];
+
+        memset(&formats[0], 0x00, sizeof(formats[0]));
+
+        formats[0].sf_enable = true;
+        formats[0].sf_scroll_screen = SCRN_RBG0;
+        formats[0].sf_type = SCRN_TYPE_BITMAP;
+        formats[0].sf_cc_count = SCRN_CCC_PALETTE_256;
+        formats[0].sf_coefficient_table = VRAM_ADDR_4MBIT(3, 0x00000);
+        formats[0].sf_reduction = SCRN_REDUCTION_NONE;
+        formats[0].sf_format.bitmap.sbf_bitmap_size.width = 512;
+        formats[0].sf_format.bitmap.sbf_bitmap_size.height = 256;
+        formats[0].sf_format.bitmap.sbf_bitmap_pattern = VRAM_ADDR_4MBIT(2, 0x00000);
+        formats[0].sf_format.bitmap.sbf_rp_mode = SCRN_RP_MODE_SWAP_COEFFICIENT;
+
+        test_format_cell_init(&formats[1], SCRN_NBG1, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(0, 0x00000));
+
+        struct state state;
+
+        test_state_init(&state, formats, 2, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+        assert_int_equal(state.ramctl, RAMCTL_VRBMD |
+            RAMCTL_RDBS(RAMCTL_RDBS_CPD, VRAM_BANK_B0) |
+            RAMCTL_RDBS(RAMCTL_RDBS_COEFFICIENT, VRAM_BANK_B1));
+
+        /* Move the coefficient table from bank B1 to bank A1 */
+        state.rbg0.format.sf_coefficient_table = VRAM_ADDR_4MBIT(1, 0x00000);
+
+        state_scrn_dirty(&state, SCRN_RBG0);
+
+        assert_int_equal(vdp2cycp_update(&state), 0);
+        assert_int_equal(RAMCTL_RDBS_GET(state.ramctl, VRAM_BANK_A1), RAMCTL_RDBS_COEFFICIENT);
+        assert_int_equal(RAMCTL_RDBS_GET(state.ramctl, VRAM_BANK_B1), RAMCTL_RDBS_NONE);
+
+        int8_t result;
+
+        assert_int_equal(vdp2cycp_validate(&state, &state.vram_cycp, 1, &result), 0);
+        assert_int_equal(result, 0);
+}
+
+/* Every access timing of bank B0 is read, each within the range left by
+ * the pattern name data access timing of its NBG */
+static void
+test_alloc_four_nbgs(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbgs_init(&state, 4, SCRN_CCC_PALETTE_256, TVMD_HRESO_NORMAL_320);
+
+        struct cycp_stats stats;
+
+        assert_int_equal(vdp2cycp_stats(&state, &stats), 0);
+
+        test_vram_cycp_assert(&state.vram_cycp, 0xFFFF3210, 0x76547654);
+
+        assert_true(stats.prune_counts[CYCP_PRUNE_RANGE] > 0);
+}
+
+/* Only T0 to T3 are available, where the ranges of character pattern
+ * data wrap around */
+static void
+test_alloc_four_nbgs_hires(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbgs_init(&state, 4, SCRN_CCC_PALETTE_16, TVMD_HRESO_HIRES_640);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+
+        test_vram_cycp_assert(&state.vram_cycp, 0xFFFF3210, 0xFFFF7654);
+}
+
+/* Three NBGs require 5 character pattern data access timings of bank B0,
+ * out of the 4 of the hi-res TV screen modes */
+static void
+test_alloc_range_conflict(void **unused __unused)
+{
+        struct scrn_format formats[3];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 3; scrn++) {
+                test_format_cell_init(&formats[scrn], scrn, VRAM_ADDR_4MBIT(0, 0x00000),
+                    VRAM_ADDR_4MBIT(2, 0x00000));
+        }
+
+        formats[SCRN_NBG0].sf_cc_count = SCRN_CCC_PALETTE_256;
+        formats[SCRN_NBG1].sf_cc_count = SCRN_CCC_PALETTE_256;
+
+        struct state state;
+
+        test_state_init(&state, formats, 3, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), 0);
+
+        test_vram_cycp_assert(&state.vram_cycp, 0xFFFFF210, 0xF6FF5544);
+
+        test_state_init(&state, formats, 3, TVMD_HRESO_HIRES_640);
+
+        assert_int_equal(vdp2cycp(&state), -6);
+}
+
+/* A character pattern table of 1,024 cells of 256 colors, 64 KiB, that
+ * starts 32 KiB before the end of bank A0 spans bank A1 too */
+static void
+test_cpd_bitmap_extent(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(2, 0x00000),
+            VRAM_ADDR_4MBIT(0, 0x18000));
+
+        format.sf_cc_count = SCRN_CCC_PALETTE_256;
+
+        struct state state;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        state.ramctl = RAMCTL_VRAMD;
+
+        union vram_cycp vram_cycp;
+
+        vram_cycp.pv[VRAM_BANK_A0] = 0xFFFFFF44;
+        vram_cycp.pv[VRAM_BANK_A1] = TEST_PV_NO_ACCESS;
+        vram_cycp.pv[VRAM_BANK_B0] = TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0);
+        vram_cycp.pv[VRAM_BANK_B1] = TEST_PV_NO_ACCESS;
+
+        int8_t result;
+
+        assert_int_equal(vdp2cycp_validate(&state, &vram_cycp, 1, &result), 0);
+        assert_int_equal(result, -6);
+
+        vram_cycp.pv[VRAM_BANK_A1] = 0xFFFFFF44;
+
+        assert_int_equal(vdp2cycp_validate(&state, &vram_cycp, 1, &result), 0);
+        assert_int_equal(result, 0);
+}
+
+/* Each configuration of a batch is validated as vdp2cycp() validates a
+ * state, including the rotational backgrounds */
+static void
+test_batch_validate(void **unused __unused)
+{
+        static const uint16_t ramctl[] = {
+                0x0000,
+                0x0000,
+                0x0000,
+                0x0000,
+                0x0000,
+                0x0000
+        };
+
+        /* NBG0, then a copy of it, then stored beyond the end of VRAM,
+         * then with vertical cell scroll the tables reject */
+        static const uint8_t nbg0_tvcs[] = { 0, 0, 0, 0xFF, 0, 0 };
+        static const uint8_t nbg0_tpnd[] = { 1, 1, 1, 0, 0, 0 };
+        static const uint8_t nbg0_tcpd[] = { 1, 1, 1, 0, 0, 0 };
+        static const uint8_t nbg0_vcs_bitmap[] = { 0, 0, 0, VRAM_BANK_BIT(VRAM_BANK_A1), 0, 0 };
+        static const uint8_t nbg0_pnd_bitmap[] = {
+                VRAM_BANK_BIT(VRAM_BANK_A0),
+                VRAM_BANK_BIT(VRAM_BANK_A0),
+                VRAM_BANK_BIT(VRAM_BANK_A0),
+                VRAM_BANK_BIT(VRAM_BANK_A0),
+                0,
+                0
+        };
+        static const uint8_t nbg0_cpd_bitmap[] = {
+                VRAM_BANK_BIT(VRAM_BANK_B0),
+                VRAM_BANK_BIT(VRAM_BANK_B0),
+                VRAM_BANK_BIT(VRAM_BANK_B0),
+                VRAM_BANK_BIT(VRAM_BANK_B0),
+                0,
+                0
+        };
+        static const uint8_t nbg0_vram_exceeded[] = { 0, 0, 1 << CYCP_DEMAND_CPD, 0, 0, 0 };
+
+        /* NBG1 along with RBG0 */
+        static const uint8_t nbg1_tpnd[] = { 0, 0, 0, 0, 0, 1 };
+        static const uint8_t nbg1_tcpd[] = { 0, 0, 0, 0, 0, 1 };
+        static const uint8_t nbg1_pnd_bitmap[] = { 0, 0, 0, 0, 0, VRAM_BANK_BIT(VRAM_BANK_A0) };
+        static const uint8_t nbg1_cpd_bitmap[] = { 0, 0, 0, 0, 0, VRAM_BANK_BIT(VRAM_BANK_A0) };
+
+        /* RBG0 swapping rotation parameters via coefficient data, first
+         * without a coefficient table */
+        static const uint8_t rbg0_rp_mode[] = {
+                0,
+                0,
+                0,
+                0,
+                SCRN_RP_MODE_SWAP_COEFFICIENT,
+                SCRN_RP_MODE_SWAP_COEFFICIENT
+        };
+        static const uint32_t rbg0_coefficient_table[] = {
+                0,
+                0,
+                0,
+                0,
+                0x00000000,
+                VRAM_ADDR_4MBIT(3, 0x00000)
+        };
+        static const uint8_t rbg0_coefficient_bitmap[] = { 0, 0, 0, 0, 0, VRAM_BANK_BIT(VRAM_BANK_B1) };
+        static const uint8_t rbg0_pnd_bitmap[] = { 0, 0, 0, 0, 0, 0 };
+        static const uint8_t rbg0_cpd_bitmap[] = {
+                0,
+                0,
+                0,
+                0,
+                VRAM_BANK_BIT(VRAM_BANK_B0),
+                VRAM_BANK_BIT(VRAM_BANK_B0)
+        };
+
+        union vram_cycp vram_cycp[6];
+        int32_t results[6];
+        uint16_t ramctl_solved[6];
+
+        struct cycp_batch batch;
+
+        memset(&batch, 0x00, sizeof(batch));
+
+        batch.count = 6;
+        batch.ramctl = ramctl;
+
+        batch.scrns[SCRN_NBG0].tvcs = nbg0_tvcs;
+        batch.scrns[SCRN_NBG0].tpnd = nbg0_tpnd;
+        batch.scrns[SCRN_NBG0].tcpd = nbg0_tcpd;
+        batch.scrns[SCRN_NBG0].vcs_bitmap = nbg0_vcs_bitmap;
+        batch.scrns[SCRN_NBG0].pnd_bitmap = nbg0_pnd_bitmap;
+        batch.scrns[SCRN_NBG0].cpd_bitmap = nbg0_cpd_bitmap;
+        batch.scrns[SCRN_NBG0].vram_exceeded = nbg0_vram_exceeded;
+
+        batch.scrns[SCRN_NBG1].tpnd = nbg1_tpnd;
+        batch.scrns[SCRN_NBG1].tcpd = nbg1_tcpd;
+        batch.scrns[SCRN_NBG1].pnd_bitmap = nbg1_pnd_bitmap;
+        batch.scrns[SCRN_NBG1].cpd_bitmap = nbg1_cpd_bitmap;
+
+        batch.rbgs[0].rp_mode = rbg0_rp_mode;
+        batch.rbgs[0].coefficient_table = rbg0_coefficient_table;
+        batch.rbgs[0].coefficient_bitmap = rbg0_coefficient_bitmap;
+        batch.rbgs[0].pnd_bitmap = rbg0_pnd_bitmap;
+        batch.rbgs[0].cpd_bitmap = rbg0_cpd_bitmap;
+
+        batch.vram_cycp = vram_cycp;
+        batch.results = results;
+        batch.ramctl_solved = ramctl_solved;
+
+        assert_int_equal(vdp2cycp_batch(&batch), 0);
+
+        assert_int_equal(results[0], 0);
+        test_vram_cycp_assert(&vram_cycp[0], 0xFFFFFFF0, 0xFFFFFFF4);
+        assert_int_equal(ramctl_solved[0], 0x0000);
+
+        assert_int_equal(results[1], 0);
+        test_vram_cycp_assert(&vram_cycp[1], 0xFFFFFFF0, 0xFFFFFFF4);
+
+        assert_int_equal(results[2], -9);
+        assert_int_equal(results[3], -4);
+        assert_int_equal(results[4], -8);
+
+        assert_int_equal(results[5], 0);
+        assert_int_equal(ramctl_solved[5], RAMCTL_VRBMD |
+            RAMCTL_RDBS(RAMCTL_RDBS_CPD, VRAM_BANK_B0) |
+            RAMCTL_RDBS(RAMCTL_RDBS_COEFFICIENT, VRAM_BANK_B1));
+}
+
+/* Partitioning VRAM-A gives the character pattern data of NBG0 a bank of
+ * its own, leaving more access timings open to the CPU */
+static void
+test_optimize_partition(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(1, 0x00000));
+
+        struct cycp_objective objective;
+
+        memset(&objective, 0x00, sizeof(objective));
+
+        objective.weights[VRAM_BANK_A0] = 1;
+        objective.weights[VRAM_BANK_A1] = 1;
+
+        struct state state;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp_optimize(&state, &objective), 0);
+        assert_int_equal(state.ramctl, 0x0000);
+        test_vram_cycp_assert(&state.vram_cycp, 0xEEEEEE40, 0xEEEEEEEE);
+
+        objective.partition = true;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp_optimize(&state, &objective), 0);
+        assert_int_equal(state.ramctl, RAMCTL_VRAMD);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A0], 0xEEEEEEE0);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A1], 0xEEEEEEE4);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B0], 0xEEEEEEEE);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B1], 0xEEEEEEEE);
+
+        /* Without weight on VRAM-A, the partitioning of STATE is kept */
+        objective.weights[VRAM_BANK_A0] = 0;
+        objective.weights[VRAM_BANK_A1] = 0;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp_optimize(&state, &objective), 0);
+        assert_int_equal(state.ramctl, 0x0000);
+}
+
+/*-
+ * The reads of one cell are multiplied by the 40x224 cells of a frame in
+ * the normal TV screen mode.
+ */
+static void
+test_simulate_cell_count(void **unused __unused)
+{
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_NORMAL_320);
+
+        union vram_cycp vram_cycp;
+
+        vram_cycp.pv[VRAM_BANK_A0] = TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0);
+        vram_cycp.pv[VRAM_BANK_A1] = vram_cycp.pv[VRAM_BANK_A0];
+        vram_cycp.pv[VRAM_BANK_B0] = TEST_PV(1, VRAM_CTL_CYCP_CHPNDR_NBG0);
+        vram_cycp.pv[VRAM_BANK_B1] = vram_cycp.pv[VRAM_BANK_B0];
+
+        struct cycp_sim sim;
+
+        assert_int_equal(vdp2cycp_simulate(&state, &vram_cycp, 1, &sim), 0);
+        assert_int_equal(sim.dot_count, 320);
+        assert_int_equal(sim.line_count, 224);
+        assert_int_equal(sim.banks[VRAM_BANK_A0].timing_count, 8 * 8960);
+        assert_int_equal(sim.banks[VRAM_BANK_A0].fetch_count, 8960);
+        assert_int_equal(sim.banks[VRAM_BANK_A0].invalid_count, 0);
+        assert_int_equal(sim.banks[VRAM_BANK_A0].stall_count, 0);
+        assert_int_equal(sim.banks[VRAM_BANK_A0].utilization, 125);
+        assert_int_equal(sim.banks[VRAM_BANK_B0].fetch_count, 8960);
+        assert_int_equal(sim.stalls[SCRN_NBG0][CYCP_DEMAND_CPD], 0);
+
+        /* VRAM-A and VRAM-B are not partitioned */
+        assert_int_equal(sim.banks[VRAM_BANK_A1].timing_count, 0);
+        assert_int_equal(sim.banks[VRAM_BANK_B1].timing_count, 0);
+
+        /* Without its character pattern data, every cell stalls */
+        vram_cycp.pv[VRAM_BANK_B0] = TEST_PV_NO_ACCESS;
+        vram_cycp.pv[VRAM_BANK_B1] = TEST_PV_NO_ACCESS;
+
+        assert_int_equal(vdp2cycp_simulate(&state, &vram_cycp, 1, &sim), 0);
+        assert_int_equal(sim.banks[VRAM_BANK_B0].fetch_count, 0);
+        assert_int_equal(sim.banks[VRAM_BANK_B0].stall_count, 8960);
+        assert_int_equal(sim.stalls[SCRN_NBG0][CYCP_DEMAND_CPD], 8960);
+}
+
+/*-
+ * The registers RAMCTL through CYCB1U are written most significant byte
+ * first, T0 in the upper nibble of each lower register.
+ */
+static void
+test_registers_block(void **unused __unused)
+{
+        static const uint8_t solved_block[VDP2_REG_CYCP_SIZE] = {
+                0x00, 0x00,     /* RAMCTL */
+                0x0F, 0xFF,     /* CYCA0L */
+                0xFF, 0xFF,     /* CYCA0U */
+                0x0F, 0xFF,     /* CYCA1L */
+                0xFF, 0xFF,     /* CYCA1U */
+                0x4F, 0xFF,     /* CYCB0L */
+                0xFF, 0xFF,     /* CYCB0U */
+                0x4F, 0xFF,     /* CYCB1L */
+                0xFF, 0xFF      /* CYCB1U */
+        };
+
+        struct state state;
+
+        test_state_nbg0_init(&state, TVMD_HRESO_NORMAL_320);
+
+        uint8_t block[VDP2_REG_CYCP_SIZE];
+
+        assert_int_equal(vdp2cycp_registers(&state, NULL), -1);
+        assert_int_equal(vdp2cycp_registers(&state, block), 0);
+        assert_memory_equal(block, solved_block, sizeof(block));
+
+        /* NBG2 can't read a vertical cell scroll table, so the block is
+         * left with no access at every access timing */
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG2, VRAM_ADDR_4MBIT(0, 0x00000),
+            VRAM_ADDR_4MBIT(2, 0x00000));
+
+        format.sf_vcs_table = VRAM_ADDR_4MBIT(1, 0x00000);
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        state.ramctl = RAMCTL_VRAMD;
+
+        assert_int_equal(vdp2cycp_registers(&state, block), -4);
+        assert_int_equal(block[0], 0x01);
+        assert_int_equal(block[1], 0x00);
+
+        uint32_t i;
+        for (i = 2; i < VDP2_REG_CYCP_SIZE; i++) {
+                assert_int_equal(block[i], 0xFF);
+        }
+}
+
+/* The three NBGs of test_alloc_range_conflict() in the hi-res TV screen
+ * modes, where every character pattern data read is in conflict */
+static void
+test_explain_conflict(void **unused __unused)
+{
+        struct scrn_format formats[3];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 3; scrn++) {
+                test_format_cell_init(&formats[scrn], scrn, VRAM_ADDR_4MBIT(0, 0x00000),
+                    VRAM_ADDR_4MBIT(2, 0x00000));
+        }
+
+        formats[SCRN_NBG0].sf_cc_count = SCRN_CCC_PALETTE_256;
+        formats[SCRN_NBG1].sf_cc_count = SCRN_CCC_PALETTE_256;
+
+        struct state state;
+
+        test_state_init(&state, formats, 3, TVMD_HRESO_HIRES_640);
+
+        struct cycp_explain explain;
+        char text[256];
+
+        assert_int_equal(vdp2cycp_explain(&state, NULL), -1);
+        assert_int_equal(vdp2cycp_explain(&state, &explain), 0);
+
+        assert_int_equal(explain.error, -6);
+        assert_int_equal(explain.demands,
+            CYCP_DEMAND_BIT(SCRN_NBG0, CYCP_DEMAND_CPD) |
+            CYCP_DEMAND_BIT(SCRN_NBG1, CYCP_DEMAND_CPD) |
+            CYCP_DEMAND_BIT(SCRN_NBG2, CYCP_DEMAND_CPD));
+        assert_int_equal(explain.bank_bitmap, VRAM_BANK_BIT(VRAM_BANK_B0));
+        assert_int_equal(explain.timings, 0x0F);
+        assert_int_equal(explain.required, 5);
+        assert_int_equal(explain.pnd_count, 0);
+
+        assert_int_equal(vdp2cycp_explain_format(&state, &explain, text, sizeof(text)), 0);
+        assert_string_equal(text, "NBG0 256-color CPD + NBG1 256-color CPD + "
+            "NBG2 16-color CPD need bank B0 T0-T3 (5 access timings)");
+
+        /* Nothing to explain in the normal TV screen modes */
+        test_state_init(&state, formats, 3, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp_explain(&state, &explain), 0);
+        assert_int_equal(explain.error, 0);
+        assert_int_equal(explain.demands, 0);
+        assert_int_equal(vdp2cycp_explain_format(&state, &explain, text, sizeof(text)), -2);
+
+        /* A cell format can't display 32,768 colors */
+        formats[SCRN_NBG0].sf_cc_count = SCRN_CCC_RGB_32768;
+
+        test_state_init(&state, formats, 3, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp_explain(&state, &explain), 0);
+        assert_int_equal(explain.error, -6);
+        assert_int_equal(explain.demands, CYCP_DEMAND_BIT(SCRN_NBG0, CYCP_DEMAND_CPD));
+        assert_int_equal(vdp2cycp_explain_format(&state, &explain, text, sizeof(text)), 0);
+        assert_string_equal(text, "NBG0 32768-color RGB CPD is not supported");
+}
+
+/* The banks of 8-Mbit VRAM are twice as large, so the pattern name data
+ * at 256 KiB is in bank A1 rather than in bank B0, and the character
+ * pattern data at 512 KiB is no longer beyond the end of VRAM */
+static void
+test_vrsize_banks(void **unused __unused)
+{
+        struct scrn_format format;
+
+        test_format_cell_init(&format, SCRN_NBG0, VRAM_ADDR_8MBIT(1, 0x00000),
+            VRAM_ADDR_8MBIT(2, 0x00000));
+
+        struct state state;
+
+        test_state_init(&state, &format, 1, TVMD_HRESO_NORMAL_320);
+
+        assert_int_equal(vdp2cycp(&state), -9);
+        assert_int_equal(state.nbg0.pnd_bitmap, VRAM_BANK_BIT(VRAM_BANK_B0));
+
+        state_vrsize_set(&state, VRSIZE_VRAMSZ);
+
+        state.ramctl = RAMCTL_VRAMD | RAMCTL_VRBMD;
+
+        assert_int_equal(state.nbg0.pnd_bitmap, VRAM_BANK_BIT(VRAM_BANK_A1));
+        assert_int_equal(state.nbg0.cpd_bitmap, VRAM_BANK_BIT(VRAM_BANK_B0));
+
+        assert_int_equal(vdp2cycp(&state), 0);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A0], TEST_PV_NO_ACCESS);
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_A1], TEST_PV(0, VRAM_CTL_CYCP_PNDR_NBG0));
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B0],
+            TEST_PV(0, VRAM_CTL_CYCP_CHPNDR_NBG0));
+        assert_int_equal(state.vram_cycp.pv[VRAM_BANK_B1], TEST_PV_NO_ACCESS);
+}
+
+int
+test_vdp2cycp(void)
+{
+        const struct CMUnitTest tests[] = {
+                cmocka_unit_test(test_validate_solution),
+                cmocka_unit_test(test_validate_pnd_halved),
+                cmocka_unit_test(test_validate_reserved),
+                cmocka_unit_test(test_validate_pairs),
+                cmocka_unit_test(test_update_coefficient_move),
+                cmocka_unit_test(test_alloc_four_nbgs),
+                cmocka_unit_test(test_alloc_four_nbgs_hires),
+                cmocka_unit_test(test_alloc_range_conflict),
+                cmocka_unit_test(test_cpd_bitmap_extent),
+                cmocka_unit_test(test_batch_validate),
+                cmocka_unit_test(test_optimize_partition),
+                cmocka_unit_test(test_simulate_cell_count),
+                cmocka_unit_test(test_registers_block),
+                cmocka_unit_test(test_explain_conflict),
+                cmocka_unit_test(test_vrsize_banks)
+        };
+
+        return cmocka_run_group_tests_name("vdp2cycp", tests, NULL, NULL);
+}
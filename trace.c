@@ -0,0 +1,262 @@
+#include <sys/cdefs.h>
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+#include "vdp2cycp.h"
+#include "debug.h"
+
+#ifdef TRACE
+void (*trace_hook)(uint32_t, uint32_t, uint32_t) = NULL;
+#endif /* TRACE */
+
+/* Events are recorded in place of the oldest once the ring is full */
+static struct trace_event _trace_ring[TRACE_RING_SIZE];
+
+/* Number of events recorded since the ring was reset */
+static _Atomic uint32_t _trace_ring_count = 0;
+
+static size_t trace_banks_format(uint8_t, char *, size_t);
+static size_t trace_timings_format(uint8_t, char *, size_t);
+
+/*-
+ * Record the event EVENT, and its two arguments A and B, in the ring
+ * buffer. It may be set as TRACE_HOOK.
+ *
+ * Recording takes no lock, and allocates no memory, so that tracing can
+ * stay on while solving from many threads. Events of different threads
+ * are interleaved in the order they claim their place in the ring.
+ */
+void
+trace_ring_record(uint32_t event, uint32_t a, uint32_t b)
+{
+        uint32_t sequence;
+        sequence = atomic_fetch_add_explicit(&_trace_ring_count, 1, memory_order_relaxed);
+
+        struct trace_event *trace_event;
+        trace_event = &_trace_ring[sequence & (TRACE_RING_SIZE - 1)];
+
+        trace_event->sequence = sequence;
+        trace_event->event = event;
+        trace_event->a = a;
+        trace_event->b = b;
+}
+
+/*-
+ * Discard every event of the ring buffer.
+ */
+void
+trace_ring_reset(void)
+{
+        atomic_store_explicit(&_trace_ring_count, 0, memory_order_relaxed);
+}
+
+/*-
+ * Copy at most COUNT of the last events of the ring buffer to EVENTS,
+ * from the oldest to the newest. No event should be recorded meanwhile.
+ *
+ * The number of events copied is returned.
+ */
+uint32_t
+trace_ring_copy(struct trace_event *events, uint32_t count)
+{
+        uint32_t recorded;
+        recorded = atomic_load_explicit(&_trace_ring_count, memory_order_acquire);
+
+        uint32_t available;
+        available = (recorded < TRACE_RING_SIZE) ? recorded : TRACE_RING_SIZE;
+
+        if (count > available) {
+                count = available;
+        }
+
+        uint32_t i;
+        for (i = 0; i < count; i++) {
+                uint32_t sequence;
+                sequence = recorded - count + i;
+
+                events[i] = _trace_ring[sequence & (TRACE_RING_SIZE - 1)];
+        }
+
+        return count;
+}
+
+/*-
+ * Write the event EVENT as text to BUFFER of SIZE bytes, which should be
+ * TRACE_EVENT_TEXT_SIZE bytes. The cycle pattern of a bank is written as
+ * the table of its access timings T7 to T0.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 EVENT or BUFFER is NULL
+ *   - -2 The event is not known, where its arguments are still written
+ */
+int32_t
+trace_event_format(const struct trace_event *event, char *buffer, size_t size)
+{
+        static const char *scroll_screen_names[] = {
+                "NBG0",
+                "NBG1",
+                "NBG2",
+                "NBG3",
+                "RBG0",
+                "RBG1",
+                "???"
+        };
+
+        static const char *bank_names[] = {
+                "CYCA0",
+                "CYCA1",
+                "CYCB0",
+                "CYCB1",
+                "???"
+        };
+
+        static const char *prune_names[] = {
+                "range",
+                "bank",
+                "pnd-bank",
+                "vcs-bank",
+                "???"
+        };
+
+        if ((event == NULL) || (buffer == NULL)) {
+                return -1;
+        }
+
+        const char *scroll_screen_name;
+        scroll_screen_name = scroll_screen_names[(event->a < SCRN_COUNT) ?
+            event->a : SCRN_COUNT];
+
+        switch (event->event) {
+        case TRACE_SOLVE_BEGIN:
+                (void)snprintf(buffer, size, "solve: RAMCTL 0x%04X", event->a);
+                return 0;
+        case TRACE_SOLVE_END:
+                (void)snprintf(buffer, size, "solve: returned %i", (int32_t)event->a);
+                return 0;
+        case TRACE_VALIDATE:
+                (void)snprintf(buffer, size, "  validate: RAMCTL 0x%04X, returned %i",
+                    event->b, (int32_t)event->a);
+                return 0;
+        case TRACE_DEMANDS:
+                (void)snprintf(buffer, size,
+                    "  %s: access timings VCS %u, PND %u, CPD %u",
+                    scroll_screen_name,
+                    event->b & 0xFF,
+                    (event->b >> 8) & 0xFF,
+                    (event->b >> 16) & 0xFF);
+                return 0;
+        case TRACE_BITMAPS: {
+                char banks[4][16];
+
+                uint32_t kind;
+                for (kind = 0; kind < 4; kind++) {
+                        (void)trace_banks_format((event->b >> (kind * 8)) & 0x0F,
+                            banks[kind], sizeof(banks[kind]));
+                }
+
+                (void)snprintf(buffer, size,
+                    "  %s: banks VCS %s, PND %s, CPD %s, coefficient %s",
+                    scroll_screen_name, banks[0], banks[1], banks[2], banks[3]);
+        } return 0;
+        case TRACE_NODE: {
+                char banks[16];
+                char timings[40];
+
+                (void)trace_banks_format(VRAM_BANK_BIT((event->b >> 8) & 0x03),
+                    banks, sizeof(banks));
+                (void)trace_timings_format(event->b & 0xFF, timings, sizeof(timings));
+
+                (void)snprintf(buffer, size, "    item %u: bank %s, %s", event->a, banks,
+                    timings);
+        } return 0;
+        case TRACE_PRUNE:
+                (void)snprintf(buffer, size, "    item %u: pruned (%s)", event->b,
+                    prune_names[(event->a < CYCP_PRUNE_COUNT) ? event->a : CYCP_PRUNE_COUNT]);
+                return 0;
+        case TRACE_CYCP: {
+                char table[DEBUG_CYCLE_PATTERN_SIZE];
+
+                debug_print_cycle_pattern(event->b, table, sizeof(table));
+
+                (void)snprintf(buffer, size, "  %s: 0x%08X%s",
+                    bank_names[(event->a < VRAM_BANK_COUNT) ? event->a : VRAM_BANK_COUNT],
+                    event->b, table);
+        } return 0;
+        default:
+                (void)snprintf(buffer, size, "event %u: 0x%08X, 0x%08X", event->event,
+                    event->a, event->b);
+                return -2;
+        }
+}
+
+/*-
+ * Write the banks of the bank bit-map BITMAP, such as "A0+B1", or "-"
+ * for none, to BUFFER of SIZE bytes.
+ *
+ * The length of the text is returned.
+ */
+static size_t
+trace_banks_format(uint8_t bitmap, char *buffer, size_t size)
+{
+        static const char *bank_names[VRAM_BANK_COUNT] = {
+                "A0",
+                "A1",
+                "B0",
+                "B1"
+        };
+
+        size_t length;
+        length = 0;
+
+        buffer[0] = '\0';
+
+        uint32_t bank;
+        for (bank = 0; (bank < VRAM_BANK_COUNT) && (length < size); bank++) {
+                if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                length += snprintf(&buffer[length], size - length, "%s%s",
+                    (length > 0) ? "+" : "", bank_names[bank]);
+        }
+
+        if (length == 0) {
+                length = snprintf(buffer, size, "-");
+        }
+
+        return length;
+}
+
+/*-
+ * Write the access timings of the bit-map TIMINGS, such as "T0 T1 T4",
+ * to BUFFER of SIZE bytes.
+ *
+ * The length of the text is returned.
+ */
+static size_t
+trace_timings_format(uint8_t timings, char *buffer, size_t size)
+{
+        size_t length;
+        length = 0;
+
+        buffer[0] = '\0';
+
+        uint32_t t;
+        for (t = 0; (t < 8) && (length < size); t++) {
+                if ((timings & (1 << t)) == 0x00) {
+                        continue;
+                }
+
+                length += snprintf(&buffer[length], size - length, "%sT%u",
+                    (length > 0) ? " " : "", t);
+        }
+
+        return length;
+}
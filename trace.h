@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2012-2016 Israel Jacquez
+ * See LICENSE for details.
+ *
+ * Israel Jacquez <mrkotfw@gmail.com>
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_SOLVE_BEGIN       0 /* A: RAMCTL */
+#define TRACE_SOLVE_END         1 /* A: Result */
+#define TRACE_DEMANDS           2 /* A: Scroll screen, B: Access timings (VCS | PND << 8 | CPD << 16) */
+#define TRACE_NODE              3 /* A: Item, B: Bank << 8 | access timings */
+#define TRACE_PRUNE             4 /* A: Reason (CYCP_PRUNE_*), B: Item */
+#define TRACE_BITMAPS           5 /* A: Scroll screen, B: Bank bit-maps (VCS | PND << 8 | CPD << 16 | coefficient << 24) */
+#define TRACE_VALIDATE          6 /* A: Result, B: RAMCTL */
+#define TRACE_CYCP              7 /* A: Bank, B: Cycle pattern */
+#define TRACE_EVENT_COUNT       8
+
+/* Number of events the ring buffer holds (must be a power of 2) */
+#define TRACE_RING_SIZE         8192
+
+/* Size of the longest text trace_event_format() writes */
+#define TRACE_EVENT_TEXT_SIZE   256
+
+/*-
+ * An event, as recorded by trace_ring_record().
+ */
+struct trace_event {
+        /* Number of events recorded before this one */
+        uint32_t sequence;
+        uint32_t event;
+        uint32_t a;
+        uint32_t b;
+};
+
+/*-
+ * Tracepoints are compiled in only when TRACE is defined, and then call
+ * TRACE_HOOK, if set, with the event and its two arguments.
+ */
+#ifdef TRACE
+#define TRACE_POINT(event, a, b) do {                                          \
+        if (trace_hook != NULL) {                                              \
+                trace_hook((event), (uint32_t)(a), (uint32_t)(b));             \
+        }                                                                      \
+} while (false)
+
+extern void (*trace_hook)(uint32_t, uint32_t, uint32_t);
+#else
+#define TRACE_POINT(event, a, b)
+#endif /* TRACE */
+
+void trace_ring_record(uint32_t, uint32_t, uint32_t);
+void trace_ring_reset(void);
+uint32_t trace_ring_copy(struct trace_event *, uint32_t);
+
+int32_t trace_event_format(const struct trace_event *, char *, size_t);
+
+#endif /* !TRACE_H_ */
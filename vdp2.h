@@ -35,9 +35,98 @@
 #define SCRN_CCC_RGB_32768      3
 #define SCRN_CCC_RGB_16770000   4
 
+#define SCRN_RP_MODE_A                  0 /* Rotation parameter A */
+#define SCRN_RP_MODE_B                  1 /* Rotation parameter B */
+#define SCRN_RP_MODE_SWAP_COEFFICIENT   2 /* Swap via coefficient data read */
+#define SCRN_RP_MODE_SWAP_WINDOW        3 /* Swap via rotation parameter window */
+
+#define VRAM_BANK_A0            0
+#define VRAM_BANK_A1            1
+#define VRAM_BANK_B0            2
+#define VRAM_BANK_B1            3
+#define VRAM_BANK_COUNT         4
+
+/* Bit representing bank B in a 4-bit bank bit-map (A0 is the MSB) */
+#define VRAM_BANK_BIT(b)        (1 << (VRAM_BANK_COUNT - (b) - 1))
+
 #define VRAM_ADDR_4MBIT(x, y)   (0x25E00000 + ((x) << 17) + (y))
+#define VRAM_ADDR_8MBIT(x, y)   (0x25E00000 + ((x) << 18) + (y))
 
 #define VRAM_BANK_4MBIT(x)      (((x) >> 17) & 0x0007)
+#define VRAM_BANK_8MBIT(x)      (((x) >> 18) & 0x0003)
+
+#define VRSIZE_VRAMSZ           0x8000 /* VRAM size is 8-Mbit (4-Mbit if clear) */
+
+/* Size of VRAM in bytes, as selected by VRSIZE X */
+#define VRAM_SIZE(x)            (((x) & VRSIZE_VRAMSZ) ? 0x00100000 : 0x00080000)
+
+/* Offset of address X from the start of VRAM */
+#define VRAM_OFFSET(x)          ((x) & 0x000FFFFF)
+
+/* Bank address X falls in, as selected by VRSIZE V. Only addresses
+ * within VRAM_SIZE(V) fall in a bank */
+#define VRAM_BANK(v, x)                                                        \
+        (((v) & VRSIZE_VRAMSZ) ? VRAM_BANK_8MBIT(x) : VRAM_BANK_4MBIT(x))
+
+/* VDP2 registers, as offsets from VDP2_REG_BASE */
+#define VDP2_REG_BASE           0x25F80000
+#define VDP2_REG_RAMCTL         0x000E /* RAM control */
+#define VDP2_REG_CYCA0L         0x0010 /* VRAM cycle pattern (bank A0, T0 to T3) */
+#define VDP2_REG_CYCA0U         0x0012 /* VRAM cycle pattern (bank A0, T4 to T7) */
+#define VDP2_REG_CYCA1L         0x0014 /* VRAM cycle pattern (bank A1, T0 to T3) */
+#define VDP2_REG_CYCA1U         0x0016 /* VRAM cycle pattern (bank A1, T4 to T7) */
+#define VDP2_REG_CYCB0L         0x0018 /* VRAM cycle pattern (bank B0, T0 to T3) */
+#define VDP2_REG_CYCB0U         0x001A /* VRAM cycle pattern (bank B0, T4 to T7) */
+#define VDP2_REG_CYCB1L         0x001C /* VRAM cycle pattern (bank B1, T0 to T3) */
+#define VDP2_REG_CYCB1U         0x001E /* VRAM cycle pattern (bank B1, T4 to T7) */
+
+/* Number of 16-bit registers from RAMCTL through CYCB1U, and their size
+ * in bytes */
+#define VDP2_REG_CYCP_COUNT     9
+#define VDP2_REG_CYCP_SIZE      (VDP2_REG_CYCP_COUNT * 2)
+
+#define RAMCTL_VRAMD            0x0100 /* Partition VRAM-A into A0 and A1 */
+#define RAMCTL_VRBMD            0x0200 /* Partition VRAM-B into B0 and B1 */
+
+/* Rotation data bank select (RDBS) of each bank, 2 bits per bank from
+ * A0 at the LSB. When a bank is not partitioned, the RDBS of its first
+ * half selects the whole bank */
+#define RAMCTL_RDBS_NONE        0x0 /* Not used by the rotational backgrounds */
+#define RAMCTL_RDBS_COEFFICIENT 0x1 /* Coefficient table */
+#define RAMCTL_RDBS_PND         0x2 /* Pattern name table */
+#define RAMCTL_RDBS_CPD         0x3 /* Character pattern (or bitmap) table */
+#define RAMCTL_RDBS_MASK        0x00FF
+
+/* Calculate the bits of RAMCTL selecting RDBS X for bank B */
+#define RAMCTL_RDBS(x, b)       ((uint16_t)(x) << ((b) << 1))
+
+/* Extract the RDBS of bank B from RAMCTL X */
+#define RAMCTL_RDBS_GET(x, b)   (((x) >> ((b) << 1)) & 0x0003)
+
+#define TVMD_HRESO_NORMAL_320           0x0000 /* 320 dots (normal) */
+#define TVMD_HRESO_NORMAL_352           0x0001 /* 352 dots (normal) */
+#define TVMD_HRESO_HIRES_640            0x0002 /* 640 dots (hi-res) */
+#define TVMD_HRESO_HIRES_704            0x0003 /* 704 dots (hi-res) */
+#define TVMD_HRESO_EXCLUSIVE_320        0x0004 /* 320 dots (exclusive monitor) */
+#define TVMD_HRESO_EXCLUSIVE_352        0x0005 /* 352 dots (exclusive monitor) */
+#define TVMD_HRESO_EXCLUSIVE_640        0x0006 /* 640 dots (exclusive monitor) */
+#define TVMD_HRESO_EXCLUSIVE_704        0x0007 /* 704 dots (exclusive monitor) */
+#define TVMD_HRESO_MASK                 0x0007
+
+#define TVMD_VRESO_224                  0x0000 /* 224 lines */
+#define TVMD_VRESO_240                  0x0010 /* 240 lines */
+#define TVMD_VRESO_256                  0x0020 /* 256 lines (PAL only) */
+#define TVMD_VRESO_MASK                 0x0030
+
+#define TVMD_LSMD_NON_INTERLACE         0x0000
+#define TVMD_LSMD_SINGLE_INTERLACE      0x0080
+#define TVMD_LSMD_DOUBLE_INTERLACE      0x00C0
+#define TVMD_LSMD_MASK                  0x00C0
+
+/* Determine if only access timings T0 to T3 are available, as in the
+ * hi-res and exclusive monitor modes, where dots are read twice as
+ * fast. Interlacing has no effect on access timings */
+#define TVMD_TIMINGS_HALVED(x)  (((x) & (TVMD_HRESO_MASK & ~0x0001)) != 0x0000)
 
 /* Determine if address is in VDP2 VRAM */
 #define VRAM_BANK_ADDRESS(x)    ((((x) >> 20) & 0x000000FF) == 0x5E)
@@ -64,25 +153,6 @@ struct scrn_bitmap_format {
                                          *   Mode 3: Swap via Rotation Parameter Window */
 };
 
-#ifdef SCRN_CELL_FORMAT_TEST_IMPL
-struct scrn_cell_format_test_impl {
-        struct {
-                unsigned int scf_character_size:1;
-                unsigned int scf_pnd_size:1;
-                unsigned int scf_auxiliary_mode:1;
-                unsigned int scf_reduction:2;
-                unsigned int scf_plane_size:2;
-                unsigned int scf_rp_mode:2;
-                unsigned int reserved:23;
-        } __packed;
-
-        uint32_t scf_cp_table;          /* Character pattern table lead address */
-        uint32_t scf_color_palette;     /* Color palette lead address */
-
-        uint32_t scf_vcs_table;         /* Vertical cell scroll table lead address */
-};
-#endif /* SCRN_CELL_FORMAT_TEST_IMPL */
-
 struct scrn_cell_format {
         uint8_t scf_character_size;     /* Character size: (1 * 1) or (2 * 2) cells */
         uint8_t scf_pnd_size;           /* Pattern name data size:
@@ -139,6 +209,10 @@ struct scrn_format {
                                          * Bitmap format type */
         uint8_t sf_cc_count;            /* Character color count */
         uint32_t sf_vcs_table;          /* Vertical cell scroll table lead address */
+        uint32_t sf_coefficient_table;  /* RBG0 and RBG1 only
+                                         *
+                                         * Coefficient table lead address
+                                         * (if applicable) */
         uint8_t sf_reduction;           /* Background reduction
                                          * 1
                                          * 1/2 reduction
@@ -167,7 +241,7 @@ struct scrn_format {
 #define VRAM_CTL_CYCP_TIMING_BIT(x)     (((x) & 0x7) << 2)
 
 /* Calculate 32-bit timing mask for T */
-#define VRAM_CTL_CYCP_TIMING_MASK(t)    ((0x0000000F) << VRAM_CTL_CYCP_TIMING_BIT(t))
+#define VRAM_CTL_CYCP_TIMING_MASK(t)    (UINT32_C(0x0000000F) << VRAM_CTL_CYCP_TIMING_BIT(t))
 
 /* Extract timing value T from raw 32-bit cycle pattern value */
 #define VRAM_CTL_CYCP_TIMING_VALUE(pv, t)                                      \
@@ -175,9 +249,10 @@ struct scrn_format {
 
 union vram_cycp {
         /*-
-         * To byte swap (Big-endian):
-         *
-         * __bswap_32(t1.pv[0])
+         * Each value holds T0 at the LSB, whereas the registers hold T0
+         * in the upper 4 bits of CYCxxL. Byte swapping a value does not
+         * give the registers; see vram_cycp_registers_write() for the
+         * big-endian registers.
          */
 
         uint32_t pv[4]; /* VRAM cycle pattern value */
@@ -1,17 +1,29 @@
 #include <sys/cdefs.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
-#include <byteswap.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* The AVX2 path is compiled for its own function only, and taken when
+ * the CPU supports it */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VALIDATE_AVX2
+#include <immintrin.h>
+#endif
 
 #include "vdp2cycp.h"
 
 #include "math.h"
 #include "debug.h"
-
-extern const struct scrn_format *bg_formats[];
+#include "trace.h"
 
 /* Table representing number of VRAM accesses required for pattern name
  * data. */
@@ -128,6 +140,114 @@ static const int8_t _timings_count_vcs[2] = {
         1
 };
 
+/* Table representing number of VRAM accesses required for pattern name
+ * data in hi-res and exclusive monitor TV screen modes, where reduction
+ * is not available. */
+static const int8_t _timings_count_pnd_hires[3][4] = {
+        /* Invalid */
+        {
+                -1,     /* Invalid */
+                -1,     /* Invalid */
+                -1,     /* Invalid */
+        },
+        /* PND 1-word */
+        {
+                 1,     /* No reduction */
+                -1,     /* 1/2 reduction (invalid) */
+                -1,     /* 1/4 reduction (invalid) */
+                -1      /* Invalid */
+        },
+        /* PND 2-word */
+        {
+                 1,     /* No reduction */
+                -1,     /* 1/2 reduction (invalid) */
+                -1,     /* 1/4 reduction (invalid) */
+                -1      /* Invalid */
+        }
+};
+
+/* Table representing number of VRAM accesses required for character
+ * pattern data in hi-res and exclusive monitor TV screen modes, where
+ * reduction is not available, and at most 4 access timings are. */
+static const int8_t _timings_count_cpd_hires[2][5][4] = {
+        /* Cell */
+        {
+                /* Character color count: 16 (palette) */
+                {
+                        1,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 256 (palette) */
+                {
+                        2,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 2048 (palette)*/
+                {
+                        4,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 32,768 (RGB) */
+                {
+                        -1,     /* Invalid */
+                        -1,     /* Invalid */
+                        -1,     /* Invalid */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 16,770,000 (RGB) */
+                {
+                        -1,     /* Invalid */
+                        -1,     /* Invalid */
+                        -1,     /* Invalid */
+                        -1      /* Invalid */
+                }
+        },
+        /* Bitmap */
+        {
+                /* Character color count: 16 (palette) */
+                {
+                        1,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 256 (palette) */
+                {
+                        2,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 2048 (palette)*/
+                {
+                        4,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 32,768 (RGB) */
+                {
+                        4,     /* No reduction */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                },
+                /* Character color count: 16,770,000 (RGB) */
+                {
+                        -1,     /* Invalid (requires 8 access timings) */
+                        -1,     /* 1/2 reduction (invalid) */
+                        -1,     /* 1/4 reduction (invalid) */
+                        -1      /* Invalid */
+                }
+        }
+};
+
 /* Table representing range of access timings for normal TV screen mode.
  *
  * For example, if T0 is selected as the pattern name data access
@@ -185,54 +305,266 @@ static const uint32_t _timings_range_vcs[2] = {
         0xF0000FFF
 };
 
-static int32_t cycp_calculate_timings(const struct scrn_format *, uint8_t *, uint8_t *, uint8_t *);
+/* Number of access timings (T0 to T7) of each VRAM bank */
+#define TIMING_COUNT            8
 
-static void state_init(struct state *state, const struct scrn_format **) __unused;
+/* Number of normal scroll screens (NBG0 to NBG3) timings are allocated
+ * for */
+#define ALLOC_SCRN_COUNT        4
 
-static int32_t pnd_bitmap_calculate(const struct scrn_format *, uint8_t *) __unused;
-static int32_t pnd_bitmap_validate(uint8_t, uint8_t) __unused;
-static int32_t pnd_bitmap_validate_all(const struct state *) __unused;
+/* At most, each NBG has a vertical cell scroll item, and a pattern name
+ * data and character pattern data item per bank */
+#define ALLOC_ITEM_COUNT        (ALLOC_SCRN_COUNT * (1 + (2 * VRAM_BANK_COUNT)))
 
-static int32_t vcs_bitmap_calculate(const struct scrn_format *, uint8_t *) __unused;
-static int32_t vcs_bitmap_validate_all(const struct state *) __unused;
+/* The kinds of reads are in the same order as the CYCP_DEMAND_* kinds */
+#define ALLOC_KIND_VCS          0 /* Vertical cell scroll table data read */
+#define ALLOC_KIND_PND          1 /* Pattern name data read */
+#define ALLOC_KIND_CPD          2 /* Character pattern data read */
+#define ALLOC_KIND_COUNT        3
 
-static int32_t scrn_plane_count_get(const struct scrn_format *) __unused;
+struct alloc_item {
+        uint8_t scrn;
+        uint8_t kind;
+        uint8_t bank;
+        uint8_t count;                  /* Number of access timings required */
+        uint8_t timings;                /* Bit-map of allocated access timings */
+};
 
-int
-main(int argc __unused, char *argv[] __unused)
-{
-        DEBUG_PRINTF("sizeof(union vram_cycp): %lu bytes(s)\n", sizeof(union vram_cycp));
-        DEBUG_PRINTF("sizeof(struct scrn_format): %lu byte(s)\n", sizeof(struct scrn_format));
-        DEBUG_PRINTF("sizeof(struct scrn_cell_format): %lu byte(s)\n", sizeof(struct scrn_cell_format));
-        DEBUG_PRINTF("sizeof(struct scrn_bitmap_format): %lu byte(s)\n", sizeof(struct scrn_bitmap_format));
-        DEBUG_PRINTF("sizeof(_timings_count_pnd): %lu byte(s)\n", sizeof(_timings_count_pnd));
-        DEBUG_PRINTF("sizeof(_timings_count_cpd): %lu byte(s)\n", sizeof(_timings_count_cpd));
-        DEBUG_PRINTF("sizeof(_timings_count_vcs): %lu byte(s)\n", sizeof(_timings_count_vcs));
+/*-
+ * Bit-maps of the ranges of access timings, derived from the access
+ * timing range tables of a TV screen mode once, and shared by every
+ * allocation.
+ */
+struct alloc_ranges {
+        /* Bit-map of access timings available in the TV screen mode */
+        uint8_t timings;
+        /* Range of CPD access timings permitted by each PND access
+         * timing */
+        uint8_t pnd[TIMING_COUNT];
+        /* Range of NBG0 and NBG1 vertical cell scroll access timings */
+        uint8_t vcs[2];
+        /* Widest CPD range possible for each number of PND access
+         * timings */
+        uint8_t cpd_widest[TIMING_COUNT + 1];
+        /* First access timing of the order in which most of the ranges
+         * above are contiguous, as alloc_bank_prune() checks them */
+        uint8_t first;
+};
 
-        DEBUG_PRINTF("sizeof(_timings_range_normal): %lu byte(s)\n", sizeof(_timings_range_normal));
-        DEBUG_PRINTF("sizeof(_timings_range_hires): %lu byte(s)\n", sizeof(_timings_range_hires));
-        DEBUG_PRINTF("sizeof(_timings_range_vcs): %lu byte(s)\n", sizeof(_timings_range_vcs));
-        DEBUG_PRINTF("sizeof(struct state): %lu byte(s)\n", sizeof(struct state));
+struct alloc {
+        struct alloc_item items[ALLOC_ITEM_COUNT];
+        uint32_t item_count;
 
-        struct state state;
+        /* Number of access timings required per bank by item I and the
+         * items following it */
+        uint8_t remaining[ALLOC_ITEM_COUNT + 1][VRAM_BANK_COUNT];
 
-        state_init(&state, bg_formats);
+        /* Items whose access timings are restricted to a range, per
+         * bank */
+        uint8_t ranged_items[VRAM_BANK_COUNT][ALLOC_ITEM_COUNT];
+        uint8_t ranged_item_count[VRAM_BANK_COUNT];
 
-        /* XXX: Place holder */
-        state.ramctl = 0x0000;
+        uint8_t free[VRAM_BANK_COUNT];  /* Bit-map of free access timings */
 
-        int32_t error;
-        error = vdp2cycp(&state);
-        DEBUG_PRINTF("vdp2cycp: %i\n", error);
+        /* Bit-map of access timings character pattern data can be read
+         * at, as constrained by the pattern name data access timings */
+        uint8_t cpd_range[ALLOC_SCRN_COUNT];
 
-        return error;
-}
+        /* Bit-map of access timings NBG1 vertical cell scroll can be
+         * read at, as NBG0 access must be selected first */
+        uint8_t vcs_range_nbg1;
+
+        const struct alloc_ranges *ranges;
+
+        /* Statistics to update, if any */
+        struct cycp_stats *stats;
+};
+
+/* Access code reported as invalid when found in a bank in use */
+#define VALIDATE_CODES_RESERVED 0x0F00
+
+/*-
+ * Demands of the NBGs of a state that each cycle pattern is validated
+ * against.
+ */
+struct validate {
+        /* Number of access timings required and the (merged) bank
+         * bit-map, for each kind of read */
+        uint8_t counts[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+        uint8_t bitmaps[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        /* Set of access codes to match */
+        uint16_t codes;
+
+        /* Bit-map of access timings of the banks in use, one byte per
+         * bank */
+        uint32_t bank_timings;
+
+        const struct alloc_ranges *ranges;
+};
+
+/*-
+ * Banks the tables of the rotational backgrounds are read from, for a
+ * given VRAM partitioning.
+ */
+struct rotation {
+        /* RDBS of each bank, as the bits of RAMCTL */
+        uint16_t rdbs;
+        /* Bit-map of the (merged) banks reserved for the rotation
+         * engine, whose cycle patterns are ignored */
+        uint8_t reserved;
+        /* Bit-maps of the (merged) banks RBG1 reads pattern name data
+         * and character pattern data from, during every access timing
+         * given to NBG0 */
+        uint8_t pnd_bitmap;
+        uint8_t cpd_bitmap;
+};
+
+/*-
+ * Configuration of a batch, gathered from its arrays, as the tables
+ * state_solve() gathers from a state.
+ */
+struct batch_entry {
+        const struct alloc_ranges *ranges;
+        uint16_t ramctl;
+
+        /* Bit-map of enabled scroll screens, by SCRN_* */
+        uint8_t enable_bitmap;
+        /* Bit-map of the rotational backgrounds, by SCRN_*, swapping
+         * rotation parameters via coefficient data without a coefficient
+         * table */
+        uint8_t swap_bitmap;
+        /* Bit-map of the scroll screens storing data beyond the end of
+         * VRAM, by SCRN_* */
+        uint8_t exceeded_bitmap;
+
+        uint8_t timings[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+        /* Where the vertical cell scroll kind of read of a rotational
+         * background is that of its coefficient table */
+        uint8_t bitmaps[SCRN_COUNT][ALLOC_KIND_COUNT];
+};
+
+/* Ranges of the normal, and of the hi-res and exclusive monitor TV
+ * screen modes */
+static struct alloc_ranges _alloc_ranges[2];
+static pthread_once_t _alloc_ranges_once = PTHREAD_ONCE_INIT;
+
+static const struct alloc_ranges *alloc_ranges_get(uint16_t);
+static void alloc_ranges_init(void);
+static uint8_t alloc_cpd_range_widest(const struct alloc_ranges *, uint32_t);
+static uint8_t alloc_ranges_first_get(const struct alloc_ranges *);
+static int32_t alloc_solve(struct alloc *, uint16_t, const uint8_t [][ALLOC_KIND_COUNT],
+    const uint8_t [][ALLOC_KIND_COUNT], union vram_cycp *);
+static void alloc_init(struct alloc *, uint16_t, const uint8_t [][ALLOC_KIND_COUNT],
+    const uint8_t [][ALLOC_KIND_COUNT], uint32_t);
+static bool alloc_feasible(struct alloc *, uint16_t, const uint8_t [][ALLOC_KIND_COUNT],
+    const uint8_t [][ALLOC_KIND_COUNT], uint32_t);
+static bool alloc_demands_exceeded(const struct alloc_ranges *, uint16_t,
+    const uint8_t [][ALLOC_KIND_COUNT], const uint8_t [][ALLOC_KIND_COUNT], uint32_t);
+static bool alloc_search(struct alloc *, uint32_t);
+static void alloc_prune_count(const struct alloc *, uint32_t, uint32_t);
+static bool alloc_bank_prune(const struct alloc *, uint32_t, uint32_t);
+static bool alloc_bank_prune_hall(const uint8_t *, const uint8_t *, uint32_t, uint8_t);
+static uint8_t alloc_item_range(const struct alloc *, const struct alloc_item *);
+static void alloc_vram_cycp_get(const struct alloc *, uint16_t, union vram_cycp *);
+static void alloc_vram_cycp_apply(const struct alloc *, uint16_t, union vram_cycp *);
+static bool alloc_repair(struct alloc *, struct state *, uint8_t);
+
+static int32_t state_solve(struct state *, struct cycp_stats *);
+
+static void batch_entry_get(const struct cycp_batch *, size_t, const struct alloc_ranges *,
+    struct batch_entry *);
+static int32_t batch_entry_solve(struct alloc *, const struct batch_entry *,
+    union vram_cycp *, uint16_t *);
+static int32_t batch_entry_partition_solve(struct alloc *, const struct batch_entry *,
+    uint16_t, union vram_cycp *, uint16_t *);
+
+static int32_t rotation_modes_validate(const struct state *);
+static int32_t rotation_modes_bitmap_validate(uint8_t, uint8_t);
+static int32_t rotation_banks_select(uint16_t, const uint8_t [][ALLOC_KIND_COUNT],
+    struct rotation *);
+static int32_t rotation_banks_select_all(const struct state *, struct rotation *);
+static void rotation_vram_cycp_apply(const struct rotation *, uint16_t, uint8_t,
+    union vram_cycp *);
+static uint8_t rotation_reserved_bitmap(uint16_t);
+
+static void vram_cycp_cpu_fill(uint16_t, union vram_cycp *, uint8_t);
+static uint32_t vram_cycp_cpu_score(uint16_t, const union vram_cycp *, uint8_t, const uint8_t *);
+static uint32_t timing_nibbles_expand(uint8_t);
+
+static int32_t validate_init(const struct state *, struct validate *, struct rotation *);
+static void validate_code_masks_get(const union vram_cycp *, uint16_t, uint32_t *);
+#if defined(VALIDATE_AVX2)
+static void validate_code_masks_pair_get(const union vram_cycp *, uint16_t, uint32_t (*)[16]);
+#endif /* VALIDATE_AVX2 */
+static int8_t validate_pattern(const struct validate *, const struct rotation *,
+    uint16_t, const union vram_cycp *, const uint32_t *);
+static int8_t validate_masks(const struct validate *, const uint32_t *);
+static uint8_t validate_vcs_range_nbg1_get(const struct validate *, const uint32_t *);
+static uint8_t validate_cpd_range_get(const struct validate *, const uint32_t *, uint32_t);
+static uint32_t validate_bank_count(uint32_t, uint8_t, uint8_t);
+
+static void simulate_cell_count(const struct validate *, const struct rotation *, const uint32_t *,
+    uint32_t, struct cycp_sim *);
+
+static int32_t explain_check(struct alloc *, uint16_t, const uint8_t [][ALLOC_KIND_COUNT],
+    const uint8_t [][ALLOC_KIND_COUNT], uint32_t);
+static void explain_demand_describe(const struct scrn_format *, uint32_t, char *, size_t);
+static void explain_cpd_range_narrow(const struct alloc_ranges *, uint16_t,
+    const uint8_t [][ALLOC_KIND_COUNT], const uint8_t [][ALLOC_KIND_COUNT],
+    struct cycp_explain *);
+
+static uint8_t timing_range_bitmap(uint32_t);
+static uint8_t timing_range_rotate(uint8_t, uint8_t);
+static uint8_t timing_range_hull(uint8_t);
+static bool timing_range_contiguous(const struct alloc_ranges *, uint8_t, uint8_t);
+static uint32_t timing_code_nibbles(uint32_t, uint32_t);
+static uint8_t timing_nibbles_compress(uint32_t);
+static uint8_t bank_bitmap_merge(uint16_t, uint8_t);
+
+static int32_t pnd_bitmap_calculate(const struct scrn_format *, uint16_t, uint8_t *) __unused;
+static int32_t pnd_bitmap_validate(uint8_t, uint8_t) __unused;
+static int32_t pnd_bitmap_validate_all(const struct state *) __unused;
+
+static int32_t cpd_bitmap_calculate(const struct scrn_format *, uint16_t, uint8_t *);
+
+static int32_t vcs_bitmap_calculate(const struct scrn_format *, uint16_t, uint8_t *) __unused;
+static int32_t vcs_bitmap_validate(uint16_t, uint8_t, uint8_t);
+static int32_t vcs_bitmap_validate_all(const struct state *) __unused;
+
+static int32_t coefficient_bitmap_calculate(const struct scrn_format *, uint16_t, uint8_t *);
+
+static int32_t scrn_plane_count_get(const struct scrn_format *) __unused;
+
+static int32_t scroll_screen_demands_calculate(struct scroll_screen *, uint16_t, uint16_t);
+static int32_t vram_bounds_validate_all(const struct state *, uint32_t *);
+
+static uint64_t stats_clock(const struct cycp_stats *);
 
 /*-
  * Calculate VDP2 VRAM cycle patterns.
  *
- * If successful, 0 is returned. Otherwise, a negative value is returned
- * for the following cases:
+ * Access timings for vertical cell scroll, pattern name data, and
+ * character pattern data reads of each enabled NBG are placed amongst
+ * the access timings T0 to T7 of the VRAM banks the data is stored in.
+ * Character pattern data reads are constrained to the range permitted
+ * by the pattern name data access timings of the same scroll screen.
+ * Unused access timings are set to no access.
+ *
+ * Each bank the tables (coefficient, pattern name, or character
+ * pattern) of RBG0 are stored in is reserved for the rotation engine,
+ * which reads it during every access timing, and its rotation data bank
+ * select (RDBS) is set. No NBG may read a reserved bank, and each bank
+ * holds a single kind of table. The coefficient table of RBG1 reserves
+ * its bank the same way, while RBG1 reads its pattern name data and
+ * character pattern data during every access timing of its banks, set
+ * to the NBG0 reads. As whether the tables share a bank depends on the
+ * VRAM partitioning, each partitioning is tried in turn when a
+ * rotational background is enabled, starting with that of STATE.
+ *
+ * If successful, 0 is returned and the cycle patterns are written to
+ * STATE, along with the VRAM partitioning and RDBS of its RAMCTL.
+ * Otherwise, a negative value is returned for the following cases:
  *
  *   - -1 STATE is NULL
  *   - -2 Vertical cell scroll is stored in an invalid bank
@@ -240,124 +572,3810 @@ main(int argc __unused, char *argv[] __unused)
  *   - -4 Insufficient number of vertical cell scroll access timings
  *   - -5 Insufficient number of pattern name data access timings
  *   - -6 Insufficient number of character pattern data access timings
+ *   - -7 Rotational background data is stored in an invalid bank
+ *   - -8 Invalid combination of rotational backgrounds, or of rotation
+ *        parameter mode and coefficient table
+ *   - -9 Data is stored beyond the end of VRAM, as sized by the VRSIZE
+ *        of STATE
+ */
+int32_t
+vdp2cycp(struct state *state)
+{
+        return vdp2cycp_stats(state, NULL);
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns, as vdp2cycp() does.
+ *
+ * If STATS is not NULL, it is cleared, then filled with the number of
+ * search nodes visited, the number of prunes per reason, the time spent
+ * per phase, and the number of access timings allocated per bank.
+ *
+ * The value vdp2cycp() returns is returned.
  */
 int32_t
-vdp2cycp(const struct state *state)
+vdp2cycp_stats(struct state *state, struct cycp_stats *stats)
 {
         if (state == NULL) {
                 return -1;
         }
 
-        if ((vcs_bitmap_validate_all(state)) < 0) {
-                return -2;
+        if (stats != NULL) {
+                memset(stats, 0x00, sizeof(*stats));
         }
 
-        if ((pnd_bitmap_validate_all(state)) < 0) {
-                return -3;
+        TRACE_POINT(TRACE_SOLVE_BEGIN, state->ramctl, 0);
+
+        state->solved = false;
+
+        uint16_t ramctl;
+        ramctl = state->ramctl;
+
+        /* Whether the tables of the rotational backgrounds share a bank
+         * depends on the VRAM partitioning */
+        uint32_t partition_count;
+        partition_count = ((state->rbg0.format.sf_enable) ||
+            (state->rbg1.format.sf_enable)) ? 4 : 1;
+
+        int32_t first_ret;
+        first_ret = 0;
+
+        uint32_t partition;
+        for (partition = 0; partition < partition_count; partition++) {
+                /* Starting with the partitioning of STATE */
+                state->ramctl = ramctl ^ (partition << 8);
+
+                int32_t ret;
+                ret = state_solve(state, stats);
+
+                if (ret == 0) {
+                        state->solved = true;
+
+                        TRACE_POINT(TRACE_SOLVE_END, 0, 0);
+
+                        return 0;
+                }
+
+                if (partition == 0) {
+                        first_ret = ret;
+                }
+        }
+
+        state->ramctl = ramctl;
+
+        TRACE_POINT(TRACE_SOLVE_END, first_ret, 0);
+
+        return first_ret;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE for the VRAM partitioning
+ * of its RAMCTL, as vdp2cycp() does, accumulating STATS if not NULL.
+ *
+ * If successful, the cycle patterns, and the RDBS of the RAMCTL of STATE
+ * are written. The value vdp2cycp() returns is returned.
+ */
+static int32_t
+state_solve(struct state *state, struct cycp_stats *stats)
+{
+        int32_t ret;
+        ret = 0;
+
+        uint64_t start;
+        start = stats_clock(stats);
+
+        struct rotation rotation;
+
+        if ((vram_bounds_validate_all(state, NULL)) < 0) {
+                ret = -9;
+        } else if ((vcs_bitmap_validate_all(state)) < 0) {
+                ret = -2;
+        } else if ((pnd_bitmap_validate_all(state)) < 0) {
+                ret = -3;
+        } else if ((rotation_modes_validate(state)) < 0) {
+                ret = -8;
+        } else if ((rotation_banks_select_all(state, &rotation)) < 0) {
+                ret = -7;
+        }
+
+        TRACE_POINT(TRACE_VALIDATE, ret, state->ramctl);
+
+        uint64_t end;
+        end = stats_clock(stats);
+
+        if (stats != NULL) {
+                stats->phase_ns[CYCP_PHASE_VALIDATE] += end - start;
+
+                if (ret == -2) {
+                        stats->prune_counts[CYCP_PRUNE_VCS_BANK]++;
+                } else if (ret == -3) {
+                        stats->prune_counts[CYCP_PRUNE_PND_BANK]++;
+                }
+        }
+
+        if (ret < 0) {
+                return ret;
+        }
+
+        start = end;
+
+        uint8_t timings[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+        uint8_t bitmaps[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        memset(timings, 0x00, sizeof(timings));
+        memset(bitmaps, 0x00, sizeof(bitmaps));
+
+        /* Go in order: NBG0, NBG1, NBG2, then NBG3 */
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                struct scrn_format *format;
+                format = &state->scroll_screens[scrn]->format;
+
+                /* Check if scroll screen is enabled */
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                uint8_t *tvcs;
+                tvcs = &timings[scrn][ALLOC_KIND_VCS];
+                uint8_t *tpnd;
+                tpnd = &timings[scrn][ALLOC_KIND_PND];
+                uint8_t *tcpd;
+                tcpd = &timings[scrn][ALLOC_KIND_CPD];
+
+                if ((ret = cycp_calculate_timings_tvmd(format, state->tvmd, tvcs, tpnd,
+                            tcpd)) < 0) {
+                        return ret;
+                }
+
+                /* Keep the demands vdp2cycp_update() compares against
+                 * those of the TV screen mode solved in */
+                state->scroll_screens[scrn]->tvcs = *tvcs;
+                state->scroll_screens[scrn]->tpnd = *tpnd;
+                state->scroll_screens[scrn]->tcpd = *tcpd;
+
+                DEBUG_PRINTF("--------------------------------------------------------------------------------\n");
+                DEBUG_FORMAT(format);
+
+                DEBUG_PRINTF("tvcs: %i access timing required\n", *tvcs);
+                DEBUG_PRINTF("tpnd: %i access timing required\n", *tpnd);
+                DEBUG_PRINTF("tcpd: %i access timing required\n", *tcpd);
+
+                TRACE_POINT(TRACE_DEMANDS, scrn, *tvcs | (*tpnd << 8) | (*tcpd << 16));
+
+                bitmaps[scrn][ALLOC_KIND_VCS] = state->scroll_screens[scrn]->vcs_bitmap;
+                bitmaps[scrn][ALLOC_KIND_PND] = state->scroll_screens[scrn]->pnd_bitmap;
+                bitmaps[scrn][ALLOC_KIND_CPD] = state->scroll_screens[scrn]->cpd_bitmap;
+
+                TRACE_POINT(TRACE_BITMAPS, scrn, bitmaps[scrn][ALLOC_KIND_VCS] |
+                    (bitmaps[scrn][ALLOC_KIND_PND] << 8) |
+                    (bitmaps[scrn][ALLOC_KIND_CPD] << 16));
+        }
+
+        end = stats_clock(stats);
+
+        if (stats != NULL) {
+                stats->phase_ns[CYCP_PHASE_TIMINGS] += end - start;
+        }
+
+        start = end;
+
+        struct alloc alloc;
+
+        alloc.ranges = alloc_ranges_get(state->tvmd);
+        alloc.stats = stats;
+
+        ret = alloc_solve(&alloc, state->ramctl, timings, bitmaps, &state->vram_cycp);
+
+        if (stats != NULL) {
+                stats->phase_ns[CYCP_PHASE_SEARCH] += stats_clock(stats) - start;
+        }
+
+        if (ret < 0) {
+                return ret;
+        }
+
+        rotation_vram_cycp_apply(&rotation, state->ramctl, alloc.ranges->timings,
+            &state->vram_cycp);
+
+        state->ramctl = (state->ramctl & ~RAMCTL_RDBS_MASK) | rotation.rdbs;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                TRACE_POINT(TRACE_CYCP, bank, state->vram_cycp.pv[bank]);
         }
 
-        /* Go in order: NBG0, NBG1, NBG2, then NBG3 */
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE, as vdp2cycp() does, and
+ * write its registers RAMCTL through CYCB1U to BLOCK, of
+ * VDP2_REG_CYCP_SIZE bytes, as vram_cycp_registers_write() does.
+ *
+ * If the cycle patterns can't be calculated, BLOCK holds the RAMCTL of
+ * STATE, with every access timing set to no access.
+ *
+ * The value vdp2cycp() returns is returned, or -1 if STATE or BLOCK is
+ * NULL.
+ */
+int32_t
+vdp2cycp_registers(struct state *state, uint8_t *block)
+{
+        if ((state == NULL) || (block == NULL)) {
+                return -1;
+        }
+
+        int32_t ret;
+
+        if ((ret = vdp2cycp(state)) < 0) {
+                union vram_cycp vram_cycp;
+
+                memset(&vram_cycp, 0xFF, sizeof(vram_cycp));
+
+                vram_cycp_registers_write(state->ramctl, &vram_cycp, block);
+
+                return ret;
+        }
+
+        vram_cycp_registers_write(state->ramctl, &state->vram_cycp, block);
+
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of each of the N states STATES, as
+ * vdp2cycp_registers() does, writing the N register blocks contiguously
+ * to BLOCKS, of N * VDP2_REG_CYCP_SIZE bytes, and the value vdp2cycp()
+ * returns for each state to RESULTS.
+ *
+ * If successful, 0 is returned. Otherwise, -1 is returned if STATES,
+ * BLOCKS, or RESULTS is NULL.
+ */
+int32_t
+vdp2cycp_registers_bulk(struct state *states, size_t n, uint8_t *blocks, int32_t *results)
+{
+        if ((states == NULL) || (blocks == NULL) || (results == NULL)) {
+                return -1;
+        }
+
+        size_t i;
+        for (i = 0; i < n; i++) {
+                results[i] = vdp2cycp_registers(&states[i], &blocks[i * VDP2_REG_CYCP_SIZE]);
+        }
+
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE, as vdp2cycp() does, after
+ * the scroll screens marked by state_scrn_dirty() have changed.
+ *
+ * Only the demands of the changed scroll screens are calculated again.
+ * If the cycle patterns of STATE hold a solution, the access timings of
+ * the other NBGs are kept, and only the NBGs whose demands changed are
+ * allocated amongst the access timings left. Otherwise, or if that fails, the cycle
+ * patterns are calculated from scratch by vdp2cycp().
+ *
+ * The cycle patterns may differ from those vdp2cycp() calculates, but
+ * satisfy the same constraints. Access timings left open to the CPU by
+ * vdp2cycp_optimize() stay open, unless the cycle patterns are
+ * calculated from scratch. When RAMCTL or TVMD changes, vdp2cycp() must
+ * be called instead.
+ *
+ * The value vdp2cycp() returns is returned.
+ */
+int32_t
+vdp2cycp_update(struct state *state)
+{
+        if (state == NULL) {
+                return -1;
+        }
+
+        uint8_t dirty;
+        dirty = state->dirty;
+
+        state->dirty = 0x00;
+
+        /* Bit-map of dirty NBGs whose demands have changed */
+        uint8_t changed;
+        changed = 0x00;
+
+        bool valid;
+        valid = true;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                if ((dirty & (1 << scrn)) == 0x00) {
+                        continue;
+                }
+
+                struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                struct scroll_screen prev_scroll_screen;
+                prev_scroll_screen = *scroll_screen;
+
+                if (((scroll_screen_demands_calculate(scroll_screen, state->tvmd,
+                                state->vrsize)) < 0) ||
+                    (scroll_screen->vram_exceeded != 0x00)) {
+                        valid = false;
+                }
+
+                if ((scroll_screen->vcs_bitmap != prev_scroll_screen.vcs_bitmap) ||
+                    (scroll_screen->pnd_bitmap != prev_scroll_screen.pnd_bitmap) ||
+                    (scroll_screen->cpd_bitmap != prev_scroll_screen.cpd_bitmap) ||
+                    (scroll_screen->tvcs != prev_scroll_screen.tvcs) ||
+                    (scroll_screen->tpnd != prev_scroll_screen.tpnd) ||
+                    (scroll_screen->tcpd != prev_scroll_screen.tcpd)) {
+                        changed |= 1 << scrn;
+                }
+        }
+
+        if ((!state->solved) || (!valid)) {
+                return vdp2cycp(state);
+        }
+
+        /* A change of a rotational background, such as of its rotation
+         * parameter mode, or a move of its coefficient table, may change
+         * the banks reserved for it without changing its demands */
+        if ((dirty & ~((1 << ALLOC_SCRN_COUNT) - 1)) != 0x00) {
+                return vdp2cycp(state);
+        }
+
+        /* The cycle patterns still hold a solution when no demands have
+         * changed, such as when a plane moves within the same bank */
+        if (changed == 0x00) {
+                return 0;
+        }
+
+        dirty = changed;
+
+        if (((vcs_bitmap_validate_all(state)) < 0) ||
+            ((pnd_bitmap_validate_all(state)) < 0)) {
+                return vdp2cycp(state);
+        }
+
+        /* The banks reserved for the rotational backgrounds depend on
+         * every scroll screen, and on the VRAM partitioning */
+        if ((state->rbg0.format.sf_enable) ||
+            (state->rbg1.format.sf_enable)) {
+                return vdp2cycp(state);
+        }
+
+        struct alloc alloc;
+
+        alloc.ranges = alloc_ranges_get(state->tvmd);
+        alloc.stats = NULL;
+
+        if (!alloc_repair(&alloc, state, dirty)) {
+                return vdp2cycp(state);
+        }
+
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of STATE, as vdp2cycp() does, that
+ * leave the most access timings open to the CPU, as weighted per bank by
+ * OBJECTIVE.
+ *
+ * Every access timing that is not allocated is set to CPU read/write in
+ * place of no access. No search is made over where the reads are
+ * placed: each read is given exactly the number of access timings it
+ * requires from the banks its data is stored in, so the number left free
+ * per bank depends on the VRAM partitioning, not on the placement. If
+ * OBJECTIVE permits the partitioning to change, the solution vdp2cycp()
+ * finds for each partitioning of VRAM-A and VRAM-B is scored, and the
+ * one with the highest weighted count is kept, and written to the RAMCTL
+ * of STATE. When several partitionings have the same count, the one of
+ * STATE is preferred. The second half of a bank that is not partitioned
+ * is not counted, as it is read during the access timings of the first
+ * half, nor are the banks reserved for the rotation engine.
+ *
+ * The value vdp2cycp() returns for the partitioning of STATE is returned
+ * when no partitioning can be solved.
+ */
+int32_t
+vdp2cycp_optimize(struct state *state, const struct cycp_objective *objective)
+{
+        if ((state == NULL) || (objective == NULL)) {
+                return -1;
+        }
+
+        uint16_t ramctl;
+        ramctl = state->ramctl;
+
+        uint32_t partition_count;
+        partition_count = objective->partition ? 4 : 1;
+
+        int32_t first_ret;
+        first_ret = 0;
+
+        bool found;
+        found = false;
+
+        uint32_t best_score;
+        best_score = 0;
+        uint16_t best_ramctl;
+        best_ramctl = ramctl;
+
+        union vram_cycp best_vram_cycp;
+
+        uint32_t partition;
+        for (partition = 0; partition < partition_count; partition++) {
+                /* Starting with the partitioning of STATE */
+                state->ramctl = ramctl ^ (partition << 8);
+
+                int32_t ret;
+                ret = vdp2cycp(state);
+
+                if (partition == 0) {
+                        first_ret = ret;
+                }
+
+                if (ret < 0) {
+                        continue;
+                }
+
+                uint8_t timings;
+                timings = alloc_ranges_get(state->tvmd)->timings;
+
+                vram_cycp_cpu_fill(state->ramctl, &state->vram_cycp, timings);
+
+                uint32_t score;
+                score = vram_cycp_cpu_score(state->ramctl, &state->vram_cycp, timings,
+                    objective->weights);
+
+                if (!found || (score > best_score)) {
+                        found = true;
+
+                        best_score = score;
+                        best_ramctl = state->ramctl;
+                        best_vram_cycp = state->vram_cycp;
+                }
+        }
+
+        state->ramctl = best_ramctl;
+
+        if (!found) {
+                state->solved = false;
+
+                return first_ret;
+        }
+
+        state->vram_cycp = best_vram_cycp;
+        state->solved = true;
+
+        return 0;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of each of the configurations of
+ * the batch BATCH, as vdp2cycp() does.
+ *
+ * The configurations are given as a structure of arrays, read one
+ * element at a time, and each is validated as vdp2cycp() validates a
+ * state, before its access timings are allocated. The ranges of each TV
+ * screen mode are set up once for the whole batch, and a configuration
+ * identical to the one before it reuses its allocation rather than being
+ * decomposed and searched again.
+ *
+ * The result of each configuration is written to BATCH->results, and if
+ * successful, its cycle patterns to BATCH->vram_cycp, and the RAMCTL it
+ * is solved with, including the RDBS of the banks reserved for the
+ * rotation engine, to BATCH->ramctl_solved. The result is one of the
+ * values vdp2cycp() returns.
+ *
+ * A count the access timing tables reject is given as cycp_calculate_timings()
+ * leaves it, negative as an int8_t, and is reported as vdp2cycp() reports
+ * it.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 BATCH, or any of its required arrays, is NULL
+ */
+int32_t
+vdp2cycp_batch(const struct cycp_batch *batch)
+{
+        if ((batch == NULL) ||
+            (batch->ramctl == NULL) ||
+            (batch->vram_cycp == NULL) ||
+            (batch->results == NULL)) {
+                return -1;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                const struct cycp_batch_scrn *batch_scrn;
+                batch_scrn = &batch->scrns[scrn];
+
+                /* An NBG is either disabled in every configuration, or
+                 * its counts and bit-maps are given */
+                if (batch_scrn->tcpd == NULL) {
+                        continue;
+                }
+
+                if ((batch_scrn->tpnd == NULL) ||
+                    (batch_scrn->pnd_bitmap == NULL) ||
+                    (batch_scrn->cpd_bitmap == NULL)) {
+                        return -1;
+                }
+
+                if ((batch_scrn->tvcs != NULL) && (batch_scrn->vcs_bitmap == NULL)) {
+                        return -1;
+                }
+        }
+
+        uint32_t rbg;
+        for (rbg = 0; rbg < 2; rbg++) {
+                const struct cycp_batch_rbg *batch_rbg;
+                batch_rbg = &batch->rbgs[rbg];
+
+                if (batch_rbg->cpd_bitmap == NULL) {
+                        continue;
+                }
+
+                if ((batch_rbg->coefficient_bitmap == NULL) || (batch_rbg->pnd_bitmap == NULL)) {
+                        return -1;
+                }
+
+                if ((batch_rbg->rp_mode != NULL) && (batch_rbg->coefficient_table == NULL)) {
+                        return -1;
+                }
+        }
+
+        /* Both ranges are initialized once, then selected by the TV
+         * screen mode of each configuration */
+        const struct alloc_ranges *ranges;
+        ranges = alloc_ranges_get(TVMD_HRESO_NORMAL_320);
+
+        struct alloc alloc;
+
+        alloc.stats = NULL;
+
+        struct batch_entry entries[2];
+
+        size_t i;
+        for (i = 0; i < batch->count; i++) {
+                struct batch_entry *entry;
+                entry = &entries[i & 1];
+
+                batch_entry_get(batch, i, ranges, entry);
+
+                union vram_cycp *vram_cycp;
+                vram_cycp = &batch->vram_cycp[i];
+
+                uint16_t ramctl_solved;
+
+                if ((i > 0) && ((memcmp(entry, &entries[(i - 1) & 1], sizeof(*entry))) == 0)) {
+                        batch->results[i] = batch->results[i - 1];
+
+                        *vram_cycp = batch->vram_cycp[i - 1];
+
+                        ramctl_solved = (batch->ramctl_solved != NULL) ?
+                            batch->ramctl_solved[i - 1] : entry->ramctl;
+                } else {
+                        batch->results[i] = batch_entry_solve(&alloc, entry, vram_cycp,
+                            &ramctl_solved);
+                }
+
+                if (batch->ramctl_solved != NULL) {
+                        batch->ramctl_solved[i] = ramctl_solved;
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Gather the configuration I of the batch BATCH into ENTRY, where RANGES
+ * are the ranges of the normal TV screen mode, followed by those of the
+ * hi-res and exclusive monitor TV screen modes.
+ */
+static void
+batch_entry_get(const struct cycp_batch *batch, size_t i, const struct alloc_ranges *ranges,
+    struct batch_entry *entry)
+{
+        /* Compared as a whole against the previous configuration */
+        memset(entry, 0x00, sizeof(*entry));
+
+        entry->ranges = &ranges[((batch->tvmd != NULL) && (TVMD_TIMINGS_HALVED(batch->tvmd[i]))) ? 1 : 0];
+        entry->ramctl = batch->ramctl[i];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                const struct cycp_batch_scrn *batch_scrn;
+                batch_scrn = &batch->scrns[scrn];
+
+                if (batch_scrn->tcpd == NULL) {
+                        continue;
+                }
+
+                /* Every enabled NBG reads character pattern data,
+                 * unless a count before it is rejected */
+                if ((batch_scrn->tcpd[i] == 0) && (batch_scrn->tpnd[i] == 0) &&
+                    ((batch_scrn->tvcs == NULL) || (batch_scrn->tvcs[i] == 0))) {
+                        continue;
+                }
+
+                entry->enable_bitmap |= 1 << scrn;
+
+                if ((batch_scrn->vram_exceeded != NULL) && (batch_scrn->vram_exceeded[i] != 0x00)) {
+                        entry->exceeded_bitmap |= 1 << scrn;
+                }
+
+                if (batch_scrn->tvcs != NULL) {
+                        entry->timings[scrn][ALLOC_KIND_VCS] = batch_scrn->tvcs[i];
+                        entry->bitmaps[scrn][ALLOC_KIND_VCS] = batch_scrn->vcs_bitmap[i];
+                }
+
+                entry->timings[scrn][ALLOC_KIND_PND] = batch_scrn->tpnd[i];
+                entry->bitmaps[scrn][ALLOC_KIND_PND] = batch_scrn->pnd_bitmap[i];
+
+                entry->timings[scrn][ALLOC_KIND_CPD] = batch_scrn->tcpd[i];
+                entry->bitmaps[scrn][ALLOC_KIND_CPD] = batch_scrn->cpd_bitmap[i];
+        }
+
+        uint32_t rbg;
+        for (rbg = 0; rbg < 2; rbg++) {
+                const struct cycp_batch_rbg *batch_rbg;
+                batch_rbg = &batch->rbgs[rbg];
+
+                scrn = SCRN_RBG0 + rbg;
+
+                if ((batch_rbg->cpd_bitmap == NULL) || (batch_rbg->cpd_bitmap[i] == 0x00)) {
+                        continue;
+                }
+
+                entry->enable_bitmap |= 1 << scrn;
+
+                if ((batch_rbg->vram_exceeded != NULL) && (batch_rbg->vram_exceeded[i] != 0x00)) {
+                        entry->exceeded_bitmap |= 1 << scrn;
+                }
+
+                if ((batch_rbg->rp_mode != NULL) &&
+                    (batch_rbg->rp_mode[i] == SCRN_RP_MODE_SWAP_COEFFICIENT) &&
+                    (batch_rbg->coefficient_table[i] == 0x00000000)) {
+                        entry->swap_bitmap |= 1 << scrn;
+                }
+
+                entry->bitmaps[scrn][ALLOC_KIND_VCS] = batch_rbg->coefficient_bitmap[i];
+                entry->bitmaps[scrn][ALLOC_KIND_PND] = batch_rbg->pnd_bitmap[i];
+                entry->bitmaps[scrn][ALLOC_KIND_CPD] = batch_rbg->cpd_bitmap[i];
+        }
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of the batch configuration ENTRY
+ * into VRAM_CYCP, as vdp2cycp() does for a state, using the allocation
+ * ALLOC. The RAMCTL it is solved with is written to RAMCTL_SOLVED.
+ *
+ * The value vdp2cycp() returns is returned.
+ */
+static int32_t
+batch_entry_solve(struct alloc *alloc, const struct batch_entry *entry,
+    union vram_cycp *vram_cycp, uint16_t *ramctl_solved)
+{
+        *ramctl_solved = entry->ramctl;
+
+        if (entry->exceeded_bitmap != 0x00) {
+                return -9;
+        }
+
+        /* Whether the tables of the rotational backgrounds share a bank
+         * depends on the VRAM partitioning */
+        uint32_t partition_count;
+        partition_count = ((entry->enable_bitmap & ((1 << SCRN_RBG0) | (1 << SCRN_RBG1))) != 0x00) ? 4 : 1;
+
+        int32_t first_ret;
+        first_ret = 0;
+
+        uint32_t partition;
+        for (partition = 0; partition < partition_count; partition++) {
+                /* Starting with the partitioning of the configuration */
+                uint16_t ramctl;
+                ramctl = entry->ramctl ^ (partition << 8);
+
+                int32_t ret;
+                ret = batch_entry_partition_solve(alloc, entry, ramctl, vram_cycp, ramctl_solved);
+
+                if (ret == 0) {
+                        return 0;
+                }
+
+                if (partition == 0) {
+                        first_ret = ret;
+                }
+        }
+
+        *ramctl_solved = entry->ramctl;
+
+        return first_ret;
+}
+
+/*-
+ * Calculate VDP2 VRAM cycle patterns of the batch configuration ENTRY,
+ * for the VRAM partitioning of RAMCTL, validating it in the order
+ * state_solve() does.
+ *
+ * If successful, the cycle patterns are written to VRAM_CYCP, and RAMCTL
+ * along with its RDBS to RAMCTL_SOLVED. The value vdp2cycp() returns is
+ * returned.
+ */
+static int32_t
+batch_entry_partition_solve(struct alloc *alloc, const struct batch_entry *entry,
+    uint16_t ramctl, union vram_cycp *vram_cycp, uint16_t *ramctl_solved)
+{
+        uint8_t pnd_bitmap;
+        pnd_bitmap = 0x00;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                pnd_bitmap |= entry->bitmaps[scrn][ALLOC_KIND_PND];
+        }
+
+        struct rotation rotation;
+
+        if ((vcs_bitmap_validate(ramctl,
+                    entry->bitmaps[SCRN_NBG0][ALLOC_KIND_VCS],
+                    entry->bitmaps[SCRN_NBG1][ALLOC_KIND_VCS])) < 0) {
+                return -2;
+        }
+
+        if ((pnd_bitmap_validate((ramctl >> 8) & 0x03, pnd_bitmap)) < 0) {
+                return -3;
+        }
+
+        if ((rotation_modes_bitmap_validate(entry->enable_bitmap, entry->swap_bitmap)) < 0) {
+                return -8;
+        }
+
+        if ((rotation_banks_select(ramctl, entry->bitmaps, &rotation)) < 0) {
+                return -7;
+        }
+
+        /* Counts the access timing tables reject are negative, as
+         * cycp_calculate_timings() leaves them */
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                if ((int8_t)entry->timings[scrn][ALLOC_KIND_VCS] < 0) {
+                        return -4;
+                }
+
+                if ((int8_t)entry->timings[scrn][ALLOC_KIND_PND] < 0) {
+                        return -5;
+                }
+
+                if ((int8_t)entry->timings[scrn][ALLOC_KIND_CPD] < 0) {
+                        return -6;
+                }
+        }
+
+        alloc->ranges = entry->ranges;
+
+        int32_t ret;
+
+        if ((ret = alloc_solve(alloc, ramctl, entry->timings, entry->bitmaps, vram_cycp)) < 0) {
+                return ret;
+        }
+
+        rotation_vram_cycp_apply(&rotation, ramctl, alloc->ranges->timings, vram_cycp);
+
+        *ramctl_solved = (ramctl & ~RAMCTL_RDBS_MASK) | rotation.rdbs;
+
+        return 0;
+}
+
+/*-
+ * Return the number of access timings left free in the cycle patterns
+ * VRAM_CYCP, where the VRAM partitioning is RAMCTL.
+ *
+ * The access timings of the second half of a bank that is not
+ * partitioned, and of the banks reserved for the rotation engine, are
+ * not counted.
+ */
+uint32_t
+vram_cycp_free_count(uint16_t ramctl, const union vram_cycp *vram_cycp)
+{
+        uint32_t free_count;
+        free_count = 0;
+
+        uint8_t reserved;
+        reserved = rotation_reserved_bitmap(ramctl);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((reserved & VRAM_BANK_BIT(bank)) != 0x00) {
+                        continue;
+                }
+
+                if ((bank == VRAM_BANK_A1) && ((ramctl & RAMCTL_VRAMD) == 0x0000)) {
+                        continue;
+                }
+
+                if ((bank == VRAM_BANK_B1) && ((ramctl & RAMCTL_VRBMD) == 0x0000)) {
+                        continue;
+                }
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        uint32_t value;
+                        value = VRAM_CTL_CYCP_TIMING_VALUE(vram_cycp->pv[bank], t);
+
+                        if ((value == VRAM_CTL_CYCP_CPU_RW) ||
+                            (value == VRAM_CTL_CYCP_NO_ACCESS)) {
+                                free_count++;
+                        }
+                }
+        }
+
+        return free_count;
+}
+
+/*-
+ * Write the values of the VDP2 registers RAMCTL through CYCB1U, in the
+ * order of the register map, for the cycle patterns VRAM_CYCP and RAMCTL
+ * to REGISTERS, an array of VDP2_REG_CYCP_COUNT values.
+ *
+ * Each cycle pattern is held from T0 at the LSB, while its registers
+ * hold T0 in the upper 4 bits of the lower word.
+ */
+void
+vram_cycp_registers_get(uint16_t ramctl, const union vram_cycp *vram_cycp,
+    uint16_t *registers)
+{
+        registers[0] = ramctl;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint16_t *bank_registers;
+                bank_registers = &registers[1 + (bank * 2)];
+
+                bank_registers[0] = 0x0000;
+                bank_registers[1] = 0x0000;
+
+                uint32_t t;
+                for (t = 0; t < 4; t++) {
+                        bank_registers[0] |= VRAM_CTL_CYCP_TIMING_VALUE(vram_cycp->pv[bank], t) <<
+                            (12 - (t * 4));
+                        bank_registers[1] |= VRAM_CTL_CYCP_TIMING_VALUE(vram_cycp->pv[bank], t + 4) <<
+                            (12 - (t * 4));
+                }
+        }
+}
+
+/*-
+ * Write the VDP2 registers RAMCTL through CYCB1U, as
+ * vram_cycp_registers_get() calculates them, to BLOCK, as laid out in
+ * the register map from RAMCTL on, big-endian. That is, BLOCK is
+ * VDP2_REG_CYCP_SIZE bytes, which may be transferred as-is to
+ * VDP2_REG_BASE + VDP2_REG_RAMCTL.
+ */
+void
+vram_cycp_registers_write(uint16_t ramctl, const union vram_cycp *vram_cycp,
+    uint8_t *block)
+{
+        uint16_t registers[VDP2_REG_CYCP_COUNT];
+
+        vram_cycp_registers_get(ramctl, vram_cycp, registers);
+
+        uint32_t i;
+        for (i = 0; i < VDP2_REG_CYCP_COUNT; i++) {
+                block[(i * 2)] = registers[i] >> 8;
+                block[(i * 2) + 1] = registers[i] & 0xFF;
+        }
+}
+
+/*-
+ * Validate the N cycle patterns PATTERNS against the demands of the NBGs
+ * of STATE, writing the result of each pattern to RESULTS.
+ *
+ * A pattern is valid when, in every bank the data of an NBG is stored
+ * in, there are enough access timings for each kind of read, character
+ * pattern data reads lie in the range permitted by the pattern name data
+ * reads of the same NBG, and vertical cell scroll reads lie in their
+ * range. Access timings of the second half of a bank that is not
+ * partitioned, and of the banks reserved for the rotation engine as
+ * vdp2cycp() selects them, are ignored. Every access timing of the banks
+ * of RBG1 must be set to the NBG0 reads.
+ *
+ * The result of each pattern is 0 if the pattern is valid. Otherwise, it
+ * is one of the following values:
+ *
+ *   - -4 Insufficient number of vertical cell scroll access timings
+ *   - -5 Insufficient number of pattern name data access timings
+ *   - -6 Insufficient number of character pattern data access timings
+ *   - -7 Reserved access code in a bank in use
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 STATE, PATTERNS, or RESULTS is NULL
+ *   - -2 Vertical cell scroll is stored in an invalid bank
+ *   - -3 Pattern name data is stored in an invalid bank
+ *   - -4 Invalid vertical cell scroll
+ *   - -5 Invalid number of pattern name data access timings
+ *   - -6 Invalid number of character pattern data access timings
+ *   - -7 Rotational background data is stored in an invalid bank
+ *   - -8 Invalid combination of rotational backgrounds, or of rotation
+ *        parameter mode and coefficient table
+ *   - -9 Data is stored beyond the end of VRAM, as sized by the VRSIZE
+ *        of STATE
+ */
+int32_t
+vdp2cycp_validate(const struct state *state, const union vram_cycp *patterns,
+    size_t n, int8_t *results)
+{
+        if ((state == NULL) || (patterns == NULL) || (results == NULL)) {
+                return -1;
+        }
+
+        struct validate validate;
+        struct rotation rotation;
+
+        int32_t ret;
+        if ((ret = validate_init(state, &validate, &rotation)) < 0) {
+                return ret;
+        }
+
+        size_t i;
+        i = 0;
+
+#if defined(VALIDATE_AVX2)
+        if (__builtin_cpu_supports("avx2")) {
+                for (; (i + 1) < n; i += 2) {
+                        uint32_t masks[2][16];
+
+                        validate_code_masks_pair_get(&patterns[i], validate.codes, masks);
+
+                        results[i] = validate_pattern(&validate, &rotation, state->ramctl,
+                            &patterns[i], masks[0]);
+                        results[i + 1] = validate_pattern(&validate, &rotation, state->ramctl,
+                            &patterns[i + 1], masks[1]);
+                }
+        }
+#endif /* VALIDATE_AVX2 */
+
+        for (; i < n; i++) {
+                uint32_t masks[16];
+
+                validate_code_masks_get(&patterns[i], validate.codes, masks);
+
+                results[i] = validate_pattern(&validate, &rotation, state->ramctl,
+                    &patterns[i], masks);
+        }
+
+        return 0;
+}
+
+/*-
+ * Approximate the VRAM reads of the N cycle patterns PATTERNS over a
+ * frame of the TV screen mode of STATE, writing the reads of each pattern
+ * to RESULTS.
+ *
+ * The reads of a single cell are counted, and multiplied by the number of
+ * cells of 8 dots of the display area of a frame: the cycle pattern of
+ * each bank is taken to repeat identically for every cell, with its
+ * access timings in the order of the dots, and no state is carried over
+ * from one cell or scanline to the next. Blanking is not counted. In each
+ * bank, a scroll screen reads the data of each kind it stores there in
+ * as many access timings as it requires per cell, from the first access
+ * timing with its access code. Character pattern data can only be read
+ * once the pattern name data it depends on is, within the range of every
+ * pattern name data access timing of the same scroll screen, and the
+ * NBG1 vertical cell scroll only after that of NBG0. A read a scroll
+ * screen requires but is not given stalls the display of the cell.
+ *
+ * The demands are those vdp2cycp_validate() validates against. Access
+ * timings of the second half of a bank that is not partitioned, and of
+ * the banks reserved for the rotation engine, are not simulated. RBG1
+ * reads in every access timing of its banks.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the same cases as vdp2cycp_validate().
+ */
+int32_t
+vdp2cycp_simulate(const struct state *state, const union vram_cycp *patterns,
+    size_t n, struct cycp_sim *results)
+{
+        /* Number of dots of a scanline, which the exclusive monitor TV
+         * screen modes share with the others */
+        static const uint16_t dot_counts[] = {
+                320,
+                352,
+                640,
+                704
+        };
+
+        static const uint16_t line_counts[] = {
+                224,
+                240,
+                256,
+                256     /* Invalid */
+        };
+
+        if ((state == NULL) || (patterns == NULL) || (results == NULL)) {
+                return -1;
+        }
+
+        struct validate validate;
+        struct rotation rotation;
+
+        int32_t ret;
+        if ((ret = validate_init(state, &validate, &rotation)) < 0) {
+                return ret;
+        }
+
+        uint16_t dot_count;
+        dot_count = dot_counts[state->tvmd & 0x0003];
+        uint16_t line_count;
+        line_count = line_counts[(state->tvmd & TVMD_VRESO_MASK) >> 4];
+
+        if ((state->tvmd & TVMD_LSMD_MASK) == TVMD_LSMD_DOUBLE_INTERLACE) {
+                line_count *= 2;
+        }
+
+        /* Each cell is read during one cycle of the access timings, as
+         * many as there are in the TV screen mode */
+        uint32_t cell_count;
+        cell_count = (dot_count / 8) * line_count;
+
+        size_t i;
+        for (i = 0; i < n; i++) {
+                struct cycp_sim *sim;
+                sim = &results[i];
+
+                memset(sim, 0x00, sizeof(*sim));
+
+                sim->dot_count = dot_count;
+                sim->line_count = line_count;
+
+                uint32_t masks[16];
+
+                validate_code_masks_get(&patterns[i], 0xFFFF, masks);
+
+                simulate_cell_count(&validate, &rotation, masks, cell_count, sim);
+
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        struct cycp_sim_bank *sim_bank;
+                        sim_bank = &sim->banks[bank];
+
+                        if (sim_bank->timing_count == 0) {
+                                continue;
+                        }
+
+                        sim_bank->utilization = (sim_bank->fetch_count * UINT64_C(1000)) /
+                            sim_bank->timing_count;
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Explain why the cycle patterns of STATE can't be calculated, by
+ * finding a minimal set of demands that still conflict, and write it to
+ * EXPLAIN.
+ *
+ * Each demand is one kind of read (vertical cell scroll, pattern name
+ * data, or character pattern data) of a scroll screen, stored in the
+ * banks of its data. Starting from every demand, each is dropped in turn
+ * if the demands left still conflict. Removing any one demand of the set
+ * found resolves the conflict, though other such sets may exist. The
+ * same checks as vdp2cycp() are made.
+ *
+ * The reads of the coefficient table of the rotational backgrounds are
+ * demands of the vertical cell scroll kind.
+ *
+ * If the format of a scroll screen is not supported, the set is the
+ * demand of that scroll screen found to be invalid. If the rotational
+ * backgrounds are enabled in an invalid combination, the set is the
+ * demands of the rotational background at fault. If data is stored
+ * beyond the end of VRAM, the set is every demand of such data. If the
+ * cycle patterns can be calculated, the set is empty and EXPLAIN->ERROR
+ * is 0. If the character pattern data of a scroll screen of the set
+ * can't fit in the range its pattern name data access timings leave,
+ * EXPLAIN->PND_COUNT is set, and the range is given instead.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 STATE or EXPLAIN is NULL
+ */
+int32_t
+vdp2cycp_explain(const struct state *state, struct cycp_explain *explain)
+{
+        if ((state == NULL) || (explain == NULL)) {
+                return -1;
+        }
+
+        memset(explain, 0x00, sizeof(*explain));
+
+        uint8_t timings[SCRN_COUNT][ALLOC_KIND_COUNT];
+        uint8_t bitmaps[SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        memset(timings, 0x00, sizeof(timings));
+        memset(bitmaps, 0x00, sizeof(bitmaps));
+
+        uint32_t demands;
+        demands = 0;
+
+        uint32_t scrn;
+
+        /* Each demand whose data is stored beyond the end of VRAM is in
+         * conflict with the VRAM size alone */
+        if ((vram_bounds_validate_all(state, &demands)) < 0) {
+                explain->error = -9;
+                explain->demands = demands;
+
+                return 0;
+        }
+
+        int32_t ret;
+        if ((ret = rotation_modes_validate(state)) < 0) {
+                scrn = (ret == -3) ? SCRN_RBG0 : SCRN_RBG1;
+
+                explain->error = -8;
+                explain->demands = CYCP_DEMAND_BIT(scrn, ALLOC_KIND_CPD);
+
+                return 0;
+        }
+
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                if (!scroll_screen->format.sf_enable) {
+                        continue;
+                }
+
+                /* Only the banks of the tables of the rotational
+                 * backgrounds are validated */
+                if (scrn >= ALLOC_SCRN_COUNT) {
+                        bitmaps[scrn][ALLOC_KIND_VCS] = scroll_screen->coefficient_bitmap;
+                        bitmaps[scrn][ALLOC_KIND_PND] = scroll_screen->pnd_bitmap;
+                        bitmaps[scrn][ALLOC_KIND_CPD] = scroll_screen->cpd_bitmap;
+
+                        uint32_t kind;
+                        for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                                if (bitmaps[scrn][kind] != 0x00) {
+                                        timings[scrn][kind] = 1;
+
+                                        demands |= CYCP_DEMAND_BIT(scrn, kind);
+                                }
+                        }
+
+                        continue;
+                }
+
+                uint8_t *counts;
+                counts = timings[scrn];
+
+                if ((ret = cycp_calculate_timings_tvmd(&scroll_screen->format,
+                            state->tvmd,
+                            &counts[ALLOC_KIND_VCS],
+                            &counts[ALLOC_KIND_PND],
+                            &counts[ALLOC_KIND_CPD])) < 0) {
+                        /* The error of cycp_calculate_timings() is
+                         * that of the kind of read found invalid */
+                        uint32_t kind;
+                        kind = ALLOC_KIND_VCS + (-4 - ret);
+
+                        explain->error = ret;
+                        explain->demands = CYCP_DEMAND_BIT(scrn, kind);
+
+                        return 0;
+                }
+
+                bitmaps[scrn][ALLOC_KIND_VCS] = scroll_screen->vcs_bitmap;
+                bitmaps[scrn][ALLOC_KIND_PND] = scroll_screen->pnd_bitmap;
+                bitmaps[scrn][ALLOC_KIND_CPD] = scroll_screen->cpd_bitmap;
+
+                uint32_t kind;
+                for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                        if (counts[kind] > 0) {
+                                demands |= CYCP_DEMAND_BIT(scrn, kind);
+                        }
+                }
+        }
+
+        struct alloc alloc;
+
+        alloc.ranges = alloc_ranges_get(state->tvmd);
+        alloc.stats = NULL;
+
+        if ((explain_check(&alloc, state->ramctl, timings, bitmaps, demands)) == 0) {
+                return 0;
+        }
+
+        uint32_t bit;
+        for (bit = 0; bit < (SCRN_COUNT * ALLOC_KIND_COUNT); bit++) {
+                uint32_t dropped;
+                dropped = demands & ~(UINT32_C(1) << bit);
+
+                if ((dropped != demands) &&
+                    ((explain_check(&alloc, state->ramctl, timings, bitmaps, dropped)) < 0)) {
+                        demands = dropped;
+                }
+        }
+
+        explain->error = explain_check(&alloc, state->ramctl, timings, bitmaps, demands);
+        explain->demands = demands;
+
+        /* The banks in common, or every bank when the demands conflict
+         * over where their data is stored */
+        uint8_t common_bitmap;
+        common_bitmap = 0x0F;
+        uint8_t all_bitmap;
+        all_bitmap = 0x00;
+
+        uint8_t bank_required[VRAM_BANK_COUNT];
+
+        memset(bank_required, 0x00, sizeof(bank_required));
+
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                uint32_t kind;
+                for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                        if ((demands & CYCP_DEMAND_BIT(scrn, kind)) == 0) {
+                                continue;
+                        }
+
+                        uint8_t bitmap;
+                        bitmap = bitmaps[scrn][kind];
+
+                        all_bitmap |= bitmap;
+
+                        /* The rotational backgrounds are allocated no
+                         * access timings */
+                        if ((explain->error > -4) || (scrn >= ALLOC_SCRN_COUNT)) {
+                                continue;
+                        }
+
+                        bitmap = bank_bitmap_merge(state->ramctl, bitmap);
+
+                        common_bitmap &= bitmap;
+
+                        uint32_t bank;
+                        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                                if ((bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                                        bank_required[bank] += timings[scrn][kind];
+                                }
+                        }
+
+                        switch (kind) {
+                        case ALLOC_KIND_VCS:
+                                explain->timings |= alloc.ranges->vcs[scrn];
+                                break;
+                        case ALLOC_KIND_PND:
+                                explain->timings |= alloc.ranges->timings;
+                                break;
+                        case ALLOC_KIND_CPD:
+                                if ((demands & CYCP_DEMAND_BIT(scrn, ALLOC_KIND_PND)) != 0) {
+                                        explain->timings |=
+                                            alloc.ranges->cpd_widest[timings[scrn][ALLOC_KIND_PND]];
+                                } else {
+                                        explain->timings |= alloc.ranges->timings;
+                                }
+                                break;
+                        }
+                }
+        }
+
+        explain->bank_bitmap = ((explain->error <= -4) && (common_bitmap != 0x00)) ?
+            common_bitmap : all_bitmap;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((explain->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                if (bank_required[bank] > explain->required) {
+                        explain->required = bank_required[bank];
+                }
+        }
+
+        if (explain->error == -6) {
+                explain_cpd_range_narrow(alloc.ranges, state->ramctl, timings, bitmaps,
+                    explain);
+        }
+
+        return 0;
+}
+
+/*-
+ * Determine if the character pattern data of a scroll screen of the
+ * conflict EXPLAIN can't fit in the range left by the pattern name data
+ * access timings of the same scroll screen, however they are chosen,
+ * where the VRAM partitioning is RAMCTL. If so, the widest range left,
+ * and the banks of the scroll screen, are written to EXPLAIN.
+ *
+ * When both are read from the same bank, the pattern name data access
+ * timings are taken from the range.
+ */
+static void
+explain_cpd_range_narrow(const struct alloc_ranges *ranges, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT], struct cycp_explain *explain)
+{
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                if (((explain->demands & CYCP_DEMAND_BIT(scrn, ALLOC_KIND_PND)) == 0) ||
+                    ((explain->demands & CYCP_DEMAND_BIT(scrn, ALLOC_KIND_CPD)) == 0)) {
+                        continue;
+                }
+
+                uint8_t tpnd;
+                tpnd = timings_table[scrn][ALLOC_KIND_PND];
+                uint8_t tcpd;
+                tcpd = timings_table[scrn][ALLOC_KIND_CPD];
+
+                uint8_t pnd_bitmap;
+                pnd_bitmap = bank_bitmap_merge(ramctl, bitmaps_table[scrn][ALLOC_KIND_PND]);
+                uint8_t cpd_bitmap;
+                cpd_bitmap = bank_bitmap_merge(ramctl, bitmaps_table[scrn][ALLOC_KIND_CPD]);
+
+                bool shared;
+                shared = (pnd_bitmap & cpd_bitmap) != 0x00;
+
+                /* The widest range left by any choice of TPND access
+                 * timings */
+                uint8_t widest_range;
+                widest_range = 0x00;
+
+                uint32_t pnd_timings;
+                for (pnd_timings = 0x00; pnd_timings <= 0xFF; pnd_timings++) {
+                        if (((pnd_timings & ~ranges->timings) != 0x00) ||
+                            (bit_count(pnd_timings) != tpnd)) {
+                                continue;
+                        }
+
+                        uint8_t range;
+                        range = ranges->timings;
+
+                        uint32_t t;
+                        for (t = 0; t < TIMING_COUNT; t++) {
+                                if ((pnd_timings & (1 << t)) != 0x00) {
+                                        range &= ranges->pnd[t];
+                                }
+                        }
+
+                        if (shared) {
+                                range &= ~pnd_timings;
+                        }
+
+                        if (bit_count(range) > bit_count(widest_range)) {
+                                widest_range = range;
+                        }
+                }
+
+                if (bit_count(widest_range) >= tcpd) {
+                        continue;
+                }
+
+                explain->bank_bitmap = shared ? (pnd_bitmap & cpd_bitmap) : cpd_bitmap;
+                explain->timings = widest_range;
+                explain->required = tcpd;
+                explain->pnd_count = tpnd;
+
+                return;
+        }
+}
+
+/*-
+ * Write the explanation EXPLAIN of the conflict of STATE, as found by
+ * vdp2cycp_explain(), as a line of text to BUFFER of SIZE bytes, such as
+ * "NBG0 256-color CPD + NBG1 1/2 reduction PND both need bank A0 T0-T3 (6
+ * access timings)".
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 STATE, EXPLAIN, or BUFFER is NULL
+ *   - -2 There is no conflict to explain
+ */
+int32_t
+vdp2cycp_explain_format(const struct state *state, const struct cycp_explain *explain,
+    char *buffer, size_t size)
+{
+        static const char *bank_names[VRAM_BANK_COUNT] = {
+                "A0",
+                "A1",
+                "B0",
+                "B1"
+        };
+
+        if ((state == NULL) || (explain == NULL) || (buffer == NULL)) {
+                return -1;
+        }
+
+        if ((explain->error == 0) || (explain->demands == 0)) {
+                return -2;
+        }
+
+        char text[256];
+        size_t length;
+        length = 0;
+
+        uint32_t demand_count;
+        demand_count = 0;
+
+        text[0] = '\0';
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                uint32_t kind;
+                for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                        if ((explain->demands & CYCP_DEMAND_BIT(scrn, kind)) == 0) {
+                                continue;
+                        }
+
+                        char description[64];
+
+                        explain_demand_describe(&state->scroll_screens[scrn]->format,
+                            kind, description, sizeof(description));
+
+                        length += snprintf(&text[length], sizeof(text) - length, "%s%s",
+                            (demand_count > 0) ? " + " : "", description);
+
+                        if (length >= sizeof(text)) {
+                                length = sizeof(text) - 1;
+                        }
+
+                        demand_count++;
+                }
+        }
+
+        if (explain->error == -9) {
+                (void)snprintf(buffer, size, "%s %s stored beyond the end of %s-Mbit VRAM",
+                    text, (demand_count == 1) ? "is" : "are",
+                    ((state->vrsize & VRSIZE_VRAMSZ) != 0x0000) ? "8" : "4");
+
+                return 0;
+        }
+
+        if (explain->error == -8) {
+                switch (rotation_modes_validate(state)) {
+                case -1:
+                        (void)snprintf(buffer, size, "%s needs RBG0 to be enabled", text);
+                        return 0;
+                case -2:
+                        (void)snprintf(buffer, size, "%s can't be enabled along with the NBGs",
+                            text);
+                        return 0;
+                default:
+                        (void)snprintf(buffer, size,
+                            "%s needs a coefficient table in rotation parameter mode 2", text);
+                        return 0;
+                }
+        }
+
+        /* Formats that are not supported */
+        if ((explain->error <= -4) && (explain->bank_bitmap == 0x00)) {
+                (void)snprintf(buffer, size, "%s is not supported", text);
+
+                return 0;
+        }
+
+        char banks[32];
+        size_t banks_length;
+        banks_length = 0;
+
+        uint32_t bank_count;
+        bank_count = 0;
+
+        banks[0] = '\0';
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((explain->bank_bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                banks_length += snprintf(&banks[banks_length], sizeof(banks) - banks_length,
+                    "%s%s", (bank_count > 0) ? ", " : "", bank_names[bank]);
+
+                bank_count++;
+        }
+
+        const char *verb;
+        verb = (demand_count == 1) ? "needs" : ((demand_count == 2) ? "both need" : "need");
+
+        switch (explain->error) {
+        case -2:
+                (void)snprintf(buffer, size,
+                    "%s %s bank%s %s, but vertical cell scroll must be read from one bank",
+                    text, verb, (bank_count == 1) ? "" : "s", banks);
+                return 0;
+        case -3:
+                (void)snprintf(buffer, size,
+                    "%s %s bank%s %s, where pattern name data can't be stored together",
+                    text, verb, (bank_count == 1) ? "" : "s", banks);
+                return 0;
+        case -7:
+                (void)snprintf(buffer, size,
+                    "%s %s bank%s %s, but a bank reserved for rotation data can't be shared",
+                    text, verb, (bank_count == 1) ? "" : "s", banks);
+                return 0;
+        }
+
+        /* Access timings as a range, or as a list */
+        char timings[32];
+        size_t timings_length;
+        timings_length = 0;
+
+        uint8_t first;
+        first = explain->timings & -explain->timings;
+        uint8_t span;
+        span = explain->timings + first;
+
+        if ((explain->timings != 0x00) && ((span & (span - 1)) == 0x00)) {
+                uint32_t first_t;
+                first_t = bit_count(first - 1);
+                uint32_t last_t;
+                last_t = first_t + bit_count(explain->timings) - 1;
+
+                if (first_t == last_t) {
+                        (void)snprintf(timings, sizeof(timings), "T%u", first_t);
+                } else {
+                        (void)snprintf(timings, sizeof(timings), "T%u-T%u", first_t, last_t);
+                }
+        } else {
+                timings[0] = '\0';
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        if ((explain->timings & (1 << t)) == 0x00) {
+                                continue;
+                        }
+
+                        timings_length += snprintf(&timings[timings_length],
+                            sizeof(timings) - timings_length, "%sT%u",
+                            (timings_length > 0) ? ", " : "", t);
+                }
+        }
+
+        if (explain->pnd_count > 0) {
+                (void)snprintf(buffer, size, "%s conflict: %u PND access timings leave "
+                    "the CPD at most %s of bank%s %s (%u access timing%s, %u needed)", text,
+                    explain->pnd_count, (explain->timings != 0x00) ? timings : "none",
+                    (bank_count == 1) ? "" : "s", banks, bit_count(explain->timings),
+                    (bit_count(explain->timings) == 1) ? "" : "s", explain->required);
+
+                return 0;
+        }
+
+        /* The access timings would suffice, were it not for the CPD
+         * ranges */
+        if ((explain->error == -6) && (explain->required <= bit_count(explain->timings))) {
+                (void)snprintf(buffer, size, "%s %s bank%s %s %s (%u access timings), but "
+                    "the PND access timings leave the CPD too narrow a range", text,
+                    verb, (bank_count == 1) ? "" : "s", banks, timings, explain->required);
+
+                return 0;
+        }
+
+        (void)snprintf(buffer, size, "%s %s bank%s %s %s (%u access timings)", text,
+            verb, (bank_count == 1) ? "" : "s", banks, timings, explain->required);
+
+        return 0;
+}
+
+int32_t
+cycp_calculate_timings(
+        const struct scrn_format *format,
+        uint8_t *tvcs,
+        uint8_t *tpnd,
+        uint8_t *tcpd)
+{
+        return cycp_calculate_timings_tvmd(format, TVMD_HRESO_NORMAL_320, tvcs, tpnd, tcpd);
+}
+
+/*-
+ * Calculate the number of access timings required by the format FORMAT,
+ * as cycp_calculate_timings() does, in the TV screen mode TVMD.
+ */
+int32_t
+cycp_calculate_timings_tvmd(
+        const struct scrn_format *format,
+        uint16_t tvmd,
+        uint8_t *tvcs,
+        uint8_t *tpnd,
+        uint8_t *tcpd)
+{
+        bool halved;
+        halved = TVMD_TIMINGS_HALVED(tvmd);
+
+        *tvcs = 0;
+        *tpnd = 0;
+        *tcpd = 0;
+
+        /* Determine if vertical cell scroll is used */
+        if ((format->sf_type == SCRN_TYPE_CELL) &&
+            (VRAM_BANK_ADDRESS(format->sf_vcs_table))) {
+                /* Only NBG0 and NBG1 are capable of vertical cell
+                 * scroll */
+                if (format->sf_scroll_screen > SCRN_NBG1) {
+                        /* Left negative, as a count the tables
+                         * reject */
+                        *tvcs = (uint8_t)-1;
+
+                        return -4;
+                }
+
+                *tvcs = _timings_count_vcs[format->sf_scroll_screen];
+
+                if ((int8_t)*tvcs < 0) {
+                        return -4;
+                }
+        }
+
+        /* Determine how many PND access timings are needed (due
+         * to reduction) */
+        if (format->sf_type == SCRN_TYPE_CELL) {
+                const struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                *tpnd = halved ?
+                    _timings_count_pnd_hires[cell_format->scf_pnd_size][format->sf_reduction] :
+                    _timings_count_pnd[cell_format->scf_pnd_size][format->sf_reduction];
+
+                /* Invalid number of PND access timings */
+                if ((int8_t)*tpnd < 0) {
+                        return -5;
+                }
+        }
+
+        /* Determine how many CPD access timings are needed (due
+         * to reduction) and character color count */
+        *tcpd = halved ?
+            _timings_count_cpd_hires[format->sf_type][format->sf_cc_count][format->sf_reduction] :
+            _timings_count_cpd[format->sf_type][format->sf_cc_count][format->sf_reduction];
+
+        /* Invalid number of PND access timings */
+        if ((int8_t)*tcpd < 0) {
+                return -6;
+        }
+
+        return 0;
+}
+
+/*-
+ * Write the ranges of access timings of the TV screen mode TVMD to
+ * RANGES, as bit-maps of the access timing range tables.
+ */
+void
+cycp_calculate_ranges(uint16_t tvmd, struct cycp_ranges *ranges)
+{
+        const struct alloc_ranges *alloc_ranges;
+        alloc_ranges = alloc_ranges_get(tvmd);
+
+        ranges->timings = alloc_ranges->timings;
+
+        (void)memcpy(ranges->pnd, alloc_ranges->pnd, sizeof(ranges->pnd));
+        (void)memcpy(ranges->vcs, alloc_ranges->vcs, sizeof(ranges->vcs));
+}
+
+/*-
+ * Check if the demands in the bit-map DEMANDS conflict, where the
+ * demands require TIMINGS_TABLE access timings from the banks in
+ * BITMAPS_TABLE, per scroll screen for each kind of read. As vdp2cycp()
+ * does, each VRAM partitioning is tried in turn when a rotational
+ * background is demanded.
+ *
+ * If there is no conflict, 0 is returned. Otherwise, the value
+ * vdp2cycp() returns is returned.
+ */
+static int32_t
+explain_check(struct alloc *alloc, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT], uint32_t demands)
+{
+        uint8_t timings[SCRN_COUNT][ALLOC_KIND_COUNT];
+        uint8_t bitmaps[SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        uint8_t pnd_bitmap;
+        pnd_bitmap = 0x00;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                uint32_t kind;
+                for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                        bool demanded;
+                        demanded = (demands & CYCP_DEMAND_BIT(scrn, kind)) != 0;
+
+                        timings[scrn][kind] = demanded ? timings_table[scrn][kind] : 0;
+                        bitmaps[scrn][kind] = demanded ? bitmaps_table[scrn][kind] : 0x00;
+                }
+
+                if (scrn < ALLOC_SCRN_COUNT) {
+                        pnd_bitmap |= bitmaps[scrn][ALLOC_KIND_PND];
+                }
+        }
+
+        uint32_t partition_count;
+        partition_count = ((demands >> (ALLOC_SCRN_COUNT * ALLOC_KIND_COUNT)) != 0) ? 4 : 1;
+
+        int32_t first_ret;
+        first_ret = 0;
+
+        uint32_t partition;
+        for (partition = 0; partition < partition_count; partition++) {
+                uint16_t partition_ramctl;
+                partition_ramctl = ramctl ^ (partition << 8);
+
+                struct rotation rotation;
+
+                int32_t ret;
+
+                if ((vcs_bitmap_validate(partition_ramctl,
+                            bitmaps[SCRN_NBG0][ALLOC_KIND_VCS],
+                            bitmaps[SCRN_NBG1][ALLOC_KIND_VCS])) < 0) {
+                        ret = -2;
+                } else if ((pnd_bitmap_validate((partition_ramctl >> 8) & 0x03,
+                            pnd_bitmap)) < 0) {
+                        ret = -3;
+                } else if ((rotation_banks_select(partition_ramctl, bitmaps,
+                            &rotation)) < 0) {
+                        ret = -7;
+                } else {
+                        union vram_cycp vram_cycp;
+
+                        ret = alloc_solve(alloc, partition_ramctl, timings, bitmaps,
+                            &vram_cycp);
+                }
+
+                if (ret == 0) {
+                        return 0;
+                }
+
+                if (partition == 0) {
+                        first_ret = ret;
+                }
+        }
+
+        return first_ret;
+}
+
+/*-
+ * Write a description of the read of kind KIND of the scroll screen of
+ * format FORMAT, such as "NBG0 256-color CPD", to BUFFER of SIZE bytes.
+ */
+static void
+explain_demand_describe(const struct scrn_format *format, uint32_t kind,
+    char *buffer, size_t size)
+{
+        static const char *scrn_names[SCRN_COUNT] = {
+                "NBG0",
+                "NBG1",
+                "NBG2",
+                "NBG3",
+                "RBG0",
+                "RBG1"
+        };
+
+        static const char *cc_count_names[] = {
+                "16-color",
+                "256-color",
+                "2048-color",
+                "32768-color RGB",
+                "16M-color RGB"
+        };
+
+        static const char *reduction_names[] = {
+                "",
+                " 1/2 reduction",
+                " 1/4 reduction",
+                " invalid reduction"
+        };
+
+        const char *scrn_name;
+        scrn_name = (format->sf_scroll_screen < SCRN_COUNT) ?
+            scrn_names[format->sf_scroll_screen] : "?";
+        const char *reduction_name;
+        reduction_name = reduction_names[format->sf_reduction & 0x03];
+
+        switch (kind) {
+        case ALLOC_KIND_VCS:
+                (void)snprintf(buffer, size, "%s %s", scrn_name,
+                    (format->sf_scroll_screen >= SCRN_RBG0) ? "coefficient table" : "VCS");
+                break;
+        case ALLOC_KIND_PND:
+                (void)snprintf(buffer, size, "%s%s PND", scrn_name, reduction_name);
+                break;
+        case ALLOC_KIND_CPD:
+                (void)snprintf(buffer, size, "%s %s%s%s CPD", scrn_name,
+                    (format->sf_cc_count <= SCRN_CCC_RGB_16770000) ?
+                    cc_count_names[format->sf_cc_count] : "invalid color",
+                    (format->sf_type == SCRN_TYPE_BITMAP) ? " bitmap" : "",
+                    reduction_name);
+                break;
+        }
+}
+
+/*-
+ * Return the access timing ranges of the TV screen mode TVMD,
+ * initializing them on first use.
+ */
+static const struct alloc_ranges *
+alloc_ranges_get(uint16_t tvmd)
+{
+        (void)pthread_once(&_alloc_ranges_once, alloc_ranges_init);
+
+        return &_alloc_ranges[TVMD_TIMINGS_HALVED(tvmd) ? 1 : 0];
+}
+
+static void
+alloc_ranges_init(void)
+{
+        static const uint32_t *timings_ranges[2] = {
+                _timings_range_normal,
+                _timings_range_hires
+        };
+
+        uint32_t i;
+        for (i = 0; i < 2; i++) {
+                struct alloc_ranges *ranges;
+                ranges = &_alloc_ranges[i];
+
+                /* Only T0 to T3 are available in hi-res and exclusive
+                 * monitor modes */
+                ranges->timings = (i == 0) ? 0xFF : 0x0F;
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        ranges->pnd[t] = timing_range_bitmap(timings_ranges[i][t]) &
+                            ranges->timings;
+                }
+
+                ranges->vcs[0] = timing_range_bitmap(_timings_range_vcs[0]) & ranges->timings;
+                ranges->vcs[1] = timing_range_bitmap(_timings_range_vcs[1]) & ranges->timings;
+
+                uint32_t count;
+                for (count = 0; count <= TIMING_COUNT; count++) {
+                        ranges->cpd_widest[count] = alloc_cpd_range_widest(ranges, count);
+                }
+
+                ranges->first = alloc_ranges_first_get(ranges);
+        }
+}
+
+/*-
+ * Return the first access timing of the order of the access timings of
+ * RANGES, starting from that access timing and wrapping around, in which
+ * the most ranges are contiguous. The access timings the TV screen mode
+ * lacks are ignored.
+ */
+static uint8_t
+alloc_ranges_first_get(const struct alloc_ranges *ranges)
+{
+        uint8_t best_first;
+        best_first = 0;
+        uint32_t best_count;
+        best_count = 0;
+
+        uint32_t first;
+        for (first = 0; first < TIMING_COUNT; first++) {
+                uint32_t count;
+                count = 0;
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        if (timing_range_contiguous(ranges, first, ranges->pnd[t])) {
+                                count++;
+                        }
+                }
+
+                for (t = 0; t < 2; t++) {
+                        if (timing_range_contiguous(ranges, first, ranges->vcs[t])) {
+                                count++;
+                        }
+                }
+
+                for (t = 0; t <= TIMING_COUNT; t++) {
+                        if (timing_range_contiguous(ranges, first, ranges->cpd_widest[t])) {
+                                count++;
+                        }
+                }
+
+                if (count > best_count) {
+                        best_first = first;
+                        best_count = count;
+                }
+        }
+
+        return best_first;
+}
+
+/*-
+ * Allocate access timings for the NBGs, requiring TIMINGS_TABLE access
+ * timings from the banks in BITMAPS_TABLE, per NBG for each kind of
+ * read, where the VRAM partitioning is RAMCTL. The ranges of ALLOC must
+ * be set.
+ *
+ * If successful, 0 is returned and the cycle patterns are written to
+ * VRAM_CYCP. Otherwise, -4, -5, or -6 is returned, as described in
+ * vdp2cycp().
+ */
+static int32_t
+alloc_solve(struct alloc *alloc, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT],
+    union vram_cycp *vram_cycp)
+{
+        /* Allocate VCS access timings first, as their range is the most
+         * constrained, then PND access timings, and lastly CPD access
+         * timings, whose range is determined by the PND access
+         * timings */
+        if (alloc_feasible(alloc, ramctl, timings_table, bitmaps_table, ALLOC_KIND_COUNT)) {
+                alloc_vram_cycp_get(alloc, ramctl, vram_cycp);
+
+                if (alloc->stats != NULL) {
+                        uint32_t i;
+                        for (i = 0; i < alloc->item_count; i++) {
+                                const struct alloc_item *item;
+                                item = &alloc->items[i];
+
+                                alloc->stats->slot_counts[item->bank] += item->count;
+                        }
+                }
+
+                return 0;
+        }
+
+        /* Determine which reads could not be allocated by dropping the
+         * CPD, then the PND items */
+        if (alloc_feasible(alloc, ramctl, timings_table, bitmaps_table, ALLOC_KIND_CPD)) {
+                return -6;
+        }
+
+        if (alloc_feasible(alloc, ramctl, timings_table, bitmaps_table, ALLOC_KIND_PND)) {
+                return -5;
+        }
+
+        return -4;
+}
+
+/*-
+ * Determine if access timings can be allocated for the first KIND_COUNT
+ * kinds of reads of the NBGs, as alloc_init() describes them, and if so,
+ * leave the allocation in ALLOC.
+ *
+ * Demands that exceed the access timings of a bank, or of their range,
+ * are rejected before the allocation is initialized and searched.
+ */
+static bool
+alloc_feasible(struct alloc *alloc, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT], uint32_t kind_count)
+{
+        if (alloc_demands_exceeded(alloc->ranges, ramctl, timings_table, bitmaps_table,
+                kind_count)) {
+                alloc_prune_count(alloc, 0, CYCP_PRUNE_BANK);
+
+                return false;
+        }
+
+        alloc_init(alloc, ramctl, timings_table, bitmaps_table, kind_count);
+
+        return alloc_search(alloc, 0);
+}
+
+/*-
+ * Determine if the first KIND_COUNT kinds of reads of the NBGs demand
+ * more access timings than a bank has, or than the range of a read
+ * allows, where the VRAM partitioning is RAMCTL.
+ *
+ * Only the totals are compared, so demands that are not exceeded may
+ * still be infeasible.
+ */
+static bool
+alloc_demands_exceeded(const struct alloc_ranges *ranges, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT], uint32_t kind_count)
+{
+        uint32_t available[VRAM_BANK_COUNT];
+        uint32_t demands[VRAM_BANK_COUNT];
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                available[bank] = bit_count(ranges->timings);
+                demands[bank] = 0;
+        }
+
+        if ((ramctl & RAMCTL_VRAMD) == 0x0000) {
+                available[VRAM_BANK_A1] = 0;
+        }
+
+        if ((ramctl & RAMCTL_VRBMD) == 0x0000) {
+                available[VRAM_BANK_B1] = 0;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                uint32_t kind;
+                for (kind = 0; kind < kind_count; kind++) {
+                        uint8_t count;
+                        count = timings_table[scrn][kind];
+
+                        if (count == 0) {
+                                continue;
+                        }
+
+                        uint8_t range;
+
+                        switch (kind) {
+                        case ALLOC_KIND_VCS:
+                                range = (scrn <= SCRN_NBG1) ? ranges->vcs[scrn] : 0x00;
+                                break;
+                        case ALLOC_KIND_CPD: {
+                                uint8_t tpnd;
+                                tpnd = timings_table[scrn][ALLOC_KIND_PND];
+
+                                range = (tpnd <= TIMING_COUNT) ? ranges->cpd_widest[tpnd] : 0x00;
+                        } break;
+                        default:
+                                range = ranges->timings;
+                                break;
+                        }
+
+                        if (count > bit_count(range)) {
+                                return true;
+                        }
+
+                        uint8_t bitmap;
+                        bitmap = bank_bitmap_merge(ramctl, bitmaps_table[scrn][kind]);
+
+                        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                                if ((bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                                        demands[bank] += count;
+                                }
+                        }
+                }
+        }
+
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if (demands[bank] > available[bank]) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/*-
+ * Initialize the allocation ALLOC of access timings for the NBGs,
+ * requiring TIMINGS_TABLE access timings from the banks in
+ * BITMAPS_TABLE, per NBG for each kind of read, where the VRAM
+ * partitioning is RAMCTL. The ranges and statistics of ALLOC are kept.
+ *
+ * Only the first KIND_COUNT kinds of reads are considered.
+ */
+static void
+alloc_init(struct alloc *alloc, uint16_t ramctl,
+    const uint8_t timings_table[][ALLOC_KIND_COUNT],
+    const uint8_t bitmaps_table[][ALLOC_KIND_COUNT], uint32_t kind_count)
+{
+        const struct alloc_ranges *ranges;
+        ranges = alloc->ranges;
+        struct cycp_stats *stats;
+        stats = alloc->stats;
+
+        memset(alloc, 0x00, sizeof(*alloc));
+
+        alloc->ranges = ranges;
+        alloc->stats = stats;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                alloc->free[bank] = ranges->timings;
+        }
+
+        /* When a bank is not partitioned, the whole bank uses the access
+         * timings of its first half */
+        if ((ramctl & RAMCTL_VRAMD) == 0x0000) {
+                alloc->free[VRAM_BANK_A1] = 0x00;
+        }
+
+        if ((ramctl & RAMCTL_VRBMD) == 0x0000) {
+                alloc->free[VRAM_BANK_B1] = 0x00;
+        }
+
+        alloc->vcs_range_nbg1 = 0xFF;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                uint8_t tpnd;
+                tpnd = (kind_count > ALLOC_KIND_PND) ? timings_table[scrn][ALLOC_KIND_PND] : 0;
+
+                alloc->cpd_range[scrn] = (tpnd <= TIMING_COUNT) ? ranges->cpd_widest[tpnd] : 0x00;
+        }
+
+        uint32_t kind;
+        for (kind = 0; kind < kind_count; kind++) {
+                for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                        /* Disabled NBGs require no access timings */
+                        uint8_t count;
+                        count = timings_table[scrn][kind];
+
+                        if (count == 0) {
+                                continue;
+                        }
+
+                        uint8_t bitmap;
+                        bitmap = bank_bitmap_merge(ramctl, bitmaps_table[scrn][kind]);
+
+                        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                                if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                                        continue;
+                                }
+
+                                struct alloc_item *item;
+                                item = &alloc->items[alloc->item_count];
+
+                                item->scrn = scrn;
+                                item->kind = kind;
+                                item->bank = bank;
+                                item->count = count;
+                                item->timings = 0x00;
+
+                                alloc->item_count++;
+                        }
+                }
+        }
+
+        /* Allocate the PND items requiring the most access timings
+         * first, as they constrain the CPD range the most */
+        uint32_t i;
+        for (i = 1; i < alloc->item_count; i++) {
+                struct alloc_item item;
+                item = alloc->items[i];
+
+                if (item.kind != ALLOC_KIND_PND) {
+                        continue;
+                }
+
+                uint32_t j;
+                for (j = i; j > 0; j--) {
+                        const struct alloc_item *prev_item;
+                        prev_item = &alloc->items[j - 1];
+
+                        if ((prev_item->kind != ALLOC_KIND_PND) || (prev_item->count >= item.count)) {
+                                break;
+                        }
+
+                        alloc->items[j] = *prev_item;
+                }
+
+                alloc->items[j] = item;
+        }
+
+        for (i = 0; i < alloc->item_count; i++) {
+                const struct alloc_item *item;
+                item = &alloc->items[i];
+
+                if (item->kind == ALLOC_KIND_PND) {
+                        continue;
+                }
+
+                uint8_t *count;
+                count = &alloc->ranged_item_count[item->bank];
+
+                alloc->ranged_items[item->bank][*count] = i;
+                (*count)++;
+        }
+
+        int32_t j;
+        for (j = alloc->item_count - 1; j >= 0; j--) {
+                const struct alloc_item *item;
+                item = &alloc->items[j];
+
+                (void)memcpy(alloc->remaining[j], alloc->remaining[j + 1],
+                    sizeof(alloc->remaining[j]));
+
+                alloc->remaining[j][item->bank] += item->count;
+        }
+}
+
+/*-
+ * Return the widest CPD range possible when COUNT PND access timings are
+ * allocated, that is, the union of the ranges of every choice of COUNT
+ * PND access timings.
+ */
+static uint8_t
+alloc_cpd_range_widest(const struct alloc_ranges *ranges, uint32_t count)
+{
+        if (count == 0) {
+                return 0xFF;
+        }
+
+        uint8_t widest_range;
+        widest_range = 0x00;
+
+        /* Enumerate every bit-map of COUNT access timings */
+        uint32_t timings;
+        for (timings = (1 << count) - 1; timings <= 0xFF; ) {
+                uint8_t range;
+                range = 0xFF;
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        if ((timings & (1 << t)) != 0x00) {
+                                range &= ranges->pnd[t];
+                        }
+                }
+
+                widest_range |= range;
+
+                uint32_t lowest;
+                lowest = timings & -timings;
+                uint32_t ripple;
+                ripple = timings + lowest;
+
+                timings = (((ripple ^ timings) >> 2) / lowest) | ripple;
+        }
+
+        return widest_range;
+}
+
+/*-
+ * Search for an allocation of access timings for item I and the items
+ * following it.
+ *
+ * Each item is given a bit-map of access timings from the free access
+ * timings of its bank, within its range. Any bank that has less free
+ * access timings than it still requires is pruned.
+ *
+ * If successful, true is returned and the access timings of each item
+ * are set.
+ */
+static bool
+alloc_search(struct alloc *alloc, uint32_t i)
+{
+        if (alloc->stats != NULL) {
+                alloc->stats->node_count++;
+        }
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if (alloc->remaining[i][bank] > bit_count(alloc->free[bank])) {
+                        alloc_prune_count(alloc, i, CYCP_PRUNE_BANK);
+
+                        return false;
+                }
+
+                if (alloc_bank_prune(alloc, i, bank)) {
+                        alloc_prune_count(alloc, i, CYCP_PRUNE_RANGE);
+
+                        return false;
+                }
+        }
+
+        if (i == alloc->item_count) {
+                return true;
+        }
+
+        struct alloc_item *item;
+        item = &alloc->items[i];
+
+        uint8_t *free;
+        free = &alloc->free[item->bank];
+
+        uint8_t allowed;
+        allowed = *free & alloc_item_range(alloc, item);
+
+        /* Once the last item of a bank is reached, the choice of
+         * access timings of a CPD item no longer affects any other
+         * item, so take the lowest access timings */
+        if ((item->kind == ALLOC_KIND_CPD) && (alloc->remaining[i + 1][item->bank] == 0)) {
+                uint8_t timings;
+                timings = 0x00;
+
+                uint32_t count;
+                for (count = 0; count < item->count; count++) {
+                        uint8_t lowest;
+                        lowest = allowed & -allowed;
+
+                        timings |= lowest;
+                        allowed &= ~lowest;
+                }
+
+                item->timings = timings;
+
+                TRACE_POINT(TRACE_NODE, i, (item->bank << 8) | timings);
+
+                *free &= ~timings;
+
+                if (alloc_search(alloc, i + 1)) {
+                        return true;
+                }
+
+                *free |= timings;
+
+                return false;
+        }
+
+        /* Enumerate every subset of the allowed access timings, in
+         * ascending order, that has exactly the required count */
+        uint8_t timings;
+        timings = 0x00;
+
+        do {
+                timings = (timings - allowed) & allowed;
+
+                if (bit_count(timings) != item->count) {
+                        continue;
+                }
+
+                uint8_t cpd_range;
+                cpd_range = alloc->cpd_range[item->scrn];
+                uint8_t vcs_range_nbg1;
+                vcs_range_nbg1 = alloc->vcs_range_nbg1;
+
+                switch (item->kind) {
+                case ALLOC_KIND_VCS:
+                        if (item->scrn == SCRN_NBG0) {
+                                uint8_t last;
+                                last = timings;
+
+                                while ((last & (last - 1)) != 0x00) {
+                                        last &= last - 1;
+                                }
+
+                                /* Exclude every access timing up to the
+                                 * last one of NBG0 */
+                                alloc->vcs_range_nbg1 &= ~((last << 1) - 1);
+                        }
+                        break;
+                case ALLOC_KIND_PND: {
+                        uint32_t t;
+                        for (t = 0; t < TIMING_COUNT; t++) {
+                                if ((timings & (1 << t)) != 0x00) {
+                                        alloc->cpd_range[item->scrn] &= alloc->ranges->pnd[t];
+                                }
+                        }
+                } break;
+                }
+
+                item->timings = timings;
+
+                TRACE_POINT(TRACE_NODE, i, (item->bank << 8) | timings);
+
+                *free &= ~timings;
+
+                if (alloc_search(alloc, i + 1)) {
+                        return true;
+                }
+
+                *free |= timings;
+
+                alloc->cpd_range[item->scrn] = cpd_range;
+                alloc->vcs_range_nbg1 = vcs_range_nbg1;
+        } while (timings != 0x00);
+
+        return false;
+}
+
+/*-
+ * Count the search of ALLOC being pruned at item I for the reason
+ * REASON.
+ */
+static void
+alloc_prune_count(const struct alloc *alloc, uint32_t i __unused, uint32_t reason)
+{
+        if (alloc->stats != NULL) {
+                alloc->stats->prune_counts[reason]++;
+        }
+
+        TRACE_POINT(TRACE_PRUNE, reason, i);
+}
+
+/*-
+ * Determine if the items restricted to a range in bank BANK, from item I
+ * onwards, can no longer be allocated.
+ *
+ * The free access timings are taken in the order starting from the first
+ * access timing of the ranges, in which most ranges are contiguous. If
+ * the free access timings of the range of every item are, each is given
+ * to the item whose range ends the soonest, of the items still requiring
+ * access timings whose range holds it, as by earliest deadline first
+ * scheduling, which finds an allocation if one exists. Otherwise, by
+ * Hall's theorem, the items can only be allocated if, for every subset
+ * of the free access timings, the items whose range lies within it
+ * require no more access timings than it holds.
+ *
+ * The range of a CPD item whose PND item has not been allocated yet only
+ * narrows, so the check remains valid.
+ */
+static bool
+alloc_bank_prune(const struct alloc *alloc, uint32_t i, uint32_t bank)
+{
+        uint8_t ranges[ALLOC_ITEM_COUNT];
+        uint8_t counts[ALLOC_ITEM_COUNT];
+
+        uint8_t first;
+        first = alloc->ranges->first;
+
+        uint8_t free;
+        free = timing_range_rotate(alloc->free[bank], first);
+
+        bool contiguous;
+        contiguous = true;
+
+        uint32_t count;
+        count = 0;
+
+        uint32_t j;
+        for (j = 0; j < alloc->ranged_item_count[bank]; j++) {
+                uint32_t index;
+                index = alloc->ranged_items[bank][j];
+
+                if (index < i) {
+                        continue;
+                }
+
+                const struct alloc_item *item;
+                item = &alloc->items[index];
+
+                uint8_t range;
+                range = free & timing_range_rotate(alloc_item_range(alloc, item), first);
+
+                if (range == 0x00) {
+                        return true;
+                }
+
+                if ((timing_range_hull(range) & free) != range) {
+                        contiguous = false;
+                }
+
+                ranges[count] = range;
+                counts[count] = item->count;
+                count++;
+        }
+
+        if (count == 0) {
+                return false;
+        }
+
+        if (!contiguous) {
+                return alloc_bank_prune_hall(ranges, counts, count, free);
+        }
+
+        uint8_t timings;
+        timings = free;
+
+        while (timings != 0x00) {
+                uint8_t timing;
+                timing = timings & -timings;
+
+                timings &= ~timing;
+
+                int32_t soonest;
+                soonest = -1;
+
+                for (j = 0; j < count; j++) {
+                        if ((counts[j] == 0) || ((ranges[j] & timing) == 0x00)) {
+                                continue;
+                        }
+
+                        /* The range that ends the soonest has the fewest
+                         * access timings left after this one */
+                        if ((soonest < 0) || (ranges[j] < ranges[soonest])) {
+                                soonest = j;
+                        }
+                }
+
+                if (soonest >= 0) {
+                        counts[soonest]--;
+                }
+        }
+
+        for (j = 0; j < count; j++) {
+                if (counts[j] != 0) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/*-
+ * Determine if the COUNT items whose ranges of free access timings are
+ * RANGES, each requiring COUNTS access timings, can't be allocated, by
+ * checking Hall's theorem over every subset of the free access timings
+ * FREE of a bank.
+ */
+static bool
+alloc_bank_prune_hall(const uint8_t *ranges, const uint8_t *counts, uint32_t count,
+    uint8_t free)
+{
+        uint8_t timings;
+        timings = 0x00;
+
+        do {
+                timings = (timings - free) & free;
+
+                uint32_t required;
+                required = 0;
+
+                uint32_t j;
+                for (j = 0; j < count; j++) {
+                        if ((ranges[j] & ~timings) == 0x00) {
+                                required += counts[j];
+                        }
+                }
+
+                if (required > bit_count(timings)) {
+                        return true;
+                }
+        } while (timings != free);
+
+        return false;
+}
+
+/*-
+ * Return the bit-map of access timings the item ITEM is restricted to.
+ */
+static uint8_t
+alloc_item_range(const struct alloc *alloc, const struct alloc_item *item)
+{
+        switch (item->kind) {
+        case ALLOC_KIND_VCS:
+                if (item->scrn == SCRN_NBG1) {
+                        return alloc->ranges->vcs[item->scrn] & alloc->vcs_range_nbg1;
+                }
+
+                return alloc->ranges->vcs[item->scrn];
+        case ALLOC_KIND_CPD:
+                return alloc->cpd_range[item->scrn];
+        default:
+                return 0xFF;
+        }
+}
+
+/*-
+ * Write the cycle patterns of the allocation ALLOC to VRAM_CYCP.
+ */
+static void
+alloc_vram_cycp_get(const struct alloc *alloc, uint16_t ramctl,
+    union vram_cycp *vram_cycp)
+{
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                vram_cycp->pv[bank] = 0xFFFFFFFF;
+        }
+
+        alloc_vram_cycp_apply(alloc, ramctl, vram_cycp);
+}
+
+/*-
+ * Write the access timings of the items of the allocation ALLOC over the
+ * cycle patterns VRAM_CYCP.
+ */
+static void
+alloc_vram_cycp_apply(const struct alloc *alloc, uint16_t ramctl,
+    union vram_cycp *vram_cycp)
+{
+        static const uint8_t kind_codes[ALLOC_KIND_COUNT] = {
+                VRAM_CTL_CYCP_VCSTDR_NBG0,
+                VRAM_CTL_CYCP_PNDR_NBG0,
+                VRAM_CTL_CYCP_CHPNDR_NBG0
+        };
+
+        uint32_t i;
+        for (i = 0; i < alloc->item_count; i++) {
+                const struct alloc_item *item;
+                item = &alloc->items[i];
+
+                uint32_t code;
+                code = kind_codes[item->kind] + item->scrn;
+
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        if ((item->timings & (1 << t)) == 0x00) {
+                                continue;
+                        }
+
+                        vram_cycp->pv[item->bank] &= ~VRAM_CTL_CYCP_TIMING_MASK(t);
+                        vram_cycp->pv[item->bank] |= code << VRAM_CTL_CYCP_TIMING_BIT(t);
+                }
+        }
+
+        if ((ramctl & RAMCTL_VRAMD) == 0x0000) {
+                vram_cycp->pv[VRAM_BANK_A1] = vram_cycp->pv[VRAM_BANK_A0];
+        }
+
+        if ((ramctl & RAMCTL_VRBMD) == 0x0000) {
+                vram_cycp->pv[VRAM_BANK_B1] = vram_cycp->pv[VRAM_BANK_B0];
+        }
+}
+
+/*-
+ * Allocate access timings for the NBGs of STATE in the bit-map DIRTY,
+ * keeping the access timings of the other NBGs in the cycle patterns of
+ * STATE, and write the resulting cycle patterns to STATE.
+ *
+ * The access timings of the dirty NBGs are freed, and every other access
+ * timing in use is left as is. As the NBG1 vertical cell scroll access
+ * timings must follow those of NBG0, NBG1 is allocated again along with
+ * NBG0 when it uses vertical cell scroll.
+ *
+ * If successful, true is returned.
+ */
+static bool
+alloc_repair(struct alloc *alloc, struct state *state, uint8_t dirty)
+{
+        uint8_t timings[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+        uint8_t bitmaps[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        memset(timings, 0x00, sizeof(timings));
+        memset(bitmaps, 0x00, sizeof(bitmaps));
+
+        if (((dirty & (1 << SCRN_NBG0)) != 0x00) && (state->nbg1.vcs_bitmap != 0x00)) {
+                dirty |= 1 << SCRN_NBG1;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                if ((dirty & (1 << scrn)) == 0x00) {
+                        continue;
+                }
+
+                timings[scrn][ALLOC_KIND_VCS] = scroll_screen->tvcs;
+                timings[scrn][ALLOC_KIND_PND] = scroll_screen->tpnd;
+                timings[scrn][ALLOC_KIND_CPD] = scroll_screen->tcpd;
+
+                bitmaps[scrn][ALLOC_KIND_VCS] = scroll_screen->vcs_bitmap;
+                bitmaps[scrn][ALLOC_KIND_PND] = scroll_screen->pnd_bitmap;
+                bitmaps[scrn][ALLOC_KIND_CPD] = scroll_screen->cpd_bitmap;
+        }
+
+        alloc_init(alloc, state->ramctl, timings, bitmaps, ALLOC_KIND_COUNT);
+
+        union vram_cycp vram_cycp;
+        vram_cycp = state->vram_cycp;
+
+        /* The cycle patterns were calculated by vdp2cycp_optimize() */
+        bool cpu_fill;
+        cpu_fill = false;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t pv;
+                pv = vram_cycp.pv[bank];
+
+                /* Free the access timings of the dirty NBGs */
+                uint32_t dirty_nibbles;
+                dirty_nibbles = 0x00000000;
+
+                for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                        if ((dirty & (1 << scrn)) == 0x00) {
+                                continue;
+                        }
+
+                        dirty_nibbles |= timing_code_nibbles(pv, VRAM_CTL_CYCP_PNDR_NBG0 + scrn);
+                        dirty_nibbles |= timing_code_nibbles(pv, VRAM_CTL_CYCP_CHPNDR_NBG0 + scrn);
+
+                        if (scrn <= SCRN_NBG1) {
+                                dirty_nibbles |= timing_code_nibbles(pv,
+                                    VRAM_CTL_CYCP_VCSTDR_NBG0 + scrn);
+                        }
+                }
+
+                /* Access timings open to the CPU are free */
+                uint32_t cpu_nibbles;
+                cpu_nibbles = timing_code_nibbles(pv, VRAM_CTL_CYCP_CPU_RW);
+
+                if (cpu_nibbles != 0x00000000) {
+                        cpu_fill = true;
+                }
+
+                uint32_t used_nibbles;
+                used_nibbles = ~(timing_code_nibbles(pv, VRAM_CTL_CYCP_NO_ACCESS) |
+                    cpu_nibbles) & 0x11111111;
+
+                vram_cycp.pv[bank] |= dirty_nibbles * 0xF;
+
+                alloc->free[bank] &= ~timing_nibbles_compress(used_nibbles & ~dirty_nibbles);
+
+                /* NBG1 vertical cell scroll must still follow that of
+                 * NBG0 */
+                uint8_t last;
+                last = timing_nibbles_compress(timing_code_nibbles(pv, VRAM_CTL_CYCP_VCSTDR_NBG0));
+
+                if (((dirty & (1 << SCRN_NBG0)) == 0x00) && (last != 0x00)) {
+                        while ((last & (last - 1)) != 0x00) {
+                                last &= last - 1;
+                        }
+
+                        alloc->vcs_range_nbg1 &= ~((last << 1) - 1);
+                }
+        }
+
+        if (!alloc_search(alloc, 0)) {
+                return false;
+        }
+
+        alloc_vram_cycp_apply(alloc, state->ramctl, &vram_cycp);
+
+        if (cpu_fill) {
+                vram_cycp_cpu_fill(state->ramctl, &vram_cycp, alloc->ranges->timings);
+        }
+
+        state->vram_cycp = vram_cycp;
+
+        return true;
+}
+
+/*-
+ * Open every access timing of the cycle patterns VRAM_CYCP in the
+ * bit-map TIMINGS set to no access to the CPU, except in the banks RAMCTL
+ * reserves for the rotation engine.
+ */
+static void
+vram_cycp_cpu_fill(uint16_t ramctl, union vram_cycp *vram_cycp, uint8_t timings)
+{
+        uint32_t nibbles;
+        nibbles = timing_nibbles_expand(timings);
+
+        uint8_t reserved;
+        reserved = rotation_reserved_bitmap(ramctl);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((reserved & VRAM_BANK_BIT(bank)) != 0x00) {
+                        continue;
+                }
+
+                uint32_t pv;
+                pv = vram_cycp->pv[bank];
+
+                /* No access (0xF) becomes CPU read/write (0xE) by
+                 * clearing the lowest bit of the access code */
+                vram_cycp->pv[bank] = pv &
+                    ~(timing_code_nibbles(pv, VRAM_CTL_CYCP_NO_ACCESS) & nibbles);
+        }
+}
+
+/*-
+ * Return the number of access timings of the cycle patterns VRAM_CYCP
+ * in the bit-map TIMINGS open to the CPU, weighted per bank by WEIGHTS,
+ * where the VRAM partitioning is RAMCTL.
+ */
+static uint32_t
+vram_cycp_cpu_score(uint16_t ramctl, const union vram_cycp *vram_cycp, uint8_t timings,
+    const uint8_t *weights)
+{
+        uint32_t nibbles;
+        nibbles = timing_nibbles_expand(timings);
+
+        uint32_t score;
+        score = 0;
+
+        uint8_t reserved;
+        reserved = rotation_reserved_bitmap(ramctl);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((reserved & VRAM_BANK_BIT(bank)) != 0x00) {
+                        continue;
+                }
+
+                if ((bank == VRAM_BANK_A1) && ((ramctl & RAMCTL_VRAMD) == 0x0000)) {
+                        continue;
+                }
+
+                if ((bank == VRAM_BANK_B1) && ((ramctl & RAMCTL_VRBMD) == 0x0000)) {
+                        continue;
+                }
+
+                uint32_t cpu_nibbles;
+                cpu_nibbles = timing_code_nibbles(vram_cycp->pv[bank], VRAM_CTL_CYCP_CPU_RW) &
+                    nibbles;
+
+                score += weights[bank] * bit_count(cpu_nibbles);
+        }
+
+        return score;
+}
+
+/*-
+ * Initialize the demands VALIDATE of the NBGs of STATE, and select the
+ * banks ROTATION of the rotational backgrounds.
+ *
+ * If successful, 0 is returned. Otherwise, a negative value is returned
+ * for the cases vdp2cycp_validate() returns.
+ */
+static int32_t
+validate_init(const struct state *state, struct validate *validate,
+    struct rotation *rotation)
+{
+        if ((vram_bounds_validate_all(state, NULL)) < 0) {
+                return -9;
+        }
+
+        if ((vcs_bitmap_validate_all(state)) < 0) {
+                return -2;
+        }
+
+        if ((pnd_bitmap_validate_all(state)) < 0) {
+                return -3;
+        }
+
+        if ((rotation_modes_validate(state)) < 0) {
+                return -8;
+        }
+
+        if ((rotation_banks_select_all(state, rotation)) < 0) {
+                return -7;
+        }
+
+        memset(validate, 0x00, sizeof(*validate));
+
+        validate->codes = VALIDATE_CODES_RESERVED;
+        validate->bank_timings = 0xFFFFFFFF;
+
+        if ((state->ramctl & RAMCTL_VRAMD) == 0x0000) {
+                validate->bank_timings &= ~(UINT32_C(0xFF) << (VRAM_BANK_A1 * TIMING_COUNT));
+        }
+
+        if ((state->ramctl & RAMCTL_VRBMD) == 0x0000) {
+                validate->bank_timings &= ~(UINT32_C(0xFF) << (VRAM_BANK_B1 * TIMING_COUNT));
+        }
+
+        validate->ranges = alloc_ranges_get(state->tvmd);
+
+        /* Ignore the access timings the TV screen mode lacks */
+        validate->bank_timings &= (uint32_t)validate->ranges->timings * 0x01010101;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((rotation->reserved & VRAM_BANK_BIT(bank)) != 0x00) {
+                        validate->bank_timings &= ~(UINT32_C(0xFF) << (bank * TIMING_COUNT));
+                }
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                if (!scroll_screen->format.sf_enable) {
+                        continue;
+                }
+
+                uint8_t *counts;
+                counts = validate->counts[scrn];
+                uint8_t *bitmaps;
+                bitmaps = validate->bitmaps[scrn];
+
+                int32_t ret;
+                if ((ret = cycp_calculate_timings_tvmd(&scroll_screen->format,
+                            state->tvmd,
+                            &counts[ALLOC_KIND_VCS],
+                            &counts[ALLOC_KIND_PND],
+                            &counts[ALLOC_KIND_CPD])) < 0) {
+                        return ret;
+                }
+
+                bitmaps[ALLOC_KIND_VCS] = bank_bitmap_merge(state->ramctl, scroll_screen->vcs_bitmap);
+                bitmaps[ALLOC_KIND_PND] = bank_bitmap_merge(state->ramctl, scroll_screen->pnd_bitmap);
+                bitmaps[ALLOC_KIND_CPD] = bank_bitmap_merge(state->ramctl, scroll_screen->cpd_bitmap);
+
+                validate->codes |= 1 << (VRAM_CTL_CYCP_PNDR_NBG0 + scrn);
+                validate->codes |= 1 << (VRAM_CTL_CYCP_CHPNDR_NBG0 + scrn);
+
+                if (counts[ALLOC_KIND_VCS] > 0) {
+                        validate->codes |= 1 << (VRAM_CTL_CYCP_VCSTDR_NBG0 + scrn);
+                }
+        }
+
+
+        return 0;
+}
+
+/*-
+ * For each access code in the set CODES, write the bit-map of access
+ * timings of the cycle patterns VRAM_CYCP with that access code to MASKS,
+ * one byte per bank.
+ */
+static void
+validate_code_masks_get(const union vram_cycp *vram_cycp, uint16_t codes,
+    uint32_t *masks)
+{
+#if defined(__SSE2__)
+        /* Each access timing T is a nibble at VRAM_CTL_CYCP_TIMING_BIT(T),
+         * so the low and high nibbles of each byte are an even and odd
+         * access timing, respectively */
+        assert(VRAM_CTL_CYCP_TIMING_BIT(1) == 4);
+
+        const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+
+        __m128i pv;
+        pv = _mm_loadu_si128((const __m128i *)vram_cycp->pv);
+
+        __m128i lo;
+        lo = _mm_and_si128(pv, nibble_mask);
+        __m128i hi;
+        hi = _mm_and_si128(_mm_srli_epi16(pv, 4), nibble_mask);
+
+        /* One byte per access timing, in order: banks A0 and A1, then
+         * banks B0 and B1 */
+        __m128i a;
+        a = _mm_unpacklo_epi8(lo, hi);
+        __m128i b;
+        b = _mm_unpackhi_epi8(lo, hi);
+
+        uint32_t code;
+        for (code = 0; code < 16; code++) {
+                if ((codes & (1 << code)) == 0x0000) {
+                        continue;
+                }
+
+                __m128i value;
+                value = _mm_set1_epi8(code);
+
+                uint32_t mask_a;
+                mask_a = _mm_movemask_epi8(_mm_cmpeq_epi8(a, value));
+                uint32_t mask_b;
+                mask_b = _mm_movemask_epi8(_mm_cmpeq_epi8(b, value));
+
+                masks[code] = mask_a | (mask_b << 16);
+        }
+#else
+        (void)codes;
+
+        memset(masks, 0x00, 16 * sizeof(uint32_t));
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t t;
+                for (t = 0; t < TIMING_COUNT; t++) {
+                        uint32_t value;
+                        value = VRAM_CTL_CYCP_TIMING_VALUE(vram_cycp->pv[bank], t);
+
+                        masks[value] |= 1 << ((bank * TIMING_COUNT) + t);
+                }
+        }
+#endif /* __SSE2__ */
+}
+
+#if defined(VALIDATE_AVX2)
+/*-
+ * Write the access code masks of the two cycle patterns VRAM_CYCP[0] and
+ * VRAM_CYCP[1] to MASKS[0] and MASKS[1], respectively, as
+ * validate_code_masks_get() does.
+ *
+ * Both patterns are loaded as one AVX2 vector, one per 128-bit lane, as
+ * the unpack instructions operate within each lane.
+ */
+__attribute__ ((target("avx2"))) static void
+validate_code_masks_pair_get(const union vram_cycp *vram_cycp, uint16_t codes,
+    uint32_t (*masks)[16])
+{
+        assert(sizeof(union vram_cycp) == 16);
+
+        const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+
+        __m256i pv;
+        pv = _mm256_loadu_si256((const __m256i *)vram_cycp);
+
+        __m256i lo;
+        lo = _mm256_and_si256(pv, nibble_mask);
+        __m256i hi;
+        hi = _mm256_and_si256(_mm256_srli_epi16(pv, 4), nibble_mask);
+
+        __m256i a;
+        a = _mm256_unpacklo_epi8(lo, hi);
+        __m256i b;
+        b = _mm256_unpackhi_epi8(lo, hi);
+
+        uint32_t code;
+        for (code = 0; code < 16; code++) {
+                if ((codes & (1 << code)) == 0x0000) {
+                        continue;
+                }
+
+                __m256i value;
+                value = _mm256_set1_epi8(code);
+
+                /* The lower 16 bits of each are of the first pattern */
+                uint32_t mask_a;
+                mask_a = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, value));
+                uint32_t mask_b;
+                mask_b = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, value));
+
+                masks[0][code] = (mask_a & 0x0000FFFF) | (mask_b << 16);
+                masks[1][code] = (mask_a >> 16) | (mask_b & 0xFFFF0000);
+        }
+}
+#endif /* VALIDATE_AVX2 */
+
+/*-
+ * Validate the cycle pattern VRAM_CYCP, whose access code masks are
+ * MASKS, against the demands VALIDATE and the banks ROTATION of the
+ * rotational backgrounds, with the RAMCTL value RAMCTL. The result is as
+ * described in vdp2cycp_validate().
+ */
+static int8_t
+validate_pattern(const struct validate *validate, const struct rotation *rotation,
+    uint16_t ramctl, const union vram_cycp *vram_cycp, const uint32_t *masks)
+{
+        int8_t result;
+        result = validate_masks(validate, masks);
+
+        if (result < 0) {
+                return result;
+        }
+
+        /* The banks of RBG1 must hold exactly the NBG0 reads */
+        union vram_cycp rbg1_vram_cycp;
+        rbg1_vram_cycp = *vram_cycp;
+
+        rotation_vram_cycp_apply(rotation, ramctl, validate->ranges->timings,
+            &rbg1_vram_cycp);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if (rbg1_vram_cycp.pv[bank] == vram_cycp->pv[bank]) {
+                        continue;
+                }
+
+                return ((rotation->pnd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) ? -5 : -6;
+        }
+
+        return 0;
+}
+
+/*-
+ * Validate the access code masks MASKS of a cycle pattern against the
+ * demands VALIDATE. The result is as described in vdp2cycp_validate().
+ */
+static int8_t
+validate_masks(const struct validate *validate, const uint32_t *masks)
+{
+        uint32_t code;
+        for (code = 0; code < 16; code++) {
+                if ((VALIDATE_CODES_RESERVED & (1 << code)) == 0x0000) {
+                        continue;
+                }
+
+                if ((masks[code] & validate->bank_timings) != 0x00000000) {
+                        return -7;
+                }
+        }
+
+        uint8_t vcs_range_nbg1;
+        vcs_range_nbg1 = validate_vcs_range_nbg1_get(validate, masks);
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < 2; scrn++) {
+                uint8_t count;
+                count = validate->counts[scrn][ALLOC_KIND_VCS];
+
+                if (count == 0) {
+                        continue;
+                }
+
+                uint32_t mask;
+                mask = masks[VRAM_CTL_CYCP_VCSTDR_NBG0 + scrn];
+
+                uint8_t bitmap;
+                bitmap = validate->bitmaps[scrn][ALLOC_KIND_VCS];
+
+                uint8_t range;
+                range = (scrn == SCRN_NBG0) ? validate->ranges->vcs[0] : vcs_range_nbg1;
+
+                if ((validate_bank_count(mask, bitmap, range)) < count) {
+                        return -4;
+                }
+        }
+
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                uint8_t count;
+                count = validate->counts[scrn][ALLOC_KIND_PND];
+
+                if (count == 0) {
+                        continue;
+                }
+
+                uint32_t mask;
+                mask = masks[VRAM_CTL_CYCP_PNDR_NBG0 + scrn];
+
+                /* Only the access timings of the TV screen mode count */
+                if ((validate_bank_count(mask, validate->bitmaps[scrn][ALLOC_KIND_PND],
+                            validate->ranges->timings)) < count) {
+                        return -5;
+                }
+        }
+
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                uint8_t count;
+                count = validate->counts[scrn][ALLOC_KIND_CPD];
+
+                if (count == 0) {
+                        continue;
+                }
+
+                uint8_t range;
+                range = validate_cpd_range_get(validate, masks, scrn);
+
+                uint32_t mask;
+                mask = masks[VRAM_CTL_CYCP_CHPNDR_NBG0 + scrn];
+
+                if ((validate_bank_count(mask, validate->bitmaps[scrn][ALLOC_KIND_CPD], range)) < count) {
+                        return -6;
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Return the bit-map of access timings NBG1 vertical cell scroll can be
+ * read at, in the access code masks MASKS of a cycle pattern, as NBG0
+ * access must be selected first.
+ */
+static uint8_t
+validate_vcs_range_nbg1_get(const struct validate *validate, const uint32_t *masks)
+{
+        uint8_t range;
+        range = validate->ranges->vcs[1];
+
+        if (validate->counts[SCRN_NBG0][ALLOC_KIND_VCS] == 0) {
+                return range;
+        }
+
+        uint32_t mask;
+        mask = masks[VRAM_CTL_CYCP_VCSTDR_NBG0];
+
+        uint8_t bitmap;
+        bitmap = validate->bitmaps[SCRN_NBG0][ALLOC_KIND_VCS];
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                uint8_t last;
+                last = mask >> (bank * TIMING_COUNT);
+
+                while ((last & (last - 1)) != 0x00) {
+                        last &= last - 1;
+                }
+
+                /* Exclude every access timing up to the last one of
+                 * NBG0 */
+                range &= ~((last << 1) - 1);
+        }
+
+        return range;
+}
+
+/*-
+ * Return the bit-map of access timings character pattern data of the NBG
+ * SCRN can be read at, in the access code masks MASKS of a cycle
+ * pattern. The range is constrained by every pattern name data access
+ * timing of the same NBG.
+ */
+static uint8_t
+validate_cpd_range_get(const struct validate *validate, const uint32_t *masks,
+    uint32_t scrn)
+{
+        uint8_t pnd_timings;
+        pnd_timings = 0x00;
+
+        uint32_t pnd_mask;
+        pnd_mask = masks[VRAM_CTL_CYCP_PNDR_NBG0 + scrn];
+
+        uint8_t pnd_bitmap;
+        pnd_bitmap = validate->bitmaps[scrn][ALLOC_KIND_PND];
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((pnd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        pnd_timings |= pnd_mask >> (bank * TIMING_COUNT);
+                }
+        }
+
+        uint8_t range;
+        range = 0xFF;
+
+        uint32_t t;
+        for (t = 0; t < TIMING_COUNT; t++) {
+                if ((pnd_timings & (1 << t)) != 0x00) {
+                        range &= validate->ranges->pnd[t];
+                }
+        }
+
+        return range;
+}
+
+/*-
+ * Return the least number of access timings set in MASK, within the
+ * range RANGE, amongst the banks in the bank bit-map BITMAP.
+ */
+static uint32_t
+validate_bank_count(uint32_t mask, uint8_t bitmap, uint8_t range)
+{
+        uint32_t min_count;
+        min_count = TIMING_COUNT;
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                        continue;
+                }
+
+                uint32_t count;
+                count = bit_count((mask >> (bank * TIMING_COUNT)) & range);
+
+                if (count < min_count) {
+                        min_count = count;
+                }
+        }
+
+        return min_count;
+}
+
+/*-
+ * Count the reads of one cell of a cycle pattern, whose access code masks
+ * are MASKS, against the demands VALIDATE and the banks ROTATION of the
+ * rotational backgrounds, and add them to SIM, multiplied by CELL_COUNT,
+ * the number of cells of a frame. The reads are as described in
+ * vdp2cycp_simulate().
+ *
+ * This is an approximation, not a simulation per dot clock: every cell
+ * is taken to read as the first does, as nothing is carried over from
+ * one cell or scanline to the next, and blanking is not counted.
+ *
+ * Every bank is counted at once, as MASKS holds one byte per bank.
+ */
+static void
+simulate_cell_count(const struct validate *validate, const struct rotation *rotation,
+    const uint32_t *masks, uint32_t cell_count, struct cycp_sim *sim)
+{
+        /* Range of access timings each kind of read of each NBG can be
+         * given */
+        uint8_t ranges[ALLOC_SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                ranges[scrn][ALLOC_KIND_VCS] = 0x00;
+                ranges[scrn][ALLOC_KIND_PND] = validate->ranges->timings;
+                ranges[scrn][ALLOC_KIND_CPD] = validate_cpd_range_get(validate, masks, scrn);
+        }
+
+        ranges[SCRN_NBG0][ALLOC_KIND_VCS] = validate->ranges->vcs[0];
+        ranges[SCRN_NBG1][ALLOC_KIND_VCS] = validate_vcs_range_nbg1_get(validate, masks);
+
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint8_t timings;
+                timings = validate->bank_timings >> (bank * TIMING_COUNT);
+
+                if (timings == 0x00) {
+                        continue;
+                }
+
+                /* Bit-map of access timings of reads that are displayed */
+                uint8_t fetched;
+                fetched = 0x00;
+
+                uint32_t stall_count;
+                stall_count = 0;
+
+                for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                        const uint32_t codes[ALLOC_KIND_COUNT] = {
+                                VRAM_CTL_CYCP_VCSTDR_NBG0 + scrn,
+                                VRAM_CTL_CYCP_PNDR_NBG0 + scrn,
+                                VRAM_CTL_CYCP_CHPNDR_NBG0 + scrn
+                        };
+
+                        uint32_t kind;
+                        for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                                uint8_t count;
+                                count = validate->counts[scrn][kind];
+
+                                if ((count == 0) ||
+                                    ((validate->bitmaps[scrn][kind] & VRAM_BANK_BIT(bank)) == 0x00)) {
+                                        continue;
+                                }
+
+                                uint8_t given;
+                                given = (masks[codes[kind]] >> (bank * TIMING_COUNT)) &
+                                    timings & ranges[scrn][kind];
+
+                                /* Reads in excess of those required are
+                                 * not displayed */
+                                uint8_t displayed;
+                                displayed = 0x00;
+
+                                while ((given != 0x00) && (bit_count(displayed) < count)) {
+                                        displayed |= given & -given;
+                                        given &= given - 1;
+                                }
+
+                                fetched |= displayed;
+
+                                uint32_t stalls;
+                                stalls = count - bit_count(displayed);
+
+                                sim->stalls[scrn][kind] += stalls * cell_count;
+                                stall_count += stalls;
+                        }
+                }
+
+                /* RBG1 reads in every access timing of its banks, during
+                 * the NBG0 reads */
+                uint32_t kind;
+                for (kind = ALLOC_KIND_PND; kind <= ALLOC_KIND_CPD; kind++) {
+                        uint8_t bitmap;
+                        bitmap = (kind == ALLOC_KIND_PND) ?
+                            rotation->pnd_bitmap : rotation->cpd_bitmap;
+
+                        if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                                continue;
+                        }
+
+                        uint32_t code;
+                        code = (kind == ALLOC_KIND_PND) ?
+                            VRAM_CTL_CYCP_PNDR_NBG0 : VRAM_CTL_CYCP_CHPNDR_NBG0;
+
+                        uint8_t given;
+                        given = (masks[code] >> (bank * TIMING_COUNT)) & timings;
+
+                        fetched |= given;
+
+                        uint32_t stalls;
+                        stalls = bit_count(timings) - bit_count(given);
+
+                        sim->stalls[SCRN_RBG1][kind] += stalls * cell_count;
+                        stall_count += stalls;
+                }
+
+                uint32_t cpu_count;
+                cpu_count = bit_count((masks[VRAM_CTL_CYCP_CPU_RW] >> (bank * TIMING_COUNT)) &
+                    timings);
+                uint32_t no_access_count;
+                no_access_count = bit_count((masks[VRAM_CTL_CYCP_NO_ACCESS] >>
+                        (bank * TIMING_COUNT)) & timings);
+
+                struct cycp_sim_bank *sim_bank;
+                sim_bank = &sim->banks[bank];
+
+                sim_bank->timing_count += bit_count(timings) * cell_count;
+                sim_bank->fetch_count += bit_count(fetched) * cell_count;
+                sim_bank->invalid_count += (bit_count(timings) - bit_count(fetched) -
+                    cpu_count - no_access_count) * cell_count;
+                sim_bank->cpu_count += cpu_count * cell_count;
+                sim_bank->stall_count += stall_count * cell_count;
+        }
+}
+
+/*-
+ * Convert a 32-bit range of access timings RANGE, where each timing is
+ * represented by a nibble, to an 8-bit bit-map of access timings.
+ */
+static uint8_t
+timing_range_bitmap(uint32_t range)
+{
+        uint8_t bitmap;
+        bitmap = 0x00;
+
+        uint32_t t;
+        for (t = 0; t < TIMING_COUNT; t++) {
+                if ((range & VRAM_CTL_CYCP_TIMING_MASK(t)) != 0x00000000) {
+                        bitmap |= 1 << t;
+                }
+        }
+
+        return bitmap;
+}
+
+/*-
+ * Return the bit-map of access timings RANGE in the order starting from
+ * access timing FIRST, wrapping around, so that FIRST is the lowest bit.
+ */
+static uint8_t
+timing_range_rotate(uint8_t range, uint8_t first)
+{
+        return (range >> first) | (range << ((TIMING_COUNT - first) & (TIMING_COUNT - 1)));
+}
+
+/*-
+ * Return the bit-map of access timings from the lowest to the highest
+ * access timing of RANGE.
+ */
+static uint8_t
+timing_range_hull(uint8_t range)
+{
+        if (range == 0x00) {
+                return 0x00;
+        }
+
+        uint8_t last;
+        last = range;
+
+        while ((last & (last - 1)) != 0x00) {
+                last &= last - 1;
+        }
+
+        return ((last << 1) - 1) & ~((range & -range) - 1);
+}
+
+/*-
+ * Determine if the access timings of RANGE are contiguous in the order
+ * starting from access timing FIRST, amongst the access timings of the
+ * TV screen mode of RANGES.
+ */
+static bool
+timing_range_contiguous(const struct alloc_ranges *ranges, uint8_t first, uint8_t range)
+{
+        uint8_t rotated;
+        rotated = timing_range_rotate(range, first);
+
+        return (timing_range_hull(rotated) &
+            timing_range_rotate(ranges->timings, first)) == rotated;
+}
+
+/*-
+ * Return the raw 32-bit cycle pattern value PV with the lowest bit of
+ * each access timing set if that access timing has the access code
+ * CODE, and clear otherwise.
+ */
+static uint32_t
+timing_code_nibbles(uint32_t pv, uint32_t code)
+{
+        uint32_t x;
+        x = pv ^ (code * 0x11111111);
+
+        return ~(x | (x >> 1) | (x >> 2) | (x >> 3)) & 0x11111111;
+}
+
+/*-
+ * Return the bit-map of access timings from NIBBLES, where the lowest bit
+ * of each access timing is set, as returned by timing_code_nibbles().
+ */
+static uint8_t
+timing_nibbles_compress(uint32_t nibbles)
+{
+        nibbles = (nibbles | (nibbles >> 3)) & 0x03030303;
+        nibbles = (nibbles | (nibbles >> 6)) & 0x000F000F;
+        nibbles = (nibbles | (nibbles >> 12)) & 0x000000FF;
+
+        return nibbles;
+}
+
+/*-
+ * Return the nibbles of the access timings in the bit-map TIMINGS, with
+ * the lowest bit of each access timing set, the inverse of
+ * timing_nibbles_compress().
+ */
+static uint32_t
+timing_nibbles_expand(uint8_t timings)
+{
+        uint32_t nibbles;
+        nibbles = timings;
+
+        nibbles = (nibbles | (nibbles << 12)) & 0x000F000F;
+        nibbles = (nibbles | (nibbles << 6)) & 0x03030303;
+        nibbles = (nibbles | (nibbles << 3)) & 0x11111111;
+
+        return nibbles;
+}
+
+/*-
+ * Validate the combination of rotational backgrounds of STATE, and their
+ * rotation parameter modes, as rotation_modes_bitmap_validate() does.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the cases rotation_modes_bitmap_validate() returns.
+ */
+static int32_t
+rotation_modes_validate(const struct state *state)
+{
+        uint8_t enable_bitmap;
+        enable_bitmap = 0x00;
+        uint8_t swap_bitmap;
+        swap_bitmap = 0x00;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                const struct scrn_format *format;
+                format = &state->scroll_screens[scrn]->format;
+
+                if (!format->sf_enable) {
+                        continue;
+                }
+
+                enable_bitmap |= 1 << scrn;
+
+                if ((scrn != SCRN_RBG0) && (scrn != SCRN_RBG1)) {
+                        continue;
+                }
+
+                uint8_t rp_mode;
+                rp_mode = (format->sf_type == SCRN_TYPE_CELL) ?
+                    format->sf_format.cell.scf_rp_mode :
+                    format->sf_format.bitmap.sbf_rp_mode;
+
+                if ((rp_mode == SCRN_RP_MODE_SWAP_COEFFICIENT) &&
+                    (format->sf_coefficient_table == 0x00000000)) {
+                        swap_bitmap |= 1 << scrn;
+                }
+        }
+
+        return rotation_modes_bitmap_validate(enable_bitmap, swap_bitmap);
+}
+
+/*-
+ * Validate the combination of scroll screens enabled in ENABLE_BITMAP,
+ * where the rotational backgrounds in SWAP_BITMAP swap rotation
+ * parameters via coefficient data without a coefficient table. Both are
+ * bit-maps of SCRN_* values.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 RBG1 is enabled without RBG0
+ *   - -2 RBG1 is enabled along with an NBG
+ *   - -3 RBG0 swaps rotation parameters via coefficient data without a
+ *        coefficient table
+ *   - -4 RBG1 swaps rotation parameters via coefficient data without a
+ *        coefficient table
+ */
+static int32_t
+rotation_modes_bitmap_validate(uint8_t enable_bitmap, uint8_t swap_bitmap)
+{
+        if ((enable_bitmap & (1 << SCRN_RBG1)) != 0x00) {
+                if ((enable_bitmap & (1 << SCRN_RBG0)) == 0x00) {
+                        return -1;
+                }
+
+                if ((enable_bitmap & ((1 << ALLOC_SCRN_COUNT) - 1)) != 0x00) {
+                        return -2;
+                }
+        }
+
+        swap_bitmap &= enable_bitmap;
+
+        if ((swap_bitmap & (1 << SCRN_RBG0)) != 0x00) {
+                return -3;
+        }
+
+        if ((swap_bitmap & (1 << SCRN_RBG1)) != 0x00) {
+                return -4;
+        }
+
+        return 0;
+}
+
+/*-
+ * Select the banks the tables of the rotational backgrounds are read
+ * from, where the VRAM partitioning is RAMCTL, and write them to
+ * ROTATION. The bank bit-maps of each kind of read of each scroll screen
+ * are given by BITMAPS, where the vertical cell scroll kind of read of a
+ * rotational background is that of its coefficient table.
+ *
+ * The banks of the tables of RBG0, and of the coefficient table of RBG1,
+ * are reserved. A reserved bank holds a single kind of table, and is
+ * read by neither the NBGs nor RBG1. RBG1 can't read its pattern name
+ * data and character pattern data from the same bank.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 Rotational background data is stored in an invalid bank
+ */
+static int32_t
+rotation_banks_select(uint16_t ramctl, const uint8_t bitmaps[][ALLOC_KIND_COUNT],
+    struct rotation *rotation)
+{
+        /* RDBS of each kind of table */
+        static const uint8_t kind_rdbs[ALLOC_KIND_COUNT] = {
+                RAMCTL_RDBS_COEFFICIENT,
+                RAMCTL_RDBS_PND,
+                RAMCTL_RDBS_CPD
+        };
+
+        memset(rotation, 0x00, sizeof(*rotation));
+
+        uint32_t kind;
+        for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                uint8_t bitmap;
+                bitmap = bitmaps[SCRN_RBG0][kind];
+
+                if (kind == ALLOC_KIND_VCS) {
+                        bitmap |= bitmaps[SCRN_RBG1][kind];
+                }
+
+                bitmap = bank_bitmap_merge(ramctl, bitmap);
+
+                uint32_t bank;
+                for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                        if ((bitmap & VRAM_BANK_BIT(bank)) == 0x00) {
+                                continue;
+                        }
+
+                        uint8_t rdbs;
+                        rdbs = RAMCTL_RDBS_GET(rotation->rdbs, bank);
+
+                        if ((rdbs != RAMCTL_RDBS_NONE) && (rdbs != kind_rdbs[kind])) {
+                                return -1;
+                        }
+
+                        rotation->rdbs |= RAMCTL_RDBS(kind_rdbs[kind], bank);
+                }
+
+                rotation->reserved |= bitmap;
+        }
+
+        rotation->pnd_bitmap = bank_bitmap_merge(ramctl, bitmaps[SCRN_RBG1][ALLOC_KIND_PND]);
+        rotation->cpd_bitmap = bank_bitmap_merge(ramctl, bitmaps[SCRN_RBG1][ALLOC_KIND_CPD]);
+
+        if (((rotation->pnd_bitmap & rotation->cpd_bitmap) != 0x00) ||
+            (((rotation->pnd_bitmap | rotation->cpd_bitmap) & rotation->reserved) != 0x00)) {
+                return -1;
+        }
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
+                for (kind = 0; kind < ALLOC_KIND_COUNT; kind++) {
+                        if ((bank_bitmap_merge(ramctl, bitmaps[scrn][kind]) &
+                                rotation->reserved) != 0x00) {
+                                return -1;
+                        }
+                }
+        }
+
+        return 0;
+}
+
+/*-
+ * Select the banks the tables of the rotational backgrounds of STATE
+ * are read from, as rotation_banks_select() does, where the VRAM
+ * partitioning is that of STATE.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 Rotational background data is stored in an invalid bank
+ */
+static int32_t
+rotation_banks_select_all(const struct state *state, struct rotation *rotation)
+{
+        uint8_t bitmaps[SCRN_COUNT][ALLOC_KIND_COUNT];
+
+        memset(bitmaps, 0x00, sizeof(bitmaps));
 
         uint32_t scrn;
         for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
-                struct scrn_format *format;
-                format = &state->scroll_screens[scrn]->format;
-
-                if (format == NULL) {
-                        continue;
-                }
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
 
-                /* Check if scroll screen is enabled */
-                if (!format->sf_enable) {
+                if (!scroll_screen->format.sf_enable) {
                         continue;
                 }
 
-                uint8_t tvcs;
-                uint8_t tpnd;
-                uint8_t tcpd;
-
-                int32_t ret;
-                if ((ret = cycp_calculate_timings(format, &tvcs, &tpnd, &tcpd)) < 0) {
-                        return ret;
-                }
+                bitmaps[scrn][ALLOC_KIND_VCS] = (scrn < ALLOC_SCRN_COUNT) ?
+                    scroll_screen->vcs_bitmap : scroll_screen->coefficient_bitmap;
+                bitmaps[scrn][ALLOC_KIND_PND] = scroll_screen->pnd_bitmap;
+                bitmaps[scrn][ALLOC_KIND_CPD] = scroll_screen->cpd_bitmap;
+        }
 
-                DEBUG_PRINTF("--------------------------------------------------------------------------------\n");
-                DEBUG_FORMAT(format);
+        return rotation_banks_select(state->ramctl, bitmaps, rotation);
+}
 
-                DEBUG_PRINTF("tvcs: %i access timing required\n", tvcs);
-                DEBUG_PRINTF("tpnd: %i access timing required\n", tpnd);
-                DEBUG_PRINTF("tcpd: %i access timing required\n", tcpd);
+/*-
+ * Set every access timing in the bit-map TIMINGS of the banks of RBG1 in
+ * ROTATION to the NBG0 reads, in the cycle patterns VRAM_CYCP, where the
+ * VRAM partitioning is RAMCTL.
+ */
+static void
+rotation_vram_cycp_apply(const struct rotation *rotation, uint16_t ramctl,
+    uint8_t timings, union vram_cycp *vram_cycp)
+{
+        if ((rotation->pnd_bitmap | rotation->cpd_bitmap) == 0x00) {
+                return;
         }
 
-        // XXX: Determine in which VRAM bank VCST is stored in
-        // XXX: Is there a restriction as to where VCST can be stored?
+        uint32_t nibbles;
+        nibbles = timing_nibbles_expand(timings);
 
-        /* Allocate PND access timing and store timing */
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t code;
 
-        // XXX: For example, If 1/4 reduction is used, PNDT should be on
-        //      different banks, as well as VCST because there just
-        //      isn't enough access timings available. 1/4 reduction
-        //      requires 4.
+                if ((rotation->pnd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        code = VRAM_CTL_CYCP_PNDR_NBG0;
+                } else if ((rotation->cpd_bitmap & VRAM_BANK_BIT(bank)) != 0x00) {
+                        code = VRAM_CTL_CYCP_CHPNDR_NBG0;
+                } else {
+                        continue;
+                }
 
-        /* Use timing from PND to determine range where CPD access
-         * timing should be and allocate */
+                vram_cycp->pv[bank] &= ~(nibbles * VRAM_CTL_CYCP_NO_ACCESS);
+                vram_cycp->pv[bank] |= nibbles * code;
+        }
 
-        // XXX: Allocation function should take in a mask on the "constraint"
-        // XXX: Allocation function should take which bank to allocate access timing on
+        if ((ramctl & RAMCTL_VRAMD) == 0x0000) {
+                vram_cycp->pv[VRAM_BANK_A1] = vram_cycp->pv[VRAM_BANK_A0];
+        }
 
-        return 0;
+        if ((ramctl & RAMCTL_VRBMD) == 0x0000) {
+                vram_cycp->pv[VRAM_BANK_B1] = vram_cycp->pv[VRAM_BANK_B0];
+        }
 }
 
-static int32_t
-cycp_calculate_timings(
-        const struct scrn_format *format,
-        uint8_t *tvcs,
-        uint8_t *tpnd,
-        uint8_t *tcpd)
+/*-
+ * Return the bit-map of banks the RDBS of RAMCTL reserves for the
+ * rotation engine. The second half of a bank that is not partitioned
+ * shares the RDBS of its first half.
+ */
+static uint8_t
+rotation_reserved_bitmap(uint16_t ramctl)
 {
-        *tvcs = 0;
-        *tpnd = 0;
-        *tcpd = 0;
+        uint8_t bitmap;
+        bitmap = 0x00;
 
-        /* Determine if vertical cell scroll is used */
-        if (VRAM_BANK_ADDRESS(format->sf_vcs_table)) {
-                *tvcs = _timings_count_vcs[format->sf_scroll_screen];
+        uint32_t bank;
+        for (bank = 0; bank < VRAM_BANK_COUNT; bank++) {
+                uint32_t first_bank;
+                first_bank = bank;
 
-                if ((int8_t)*tvcs < 0) {
-                        return -4;
+                if ((bank == VRAM_BANK_A1) && ((ramctl & RAMCTL_VRAMD) == 0x0000)) {
+                        first_bank = VRAM_BANK_A0;
                 }
-        }
-
-        /* Determine how many PND access timings are needed (due
-         * to reduction) */
-        if (format->sf_type == SCRN_TYPE_CELL) {
-                const struct scrn_cell_format *cell_format;
-                cell_format = &format->sf_format.cell;
 
-                *tpnd = _timings_count_pnd[cell_format->scf_pnd_size][format->sf_reduction];
+                if ((bank == VRAM_BANK_B1) && ((ramctl & RAMCTL_VRBMD) == 0x0000)) {
+                        first_bank = VRAM_BANK_B0;
+                }
 
-                /* Invalid number of PND access timings */
-                if ((int8_t)*tpnd < 0) {
-                        return -5;
+                if (RAMCTL_RDBS_GET(ramctl, first_bank) != RAMCTL_RDBS_NONE) {
+                        bitmap |= VRAM_BANK_BIT(bank);
                 }
         }
 
-        /* Determine how many CPD access timings are needed (due
-         * to reduction) and character color count */
-        *tcpd = _timings_count_cpd[format->sf_type][format->sf_cc_count][format->sf_reduction];
+        return bitmap;
+}
 
-        /* Invalid number of PND access timings */
-        if ((int8_t)*tcpd < 0) {
-                return -6;
+/*-
+ * Merge the bank bit-map BITMAP according to the VRAM partitioning in
+ * RAMCTL.
+ *
+ * When a bank is not partitioned, data stored in its second half is
+ * read during the access timings of its first half.
+ */
+static uint8_t
+bank_bitmap_merge(uint16_t ramctl, uint8_t bitmap)
+{
+        if (((ramctl & RAMCTL_VRAMD) == 0x0000) &&
+            ((bitmap & VRAM_BANK_BIT(VRAM_BANK_A1)) != 0x00)) {
+                bitmap &= ~VRAM_BANK_BIT(VRAM_BANK_A1);
+                bitmap |= VRAM_BANK_BIT(VRAM_BANK_A0);
         }
 
-        return 0;
+        if (((ramctl & RAMCTL_VRBMD) == 0x0000) &&
+            ((bitmap & VRAM_BANK_BIT(VRAM_BANK_B1)) != 0x00)) {
+                bitmap &= ~VRAM_BANK_BIT(VRAM_BANK_B1);
+                bitmap |= VRAM_BANK_BIT(VRAM_BANK_B0);
+        }
+
+        return bitmap;
 }
 
 /*-
  * Initialize pseudo HW state via scaffolding.
  */
-static void
+void
 state_init(struct state *state, const struct scrn_format **formats)
 {
         if (state == NULL) {
@@ -366,10 +4384,6 @@ state_init(struct state *state, const struct scrn_format **formats)
 
         memset(state, 0x00, sizeof(*state));
 
-        if (formats == NULL) {
-                return;
-        }
-
         state->scroll_screens[0] = &state->nbg0;
         state->scroll_screens[1] = &state->nbg1;
         state->scroll_screens[2] = &state->nbg2;
@@ -377,6 +4391,10 @@ state_init(struct state *state, const struct scrn_format **formats)
         state->scroll_screens[4] = &state->rbg0;
         state->scroll_screens[5] = &state->rbg1;
 
+        if (formats == NULL) {
+                return;
+        }
+
         uint32_t i;
         for (i = 0; (i < SCRN_COUNT) && (formats[i] != NULL); i++) {
                 uint8_t scrn;
@@ -387,26 +4405,107 @@ state_init(struct state *state, const struct scrn_format **formats)
 
                 (void)memcpy(&scroll_screen->format, formats[i], sizeof(*formats[i]));
 
-                vcs_bitmap_calculate(&scroll_screen->format, &scroll_screen->vcs_bitmap);
-                pnd_bitmap_calculate(&scroll_screen->format, &scroll_screen->pnd_bitmap);
+                (void)scroll_screen_demands_calculate(scroll_screen, state->tvmd,
+                    state->vrsize);
+        }
+}
+
+/*-
+ * Mark the scroll screen SCRN of STATE as changed, once its format has
+ * been modified in place, so that vdp2cycp_update() calculates its
+ * bit-maps and access timings again.
+ */
+void
+state_scrn_dirty(struct state *state, uint8_t scrn)
+{
+        if ((state == NULL) || (scrn >= SCRN_COUNT)) {
+                return;
+        }
+
+        state->dirty |= 1 << scrn;
+}
+
+/*-
+ * Set the VRAM size of STATE to that of VRSIZE, either 4-Mbit, or 8-Mbit
+ * when VRSIZE_VRAMSZ is set, and calculate the bank bit-maps of every
+ * scroll screen again, as the banks are twice as large in 8-Mbit VRAM.
+ *
+ * The cycle patterns of STATE no longer hold a solution.
+ */
+void
+state_vrsize_set(struct state *state, uint16_t vrsize)
+{
+        if (state == NULL) {
+                return;
+        }
+
+        state->vrsize = vrsize;
+        state->solved = false;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                (void)scroll_screen_demands_calculate(state->scroll_screens[scrn],
+                    state->tvmd, state->vrsize);
+        }
+}
+
+/*-
+ * Calculate the number of access timings and the bank bit-maps of each
+ * kind of read of the scroll screen SCROLL_SCREEN from its format, in
+ * the TV screen mode TVMD, and with the VRAM size VRSIZE. The kinds of
+ * data stored beyond the end of VRAM are marked.
+ *
+ * The value cycp_calculate_timings() returns is returned.
+ */
+static int32_t
+scroll_screen_demands_calculate(struct scroll_screen *scroll_screen, uint16_t tvmd,
+    uint16_t vrsize)
+{
+        const struct scrn_format *format;
+        format = &scroll_screen->format;
+
+        scroll_screen->vram_exceeded = 0x00;
+
+        if (((vcs_bitmap_calculate(format, vrsize, &scroll_screen->vcs_bitmap)) == -3) ||
+            ((coefficient_bitmap_calculate(format, vrsize,
+                    &scroll_screen->coefficient_bitmap)) == -3)) {
+                scroll_screen->vram_exceeded |= 1 << CYCP_DEMAND_VCS;
+        }
+
+        if ((pnd_bitmap_calculate(format, vrsize, &scroll_screen->pnd_bitmap)) == -3) {
+                scroll_screen->vram_exceeded |= 1 << CYCP_DEMAND_PND;
+        }
+
+        if ((cpd_bitmap_calculate(format, vrsize, &scroll_screen->cpd_bitmap)) == -3) {
+                scroll_screen->vram_exceeded |= 1 << CYCP_DEMAND_CPD;
+        }
+
+        scroll_screen->tvcs = 0;
+        scroll_screen->tpnd = 0;
+        scroll_screen->tcpd = 0;
+
+        if (!scroll_screen->format.sf_enable) {
+                return 0;
         }
+
+        return cycp_calculate_timings_tvmd(&scroll_screen->format, tvmd,
+            &scroll_screen->tvcs, &scroll_screen->tpnd, &scroll_screen->tcpd);
 }
 
 /*-
  * Calculate an 8-bit bit-map PND_BITMAP of where pattern name data is
- * stored amongst the 4 banks.
+ * stored amongst the 4 banks of VRAM of size VRSIZE.
  *
  * If succesful, 0 is returned. Otherwise, a negative value is returned
  * for the following cases:
  *
  *   - -1 PND_BITMAP is NULL
  *   - -2 FORMAT is NULL
+ *   - -3 A plane is stored beyond the end of VRAM
  */
 static int
-pnd_bitmap_calculate(const struct scrn_format *format, uint8_t *pnd_bitmap)
+pnd_bitmap_calculate(const struct scrn_format *format, uint16_t vrsize, uint8_t *pnd_bitmap)
 {
-#define BANK_BIT(b) (1 << (4 - (b) - 1))
-
         if (pnd_bitmap == NULL) {
                 return -1;
         }
@@ -428,26 +4527,36 @@ pnd_bitmap_calculate(const struct scrn_format *format, uint8_t *pnd_bitmap)
         const struct scrn_cell_format *cell_format;
         cell_format = &format->sf_format.cell;
 
+        int ret;
+        ret = 0;
+
         int32_t plane_count;
         plane_count = scrn_plane_count_get(format);
 
         int32_t i;
         for (i = 0; i < plane_count; i++) {
-                /* XXX: 4 or 8-Mbit? */
+                /* Not every plane of RBG0 and RBG1 need be given */
+                if (!VRAM_BANK_ADDRESS(cell_format->scf_map.planes[i])) {
+                        continue;
+                }
+
+                if (VRAM_OFFSET(cell_format->scf_map.planes[i]) >= VRAM_SIZE(vrsize)) {
+                        ret = -3;
+                        continue;
+                }
+
                 uint8_t bank;
-                bank = VRAM_BANK_4MBIT(cell_format->scf_map.planes[i]);
+                bank = VRAM_BANK(vrsize, cell_format->scf_map.planes[i]);
 
-                *pnd_bitmap |= BANK_BIT(bank);
+                *pnd_bitmap |= VRAM_BANK_BIT(bank);
 
-                DEBUG_PRINTF("p: 0x%08X, %i, BANK_BIT(bank): 0x%02X\n",
+                DEBUG_PRINTF("p: 0x%08X, %i, VRAM_BANK_BIT(bank): 0x%02X\n",
                     cell_format->scf_map.planes[i],
                     bank,
-                    BANK_BIT(bank));
+                    VRAM_BANK_BIT(bank));
         }
 
-        return 0;
-
-#undef BANK_BIT
+        return ret;
 }
 
 /*-
@@ -630,7 +4739,8 @@ pnd_bitmap_validate(uint8_t bank_config, uint8_t pnd_bitmap)
 }
 
 /*-
- * Validate the pattern name bit-map of all configured scroll screens.
+ * Validate the pattern name bit-map of all configured NBGs. The pattern
+ * name data of the rotational backgrounds is read from banks of its own.
  *
  * If succesful, 0 is returned. Otherwise, a negative value is returned
  * for the following cases:
@@ -649,7 +4759,7 @@ pnd_bitmap_validate_all(const struct state *state)
         pnd_bitmap = 0x00;
 
         uint32_t scrn;
-        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+        for (scrn = 0; scrn < ALLOC_SCRN_COUNT; scrn++) {
                 struct scroll_screen *scroll_screen;
                 scroll_screen = state->scroll_screens[scrn];
 
@@ -672,18 +4782,118 @@ pnd_bitmap_validate_all(const struct state *state)
         return pnd_bitmap_validate(bank_config, pnd_bitmap);
 }
 
+/*-
+ * Calculate an 8-bit bit-map CPD_BITMAP of where character pattern data
+ * is stored amongst the 4 banks of VRAM of size VRSIZE.
+ *
+ * Every bank the table spans is considered. As the cell format does not
+ * give the size of its character pattern table, the table is taken to
+ * hold CYCP_CP_TABLE_CELL_COUNT cells, up to the end of VRAM.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 CPD_BITMAP is NULL
+ *   - -2 FORMAT is NULL
+ *   - -3 Character pattern data is stored beyond the end of VRAM, where
+ *        the banks of the part within VRAM are still written
+ */
+static int32_t
+cpd_bitmap_calculate(const struct scrn_format *format, uint16_t vrsize, uint8_t *cpd_bitmap)
+{
+        /* Number of bits per dot for each character color count */
+        static const uint8_t cc_count_bpp[] = {
+                4,      /* 16 (palette) */
+                8,      /* 256 (palette) */
+                16,     /* 2048 (palette) */
+                16,     /* 32,768 (RGB) */
+                32      /* 16,770,000 (RGB) */
+        };
+
+        if (cpd_bitmap == NULL) {
+                return -1;
+        }
+
+        *cpd_bitmap = 0x00;
+
+        if (format == NULL) {
+                return -2;
+        }
+
+        if (!format->sf_enable) {
+                return 0;
+        }
+
+        uint32_t first;
+        uint32_t last;
+
+        switch (format->sf_type) {
+        case SCRN_TYPE_CELL: {
+                const struct scrn_cell_format *cell_format;
+                cell_format = &format->sf_format.cell;
+
+                uint32_t size;
+                size = (CYCP_CP_TABLE_CELL_COUNT * 8 * 8 *
+                    cc_count_bpp[format->sf_cc_count]) >> 3;
+
+                first = VRAM_OFFSET(cell_format->scf_cp_table);
+                last = first + size - 1;
+
+                if ((first < VRAM_SIZE(vrsize)) && (last >= VRAM_SIZE(vrsize))) {
+                        last = VRAM_SIZE(vrsize) - 1;
+                }
+        } break;
+        case SCRN_TYPE_BITMAP: {
+                const struct scrn_bitmap_format *bitmap_format;
+                bitmap_format = &format->sf_format.bitmap;
+
+                uint32_t size;
+                size = (bitmap_format->sbf_bitmap_size.width *
+                    bitmap_format->sbf_bitmap_size.height *
+                    cc_count_bpp[format->sf_cc_count]) >> 3;
+
+                first = VRAM_OFFSET(bitmap_format->sbf_bitmap_pattern);
+                last = first;
+
+                if (size > 0) {
+                        last = first + size - 1;
+                }
+        } break;
+        default:
+                return 0;
+        }
+
+        uint32_t vram_size;
+        vram_size = VRAM_SIZE(vrsize);
+
+        if (first >= vram_size) {
+                return -3;
+        }
+
+        uint32_t last_bank;
+        last_bank = VRAM_BANK(vrsize, (last < vram_size) ? last : (vram_size - 1));
+
+        uint32_t bank;
+        for (bank = VRAM_BANK(vrsize, first); bank <= last_bank; bank++) {
+                *cpd_bitmap |= VRAM_BANK_BIT(bank);
+        }
+
+        return (last < vram_size) ? 0 : -3;
+}
+
 /*-
  * Calculate an 8-bit bit-map VCS_BITMAP of where vertical cell scroll
- * data is stored amongst the 4 banks.
+ * data is stored amongst the 4 banks of VRAM of size VRSIZE.
  *
  * If succesful, 0 is returned. Otherwise, a negative value is returned
  * for the following cases:
  *
  *   - -1 VCS_BITMAP is NULL
  *   - -2 FORMAT is NULL
+ *   - -3 Vertical cell scroll data is stored beyond the end of VRAM
  */
 static int
-vcs_bitmap_calculate(const struct scrn_format *format, uint8_t *vcs_bitmap)
+vcs_bitmap_calculate(const struct scrn_format *format, uint16_t vrsize, uint8_t *vcs_bitmap)
 {
         if (vcs_bitmap == NULL) {
                 return -1;
@@ -703,7 +4913,18 @@ vcs_bitmap_calculate(const struct scrn_format *format, uint8_t *vcs_bitmap)
                 return 0;
         }
 
-        *vcs_bitmap = VRAM_BANK_4MBIT(format->sf_vcs_table);
+        if (!VRAM_BANK_ADDRESS(format->sf_vcs_table)) {
+                return 0;
+        }
+
+        if (VRAM_OFFSET(format->sf_vcs_table) >= VRAM_SIZE(vrsize)) {
+                return -3;
+        }
+
+        uint8_t bank;
+        bank = VRAM_BANK(vrsize, format->sf_vcs_table);
+
+        *vcs_bitmap = VRAM_BANK_BIT(bank);
 
         return 0;
 }
@@ -724,17 +4945,117 @@ vcs_bitmap_validate_all(const struct state *state)
                 return -1;
         }
 
-        const uint8_t *vcs_bitmap_nbg0;
-        vcs_bitmap_nbg0 = &state->nbg0.vcs_bitmap;
+        return vcs_bitmap_validate(state->ramctl, state->nbg0.vcs_bitmap,
+            state->nbg1.vcs_bitmap);
+}
+
+static int32_t
+vcs_bitmap_validate(uint16_t ramctl, uint8_t vcs_bitmap_nbg0, uint8_t vcs_bitmap_nbg1)
+{
+        /* Only one of NBG0 or NBG1 uses vertical cell scroll */
+        if ((vcs_bitmap_nbg0 == 0x00) || (vcs_bitmap_nbg1 == 0x00)) {
+                return 0;
+        }
+
+        /* Access for NBG0 and NBG1 must be by the same bank */
+        uint8_t vcs_bitmap_nbg0_merged;
+        vcs_bitmap_nbg0_merged = bank_bitmap_merge(ramctl, vcs_bitmap_nbg0);
+        uint8_t vcs_bitmap_nbg1_merged;
+        vcs_bitmap_nbg1_merged = bank_bitmap_merge(ramctl, vcs_bitmap_nbg1);
+
+        return (vcs_bitmap_nbg0_merged == vcs_bitmap_nbg1_merged) ? 0 : -2;
+}
+
+/*-
+ * Validate that the data of every enabled scroll screen of STATE is
+ * stored within VRAM, of the size of its VRSIZE. If DEMANDS is not NULL,
+ * the bit-map of the demands whose data is stored beyond the end of VRAM
+ * is written to it.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 Data is stored beyond the end of VRAM
+ */
+static int32_t
+vram_bounds_validate_all(const struct state *state, uint32_t *demands)
+{
+        uint32_t exceeded;
+        exceeded = 0;
+
+        uint32_t scrn;
+        for (scrn = 0; scrn < SCRN_COUNT; scrn++) {
+                const struct scroll_screen *scroll_screen;
+                scroll_screen = state->scroll_screens[scrn];
+
+                if (!scroll_screen->format.sf_enable) {
+                        continue;
+                }
+
+                uint32_t kind;
+                for (kind = 0; kind < CYCP_DEMAND_COUNT; kind++) {
+                        if ((scroll_screen->vram_exceeded & (1 << kind)) != 0x00) {
+                                exceeded |= CYCP_DEMAND_BIT(scrn, kind);
+                        }
+                }
+        }
+
+        if (demands != NULL) {
+                *demands = exceeded;
+        }
+
+        return (exceeded != 0) ? -1 : 0;
+}
+
+/*-
+ * Calculate an 8-bit bit-map COEFFICIENT_BITMAP of where the coefficient
+ * table of a rotational background is stored amongst the 4 banks of VRAM
+ * of size VRSIZE. A coefficient table in color RAM is stored in no bank.
+ *
+ * If succesful, 0 is returned. Otherwise, a negative value is returned
+ * for the following cases:
+ *
+ *   - -1 COEFFICIENT_BITMAP is NULL
+ *   - -2 FORMAT is NULL
+ *   - -3 The coefficient table is stored beyond the end of VRAM
+ */
+static int32_t
+coefficient_bitmap_calculate(const struct scrn_format *format, uint16_t vrsize,
+    uint8_t *coefficient_bitmap)
+{
+        if (coefficient_bitmap == NULL) {
+                return -1;
+        }
+
+        *coefficient_bitmap = 0x00;
+
+        if (format == NULL) {
+                return -2;
+        }
+
+        if (!format->sf_enable) {
+                return 0;
+        }
 
-        const uint8_t *vcs_bitmap_nbg1;
-        vcs_bitmap_nbg1 = &state->nbg1.vcs_bitmap;
+        if ((format->sf_scroll_screen != SCRN_RBG0) &&
+            (format->sf_scroll_screen != SCRN_RBG1)) {
+                return 0;
+        }
 
-        if ((*vcs_bitmap_nbg0 == 0x00) && (*vcs_bitmap_nbg1 == 0x00)) {
+        if (!VRAM_BANK_ADDRESS(format->sf_coefficient_table)) {
                 return 0;
         }
 
-        return ((*vcs_bitmap_nbg0 & *vcs_bitmap_nbg1) != 0x00) ? 0 : -2;
+        if (VRAM_OFFSET(format->sf_coefficient_table) >= VRAM_SIZE(vrsize)) {
+                return -3;
+        }
+
+        uint8_t bank;
+        bank = VRAM_BANK(vrsize, format->sf_coefficient_table);
+
+        *coefficient_bitmap = VRAM_BANK_BIT(bank);
+
+        return 0;
 }
 
 /*-
@@ -770,3 +5091,21 @@ scrn_plane_count_get(const struct scrn_format *format)
 
         return -1;
 }
+
+/*-
+ * Return the time in nanoseconds if STATS is not NULL, so that the clock
+ * is only read when statistics are collected.
+ */
+static uint64_t
+stats_clock(const struct cycp_stats *stats)
+{
+        if (stats == NULL) {
+                return 0;
+        }
+
+        struct timespec ts;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
@@ -8,19 +8,42 @@
 #ifndef VDP2CYCP_H_
 #define VDP2CYCP_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 #include "vdp2.h"
 
+/* Number of cells the character pattern table of a cell format is taken
+ * to hold, as the format does not give its size */
+#define CYCP_CP_TABLE_CELL_COUNT        1024
+
 struct state {
         uint16_t ramctl;
+        /* TV screen mode (TVMD), normal mode by default */
+        uint16_t tvmd;
+        /* VRAM size (VRSIZE), 4-Mbit by default, as set by
+         * state_vrsize_set() */
+        uint16_t vrsize;
         union vram_cycp vram_cycp;
 
         struct scroll_screen {
                 struct scrn_format format;
                 uint8_t pnd_bitmap;
+                uint8_t cpd_bitmap;
                 uint8_t vcs_bitmap;
+                /* Bank bit-map of the coefficient table, of RBG0 and
+                 * RBG1 only */
+                uint8_t coefficient_bitmap;
+                /* Bit-map of the kinds of data (CYCP_DEMAND_VCS,
+                 * CYCP_DEMAND_PND, or CYCP_DEMAND_CPD) stored beyond the
+                 * end of VRAM, where the coefficient table is of the
+                 * vertical cell scroll kind */
+                uint8_t vram_exceeded;
+                /* Number of access timings required, if enabled */
+                uint8_t tvcs;
+                uint8_t tpnd;
+                uint8_t tcpd;
         };
 
         struct scroll_screen nbg0;
@@ -31,8 +54,233 @@ struct state {
         struct scroll_screen rbg1;
 
         struct scroll_screen *scroll_screens[SCRN_COUNT];
+
+        /* Bit-map of scroll screens changed since the cycle patterns were
+         * calculated, as marked by state_scrn_dirty() */
+        uint8_t dirty;
+        /* The cycle patterns hold a solution */
+        bool solved;
+};
+
+/*-
+ * Structure of arrays describing COUNT configurations of the NBGs, and
+ * of the rotational backgrounds. Each array holds one element per
+ * configuration.
+ *
+ * The number of access timings required for each kind of read is given,
+ * as calculated by cycp_calculate_timings(), along with the bank bit-map
+ * of the data, and the bit-map of the kinds of data stored beyond the
+ * end of VRAM, as found in struct scroll_screen. An NBG is disabled in a
+ * configuration when each of its counts is zero, or in every
+ * configuration when its TCPD array is NULL. The TVCS and
+ * VCS_BITMAP arrays are NULL when vertical cell scroll is not used, and
+ * the VRAM_EXCEEDED arrays are NULL when no data is stored beyond the
+ * end of VRAM.
+ *
+ * A rotational background is disabled in a configuration when its
+ * character pattern data bit-map is zero, or in every configuration when
+ * its CPD_BITMAP array is NULL. Its RP_MODE and COEFFICIENT_TABLE arrays
+ * are NULL when it doesn't swap rotation parameters via coefficient
+ * data.
+ */
+struct cycp_batch {
+        size_t count;
+
+        const uint16_t *ramctl;
+        /* TV screen mode of each configuration, or normal mode if
+         * NULL */
+        const uint16_t *tvmd;
+
+        struct cycp_batch_scrn {
+                const uint8_t *tvcs;
+                const uint8_t *tpnd;
+                const uint8_t *tcpd;
+
+                const uint8_t *vcs_bitmap;
+                const uint8_t *pnd_bitmap;
+                const uint8_t *cpd_bitmap;
+
+                const uint8_t *vram_exceeded;
+        } scrns[4];
+
+        struct cycp_batch_rbg {
+                /* Rotation parameter mode, and coefficient table
+                 * address, of the format */
+                const uint8_t *rp_mode;
+                const uint32_t *coefficient_table;
+
+                const uint8_t *coefficient_bitmap;
+                const uint8_t *pnd_bitmap;
+                const uint8_t *cpd_bitmap;
+
+                const uint8_t *vram_exceeded;
+        } rbgs[2];
+
+        /* Cycle patterns and result of each configuration */
+        union vram_cycp *vram_cycp;
+        int32_t *results;
+        /* RAMCTL each configuration is solved with, as vdp2cycp()
+         * leaves it in the state, or NULL if not needed */
+        uint16_t *ramctl_solved;
+};
+
+#define CYCP_PRUNE_RANGE        0 /* Too few free access timings in the range of the items of a bank */
+#define CYCP_PRUNE_BANK         1 /* Too few free access timings in a bank */
+#define CYCP_PRUNE_PND_BANK     2 /* Pattern name data stored in an invalid bank */
+#define CYCP_PRUNE_VCS_BANK     3 /* Vertical cell scroll stored in an invalid bank */
+#define CYCP_PRUNE_COUNT        4
+
+#define CYCP_PHASE_VALIDATE     0 /* Validation of the banks data is stored in */
+#define CYCP_PHASE_TIMINGS      1 /* Calculation of the access timings required */
+#define CYCP_PHASE_SEARCH       2 /* Allocation of the access timings */
+#define CYCP_PHASE_COUNT        3
+
+/*-
+ * Statistics of a single call to vdp2cycp_stats().
+ */
+struct cycp_stats {
+        /* Number of nodes of the allocation search visited */
+        uint64_t node_count;
+        /* Number of branches (or whole configurations) pruned, per
+         * reason */
+        uint64_t prune_counts[CYCP_PRUNE_COUNT];
+        /* Time spent per phase, in nanoseconds */
+        uint64_t phase_ns[CYCP_PHASE_COUNT];
+        /* Number of access timings allocated per bank */
+        uint8_t slot_counts[VRAM_BANK_COUNT];
 };
 
-int32_t vdp2cycp(const struct state *);
+#define CYCP_DEMAND_VCS         0 /* Vertical cell scroll table data read */
+#define CYCP_DEMAND_PND         1 /* Pattern name data read */
+#define CYCP_DEMAND_CPD         2 /* Character pattern data read */
+#define CYCP_DEMAND_COUNT       3
+
+/* Bit of the demand of kind KIND of scroll screen SCRN in a bit-map of
+ * demands */
+#define CYCP_DEMAND_BIT(scrn, kind)                                            \
+        (UINT32_C(1) << (((scrn) * CYCP_DEMAND_COUNT) + (kind)))
+
+/*-
+ * Explanation of why the cycle patterns of a state can't be calculated,
+ * as found by vdp2cycp_explain().
+ */
+struct cycp_explain {
+        /* Value vdp2cycp() returns for the demands below alone */
+        int32_t error;
+        /* Bit-map of the demands in conflict, where removing any one of
+         * them resolves the conflict */
+        uint32_t demands;
+        /* Bit-map of the banks the demands need */
+        uint8_t bank_bitmap;
+        /* Bit-map of the access timings the demands may be allocated
+         * to, and the most access timings they require from any one of
+         * the banks, if the conflict is over access timings */
+        uint8_t timings;
+        uint8_t required;
+        /* If the conflict is over the range of character pattern data
+         * left by the pattern name data access timings of the same
+         * scroll screen, the number of those access timings. TIMINGS
+         * is then the widest range they leave, and REQUIRED the number
+         * of character pattern data access timings */
+        uint8_t pnd_count;
+};
+
+/*-
+ * Ranges of access timings of a TV screen mode, as calculated by
+ * cycp_calculate_ranges().
+ */
+struct cycp_ranges {
+        /* Bit-map of access timings available */
+        uint8_t timings;
+        /* Range of character pattern data access timings permitted by
+         * each pattern name data access timing */
+        uint8_t pnd[8];
+        /* Range of NBG0 and NBG1 vertical cell scroll access timings,
+         * where NBG1 access must follow that of NBG0 */
+        uint8_t vcs[2];
+};
+
+/*-
+ * Objective of vdp2cycp_optimize(): the access timings left open to the
+ * CPU, weighted per bank, compared across VRAM partitionings.
+ */
+struct cycp_objective {
+        /* Weight of each access timing of each bank left open to the
+         * CPU */
+        uint8_t weights[VRAM_BANK_COUNT];
+        /* The partitioning of VRAM-A and VRAM-B in RAMCTL may be
+         * changed */
+        bool partition;
+};
+
+/*-
+ * VRAM reads of a cycle pattern over a frame, as approximated by
+ * vdp2cycp_simulate().
+ *
+ * The access timings of a bank in use are counted for a single cell, as
+ * either a read of data a scroll screen displays, an invalid read, an
+ * access timing open to the CPU, or no access, and each count is then
+ * multiplied by the number of cells of the display area of a frame.
+ */
+struct cycp_sim {
+        /* Number of dots of a scanline, and of scanlines of a frame */
+        uint16_t dot_count;
+        uint16_t line_count;
+
+        struct cycp_sim_bank {
+                /* Number of access timings over a frame, or zero if the
+                 * bank is not in use */
+                uint32_t timing_count;
+                /* Reads of data a scroll screen displays */
+                uint32_t fetch_count;
+                /* Reads that can't be displayed: reads of data not
+                 * stored in the bank, of a disabled scroll screen, in
+                 * excess of those required, of character pattern data
+                 * before its pattern name data is read, or reserved
+                 * access codes */
+                uint32_t invalid_count;
+                uint32_t cpu_count;
+                /* Reads a scroll screen required from the bank but was
+                 * not given */
+                uint32_t stall_count;
+                /* Access timings spent on reads a scroll screen displays,
+                 * per mille */
+                uint16_t utilization;
+        } banks[VRAM_BANK_COUNT];
+
+        /* Reads each scroll screen was not given, per CYCP_DEMAND_*
+         * kind */
+        uint32_t stalls[SCRN_COUNT][CYCP_DEMAND_COUNT];
+};
+
+/*-
+ * Entry points of libvdp2cycp. None allocates memory on the heap, and
+ * each is reentrant: any number of threads may each solve a state of
+ * their own at the same time.
+ */
+void state_init(struct state *, const struct scrn_format **);
+void state_scrn_dirty(struct state *, uint8_t);
+void state_vrsize_set(struct state *, uint16_t);
+
+int32_t vdp2cycp(struct state *);
+int32_t vdp2cycp_stats(struct state *, struct cycp_stats *);
+int32_t vdp2cycp_update(struct state *);
+int32_t vdp2cycp_optimize(struct state *, const struct cycp_objective *);
+int32_t vdp2cycp_registers(struct state *, uint8_t *);
+int32_t vdp2cycp_registers_bulk(struct state *, size_t, uint8_t *, int32_t *);
+int32_t vdp2cycp_batch(const struct cycp_batch *);
+int32_t vdp2cycp_explain(const struct state *, struct cycp_explain *);
+int32_t vdp2cycp_explain_format(const struct state *, const struct cycp_explain *, char *, size_t);
+int32_t vdp2cycp_validate(const struct state *, const union vram_cycp *, size_t, int8_t *);
+int32_t vdp2cycp_simulate(const struct state *, const union vram_cycp *, size_t,
+    struct cycp_sim *);
+int32_t cycp_calculate_timings(const struct scrn_format *, uint8_t *, uint8_t *, uint8_t *);
+int32_t cycp_calculate_timings_tvmd(const struct scrn_format *, uint16_t, uint8_t *, uint8_t *,
+    uint8_t *);
+void cycp_calculate_ranges(uint16_t, struct cycp_ranges *);
+
+uint32_t vram_cycp_free_count(uint16_t, const union vram_cycp *);
+void vram_cycp_registers_get(uint16_t, const union vram_cycp *, uint16_t *);
+void vram_cycp_registers_write(uint16_t, const union vram_cycp *, uint8_t *);
 
 #endif /* !VDP2CYCP_H_ */